@@ -22,11 +22,41 @@
  * 
  */
 
+// Required for MAP_ANONYMOUS and other non-POSIX extensions on Linux
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
 #include <stdarg.h>
+#include <stddef.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <dirent.h>
+#include <time.h>
+#include <sched.h>
+#include <dlfcn.h>
+
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#if defined(__linux__) && defined(__x86_64__)
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <linux/audit.h>
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+#endif
 
 #include <math.h>
+#include <limits.h>
+
+// Use POSIX per-process timers if available
+#if defined(_POSIX_TIMERS) && ( _POSIX_TIMERS > 0 ) && defined(SIGEV_SIGNAL)
+#define _EVAL_POSIX_TIMERS 1
+#endif
+#include <ctype.h>
 
 /**
  * Undefine the replacement macros defined in eval.h so we may call the base
@@ -83,6 +113,9 @@ int question_setgrade( question_t questions[], char key[], float grade ) {
     int idx = question_find( questions, key );
     if ( idx >= 0 ) {
         questions[idx].grade = grade;
+        eval_results_setgrade( key, grade );
+        _eval_report_grade( key, grade );
+        _eval_runner_grade( key, grade );
     } else {
         fprintf(stderr,"(*error*) Bad key: %s\n", key );
     }
@@ -90,17 +123,57 @@ int question_setgrade( question_t questions[], char key[], float grade ) {
 }
 
 /**
- * @brief Print a detailed list of keys, questions and grades
+ * @brief Prints the header of a question list
+ * 
+ * Used by question_list() and eval_questions_list()
  * 
- * @param questions     Question list
  * @param msg           Message to print before the list
- * @return int          Number of questions in the list
  */
-int question_list( question_t questions[], char* msg ) {
+static void _eval_question_list_head( char *msg ) {
     if ( msg ) printf("\n\033[1m[%s]\033[0m\n", msg);
 
     printf("\nQuestion list:\n");
     printf("--------------\n");
+}
+
+/**
+ * @brief Prints a question list entry
+ * 
+ * @param key           Question key
+ * @param grade         Question grade
+ * @param text          Question text
+ */
+static void _eval_question_list_item( const char key[], float grade, const char text[] ) {
+    printf("%-7s [%4.2f] - %s\n", key, grade, text );
+}
+
+/**
+ * @brief Prints the total number of questions and score of a question list
+ * 
+ * @param n             Number of questions
+ * @param total         Total score
+ * @param max           Maximum score
+ */
+static void _eval_question_list_total( int n, double total, double max ) {
+    printf("\nTotal number of questions: %d\n", n);
+    if ( n > 0 ) {
+        if ( round(total) == round(max) ) {
+            printf("\033[1;32m[✔]\033[0m Total score: %g/%g\n", total, max);
+        } else {
+            printf("\033[1;31m[✗]\033[0m Total score: %g/%g\n", total, max);
+        }
+    }
+}
+
+/**
+ * @brief Print a detailed list of keys, questions and grades
+ * 
+ * @param questions     Question list
+ * @param msg           Message to print before the list
+ * @return int          Number of questions in the list
+ */
+int question_list( question_t questions[], char* msg ) {
+    _eval_question_list_head( msg );
 
     double total = 0;
 
@@ -108,16 +181,9 @@ int question_list( question_t questions[], char* msg ) {
     for( i = 0; i < MAX_QUESTIONS; i++ ) {
         if ( ! strcmp( questions[i].key, "---" ) ) break;
         total += questions[i].grade;
-        printf("%-7s [%4.2f] - %s\n",questions[i].key, questions[i].grade, questions[i].text );
-    }
-    printf("\nTotal number of questions: %d\n", i);
-    if ( i > 0 ) {
-        if ( round(total) == i ) {
-            printf("\033[1;32m[✔]\033[0m Total score: %g/%d\n", total, i);
-        } else {
-            printf("\033[1;31m[✗]\033[0m Total score: %g/%d\n", total, i);
-        }
+        _eval_question_list_item( questions[i].key, questions[i].grade, questions[i].text );
     }
+    _eval_question_list_total( i, total, i );
     return i;
 }
 
@@ -132,3329 +198,12264 @@ int question_list( question_t questions[], char* msg ) {
 void question_export( question_t questions[], char msg[] ) {
     printf("\n%s:grade\n", msg );
 
-    if ( strncmp( questions[0].key, "---", 16 ) ) {
-        printf("%s:%4.2f",questions[0].key, questions[0].grade);
-        for( int i = 1; i < MAX_QUESTIONS; i++ ) {
-            if ( ! strcmp( questions[i].key, "---" ) ) break;
-            printf(",%s:%4.2f",questions[i].key, questions[i].grade);
-        }
+    for( int i = 0; i < MAX_QUESTIONS; i++ ) {
+        if ( ! strncmp( questions[i].key, "---", 16 ) ) break;
+        printf("%s%s:%4.2f", ( i > 0 ) ? "," : "", questions[i].key, questions[i].grade);
     }
 
     printf("\n%s:end\n", msg );
 }
 
-
-log_t _success_log;
-log_t _error_log;
-log_t _data_log;
-
-eval_stats_t _eval_stats;
+/******************************************************************************
+ * Question registry
+ *****************************************************************************/
 
 /**
- * initialize a log_t variable
- * @param log   Log variable to initialize
+ * @brief Hash value of a question key (FNV-1a)
+ * 
+ * @param key       Question key
+ * @return uint32_t Hash value
  */
-void initlog( log_t* log ) {
-    log -> start = -1;
-    log -> end = 0;
+static uint32_t _eval_questions_hash( const char key[] ) {
+    uint32_t h = 2166136261u;
+    for( int i = 0; i < 16 && key[i]; i++ ) {
+        h ^= (unsigned char) key[i];
+        h *= 16777619u;
+    }
+    return h;
 }
 
 /**
- * Returns a pointer to a new line in the log and updates internal pointers
- * @param log   Log variable
- * @return      char* to a new line
+ * @brief Rebuilds the hash index with the specified number of slots
+ * 
+ * @param table     Question registry
+ * @param nslots    Number of slots (power of 2)
+ * @return int      0 on success, -1 on error
  */
-char *newline( log_t* log ) {
-    char *line = NULL;
-    if ( log -> end < LOGSIZE ) {
-        line = log -> buffer[ log -> end ];
-        if ( log -> start < 0 ) log -> start = 0;
-        log -> end++;
-    } else {
-        eval_error( "No more space in logbuffer, aborting" );
-        eval_error( "Last message was: \"%s\"", log -> buffer[LOGSIZE-1]);
+static int _eval_questions_rehash( eval_questions_t *table, int nslots ) {
+    int *index = malloc( nslots * sizeof( int ) );
+    if ( index == NULL ) {
+        perror("eval_questions: Unable to grow question index");
+        return -1;
+    }
+    for( int i = 0; i < nslots; i++ ) index[i] = -1;
 
-        // Check if this happened inside an EVAL_CATCH macro
-        if ( _eval_env.catch ) {
-            siglongjmp( _eval_env.jmp, EVAL_CATCH_LOG_OVERFLOW );
-        } else {
-            exit(1);
-        }
+    for( int i = 0; i < table -> n; i++ ) {
+        uint32_t s = _eval_questions_hash( table -> list[i].key ) & ( nslots - 1 );
+        while( index[s] >= 0 ) s = ( s + 1 ) & ( nslots - 1 );
+        index[s] = i;
     }
-    return line;
+
+    free( table -> index );
+    table -> index = index;
+    table -> nslots = nslots;
+    return 0;
 }
 
 /**
- * Prints entire log
- * @param log   Log variable
+ * @brief Initializes a question registry
+ * 
+ * Questions loaded from a question list are all top level questions (even
+ * if the key of one is a prefix of another, e.g. "1" and "1.a"), so that the
+ * registry scores them just like the list.
+ * 
+ * @param table     Question registry
+ * @param questions Question list to load (terminated by a "---" key, at most
+ *                  MAX_QUESTIONS questions), may be NULL
+ * @return int      Number of questions loaded, -1 on error
  */
-void printlog( log_t* log ) {
-    if ( log -> start < 0 || log -> start >= log -> end ) {
-        printf("<empty>\n");
-    } else {
-        for( int i = log -> start, j = 0; i != log -> end; i++, j++ ) {
-            printf("%3d - %s\n", j, log -> buffer[i]);
+int eval_questions_init( eval_questions_t *table, const question_t questions[] ) {
+    memset( table, 0, sizeof( eval_questions_t ) );
+
+    if ( questions ) {
+        for( int i = 0; i < MAX_QUESTIONS && strncmp( questions[i].key, "---", 16 ); i++ ) {
+            int idx = eval_questions_add( table, questions[i].key, questions[i].text, 1.0 );
+            if ( idx < 0 ) {
+                eval_questions_free( table );
+                return -1;
+            }
+            table -> list[idx].grade = questions[i].grade;
+            table -> list[idx].parent = -1;
         }
     }
+    return table -> n;
 }
 
-
 /**
- * @brief Looks for the message specified by the format and optional arguments.
- * Returns the index position on success or -1 if not found.
+ * @brief Frees a question registry
  * 
- * @param log       Log
- * @param format    Format for message
- * @param ...       Optional message values
- * @return int      Position in log or -1 if not found
+ * @param table     Question registry
  */
-int findinlog( log_t* log, const char *restrict format, ... ) {
-    char msg[LOGLINE];
-
-    va_list ap;
-    va_start(ap, format);
-    vsnprintf(msg, LOGLINE-1, format, ap);
-    va_end(ap);
+void eval_questions_free( eval_questions_t *table ) {
+    free( table -> list );
+    free( table -> index );
+    memset( table, 0, sizeof( eval_questions_t ) );
+}
 
-    int idx = -1;
-    for( int i = log->start; i != log->end; i++ ) {
-        if ( !strncmp( msg, log->buffer[i], LOGLINE-1) ) {
-            idx = i;
-            break;
-        }
+/**
+ * @brief Finds a question in the registry
+ * 
+ * @param table     Question registry
+ * @param key       Question key
+ * @return int      Question index, -1 if not found
+ */
+int eval_questions_find( const eval_questions_t *table, const char key[] ) {
+    if ( table -> nslots == 0 ) return -1;
+
+    uint32_t s = _eval_questions_hash( key ) & ( table -> nslots - 1 );
+    int idx;
+    while( ( idx = table -> index[s] ) >= 0 ) {
+        if ( ! strncmp( table -> list[idx].key, key, 16 ) ) return idx;
+        s = ( s + 1 ) & ( table -> nslots - 1 );
     }
-    return idx;
+    return -1;
 }
 
 /**
- * Removes the head line from the log if it contains the supplied message
- * 
- * @param msg   Messagem to look for
- * @return      0 on success, -1 on error (empty log or msg not found)
+ * @brief Adds a question to the registry
+ * 
+ * The parent of the question is the registered question with the longest
+ * key that is a prefix of the new key, ending before a '.' (e.g. "3.2" or
+ * "3" for "3.2.a"), so parent questions must be added before their
+ * sub-items.
+ * 
+ * @param table     Question registry
+ * @param key       Question key (at most 15 characters)
+ * @param text      Question text
+ * @param weight    Weight of the question in the score of its parent / total
+ * @return int      Question index, -1 on error
  */
-int rmheadmsg( log_t* log, const char msg[] ) {
-    if ( log -> start < 0 ) return -1;
-    if ( strstr( log -> buffer[ log -> start], msg ) ) {
-        // Remove the line
-        log -> start ++;
-        return 0;
-    } else {
+int eval_questions_add( eval_questions_t *table, const char key[], const char text[], float weight ) {
+
+    if ( key == NULL || key[0] == 0 || strlen( key ) >= sizeof( table -> list[0].key ) ||
+         ! strcmp( key, "---" ) ) {
+        eval_error("(eval_questions_add) Invalid question key '%s'", key ? key : "(null)" );
+        return -1;
+    }
+
+    if ( eval_questions_find( table, key ) >= 0 ) {
+        eval_error("(eval_questions_add) Duplicate question key '%s'", key );
         return -1;
     }
+
+    if ( table -> n >= table -> size ) {
+        int size = ( table -> size > 0 ) ? 2 * table -> size : 64;
+        eval_question_t *list = realloc( table -> list, size * sizeof( eval_question_t ) );
+        if ( list == NULL ) {
+            perror("eval_questions_add: Unable to grow question list");
+            return -1;
+        }
+        table -> list = list;
+        table -> size = size;
+    }
+
+    // Keep the index at most half full
+    if ( 2 * ( table -> n + 1 ) > table -> nslots ) {
+        if ( _eval_questions_rehash( table, ( table -> nslots > 0 ) ? 2 * table -> nslots : 128 ) )
+            return -1;
+    }
+
+    int idx = table -> n++;
+    eval_question_t *q = &table -> list[idx];
+    memset( q, 0, sizeof( eval_question_t ) );
+    strcpy( q -> key, key );
+    if ( text ) {
+        strncpy( q -> text, text, sizeof( q -> text ) - 1 );
+    }
+    q -> weight = weight;
+    q -> parent = -1;
+
+    char prefix[ sizeof( q -> key ) ];
+    strcpy( prefix, key );
+    for( char *dot; q -> parent < 0 && ( dot = strrchr( prefix, '.' ) ) != NULL; ) {
+        *dot = 0;
+        q -> parent = eval_questions_find( table, prefix );
+    }
+
+    uint32_t s = _eval_questions_hash( key ) & ( table -> nslots - 1 );
+    while( table -> index[s] >= 0 ) s = ( s + 1 ) & ( table -> nslots - 1 );
+    table -> index[s] = idx;
+
+    return idx;
 }
 
 /**
- * Returns the string at the head of the log or "empty" if empty
+ * @brief Gets the text of a question
  * 
- * @param log   Log
- * @return      Pointer to string
+ * @param table     Question registry
+ * @param key       Question key
+ * @return          Question text, "<not found>" if key not found
  */
-const char* loghead( log_t* log ) {
-    static const char empty[] = "<empty>";
-    if ( log -> start < 0 ) return empty;
-    else return log -> buffer[log -> start];
+const char *eval_questions_text( const eval_questions_t *table, const char key[] ) {
+    int idx = eval_questions_find( table, key );
+    return ( idx < 0 ) ? "<not found>" : table -> list[idx].text;
 }
 
-
 /**
- * @brief Adds line into specified log
+ * @brief Sets the grade of a question
  * 
- * @param log       Pointer to log variable
- * @param format    Format modifier
- * @param ...       Values
- * @return int      Number of characters written
+ * @param table     Question registry
+ * @param key       Question key
+ * @param grade     New value of grade
+ * @param notify    Also store the grade in the shared result table,
+ *                  structured report and runner results
+ * @return int      Question index or -1 if key not found
  */
-int eval_log( log_t* log, const char *restrict format, ...) {
-    va_list ap;
-    va_start(ap, format);
-    int n = vsnprintf(newline( log ), LOGLINE, format, ap);
-    va_end(ap);
-    return n;
+static int _eval_questions_setgrade( eval_questions_t *table, const char key[], float grade, int notify ) {
+    int idx = eval_questions_find( table, key );
+    if ( idx >= 0 ) {
+        table -> list[idx].grade = grade;
+        if ( notify ) {
+            eval_results_setgrade( table -> list[idx].key, grade );
+            _eval_report_grade( key, grade );
+            _eval_runner_grade( key, grade );
+        }
+    } else {
+        fprintf(stderr,"(*error*) Bad key: %s\n", key );
+    }
+    return idx;
 }
 
 /**
- * @brief Adds line into datalog
+ * @brief Sets the grade of a question
  * 
- * @param format    Format modifier
- * @param ...       Values
- * @return int      Number of characters written
+ * As with question_setgrade(), the grade is also stored in the shared result
+ * table and structured report, if open, and forwarded to the parallel runner
+ * when called inside a test case worker.
+ * 
+ * @param table     Question registry
+ * @param key       Question key
+ * @param grade     New value of grade
+ * @return int      Question index or -1 if key not found
  */
-int datalog(const char *restrict format, ...) {
-    va_list ap;
-    va_start(ap, format);
-    int n = vsnprintf(newline( &_data_log ), LOGLINE, format, ap);
-    va_end(ap);
-    return n;
+int eval_questions_setgrade( eval_questions_t *table, const char key[], float grade ) {
+    return _eval_questions_setgrade( table, key, grade, 1 );
 }
 
 /**
- * @brief Adds line into datalog
+ * @brief Sets the grades of several questions
  * 
- * @param format    Format modifier
- * @param ...       Values
- * @return int      Number of characters written
+ * @param table     Question registry
+ * @param grades    Grade updates
+ * @param n         Number of grade updates
+ * @param notify    See _eval_questions_setgrade()
+ * @return int      Number of grades set (keys not found are skipped)
  */
-int errorlog(const char *restrict format, ...) {
-    va_list ap;
-    va_start(ap, format);
-    int n = vsnprintf(newline( &_error_log ), LOGLINE, format, ap);
-    va_end(ap);
-    return n;
+static int _eval_questions_update( eval_questions_t *table, const eval_grade_t grades[], int n, int notify ) {
+    int count = 0;
+    for( int i = 0; i < n; i++ )
+        if ( _eval_questions_setgrade( table, grades[i].key, grades[i].grade, notify ) >= 0 ) count++;
+    return count;
 }
 
 /**
- * @brief Adds line into successlog
+ * @brief Sets the grades of several questions
  * 
- * @param format    Format modifier
- * @param ...       Values
- * @return int      Number of characters written
+ * Equivalent to calling eval_questions_setgrade() for each update. The
+ * parallel runner applies the grades set by each test case through
+ * _eval_questions_update(), without storing / reporting them again, see
+ * _eval_runner.questions.
+ * 
+ * @param table     Question registry
+ * @param grades    Grade updates
+ * @param n         Number of grade updates
+ * @return int      Number of grades set (keys not found are skipped)
  */
-int successlog(const char *restrict format, ...) {
-    va_list ap;
-    va_start(ap, format);
-    int n = vsnprintf(newline( &_success_log ), LOGLINE, format, ap);
-    va_end(ap);
-    return n;
+int eval_questions_update( eval_questions_t *table, const eval_grade_t grades[], int n ) {
+    return _eval_questions_update( table, grades, n, 1 );
 }
 
 /**
- * @brief Checks if the supplied message (specified by format and optionally additional values)
- * is at the head of the success log.
+ * @brief Computes the question scores and the weighted total score
  * 
- * If true, removes head line and returns 0, otherwise issues an error message.
+ * The score of a question is its grade or, if it has sub-items, the weighted
+ * mean of the sub-item scores. Scores are stored in the .score field of each
+ * question. The total score is the weighted sum of the scores of the top
+ * level questions.
  * 
- * @param format    Format for message
- * @param ...       (optional) additional values
- * @return int      1 on success, 0 if message not found at head
+ * @param table     Question registry
+ * @param max       (out) Maximum total score (sum of the top level weights),
+ *                  may be NULL
+ * @return double   Total score
  */
-int eval_check_successlog( const char *restrict format, ...) {
-    char msg[LOGLINE];
+double eval_questions_total( eval_questions_t *table, double *max ) {
+    double total = 0, wtotal = 0;
 
-    va_list ap;
-    va_start(ap, format);
-    vsnprintf(msg, LOGLINE-1, format, ap);
-    va_end(ap);
-
-    const char *log_msg = loghead(&_success_log);
-    if ( rmheadmsg( &_success_log, msg ) ) {
-        eval_error( "Invalid success log message, expected '%s', got '%s'",
-            msg, log_msg );
+    double *acc = calloc( 2 * ( table -> n > 0 ? table -> n : 1 ), sizeof( double ) );
+    if ( acc == NULL ) {
+        perror("eval_questions_total: Unable to allocate memory");
+        if ( max ) *max = 0;
         return 0;
-    } else { 
-        eval_success( "Success log ok: '%s'", log_msg );
-        return 1;
     }
+    double *wacc = acc + table -> n;
+
+    // Sub-items are always registered after their parents
+    for( int i = table -> n - 1; i >= 0; i-- ) {
+        eval_question_t *q = &table -> list[i];
+        q -> score = ( wacc[i] > 0 ) ? acc[i] / wacc[i] : q -> grade;
+        if ( q -> parent >= 0 ) {
+            acc[ q -> parent ] += q -> weight * q -> score;
+            wacc[ q -> parent ] += q -> weight;
+        } else {
+            total += q -> weight * q -> score;
+            wtotal += q -> weight;
+        }
+    }
+    free( acc );
+
+    if ( max ) *max = wtotal;
+    return total;
 }
 
 /**
- * @brief Checks if the supplied message (specified by format and optionally additional values)
- * is at the head of the error log.
+ * @brief Print a detailed list of keys, questions and scores
  * 
- * If true, removes head line and returns 0, otherwise issues an error message.
+ * Uses the same format as question_list(). For questions with sub-items the
+ * score is printed instead of the grade, see eval_questions_total().
  * 
- * @param format    Format for message
- * @param ...       (optional) additional values
- * @return int      1 on success, 0 if message not found at head
+ * @param table     Question registry
+ * @param msg       Message to print before the list
+ * @return int      Number of questions in the registry
  */
-int eval_check_errorlog( const char *restrict format, ...) {
-    char msg[LOGLINE];
+int eval_questions_list( eval_questions_t *table, char *msg ) {
+    double max;
+    double total = eval_questions_total( table, &max );
+
+    _eval_question_list_head( msg );
+    for( int i = 0; i < table -> n; i++ ) {
+        eval_question_t *q = &table -> list[i];
+        _eval_question_list_item( q -> key, q -> score, q -> text );
+    }
+    _eval_question_list_total( table -> n, total, max );
+    return table -> n;
+}
 
-    va_list ap;
-    va_start(ap, format);
-    vsnprintf(msg, LOGLINE-1, format, ap);
-    va_end(ap);
+/**
+ * @brief Export question scores
+ * 
+ * Uses the same format as question_export(), see eval_questions_total()
+ * 
+ * @param table     Question registry
+ * @param msg       Message to print before / after the grades
+ */
+void eval_questions_export( eval_questions_t *table, char msg[] ) {
+    eval_questions_total( table, NULL );
 
-    const char *err_msg = loghead(&_error_log);
-    if ( rmheadmsg( &_error_log, msg ) ) {
-        eval_error( "Invalid error log message, expected '%s', got '%s'",
-            msg, err_msg );
-        return 0;
-    } else { 
-        eval_success( "Error log ok: '%s'", err_msg );
-        return 1;
+    printf("\n%s:grade\n", msg );
+    for( int i = 0; i < table -> n; i++ ) {
+        eval_question_t *q = &table -> list[i];
+        printf("%s%s:%4.2f", ( i > 0 ) ? "," : "", q -> key, q -> score );
     }
+    printf("\n%s:end\n", msg );
 }
 
+
+/******************************************************************************
+ * Shared result table
+ *****************************************************************************/
+
 /**
- * Clears both success and error logs
+ * @brief Result table shared between the parent process and all workers /
+ * forked tests
+ * 
  */
-void eval_clear_logs( void ) {
-    initlog( &_success_log );
-    initlog( &_error_log );
-    initlog( &_data_log );
-}
+static struct {
+    int nresults;
+    eval_result_t *results;
+} _eval_results;
 
 /**
- * Clears both success and error logs, and prints remaning messages if any
+ * @brief Opens the shared result table for the specified question list. This
+ * must be called before forking any workers (e.g. before eval_run_parallel())
+ * 
+ * Once the table is open question_setgrade() will also store the grade in the
+ * table.
+ * 
+ * @param questions     Question list
+ * @return int          Number of questions in the table, -1 on error
  */
-void eval_close_logs( char msg[] ) {
-    if ( _success_log.start >= 0 && _success_log.start < _success_log.end ) {
-        eval_info( "%s Remaining messages on success log", msg );
-        for( int i = _success_log.start; i != _success_log.end; i++ ) {
-            printf("%3d - %s\n", i, _success_log.buffer[i]);
-        }
-    } 
+int eval_results_open( question_t questions[] ) {
+    eval_results_close();
 
-    if ( _error_log.start >= 0 && _error_log.start < _error_log.end ) {
-        eval_info( "%s Remaining messages on error log", msg );
-        for( int i = _error_log.start; i != _error_log.end; i++ ) {
-            printf("%3d - %s\n", i, _error_log.buffer[i]);
-        }
-    } 
-    
-    eval_clear_logs( );
+    int n;
+    for( n = 0; n < MAX_QUESTIONS; n++ ) {
+        if ( ! strncmp( questions[n].key, "---", 16 ) ) break;
+    }
+
+    size_t bytes = ( n > 0 ? n : 1 ) * sizeof( eval_result_t );
+    eval_result_t *results = mmap( NULL, bytes, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_ANONYMOUS, -1, 0 );
+    if ( results == MAP_FAILED ) {
+        perror("eval_results_open: Unable to map shared result table");
+        return -1;
+    }
+
+    for( int i = 0; i < n; i++ ) {
+        strncpy( results[i].key, questions[i].key, sizeof( results[i].key ) );
+        results[i].key[ sizeof( results[i].key ) - 1 ] = 0;
+        results[i].grade = questions[i].grade;
+        results[i].test = -1;
+    }
+
+    _eval_results.nresults = n;
+    _eval_results.results = results;
+    return n;
 }
 
 /**
- * @brief Checks errors at section completion
+ * @brief Finds the result table entry for the specified key
  * 
- * @param msg   Message to print
- * @return int  Total of errors found
+ * @param key       Question key
+ * @return          Pointer to table entry, NULL if the table is not open or
+ *                  the key was not found
  */
-int eval_complete( char msg[] ) {
-    if ( _eval_stats.error > 0 ) {
-        printf("\033[1;31m[✗]\033[0m %s completed with %d error(s).\n", msg, _eval_stats.error );
-    } else {
-        printf("\033[1;32m[✔]\033[0m %s completed with no errors.\n", msg );
+static eval_result_t * _eval_results_find( const char key[] ) {
+    for( int i = 0; i < _eval_results.nresults; i++ ) {
+        if ( ! strncmp( _eval_results.results[i].key, key, 16 ) ) return &_eval_results.results[i];
     }
-    printf("\n");
-    return _eval_stats.error;
+    return NULL;
 }
 
 /**
- * @brief Prints error message and updates error counter
+ * @brief Sets the grade for a question in the shared result table, together
+ * with the termination status and timing of the last EVAL_CATCH* macro
  * 
- * @param format    Format modifier
- * @param ...       Values
- * @return int      Current number of errors
+ * Entries are updated atomically: concurrent writers are serialized and
+ * readers never see a partially written entry. An entry left locked by a
+ * writer that terminated while writing it is taken over once the writer
+ * process no longer exists.
+ * 
+ * @param key       Question key
+ * @param grade     New value of grade
+ * @return int      0 on success, -1 if the table is not open or the key was
+ *                  not found
  */
-int eval_error(const char *restrict format, ...) {
-    va_list ap;
-    size_t size = 0;
-    char *tmp = NULL;
-
-    va_start(ap, format);
-    int n = vsnprintf(tmp, size, format, ap);
-    va_end(ap);
-
-    // Allocate temporary buffer
-    size = (size_t) n + 1;
-    tmp = malloc( size );
-
-    // Print to buffer
-    va_start(ap, format);
-    vsnprintf(tmp, size, format, ap);
-    va_end(ap);
-
-    printf("\033[1;31m[✗]\033[0m %s\n", tmp );
-
-    free(tmp);
-
-    _eval_stats.error++;
+int eval_results_setgrade( char key[], float grade ) {
+    eval_result_t *r = _eval_results_find( key );
+    if ( r == NULL ) return -1;
+
+    // Acquire the entry by setting the owner. If the owner died while
+    // holding the entry (and only then), take it over after a while
+    const pid_t self = getpid();
+    for( int spin = 0; ; spin++ ) {
+        pid_t owner = 0;
+        if ( __atomic_compare_exchange_n( &r -> owner, &owner, self, 0,
+            __ATOMIC_ACQUIRE, __ATOMIC_RELAXED ) ) break;
+        if ( spin >= 100000 ) {
+            if ( owner != self && kill( owner, 0 ) < 0 && errno == ESRCH &&
+                 __atomic_compare_exchange_n( &r -> owner, &owner, self, 0,
+                    __ATOMIC_ACQUIRE, __ATOMIC_RELAXED ) ) break;
+            spin = 0;
+        }
+        sched_yield();
+    }
 
-    return _eval_stats.error;
+    // Mark the write in progress (even -> odd), unless a dead owner left
+    // the entry odd
+    unsigned seq = __atomic_load_n( &r -> seq, __ATOMIC_RELAXED );
+    if ( ! ( seq & 1 ) ) __atomic_store_n( &r -> seq, ++seq, __ATOMIC_RELAXED );
+    __atomic_thread_fence( __ATOMIC_RELEASE );
+
+    r -> grade = grade;
+    r -> set++;
+    r -> test = _eval_runner.current;
+    r -> stat = _eval_env.stat;
+    r -> cpu_time = _eval_env.cpu_time;
+    r -> wall_time = _eval_env.wall_time;
+    r -> pid = self;
+
+    __atomic_store_n( &r -> seq, seq + 1, __ATOMIC_RELEASE );
+    __atomic_store_n( &r -> owner, 0, __ATOMIC_RELEASE );
+    return 0;
 }
 
 /**
- * @brief Prints info message and updates the info counter
+ * @brief Gets a consistent copy of a result table entry
  * 
- * @param format    Format modifier
- * @param ...       Values
- * @return int      Current number of errors
+ * @param key       Question key
+ * @param result    Copy of the table entry
+ * @return int      0 on success, -1 if the table is not open, the key was not
+ *                  found, or the entry is stuck in an incomplete write
  */
-int eval_info(const char *restrict format, ...) {
-    va_list ap;
-    size_t size = 0;
-    char *tmp = NULL;
-
-    va_start(ap, format);
-    int n = vsnprintf(tmp, size, format, ap);
-    va_end(ap);
-
-    // Allocate temporary buffer
-    size = (size_t) n + 1;
-    tmp = malloc( size );
-
-    // Print to buffer
-    va_start(ap, format);
-    vsnprintf(tmp, size, format, ap);
-    va_end(ap);
-
-    printf("\033[1;34m[ℹ︎]\033[0m %s\n", tmp );
+int eval_results_get( char key[], eval_result_t *result ) {
+    eval_result_t *r = _eval_results_find( key );
+    if ( r == NULL ) return -1;
+
+    for( int spin = 0; spin < 100000; spin++ ) {
+        unsigned seq = __atomic_load_n( &r -> seq, __ATOMIC_ACQUIRE );
+        if ( ! ( seq & 1 ) ) {
+            memcpy( result, r, sizeof( eval_result_t ) );
+            __atomic_thread_fence( __ATOMIC_ACQUIRE );
+            if ( __atomic_load_n( &r -> seq, __ATOMIC_RELAXED ) == seq ) return 0;
+        }
+        sched_yield();
+    }
+    return -1;
+}
 
-    free(tmp);
+/**
+ * @brief Copies the grades stored in the shared result table back into the
+ * question list. Questions whose grade was never set are left unchanged.
+ * 
+ * @param questions     Question list
+ * @return int          Number of questions whose grade was set, -1 if the table
+ *                      is not open
+ */
+int eval_results_collect( question_t questions[] ) {
+    if ( _eval_results.results == NULL ) return -1;
 
-    _eval_stats.info++;
+    int count = 0;
+    for( int i = 0; i < MAX_QUESTIONS; i++ ) {
+        if ( ! strncmp( questions[i].key, "---", 16 ) ) break;
 
-    return _eval_stats.info;
+        eval_result_t r;
+        if ( eval_results_get( questions[i].key, &r ) == 0 && r.set > 0 ) {
+            questions[i].grade = r.grade;
+            count++;
+        }
+    }
+    return count;
 }
 
 /**
- * @brief Prints success message and updates info counter
+ * @brief Export the grades in the shared result table
  * 
- * @param format    Format modifier
- * @param ...       Values
- * @return int      Current number of errors
+ * Uses the same format as question_export(), followed by a line with the
+ * termination status and wall clock time for each question. Questions whose
+ * grade was never set are reported with status "unset"; entries that could
+ * not be read consistently are left out of the grades and reported with
+ * status "torn".
+ * 
+ * @param msg   Message to print before / after the grades
  */
-int eval_success(const char *restrict format, ...) {
-    va_list ap;
-    size_t size = 0;
-    char *tmp = NULL;
+void eval_results_export( char msg[] ) {
+    printf("\n%s:grade\n", msg );
+    int first = 1;
+    for( int i = 0; i < _eval_results.nresults; i++ ) {
+        eval_result_t r;
+        // Entries that cannot be read are skipped, and reported as "torn" below
+        if ( eval_results_get( _eval_results.results[i].key, &r ) ) continue;
+        printf( "%s%s:%4.2f", first ? "" : ",", _eval_results.results[i].key, r.grade );
+        first = 0;
+    }
+    printf("\n%s:status\n", msg );
+    for( int i = 0; i < _eval_results.nresults; i++ ) {
+        eval_result_t r;
+        char *key = _eval_results.results[i].key;
+        const char *sep = ( i > 0 ) ? "," : "";
+        if ( eval_results_get( key, &r ) ) {
+            printf( "%s%s:torn", sep, key );
+        } else if ( r.set == 0 ) {
+            printf( "%s%s:unset", sep, key );
+        } else {
+            printf( "%s%s:%d/%.3f", sep, key, r.stat, r.wall_time );
+        }
+    }
+    printf("\n%s:end\n", msg );
+}
 
-    va_start(ap, format);
-    int n = vsnprintf(tmp, size, format, ap);
-    va_end(ap);
+/**
+ * @brief Closes the shared result table
+ * 
+ */
+void eval_results_close( void ) {
+    if ( _eval_results.results ) {
+        size_t bytes = ( _eval_results.nresults > 0 ? _eval_results.nresults : 1 ) * sizeof( eval_result_t );
+        munmap( _eval_results.results, bytes );
+        _eval_results.results = NULL;
+        _eval_results.nresults = 0;
+    }
+}
 
-    // Allocate temporary buffer
-    size = (size_t) n + 1;
-    tmp = malloc( size );
 
-    // Print to buffer
-    va_start(ap, format);
-    vsnprintf(tmp, size, format, ap);
-    va_end(ap);
+log_t _success_log;
+log_t _error_log;
+log_t _data_log;
 
-    printf("\033[1;32m[✔]\033[0m %s\n", tmp );
+eval_stats_t _eval_stats;
 
-    free(tmp);
+/**
+ * @brief Bucket of the log line prefix index
+ * 
+ */
+typedef struct {
+    int *lines;         // Indices of lines in the bucket, in increasing order
+    int n;              // Number of line indices
+    int size;           // Size of lines
+    int head;           // First entry that may still be in the log
+} _eval_log_bucket_t;
 
-    _eval_stats.info++;
+/**
+ * @brief Log line prefix index
+ * 
+ * Lines are hashed on their prefix, i.e. the text up to the first ',', ' ',
+ * ':', '(', '=' or tab character (e.g. the function name in the data log
+ * lines written by the wrappers). Lines are added to the index by
+ * _eval_log_index_update(), before each query.
+ */
+struct _eval_log_index {
+    _eval_log_bucket_t bucket[ EVAL_LOG_BUCKETS ];
+};
 
-    return _eval_stats.info;
+/**
+ * @brief Checks if a character ends the prefix of a log line
+ * 
+ * @param c         Character to check
+ * @return int      1 if c is a prefix delimiter, 0 otherwise
+ */
+static int _eval_log_delim( char c ) {
+    return c == ',' || c == ' ' || c == ':' || c == '(' || c == '=' || c == '\t';
 }
 
 /**
- * @brief Variable holding stdin and stdout descriptors (previous and current)
+ * @brief Returns the length of the prefix of a log line
  * 
+ * @param line      Log line
+ * @return size_t   Prefix length
  */
-_eval_stdio_t _eval_stdio;
+static size_t _eval_log_prefix( const char *line ) {
+    size_t n = 0;
+    while( line[n] && ! _eval_log_delim( line[n] ) ) n++;
+    return n;
+}
 
 /**
- * @brief Redirects stdin and stdout to files
- *
- * Requires data in _eval_stdio
+ * @brief Returns the index bucket for a line prefix (FNV-1a hash)
  * 
- * @param stdin     File name for stdin. If set to NULL no redirection takes place
- * @param stdout    File name for stdout. If set to NULL no redirection takes place
- * @return int      0 on success
+ * @param prefix    Line prefix
+ * @param len       Prefix length
+ * @return unsigned Bucket number
  */
-int _eval_io_redirect( const char* _fstdin, const char* _fstdout ) {
+static unsigned _eval_log_hash( const char *prefix, size_t len ) {
+    uint32_t h = 2166136261u;
+    for( size_t i = 0; i < len; i++ ) {
+        h ^= (unsigned char) prefix[i];
+        h *= 16777619u;
+    }
+    return h % EVAL_LOG_BUCKETS;
+}
 
-    if ( _fstdin ) {
-        if ( (_eval_stdio.old_stdin = dup( STDIN_FILENO ))< 0 ) {
-            eval_error("Unable to duplicate STDIN_FILENO");
-            return -1;
+/**
+ * @brief Clears the line prefix index of a log, keeping allocated memory
+ * 
+ * @param log       Log variable
+ */
+static void _eval_log_index_clear( log_t* log ) {
+    if ( log -> index ) {
+        for( int i = 0; i < EVAL_LOG_BUCKETS; i++ ) {
+            log -> index -> bucket[i].n = 0;
+            log -> index -> bucket[i].head = 0;
         }
+    }
+    log -> indexed = 0;
+}
 
-        int new_stdin;
-        if ( (new_stdin = open( _fstdin, O_RDONLY )) < 0 ) {
-            eval_error("Unable to open file %s as read-only", _fstdin);
-            return -1;
-        }
-        if ( (dup2( new_stdin, STDIN_FILENO )) < 0 ) {
-            eval_error("Unable to associate file %s with stdin", _fstdin);
-            return -1;
-        };
+/**
+ * initialize a log_t variable
+ *
+ * Any memory already allocated for the log is kept for reuse
+ * 
+ * @param log   Log variable to initialize
+ */
+void initlog( log_t* log ) {
+    log -> first = 0;
+    log -> start = 0;
+    log -> end = 0;
+    _eval_log_index_clear( log );
+}
 
-        if ( close(new_stdin) < 0 ) {
-            eval_error("Unable to close fd %d", new_stdin );
-            return -1;
-        };
+/**
+ * @brief Frees all memory used by a log_t variable
+ * 
+ * @param log   Log variable
+ */
+void freelog( log_t* log ) {
+    free( log -> buffer );
+    free( log -> offsets );
+    if ( log -> index ) {
+        for( int i = 0; i < EVAL_LOG_BUCKETS; i++ ) free( log -> index -> bucket[i].lines );
+        free( log -> index );
+    }
+    memset( log, 0, sizeof( log_t ) );
+}
 
+/**
+ * @brief Returns the position in the log buffer after the last line
+ * 
+ * @param log       Log variable
+ * @return size_t   Offset of the first free byte in the log buffer
+ */
+static size_t _eval_log_tail( log_t* log ) {
+    if ( log -> end > log -> first ) {
+        size_t off = log -> offsets[ log -> end - 1 - log -> first ];
+        return off + strlen( log -> buffer + off ) + 1;
     } else {
-        _eval_stdio.old_stdin = -1;
+        return 0;
     }
+}
 
-    if ( _fstdout ) {
-        if ( (_eval_stdio.old_stdout = dup( STDOUT_FILENO )) < 0 ) {
-            fprintf(stderr, "Unable to duplicate STDOUT_FILENO\n");
-            eval_error("Unable to duplicate STDOUT_FILENO");
-            return -1;
-        }
-
-        int new_stdout;
-        if ( (new_stdout = open( _fstdout, O_CREAT | O_WRONLY | O_TRUNC, 0600 )) < 0 ) {
-            fprintf(stderr, "Unable to open file %s as write-only\n", _fstdout);
-            eval_error("Unable to open file %s as write-only", _fstdout);
-            return -1;
-        }
-
-        if ( (dup2( new_stdout, STDOUT_FILENO )) < 0 ) {
-            fprintf(stderr, "Unable to associate file %s with stdout\n", _fstdout);
-            eval_error("Unable to associate file %s with stdout", _fstdout);
-            return -1;
-        }
-
-        if ( close( new_stdout ) < 0 ) {
-            fprintf(stderr, "Unable to close new_stdout file descriptor\n");
-            return -1;
-        }
+/**
+ * @brief Discards lines already removed from the head of the log
+ *
+ * Line data is moved to the beginning of the buffer, reclaiming the space
+ * used by these lines.
+ * 
+ * @param log       Log variable
+ * @param tail      Offset of the first free byte in the log buffer
+ * @return size_t   New offset of the first free byte
+ */
+static size_t _eval_log_compact( log_t* log, size_t tail ) {
+    const int n = log -> end - log -> start;
+    size_t head = ( n > 0 ) ? log -> offsets[ log -> start - log -> first ] : tail;
 
-    } else {
-        _eval_stdio.old_stdout = -1;
-    }
+    if ( head > 0 ) memmove( log -> buffer, log -> buffer + head, tail - head );
+    for( int i = 0; i < n; i++ )
+        log -> offsets[i] = log -> offsets[ log -> start - log -> first + i ] - head;
 
-    return 0;
+    log -> first = log -> start;
+    return tail - head;
 }
 
 /**
- * @brief Restores stdin and stdout to console
+ * Returns a pointer to a new line in the log and updates internal pointers
  *
- * Requires data in _eval_stdio
+ * Lines are stored contiguously in a single buffer that grows on demand, up
+ * to EVAL_LOG_MAXSIZE bytes. The space used by lines removed from the head of
+ * the log (see rmheadmsg()) is reclaimed when required.
  *
- * @return int      0 on success
+ * The new line may hold up to LOGLINE characters (including the terminating
+ * '\0'), and the pointer is only valid until the next call to newline().
+ * 
+ * @param log   Log variable
+ * @return      char* to a new line
  */
-int _eval_io_restore( void ) {
+char *newline( log_t* log ) {
 
-    if ( _eval_stdio.old_stdout != -1 ) {
+    size_t tail = _eval_log_tail( log );
 
-        // Flush any remaining data to disk
-        // If this is not done then this data will be sent to the next STDOUT device
-        fflush( stdout );
+    // The log is empty, reuse the whole buffer
+    if ( log -> start == log -> end ) {
+        log -> first = log -> start;
+        tail = 0;
+    }
 
-        if ( dup2( _eval_stdio.old_stdout, STDOUT_FILENO ) < 0 ) {
-            fprintf(stderr, "Unable to reassociate STDOUT with console\n" );
-            return -1;
-        }
+    if ( log -> size - tail < LOGLINE ) {
+        size_t head = ( log -> start < log -> end ) ? 
+            log -> offsets[ log -> start - log -> first ] : tail;
 
-        if ( close( _eval_stdio.old_stdout ) < 0 ) {
-            fprintf(stderr, "Unable to close old_stdout file\n" );
-            return -1;
+        if ( head > 0 && head >= log -> size / 2 ) {
+            // At least half of the log buffer is unused
+            tail = _eval_log_compact( log, tail );
+        } else {
+            size_t size = ( log -> size > 0 ) ? 2 * log -> size : LOGSIZE * 64;
+            if ( size > EVAL_LOG_MAXSIZE ) size = EVAL_LOG_MAXSIZE;
+
+            char *buffer = NULL;
+            if ( size - tail >= LOGLINE )
+                buffer = realloc( log -> buffer, size );
+
+            if ( buffer ) {
+                log -> buffer = buffer;
+                log -> size = size;
+            } else if ( head > 0 ) {
+                tail = _eval_log_compact( log, tail );
+            }
         }
-    }
-
-    if ( _eval_stdio.old_stdin != -1 ) {
 
-        // Clear any remaining data on stdin
-        // If this is not done then it will remain in STDIN
-        fflush( stdin );
+        if ( log -> size - tail < LOGLINE ) {
+            eval_error( "No more space in logbuffer, aborting" );
+            if ( log -> end > log -> first )
+                eval_error( "Last message was: \"%s\"",
+                    log -> buffer + log -> offsets[ log -> end - 1 - log -> first ] );
 
-        if ( dup2( _eval_stdio.old_stdin, STDIN_FILENO ) < 0 ) {
-            fprintf(stderr, "Unable to reassociate STDIN with console\n" );
-            return -1;
+            // Check if this happened inside an EVAL_CATCH macro
+            if ( _eval_env.catch ) {
+                _eval_longjmp( EVAL_CATCH_LOG_OVERFLOW );
+            } else {
+                exit(1);
+            }
         }
+    }
 
-        if ( close( _eval_stdio.old_stdin ) < 0 ) {
-            fprintf(stderr, "Unable to close old_stdin file\n" );
-            return -1;
+    if ( log -> end - log -> first >= log -> nlines ) {
+        if ( log -> start > log -> first ) {
+            tail = _eval_log_compact( log, tail );
+        } else {
+            int nlines = ( log -> nlines > 0 ) ? 2 * log -> nlines : LOGSIZE;
+            size_t *offsets = realloc( log -> offsets, nlines * sizeof( size_t ) );
+            if ( offsets == NULL ) {
+                perror("newline: (*critical*) Unable to grow log index");
+                exit(1);
+            }
+            log -> offsets = offsets;
+            log -> nlines = nlines;
         }
     }
 
-    return 0;
+    char *line = log -> buffer + tail;
+    line[0] = 0;
+    log -> offsets[ log -> end - log -> first ] = tail;
+    log -> end++;
+
+    return line;
 }
 
 /**
- * @brief Initialize file monitor variable
+ * @brief Returns the log line with the specified index
  * 
- * This value will be used to check if the test routine left any files open
+ * @param log       Log variable
+ * @param idx       Line index (as returned by findinlog())
+ * @return          Pointer to line or NULL if line is not in the log
  */
-void _eval_init_filemon( void ) {    
-    // Get the file descriptor value of a new file
-    // All files opened from test code should have a descriptor >= than this
-    _eval_env.filemon = dup(STDERR_FILENO);
-    close(_eval_env.filemon);
+const char* logline( log_t* log, int idx ) {
+    if ( idx < log -> start || idx >= log -> end ) return NULL;
+    return log -> buffer + log -> offsets[ idx - log -> first ];
 }
 
 /**
- * @brief Closes any files open (besides STDIN, STDOUT and STDERR)
- * 
- * Requires values in _eval_env.filemon
+ * Prints entire log
+ * @param log   Log variable
  */
-void _eval_close_filemon( void ) {
+void printlog( log_t* log ) {
+    if ( log -> start >= log -> end ) {
+        printf("<empty>\n");
+    } else {
+        for( int i = log -> start, j = 0; i != log -> end; i++, j++ ) {
+            printf("%3d - %s\n", j, logline( log, i ) );
+        }
+    }
+}
 
-    // Get maximum number of open file descriptors
-    const int maxfd=sysconf(_SC_OPEN_MAX);
 
-    // Go through all possible file descriptors starting from .filemon
-    int nfiles = 0;
-    for( int fd = _eval_env.filemon; fd < maxfd; fd++ ) {
-        if ( close(fd) ) {
-            // If file was not open, errno is set to EBADF
-            if ( errno != EBADF ) {
-                // File is opened but close failed for another reason
-                nfiles++;
-                perror("_eval_close_filemon: Unable to close file");
-            }
-        } else {
-            // File closed successfully
-            nfiles++;
+/**
+ * @brief Adds the lines appended to the log since the last query to the
+ * line prefix index
+ * 
+ * The index is allocated on first use. Entries for lines already removed
+ * from the head of the log are discarded as buckets grow.
+ * 
+ * @param log       Log variable
+ * @return int      0 on success, -1 on error (index not available)
+ */
+static int _eval_log_index_update( log_t* log ) {
+    if ( log -> index == NULL ) {
+        log -> index = calloc( 1, sizeof( struct _eval_log_index ) );
+        if ( log -> index == NULL ) {
+            eval_error("Unable to allocate log index");
+            return -1;
         }
+        log -> indexed = 0;
     }
 
-    if ( nfiles > 0 ) {
-        if ( nfiles == 1 ) {
-            eval_error("1 file was not closed" );
-        } else {
-            eval_error("%d files were not closed", nfiles );
+    // The log was reset without initlog()
+    if ( log -> indexed > log -> end ) _eval_log_index_clear( log );
+    if ( log -> indexed < log -> start ) log -> indexed = log -> start;
+
+    for( ; log -> indexed < log -> end; log -> indexed++ ) {
+        const char *line = logline( log, log -> indexed );
+        _eval_log_bucket_t *b = &log -> index -> bucket[ _eval_log_hash( line, _eval_log_prefix( line ) ) ];
+
+        if ( b -> n == b -> size ) {
+            while( b -> head < b -> n && b -> lines[ b -> head ] < log -> start ) b -> head++;
+            if ( b -> head > 0 && b -> head >= b -> n / 2 ) {
+                memmove( b -> lines, b -> lines + b -> head, ( b -> n - b -> head ) * sizeof( int ) );
+                b -> n -= b -> head;
+                b -> head = 0;
+            } else {
+                int size = ( b -> size > 0 ) ? 2 * b -> size : 16;
+                int *lines = realloc( b -> lines, size * sizeof( int ) );
+                if ( lines == NULL ) {
+                    eval_error("Unable to grow log index");
+                    _eval_log_index_clear( log );
+                    return -1;
+                }
+                b -> lines = lines;
+                b -> size = size;
+            }
         }
+        b -> lines[ b -> n++ ] = log -> indexed;
     }
-
+    return 0;
 }
 
 /**
- * @brief Resets the _eval_stats variable
+ * @brief Returns the first entry of an index bucket for a line with index
+ * >= from
  * 
+ * @param b         Index bucket
+ * @param from      Line index
+ * @return int      Position in bucket, b -> n if none
  */
-void eval_reset_stats( void ) {
-    _eval_stats.error = 0;
-    _eval_stats.info = 0;
+static int _eval_log_bucket_find( const _eval_log_bucket_t *b, int from ) {
+    int lo = b -> head, hi = b -> n;
+    while( lo < hi ) {
+        int mid = lo + ( hi - lo ) / 2;
+        if ( b -> lines[ mid ] < from ) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
 }
 
 /**
- * @brief Configuration variable for the eval_checkptr() function
+ * @brief Looks for the message specified by the format and optional arguments.
+ * Returns the index position on success or -1 if not found.
+ * 
+ * Only lines with the same prefix as the message (see the line prefix index)
+ * are compared.
  * 
+ * @param log       Log
+ * @param format    Format for message
+ * @param ...       Optional message values
+ * @return int      Position in log or -1 if not found
  */
-struct {
-    int stat;
-    int sig;
-    jmp_buf jmp;
-    char buffer;
-}_eval_checkptr_data;
+int findinlog( log_t* log, const char *restrict format, ... ) {
+    char msg[LOGLINE];
+
+    va_list ap;
+    va_start(ap, format);
+    vsnprintf(msg, LOGLINE-1, format, ap);
+    va_end(ap);
+
+    if ( _eval_log_index_update( log ) == 0 ) {
+        const _eval_log_bucket_t *b = &log -> index -> bucket[ _eval_log_hash( msg, _eval_log_prefix( msg ) ) ];
+        for( int i = _eval_log_bucket_find( b, log -> start ); i < b -> n; i++ ) {
+            if ( !strncmp( msg, logline( log, b -> lines[i] ), LOGLINE-1) ) return b -> lines[i];
+        }
+        return -1;
+    }
+
+    int idx = -1;
+    for( int i = log->start; i != log->end; i++ ) {
+        if ( !strncmp( msg, logline( log, i ), LOGLINE-1) ) {
+            idx = i;
+            break;
+        }
+    }
+    return idx;
+}
 
 /**
- * @brief Signal handler for the eval_checkptr function
- * Requires data in the _eval_checkptr_data variable
+ * Removes the head line from the log if it contains the supplied message
  * 
- * @param sig 
- * @param info 
- * @param ucontext 
+ * @param msg   Messagem to look for
+ * @return      0 on success, -1 on error (empty log or msg not found)
  */
-void _eval_checkptr_sighndlr( int sig, siginfo_t *info, void *ucontext) {
-    _eval_checkptr_data.stat = 1;
-    _eval_checkptr_data.sig = sig;
-    siglongjmp( _eval_checkptr_data.jmp, 1 );
+int rmheadmsg( log_t* log, const char msg[] ) {
+    if ( log -> start >= log -> end ) return -1;
+    if ( strstr( logline( log, log -> start ), msg ) ) {
+        // Remove the line
+        log -> start ++;
+        return 0;
+    } else {
+        return -1;
+    }
 }
 
 /**
- * Checks if a pointer is valid by reading/writing 1 byte from/to address
- * @param ptr   Pointer to be evaluated
- * @return      0 is pointer is valid
- *              1 NULL pointer
- *              2 (-1) pointer
- *              3 Segmentation fault when accessing pointer
- *              4 Bus Error when accessing pointer
- *              5 Invalid signal caught (should never happen)
+ * Returns the string at the head of the log or "empty" if empty
+ * 
+ * @param log   Log
+ * @return      Pointer to string
  */
-int eval_checkptr( void* ptr ) {
-
-    if ( ptr == NULL ) {
-        eval_error("NULL pointer");
-        return 1;
-    }
-
-    if ( ptr == (void *) -1 ) {
-        eval_error("Invalid pointer %p", ptr );
-        return 2;
-    }
-
-    // Catch SIGSEGV and SIGBUS
-    struct sigaction act = {
-        .sa_flags = SA_SIGINFO | SA_RESTART,
-        .sa_sigaction = _eval_checkptr_sighndlr
-    };
-    struct sigaction tmp[2];
+const char* loghead( log_t* log ) {
+    static const char empty[] = "<empty>";
+    if ( log -> start >= log -> end ) return empty;
+    else return logline( log, log -> start );
+}
 
-    if ( sigaction( SIGSEGV, &act, &tmp[0] ) < 0 ) {
-        perror("eval_checkptr: (*critical*) Unable to set SIGSEGV handler");
-        exit(1);
-    };
 
-    if ( sigaction( SIGBUS, &act, &tmp[1] ) < 0 ) {
-        perror("eval_checkptr: (*critical*) Unable to set SIGBUS handler");
-        exit(1);
-    };
+/**
+ * @brief Compiles a log pattern
+ * 
+ * The pattern is built from the format and optional arguments (as in
+ * printf()) and then interpreted as a glob pattern matching the whole log
+ * line: '*' matches any sequence of characters (captured), '?' matches any
+ * single character, '[...]' matches any character in the set ('[!...]' or
+ * '[^...]' any character not in the set, ranges as in 'a-z') and '\'
+ * escapes the next character.
+ * 
+ * Patterns starting with a literal line prefix (see the line prefix index)
+ * only check lines with that prefix.
+ * 
+ * @param pat       (out) Compiled pattern
+ * @param format    Format for pattern
+ * @param ...       Optional pattern values
+ * @return int      0 on success, -1 on invalid pattern
+ */
+int eval_logpat( eval_logpat_t *pat, const char *restrict format, ... ) {
+    va_list ap;
+    va_start(ap, format);
+    vsnprintf(pat -> pattern, LOGLINE, format, ap);
+    va_end(ap);
 
-    // Reset _eval_checkptr_data
-    _eval_checkptr_data.stat = 0;
-    _eval_checkptr_data.sig = -1;
+    pat -> ncap = 0;
+    pat -> haskey = 0;
+    pat -> key[0] = 0;
 
-    // Access memory at position ptr, invalid pointers will throw a signal
-    int stat = sigsetjmp( _eval_checkptr_data.jmp, 1 );
-    if ( !stat ) {
-        char *p = (char *) ptr;
-        _eval_checkptr_data.buffer = *p;
-        *p = _eval_checkptr_data.buffer;
+    // Validate the pattern and count captures
+    for( const char *p = pat -> pattern; *p; p++ ) {
+        switch( *p ) {
+        case( '*' ):
+            pat -> ncap++;
+            break;
+        case( '[' ):
+            {
+                const char *q = p + 1;
+                if ( *q == '!' || *q == '^' ) q++;
+                if ( *q == ']' ) q++;
+                while( *q && *q != ']' ) q++;
+                if ( *q == 0 ) {
+                    eval_error("(eval_logpat) Unterminated set in pattern '%s'", pat -> pattern );
+                    return -1;
+                }
+                p = q;
+            }
+            break;
+        case( '\\' ):
+            if ( p[1] ) p++;
+            break;
+        }
     }
 
-    // Restore previous signal handlers
-    if ( sigaction( SIGSEGV, &tmp[0], NULL ) < 0 ) {
-        perror("eval_checkptr: (*critical*) Unable to reset SIGSEGV handler");
-        exit(1);
-    };
-
-    if ( sigaction( SIGBUS, &tmp[0], NULL ) < 0 ) {
-        perror("eval_checkptr: (*critical*) Unable to reset SIGBUS handler");
-        exit(1);
-    };
+    if ( pat -> ncap > EVAL_LOGPAT_MAXCAP ) {
+        eval_error("(eval_logpat) Too many captures in pattern '%s' (max. %d)",
+            pat -> pattern, EVAL_LOGPAT_MAXCAP );
+        return -1;
+    }
 
-    if ( _eval_checkptr_data.stat ) {
-        switch( _eval_checkptr_data.sig ) {
-        case(SIGSEGV):
-            eval_error("(checkptr) Accessing %p caused Segmentation Fault", ptr);
-            return 3;
-        case(SIGBUS):
-            eval_error("(checkptr) Accessing %p caused Bus Error", ptr);
-            return 4;
-        default:
-            eval_error("(checkptr) Accessing %p caused unknonown signal", ptr);
-            return 5;
+    // Find the literal text at the start of the pattern, and check if it
+    // includes the complete line prefix
+    size_t k = 0;
+    for( const char *p = pat -> pattern; ; ) {
+        char c = *p;
+        if ( c == '\\' && p[1] ) {
+            c = p[1];
+            p += 2;
+        } else if ( c == '*' || c == '?' || c == '[' ) {
+            break;
+        } else {
+            p++;
         }
+        if ( c == 0 || _eval_log_delim( c ) ) pat -> haskey = 1;
+        if ( c == 0 ) break;
+        pat -> key[ k++ ] = c;
     }
+    pat -> key[k] = 0;
 
     return 0;
 }
 
 /**
- * Checks if a pointer is valid by reading 1 byte from address
- * @param ptr   Pointer to be evaluated
- * @return      0 is pointer is valid
- *              1 NULL pointer
- *              2 (-1) pointer
- *              3 Segmentation fault when accessing pointer
- *              4 Bus Error when accessing pointer
- *              5 Invalid signal caught (should never happen)
+ * @brief Checks if a character matches a '[...]' set
+ * 
+ * @param pp        (in/out) Pointer to the '[' character, set to the
+ *                  closing ']' character on return
+ * @param c         Character to check
+ * @return int      1 if the character matches, 0 otherwise
  */
-int eval_checkconstptr( const void * ptr ) {
-
-    if ( ptr == NULL ) {
-        eval_error("NULL pointer");
-        return 1;
-    }
+static int _eval_logpat_set( const char **pp, char c ) {
+    const char *p = *pp + 1;
+    int neg = 0, found = 0;
 
-    if ( ptr == (void *) -1 ) {
-        eval_error("Invalid pointer %p", ptr );
-        return 2;
+    if ( *p == '!' || *p == '^' ) {
+        neg = 1;
+        p++;
     }
 
-    // Catch SIGSEGV and SIGBUS
-    struct sigaction act = {
-        .sa_flags = SA_SIGINFO | SA_RESTART,
-        .sa_sigaction = _eval_checkptr_sighndlr
-    };
-    struct sigaction tmp[2];
-
-    if ( sigaction( SIGSEGV, &act, &tmp[0] ) < 0 ) {
-        perror("eval_checkptr: (*critical*) Unable to set SIGSEGV handler");
-        exit(1);
-    };
-
-    if ( sigaction( SIGBUS, &act, &tmp[1] ) < 0 ) {
-        perror("eval_checkptr: (*critical*) Unable to set SIGBUS handler");
-        exit(1);
-    };
-
-    // Reset _eval_checkptr_data
-    _eval_checkptr_data.stat = 0;
-    _eval_checkptr_data.sig = -1;
-
-    // Access memory at position ptr, invalid pointers will throw a signal
-    int stat = sigsetjmp( _eval_checkptr_data.jmp, 1 );
-    if ( !stat ) {
-        char *p = (char *) ptr;
-        _eval_checkptr_data.buffer = *p;
+    for( int first = 1; *p && ( first || *p != ']' ); first = 0, p++ ) {
+        if ( p[1] == '-' && p[2] && p[2] != ']' ) {
+            if ( (unsigned char) c >= (unsigned char) p[0] && (unsigned char) c <= (unsigned char) p[2] ) found = 1;
+            p += 2;
+        } else if ( c == *p ) {
+            found = 1;
+        }
     }
 
-    // Restore previous signal handlers
-    if ( sigaction( SIGSEGV, &tmp[0], NULL ) < 0 ) {
-        perror("eval_checkptr: (*critical*) Unable to reset SIGSEGV handler");
-        exit(1);
-    };
-
-    if ( sigaction( SIGBUS, &tmp[0], NULL ) < 0 ) {
-        perror("eval_checkptr: (*critical*) Unable to reset SIGBUS handler");
-        exit(1);
-    };
+    *pp = p;
+    return found != neg;
+}
 
-    if ( _eval_checkptr_data.stat ) {
-        switch( _eval_checkptr_data.sig ) {
-        case(SIGSEGV):
-            eval_error("(checkptr) Accessing %p caused Segmentation Fault", ptr);
-            return 3;
-        case(SIGBUS):
-            eval_error("(checkptr) Accessing %p caused Bus Error", ptr);
-            return 4;
+/**
+ * @brief Matches a glob pattern against a string, recording captures
+ * 
+ * '*' wildcards match the shortest possible text.
+ * 
+ * @param p         Pattern
+ * @param s         String
+ * @param cs        (out) Capture start positions
+ * @param ce        (out) Capture end positions
+ * @param ncap      Captures already recorded
+ * @return int      1 if the string matches, 0 otherwise
+ */
+static int _eval_logpat_rec( const char *p, const char *s, const char **cs, const char **ce, int ncap ) {
+    while( *p ) {
+        switch( *p ) {
+        case( '*' ):
+            cs[ ncap ] = s;
+            for( const char *t = s; ; t++ ) {
+                ce[ ncap ] = t;
+                if ( _eval_logpat_rec( p + 1, t, cs, ce, ncap + 1 ) ) return 1;
+                if ( *t == 0 ) return 0;
+            }
+        case( '?' ):
+            if ( *s == 0 ) return 0;
+            break;
+        case( '[' ):
+            if ( *s == 0 || ! _eval_logpat_set( &p, *s ) ) return 0;
+            break;
+        case( '\\' ):
+            if ( p[1] ) p++;
+            if ( *p != *s ) return 0;
+            break;
         default:
-            eval_error("(checkptr) Accessing %p caused unknonown signal", ptr);
-            return 5;
+            if ( *p != *s ) return 0;
         }
+        p++;
+        s++;
     }
-
-    return 0;
+    return *s == 0;
 }
 
 /**
- * @brief Reads a line from file f and compares it with the string s2
+ * @brief Matches a compiled log pattern against a log line
  * 
- * @param f 
- * @param s2 
- * @param n         Max. size for the comparison
- * @return int      Returns
+ * @param pat       Compiled pattern
+ * @param line      Log line
+ * @param m         (out) Captured text, may be NULL. The .line field is set
+ *                  to -1
+ * @return int      1 if the line matches, 0 otherwise
  */
-int eval_fstrncmp( FILE *f, const char *s2, const size_t n ) {
-    int ret;
-    if (f) {
-        char buffer[ n + 1 ];
-        fgets( buffer, n, f );
-
-        size_t size = strlen( s2 );
-        if ( n < size ) size = n;
+int eval_logpat_match( const eval_logpat_t *pat, const char line[], eval_logmatch_t *m ) {
+    const char *cs[ EVAL_LOGPAT_MAXCAP ], *ce[ EVAL_LOGPAT_MAXCAP ];
+
+    if ( line == NULL ) return 0;
+    if ( strncmp( line, pat -> key, strlen( pat -> key ) ) ) return 0;
+    if ( ! _eval_logpat_rec( pat -> pattern, line, cs, ce, 0 ) ) return 0;
+
+    if ( m ) {
+        char *buf = m -> buffer;
+        m -> line = -1;
+        m -> ncap = pat -> ncap;
+        for( int i = 0; i < pat -> ncap; i++ ) {
+            size_t len = ce[i] - cs[i];
+            memcpy( buf, cs[i], len );
+            buf[ len ] = 0;
+            m -> cap[i] = buf;
+            buf += len + 1;
+        }
+    }
+    return 1;
+}
 
-        // printf( "eval_fstrncmp: %s, %s, %ld ", buffer, s2, n );
+/**
+ * @brief Looks for the first log line with index >= from matching a pattern
+ * 
+ * @param log       Log
+ * @param pat       Compiled pattern
+ * @param from      First line index to check (values below the head of the
+ *                  log start at the head)
+ * @param m         (out) Match information, may be NULL
+ * @return int      Index of the matching line or -1 if not found
+ */
+int eval_log_find( log_t* log, const eval_logpat_t *pat, int from, eval_logmatch_t *m ) {
+    if ( from < log -> start ) from = log -> start;
+
+    if ( pat -> haskey && _eval_log_index_update( log ) == 0 ) {
+        const _eval_log_bucket_t *b = &log -> index -> bucket[ _eval_log_hash( pat -> key, _eval_log_prefix( pat -> key ) ) ];
+        for( int i = _eval_log_bucket_find( b, from ); i < b -> n; i++ ) {
+            if ( eval_logpat_match( pat, logline( log, b -> lines[i] ), m ) ) {
+                if ( m ) m -> line = b -> lines[i];
+                return b -> lines[i];
+            }
+        }
+        return -1;
+    }
 
-        ret = strncmp( buffer, s2, size );
-    } else {
-        ret = -2;
+    for( int i = from; i < log -> end; i++ ) {
+        if ( eval_logpat_match( pat, logline( log, i ), m ) ) {
+            if ( m ) m -> line = i;
+            return i;
+        }
     }
-    return ret;
+    return -1;
 }
 
-
 /**
- * @brief Creates a "locked" file, i.e. a file with 0000 permissions
- *
- * Note that this file can still be removed using unlink() or remove()
+ * @brief Counts the log lines matching a pattern
  * 
- * @param fname     Name of the file to create
- *
- * @return int      0 on success, -1 on error
+ * @param log       Log
+ * @param pat       Compiled pattern
+ * @return int      Number of matching lines
  */
-int create_lockfile( char *fname ) {
-       
-    // Open file and write magic bytes
-    FILE *f = fopen( fname, "w" );
-    if ( f ==  NULL ) {
-        perror("create_lockfile: Unable to create lock file");
-        return -1;
-    } else {
-        char magic[] = "LOCK";
-        if ( fwrite( magic, 1, 4, f ) != 4 ) {
-            perror("create_lockfile: Unable to write magic bytes to lock file");
-            return -1;
-        };
-
-        if ( fclose(f) ) {
-            perror("create_lockfile: Unable to close lock file");
-            return -1;
-        }
-
-        // Remove all permissions
-        if ( chmod( fname, 0000 ) ) {
-            perror("create_lockfile: Unable to set lock file permissions");
-            return -1;
-        }
-    }
-
-    return 0;
+int eval_log_count( log_t* log, const eval_logpat_t *pat ) {
+    int n = 0;
+    for( int i = eval_log_find( log, pat, log -> start, NULL ); i >= 0;
+        i = eval_log_find( log, pat, i + 1, NULL ) ) n++;
+    return n;
 }
 
 /**
- * @brief Removes a "locked" file created by create_lockfile()
- * 
- * User must be file owner.
- * 
- * @param fname     Name of the file to create 
- *
- * @return int      0 on success, -1 on error
+ * @brief Finds an augmenting path for pattern p (bipartite matching)
+ * 
+ * @param p         Pattern
+ * @param off       Candidate lines of pattern i are cand[off[i]..off[i+1]-1]
+ * @param cand      Candidate lines (compact ids)
+ * @param owner     Pattern assigned to each line, -1 if none
+ * @param seen      Lines visited, marked with stamp
+ * @param stamp     Current search stamp
+ * @return int      1 if pattern p was assigned a line, 0 otherwise
  */
-int remove_lockfile( char *fname ) {
-    struct stat st;
-    if ( stat( fname, &st ) < 0 ) {
-        perror("remove_lockfile: File no longer exists" );
-        return -1;
+static int _eval_log_augment( int p, const int *off, const int *cand, int *owner, int *seen, int stamp ) {
+    for( int j = off[p]; j < off[p+1]; j++ ) {
+        int l = cand[j];
+        if ( seen[l] == stamp ) continue;
+        seen[l] = stamp;
+        if ( owner[l] < 0 || _eval_log_augment( owner[l], off, cand, owner, seen, stamp ) ) {
+            owner[l] = p;
+            return 1;
+        }
     }
-
-    // Unlink does not check write permission
-    if ( unlink( fname ) ) {
-        perror("remove_lockfile: Unable to remove lock file");
-        return -1;
-    };
-
     return 0;
 }
 
-
-/**
- * Global variable for use by the EVAL_CATCH* macros
- */
-_eval_env_type _eval_env = {0};
-
 /**
- * Global variable for use by the eval_termination() function
+ * @brief Compares two ints, for qsort() / bsearch()
  */
-char _eval_term_str[256] = {0};
+static int _eval_log_cmpint( const void *a, const void *b ) {
+    int x = *(const int *) a, y = *(const int *) b;
+    return ( x > y ) - ( x < y );
+}
 
 /**
- * @brief Pointer to string describing the test code termination
- *
- * Requires values in _eval_env. Note that the function always returns a pointer
- * to the same location, the global _eval_term_str variable is modified with the
- * updated termination message.
+ * @brief Checks that each pattern matches a different log line, in any order
  * 
- * @return const char*      Test code termination description
+ * Lines matching several patterns are assigned so that as many patterns as
+ * possible are matched (maximum bipartite matching). The cost is
+ * proportional to the number of lines matching each pattern, not to the size
+ * of the log. Lines are not removed from the log.
+ * 
+ * @param log       Log
+ * @param pats      Compiled patterns
+ * @param npats     Number of patterns
+ * @param lines     (out) Index of the line assigned to each pattern (-1 if
+ *                  none), may be NULL
+ * @return int      Number of patterns not matched, -1 on error
  */
-const char* eval_termination( void ) {
-    char *signame;
-    
-    switch( _eval_env.stat ) {
-        case(0):
-            snprintf(_eval_term_str, 255, "code returned normally" );
-            break;
-        case(EVAL_CATCH_EXIT):
-            snprintf(_eval_term_str, 255, "exit(%d) called", _eval_exit_data.status );
-            break;
-        case(EVAL_CATCH_ABORT):
-            snprintf(_eval_term_str, 255, "abort() called" );
-            break;
-        case(EVAL_CATCH_BLOCKED):
-            snprintf(_eval_term_str, 255, "blocked function called" );
-            break;
-        case(EVAL_CATCH_SIGNAL):
-            signame = strsignal(_eval_env.signal);
-            if ( signame ) {
-                snprintf(_eval_term_str, 255, "signal %s caught", signame );
-            } else {
-                snprintf(_eval_term_str, 255, "Unknown signal %d caught", _eval_env.signal );
+int eval_log_unordered( log_t* log, const eval_logpat_t pats[], int npats, int lines[] ) {
+    if ( npats <= 0 ) return 0;
+
+    int *off = malloc( ( npats + 1 ) * sizeof( int ) );
+    int *cand = NULL, *ids = NULL, *owner = NULL, *seen = NULL;
+    int ncand = 0, size = 0, ret = -1;
+    if ( off == NULL ) goto done;
+
+    // Candidate lines for each pattern
+    for( int p = 0; p < npats; p++ ) {
+        off[p] = ncand;
+        for( int i = eval_log_find( log, &pats[p], log -> start, NULL ); i >= 0;
+            i = eval_log_find( log, &pats[p], i + 1, NULL ) ) {
+            if ( ncand == size ) {
+                size = ( size > 0 ) ? 2 * size : 64;
+                int *tmp = realloc( cand, size * sizeof( int ) );
+                if ( tmp == NULL ) goto done;
+                cand = tmp;
             }
-            break;
-        case(EVAL_CATCH_LOG_OVERFLOW):
-            snprintf(_eval_term_str, 255, "log buffer full" );
-            break;
-        default:
-            snprintf(_eval_term_str, 255, "abnormal termination");
+            cand[ ncand++ ] = i;
+        }
     }
-    return _eval_term_str;
+    off[ npats ] = ncand;
+
+    // Map candidate lines to compact ids
+    int nids = 0;
+    if ( ncand > 0 ) {
+        if ( ( ids = malloc( ncand * sizeof( int ) ) ) == NULL ) goto done;
+        memcpy( ids, cand, ncand * sizeof( int ) );
+        qsort( ids, ncand, sizeof( int ), _eval_log_cmpint );
+        for( int i = 0; i < ncand; i++ )
+            if ( nids == 0 || ids[ nids - 1 ] != ids[i] ) ids[ nids++ ] = ids[i];
+        for( int j = 0; j < ncand; j++ )
+            cand[j] = (int *) bsearch( &cand[j], ids, nids, sizeof( int ), _eval_log_cmpint ) - ids;
+
+        owner = malloc( nids * sizeof( int ) );
+        seen = malloc( nids * sizeof( int ) );
+        if ( owner == NULL || seen == NULL ) goto done;
+        for( int i = 0; i < nids; i++ ) {
+            owner[i] = -1;
+            seen[i] = -1;
+        }
+    }
+
+    ret = 0;
+    for( int p = 0; p < npats; p++ ) {
+        if ( ! _eval_log_augment( p, off, cand, owner, seen, p ) ) ret++;
+    }
+
+    if ( lines ) {
+        for( int p = 0; p < npats; p++ ) lines[p] = -1;
+        for( int i = 0; i < nids; i++ ) 
+            if ( owner[i] >= 0 ) lines[ owner[i] ] = ids[i];
+    }
+
+done:
+    if ( ret < 0 ) eval_error("(eval_log_unordered) Unable to allocate memory");
+    free( off );
+    free( cand );
+    free( ids );
+    free( owner );
+    free( seen );
+    return ret;
 }
 
 /**
- * @brief Signal handler for the EVAL_CATCH* macros
- *
- * Requires data in the _eval_env variable
+ * @brief Checks that the patterns match log lines in the same order, allowing
+ * other lines in between
  * 
- * @param sig           Signal caught
- * @param info          Pointer to object explaining the reason why the signal
- *                      was generated
- * @param ucontext      Additional information from the process sending the 
- *                      signal
+ * Each pattern is matched to the first matching line after the line matched
+ * by the previous pattern. Lines are not removed from the log.
+ * 
+ * @param log       Log
+ * @param pats      Compiled patterns
+ * @param npats     Number of patterns
+ * @param lines     (out) Index of the line matched by each pattern (-1 if
+ *                  none), may be NULL
+ * @return int      Number of patterns not matched
  */
-void _eval_sighandler( int sig, siginfo_t *info, void *ucontext) {
-
-    char *name;
-
-    switch( sig ) {
-    case( SIGSEGV ):
-        eval_error("Segmentation fault (SIGSEGV)");
-        break;
-    case( SIGBUS ):
-        eval_error("Bus error (SIGBUS)");
-        break;
-    case( SIGFPE ):
-        eval_error("Floating point exception / division by 0 (SIGFPE)");
-        break;
-    case( SIGILL ):
-        eval_error("Illegal instruction (SIGILL)");
-        break;
-    case( SIGPROF ):
-        eval_error("Timeout (SIGPROF)");
-        break;
-    default:
-        name = strsignal(sig);
-        if ( name ) {
-            eval_error("Unexepected signal %s (%d) caught!", name, sig);
+int eval_log_sequence( log_t* log, const eval_logpat_t pats[], int npats, int lines[] ) {
+    int missing = 0;
+    int from = log -> start;
+    for( int p = 0; p < npats; p++ ) {
+        int idx = eval_log_find( log, &pats[p], from, NULL );
+        if ( idx < 0 ) {
+            missing++;
         } else {
-            eval_error("Unexepected signal %d caught!", sig);
+            from = idx + 1;
         }
+        if ( lines ) lines[p] = idx;
     }
-
-    _eval_env.signal = sig;
-    siglongjmp(_eval_env.jmp, EVAL_CATCH_SIGNAL);
+    return missing;
 }
 
 /**
- * @brief Arms signals for the EVAL_CATCH* macros and sets timeout alarm
+ * @brief Checks that each pattern matches a different log line, in any order,
+ * issuing an error message for each pattern not matched
  * 
- * Requires data in the _eval_env variable
- *
- * Specifically, SIGSEGV, SIGBUS, SIGFPE and SIGILL will be caught.
- *
- * If _eval_env.timeout > 0 then a timout alarm for _eval_env.timeout seconds
- * will be set using the SIGPROF signal. Note that if _eval_env.timeout <= 0
- * SIGPROF will not be armed.
- *
- * The routine will also store any previous signal handlers in 
- * _eval_env.sigactions[*] so that these may be restored later
+ * @param log       Log
+ * @param pats      Compiled patterns
+ * @param npats     Number of patterns
+ * @return int      1 on success, 0 if some pattern was not matched
  */
-void _eval_arm_signals( void ) {
-
-    struct sigaction act;
-
-    act.sa_flags = SA_SIGINFO | SA_RESTART;
-    act.sa_sigaction = _eval_sighandler;
-
-    if ( sigaction( SIGSEGV, &act, &_eval_env.sigactions[0] ) < 0) {
-        perror("_eval_arm_signals: (*critical*) Unable to set signal handler for SIGSEGV");
-        exit(1);
-    }
-
-    if ( sigaction( SIGBUS, &act, &_eval_env.sigactions[1] ) < 0) {
-        perror("_eval_arm_signals: (*critical*) Unable to set signal handler for SIGBUS");
-        exit(1);
-    }
-
-    if ( sigaction( SIGFPE, &act, &_eval_env.sigactions[2] ) < 0) {
-        perror("_eval_arm_signals: (*critical*) Unable to set signal handler for SIGFPE");
-        exit(1);
-    }
-
-    if ( sigaction( SIGILL, &act, &_eval_env.sigactions[3] ) < 0) {
-        perror("_eval_arm_signals: (*critical*) Unable to set signal handler for SIGILL");
-        exit(1);
+int eval_check_log_unordered( log_t* log, const eval_logpat_t pats[], int npats ) {
+    int *lines = malloc( ( npats > 0 ? npats : 1 ) * sizeof( int ) );
+    if ( lines == NULL ) {
+        eval_error("(eval_check_log_unordered) Unable to allocate memory");
+        return 0;
     }
 
-    // Timeouts
-    if( _eval_env.timeout > 0 ) {
-        if ( sigaction( SIGPROF, &act, &_eval_env.sigactions[4] ) < 0) {
-            perror("_eval_arm_signals: (*critical*) Unable to set signal handler for SIGPROF");
-            exit(1);
-        }
-
-        struct itimerval value;
-        value.it_value.tv_sec = floor( _eval_env.timeout );
-        value.it_value.tv_usec = floor( (_eval_env.timeout - value.it_value.tv_sec) * 1.e6 ) ;
-        value.it_interval.tv_sec = 0;
-        value.it_interval.tv_usec = 0;
-
-        if ( setitimer( ITIMER_PROF, &value, NULL ) < 0 ) {
-            perror("_eval_arm_signals: (*critical*) Unable to set timeout itimer");
-            exit(1);
+    int ret = eval_log_unordered( log, pats, npats, lines );
+    if ( ret > 0 ) {
+        for( int p = 0; p < npats; p++ ) {
+            if ( lines[p] < 0 ) eval_error( "Log message matching '%s' not found", pats[p].pattern );
         }
+    } else if ( ret == 0 ) {
+        eval_success( "Log ok: %d message(s) found", npats );
     }
 
-    // Reset _eval_env.signal
-    _eval_env.signal = -1;
+    free( lines );
+    return ret == 0;
 }
 
 /**
- * @brief Restores previous signal handlers
- * 
- * Requires data in the _eval_env variable
+ * @brief Checks that the patterns match log lines in the same order, allowing
+ * other lines in between, issuing an error message for each pattern not
+ * matched
  * 
+ * @param log       Log
+ * @param pats      Compiled patterns
+ * @param npats     Number of patterns
+ * @return int      1 on success, 0 if some pattern was not matched
  */
-void _eval_disarm_signals( void ) {
-
-    if( _eval_env.timeout > 0 ) {
-
-        struct itimerval value;
-        value.it_value.tv_sec = 0;
-        value.it_value.tv_usec = 0;
-        value.it_interval.tv_sec = 0;
-        value.it_interval.tv_usec = 0;
-
-        if ( setitimer( ITIMER_PROF, &value, NULL ) < 0 ) {
-            perror("_eval_disarm_signals: (*critical*) Unable to reset timeout itimer");
-            exit(1);
-        }
-
-        if ( sigaction( SIGPROF, &_eval_env.sigactions[4], NULL ) < 0) {
-            perror("_eval_disarm_signals: (*critical*) Unable to reset signal handler for SIGPROF");
-            exit(1);
+int eval_check_log_sequence( log_t* log, const eval_logpat_t pats[], int npats ) {
+    int missing = 0;
+    int from = log -> start;
+    for( int p = 0; p < npats; p++ ) {
+        int idx = eval_log_find( log, &pats[p], from, NULL );
+        if ( idx < 0 ) {
+            eval_error( "Log message matching '%s' not found in sequence (entry %d)", pats[p].pattern, p );
+            missing++;
+        } else {
+            from = idx + 1;
         }
     }
-
-    if ( sigaction( SIGSEGV, &_eval_env.sigactions[0], NULL ) < 0) {
-        perror("_eval_disarm_signals: (*critical*) Unable to reset signal handler for SIGSEGV");
-        exit(1);
-    }
-
-    if ( sigaction( SIGBUS, &_eval_env.sigactions[1], NULL ) < 0) {
-        perror("_eval_disarm_signals: (*critical*) Unable to reset signal handler for SIGBUS");
-        exit(1);
-    }
-
-    if ( sigaction( SIGFPE, &_eval_env.sigactions[2], NULL ) < 0) {
-        perror("_eval_disarm_signals: (*critical*) Unable to reset signal handler for SIGFPE");
-        exit(1);
-    }
-
-    if ( sigaction( SIGILL, &_eval_env.sigactions[3], NULL ) < 0) {
-        perror("_eval_disarm_signals: (*critical*) Unable to reset signal handler for SIGILL");
-        exit(1);
-    }
-
+    if ( missing == 0 ) eval_success( "Log ok: %d message(s) found in sequence", npats );
+    return missing == 0;
 }
 
-/******************************************************************************
- * Function wrappers
- *****************************************************************************/
-
 /**
- * @brief Global _eval_exit_data variable for the exit() function
+ * @brief Adds line into specified log
  * 
+ * @param log       Pointer to log variable
+ * @param format    Format modifier
+ * @param ...       Values
+ * @return int      Number of characters written
  */
-EVAL_VAR(exit);
+int eval_log( log_t* log, const char *restrict format, ...) {
+    va_list ap;
+    va_start(ap, format);
+    int n = vsnprintf(newline( log ), LOGLINE, format, ap);
+    va_end(ap);
+    return n;
+}
 
 /**
- * @brief Evaluate implementation calling of exit function
- *
- * Requires data in global _eval_exit_data and _eval_env
- *
- * Note that in this case the wrapped function will never be called. Instead,
- * execution will be returned to the EVAL_CATCH macro,setting the appropriate
- * _eval_env and _eval_exit_data values.
- *
- * Behavior:
- *   .action = 1    Issue info message and return to EVAL_CATCH macro
- *   default        return to EVAL_CATCH macro
+ * @brief Adds line into datalog
  * 
- * @param status    Exit status
+ * @param format    Format modifier
+ * @param ...       Values
+ * @return int      Number of characters written
  */
-void _eval_exit( int status ) {
-    _eval_exit_data.status = status;
-    if ( _eval_exit_data.action == ACTION_WARN )
-         eval_info("exit(%d) caught!", status );
-    
-    siglongjmp(_eval_env.jmp, EVAL_CATCH_EXIT);
+int datalog(const char *restrict format, ...) {
+    va_list ap;
+    va_start(ap, format);
+    int n = vsnprintf(newline( &_data_log ), LOGLINE, format, ap);
+    va_end(ap);
+    return n;
 }
 
 /**
- * @brief Global _eval_abort_data variable for the abort() function
+ * @brief Adds line into datalog
  * 
+ * @param format    Format modifier
+ * @param ...       Values
+ * @return int      Number of characters written
  */
-EVAL_VAR(abort);
-
-/**
- * @brief Evaluate implementation calling of abort function
- *
- * Requires data in global _eval_abort_data and _eval_env
- *
- * Note that in this case the wrapped function will never be called. Instead,
- * execution will be returned to the EVAL_CATCH macro,setting the appropriate
- * _eval_env and _eval_abort_data values.
- *
- * Behavior:
- *   .action = 1    Issue info message and return to EVAL_CATCH macro
- *   default        return to EVAL_CATCH macro
+int errorlog(const char *restrict format, ...) {
+    va_list ap;
+    va_start(ap, format);
+    int n = vsnprintf(newline( &_error_log ), LOGLINE, format, ap);
+    va_end(ap);
+    return n;
+}
+
+/**
+ * @brief Adds line into successlog
  * 
- * @param status    Exit status
+ * @param format    Format modifier
+ * @param ...       Values
+ * @return int      Number of characters written
  */
-void _eval_abort( void ) {
-    _eval_abort_data.status = 1;
-    if ( _eval_abort_data.action == ACTION_WARN )
-         eval_info("abort() caught!" );
-    
-    siglongjmp(_eval_env.jmp, EVAL_CATCH_ABORT);
+int successlog(const char *restrict format, ...) {
+    va_list ap;
+    va_start(ap, format);
+    int n = vsnprintf(newline( &_success_log ), LOGLINE, format, ap);
+    va_end(ap);
+    return n;
 }
 
 /**
- * @brief Global _eval_sleep_data variable for the sleep() function
+ * @brief Checks if the supplied message (specified by format and optionally additional values)
+ * is at the head of the success log.
+ * 
+ * If true, removes head line and returns 0, otherwise issues an error message.
  * 
+ * @param format    Format for message
+ * @param ...       (optional) additional values
+ * @return int      1 on success, 0 if message not found at head
  */
-EVAL_VAR(sleep);
+int eval_check_successlog( const char *restrict format, ...) {
+    char msg[LOGLINE];
+
+    va_list ap;
+    va_start(ap, format);
+    vsnprintf(msg, LOGLINE-1, format, ap);
+    va_end(ap);
+
+    const char *log_msg = loghead(&_success_log);
+    if ( rmheadmsg( &_success_log, msg ) ) {
+        eval_error( "Invalid success log message, expected '%s', got '%s'",
+            msg, log_msg );
+        return 0;
+    } else { 
+        eval_success( "Success log ok: '%s'", log_msg );
+        return 1;
+    }
+}
 
 /**
- * @brief Evaluate implementation calling of sleep function
- * Requires data in global _eval_sleep_data
+ * @brief Checks if the supplied message (specified by format and optionally additional values)
+ * is at the head of the error log.
  * 
- * .action behavior:
- *   ACTION_ERROR       (interrupted by signal) Return 1
- *   ACTION_LOG         (log) Log function call and proceed with ACTION_SUCCESS
- *   ACTION_SUCCESS     (success) Return 0
- *   ACTION_DEFAULT     call sleep(seconds)
+ * If true, removes head line and returns 0, otherwise issues an error message.
  * 
- * @param seconds   Number of seconds to sleep
- * @return          Evalation result or result of sleep operation
+ * @param format    Format for message
+ * @param ...       (optional) additional values
+ * @return int      1 on success, 0 if message not found at head
  */
-unsigned int _eval_sleep(unsigned int seconds) {
+int eval_check_errorlog( const char *restrict format, ...) {
+    char msg[LOGLINE];
 
-#ifdef _EVAL_DEBUG
-    printf( _EVAL_DEBUG_PREFIX "sleep( %d )\n", seconds );
-#endif
+    va_list ap;
+    va_start(ap, format);
+    vsnprintf(msg, LOGLINE-1, format, ap);
+    va_end(ap);
 
-    _eval_sleep_data.status ++;
-    _eval_sleep_data.seconds = seconds;
-    switch( _eval_sleep_data.action ) {
-    case(ACTION_ERROR): // Interrupted by signal
-        _eval_sleep_data.ret = 1;
-        break;
-    case(ACTION_LOG):
-        datalog("sleep,%d", seconds );
-    case(ACTION_SUCCESS): // success (finished sleep)
-        _eval_sleep_data.ret = 0;
-        break;
-    case(ACTION_BLOCK):
-        eval_error("sleep() called, aborting");
-        siglongjmp(_eval_env.jmp, EVAL_CATCH_BLOCKED );
-        break;
-    default:
-        _eval_sleep_data.ret = sleep( seconds );
+    const char *err_msg = loghead(&_error_log);
+    if ( rmheadmsg( &_error_log, msg ) ) {
+        eval_error( "Invalid error log message, expected '%s', got '%s'",
+            msg, err_msg );
+        return 0;
+    } else { 
+        eval_success( "Error log ok: '%s'", err_msg );
+        return 1;
     }
-    return _eval_sleep_data.ret;
 }
 
 /**
- * @brief Global _eval_fork_data variable for the fork() function
- * 
+ * Clears both success and error logs
  */
-EVAL_VAR(fork);
+void eval_clear_logs( void ) {
+    initlog( &_success_log );
+    initlog( &_error_log );
+    initlog( &_data_log );
+}
 
 /**
- * @brief Evaluate implementation calling of fork function
- * Requires data in global _eval_fork_data
- * 
- * .action behavior:
- * + `ACTION_ERROR`   - (error) Return -1
- * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`
- * + `ACTION_SUCCESS` - (success) Return value previously set in `_eval_fork_data.ret`.
- *                      If the value was less than 0 it is set to 0. If we want the 
- *                      command to behave as if it returns in the parent process, we 
- *                      should set this to a value `>= 1`.
- * + `ACTION_DEFAULT` - Capture parameters and call `fork()`
+ * Clears both success and error logs, and prints remaning messages if any
+ */
+void eval_close_logs( char msg[] ) {
+    if ( _success_log.start < _success_log.end ) {
+        eval_info( "%s Remaining messages on success log", msg );
+        for( int i = _success_log.start; i != _success_log.end; i++ ) {
+            printf("%3d - %s\n", i, logline( &_success_log, i ));
+        }
+    } 
+
+    if ( _error_log.start < _error_log.end ) {
+        eval_info( "%s Remaining messages on error log", msg );
+        for( int i = _error_log.start; i != _error_log.end; i++ ) {
+            printf("%3d - %s\n", i, logline( &_error_log, i ));
+        }
+    } 
+    
+    eval_clear_logs( );
+}
+
+/**
+ * @brief Checks errors at section completion
  * 
- * @return          Evalation result or result of fork operation
+ * @param msg   Message to print
+ * @return int  Total of errors found
  */
-pid_t _eval_fork(void) {
-    _eval_fork_data.status ++;
-    switch( _eval_fork_data.action ) {
-    case(ACTION_ERROR): // error
-        _eval_fork_data.ret = -1;
-        break;
-    case(ACTION_LOG):
-        datalog("fork");
-    case(ACTION_SUCCESS): // success
-        // Returns the value present in _eval_fork_data.ret
-        if ( _eval_fork_data.ret < 0 ) _eval_fork_data.ret = 0;
-        break;
-    case(ACTION_BLOCK):
-        eval_error("fork() called, aborting");
-        siglongjmp(_eval_env.jmp, EVAL_CATCH_BLOCKED );
-        break;
-    default:
-        _eval_fork_data.ret = fork( );
+int eval_complete( char msg[] ) {
+    if ( _eval_stats.error > 0 ) {
+        printf("\033[1;31m[✗]\033[0m %s completed with %d error(s).\n", msg, _eval_stats.error );
+    } else {
+        printf("\033[1;32m[✔]\033[0m %s completed with no errors.\n", msg );
     }
-    return _eval_fork_data.ret;
+    printf("\n");
+    fflush( stdout );
+    _eval_report_section( msg );
+    eval_report_flush();
+    return _eval_stats.error;
 }
 
 /**
- * @brief Global _eval_wait_data variable for the wait() function
+ * @brief Output buffer for stdout, used when stdout is not a terminal
  * 
  */
-EVAL_VAR(wait);
+static char _eval_msg_sink[ EVAL_MSG_SINK ];
 
 /**
- * Evaluate implementation calling of wait function
- * Requires data in global _eval_wait_data
+ * @brief Prints a message to stdout, prefixed by the supplied tag
  * 
- * .action behavior:
- * + `ACTION_ERROR`   - (error) Return -1
- * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`
- * + `ACTION_SUCCESS` - (success) Return value previously set in `_eval_fork_data.ret`. 
- *                      If the value was less than 0 it is set to 0.
- * + `ACTION_DEFAULT` - Capture parameters and call `wait(stat_loc)`
- *
- * @return          Evalation result or result of wait operation
+ * The message is formatted into a thread-local scratch buffer, only resorting
+ * to a heap allocation for messages longer than EVAL_MSG_SIZE. If stdout is
+ * not a terminal, it is switched to full buffering on the first call and
+ * messages are only written out when the buffer fills up, at
+ * eval_complete(), or when a signal is caught.
+ * 
+ * @param tag       Message tag (e.g. colored "[✗]")
+ * @param type      Message type for the structured report
+ * @param format    Format modifier
+ * @param ap        Values
  */
-pid_t _eval_wait(int *stat_loc) {
-
-    _eval_wait_data.status ++;
-
-    int err = 0;
-    if ( stat_loc != NULL ) {
-        if ( eval_checkptr( stat_loc ) != 0 ) {
-            eval_error("wait() called with invalid pointer (stat_loc)\n");
-            err++;
+static void _eval_msg( const char tag[], const char type[], const char *restrict format, va_list ap ) {
+    static _EVAL_THREAD_LOCAL char buffer[ EVAL_MSG_SIZE ];
+    static int sink = 0;
+
+    if ( ! sink ) {
+        sink = 1;
+        if ( ! isatty( STDOUT_FILENO ) ) {
+            fflush( stdout );
+            setvbuf( stdout, _eval_msg_sink, _IOFBF, sizeof( _eval_msg_sink ) );
         }
     }
 
-    switch( _eval_wait_data.action ) {
-
-    case(ACTION_ERROR): // error
-        _eval_wait_data.ret = -1;
-        errno = EINVAL;
-        break;
-
-    case(ACTION_LOG):
-        datalog("wait,%p", stat_loc);
+    const size_t tlen = strlen( tag );
+    memcpy( buffer, tag, tlen );
 
-    case(ACTION_SUCCESS): // success
-        if ( _eval_wait_data.ret < 0 ) _eval_wait_data.ret = 0;
-        if ( !err && stat_loc ) {
-            if ( _eval_wait_data.stat_loc ) *stat_loc = *_eval_wait_data.stat_loc;
-            else *stat_loc = 0;
-        }
-        break;
+    va_list aq;
+    va_copy( aq, ap );
+    int n = vsnprintf( buffer + tlen, sizeof(buffer) - tlen, format, ap );
+    if ( n < 0 ) n = 0;
 
-    case(ACTION_BLOCK):
-        eval_error("wait() called, aborting");
-        siglongjmp(_eval_env.jmp, EVAL_CATCH_BLOCKED );
-        break;
+    char *msg = buffer;
+    size_t len = tlen + n;
 
-    default:
-        if ( ! err ) {
-            _eval_wait_data.ret = wait( stat_loc );
+    if ( len + 1 >= sizeof( buffer ) ) {
+        // Message (and newline) does not fit in scratch buffer
+        msg = malloc( len + 2 );
+        if ( msg ) {
+            memcpy( msg, tag, tlen );
+            vsnprintf( msg + tlen, n + 1, format, aq );
         } else {
-            _eval_wait_data.ret = -1;
+            // Truncate message
+            msg = buffer;
+            len = sizeof( buffer ) - 2;
         }
     }
+    va_end( aq );
 
-    _eval_wait_data.stat_loc = stat_loc;
-    return _eval_wait_data.ret;
+    _eval_report_message( type, msg + tlen, len - tlen );
+
+    msg[ len++ ] = '\n';
+    fwrite( msg, 1, len, stdout );
+
+    if ( msg != buffer ) free( msg );
 }
 
 /**
- * @brief Global _eval_waipid_data variable for the waitpid() function
+ * @brief Prints error message and updates error counter
  * 
+ * @param format    Format modifier
+ * @param ...       Values
+ * @return int      Current number of errors
  */
-EVAL_VAR(waitpid);
+int eval_error(const char *restrict format, ...) {
+    va_list ap;
+
+    va_start(ap, format);
+    _eval_msg( "\033[1;31m[✗]\033[0m ", "error", format, ap );
+    va_end(ap);
+
+    _eval_stats.error++;
+
+    return _eval_stats.error;
+}
 
 /**
- * Evaluate implementation calling of waitpid function
- * Requires data in global _eval_waitpid_data
+ * @brief Prints info message and updates the info counter
  * 
- * Behavior:
- * + `ACTION_ERROR`   - (error) Return -1
- * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`
- * + `ACTION_SUCCESS` - (success) Return value previously set in `_eval_fork_data.ret`.
- *                      If the value was less than 0 it is set to 0. If `stat_loc` is
- *                      not NULL then `*stat_loc` will be set to `*_eval_wait_data.stat_loc`,
- *                      if this is not NULL, or 0 otherwise
- * + `ACTION_DEFAULT` - Capture parameters and call `waitpid(pid,stat_loc,options)`
- *
- * @return          Evalation result or result of wait operation
- */
-pid_t _eval_waitpid(pid_t pid, int *stat_loc, int options) {
+ * @param format    Format modifier
+ * @param ...       Values
+ * @return int      Current number of errors
+ */
+int eval_info(const char *restrict format, ...) {
+    va_list ap;
 
-    int err = 0;
-    if ( stat_loc != NULL ) {
-        if ( eval_checkptr( stat_loc ) != 0 ) {
-            eval_error("waitpid() called with invalid pointer (stat_loc)\n");
-            err ++;
-        }
-    }
+    va_start(ap, format);
+    _eval_msg( "\033[1;34m[ℹ︎]\033[0m ", "info", format, ap );
+    va_end(ap);
 
-    _eval_waitpid_data.status ++;
+    _eval_stats.info++;
 
+    return _eval_stats.info;
+}
 
-    switch( _eval_waitpid_data.action ) {
+/**
+ * @brief Prints success message and updates info counter
+ * 
+ * @param format    Format modifier
+ * @param ...       Values
+ * @return int      Current number of errors
+ */
+int eval_success(const char *restrict format, ...) {
+    va_list ap;
 
-    case(ACTION_ERROR):
-        _eval_waitpid_data.stat_loc = stat_loc;
-        _eval_waitpid_data.ret = -1;
-        errno = EINVAL;
-        break;
+    va_start(ap, format);
+    _eval_msg( "\033[1;32m[✔]\033[0m ", "success", format, ap );
+    va_end(ap);
 
-    case(ACTION_LOG):
-        datalog("waitpid,%d,%p,%d", pid,stat_loc,options);
+    _eval_stats.info++;
 
-    case(ACTION_SUCCESS):
-        if ( pid <= 0 ) {
-            _eval_waitpid_data.ret = _eval_waitpid_data.pid;
-        } else {
-            _eval_waitpid_data.ret = pid;
-        }
-        if ( !err && stat_loc ) {
-            if ( _eval_waitpid_data.stat_loc ) *stat_loc = *_eval_waitpid_data.stat_loc;
-            else *stat_loc = 0;
-        }
-        break;
+    return _eval_stats.info;
+}
 
-    case(ACTION_BLOCK):
-        eval_error("waitpid() called, aborting");
-        siglongjmp(_eval_env.jmp, EVAL_CATCH_BLOCKED );
-        break;
+/******************************************************************************
+ * Structured reports
+ *****************************************************************************/
 
-    default:
-        if ( ! err ) {
-            _eval_waitpid_data.ret = waitpid( pid, stat_loc, options );
-        } else {
-            _eval_waitpid_data.ret = -1;
-        }
-    }
+/**
+ * @brief Structured report state
+ * 
+ */
+static struct {
+    int fd;                 // Report file descriptor, -1 if not open
+    int format;             // EVAL_REPORT_JSONL or EVAL_REPORT_JUNIT
+    pid_t pid;              // Process that opened the report
+    int ncatch;             // EVAL_CATCH* blocks completed
+    char name[128];         // Name for subsequent records (eval_report_case())
+    size_t len;             // Buffered data size
+    char buffer[ EVAL_REPORT_BUFSIZE ];
+} _eval_report = {
+    .fd = -1
+};
 
-    _eval_waitpid_data.pid = pid;
-    _eval_waitpid_data.options = options;
-    _eval_waitpid_data.stat_loc = stat_loc;
+/**
+ * @brief Returns the structured report file descriptor
+ * 
+ * Used to keep the descriptor out of the file monitor (see
+ * _eval_close_filemon())
+ * 
+ * @return int      File descriptor, -1 if no report is open
+ */
+int _eval_report_fd( void ) {
+    return _eval_report.fd;
+}
 
-    return _eval_waitpid_data.ret;
+/**
+ * @brief Blocks signals while a report record is written
+ * 
+ * Signal handlers issue messages (eval_error()) and flush the report
+ * (eval_report_flush()), so they must not interrupt a record being added to
+ * the buffer. Faults (SIGSEGV, SIGBUS, SIGFPE, SIGILL) are not blocked.
+ * 
+ * @param old       (out) Previous signal mask, restored by
+ *                  _eval_report_unlock()
+ */
+static void _eval_report_lock( sigset_t *old ) {
+    sigset_t set;
+    sigfillset( &set );
+    sigdelset( &set, SIGSEGV );
+    sigdelset( &set, SIGBUS );
+    sigdelset( &set, SIGFPE );
+    sigdelset( &set, SIGILL );
+    pthread_sigmask( SIG_BLOCK, &set, old );
 }
 
 /**
- * @brief Global _eval_kill_data variable for the kill() function
+ * @brief Restores the signal mask saved by _eval_report_lock()
  * 
+ * @param old       Previous signal mask
  */
-EVAL_VAR(kill);
+static void _eval_report_unlock( const sigset_t *old ) {
+    pthread_sigmask( SIG_SETMASK, old, NULL );
+}
 
 /**
- * Evaluate implementation calling of kill function
- * Requires data in global _eval_kill_data
+ * @brief Writes out all buffered report records
  * 
- * Behavior:
- * + `ACTION_ERROR`   - (error) Return -1
- * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`
- * + `ACTION_SUCCESS` - (success) Return 0
- * + `ACTION_DEFAULT` - Capture parameters and call `kill(pid,sig)`
- * + `ACTION_PROTECT` - Same as default `ACTION_DEFAULT` but prevent routine from
- *                      signaling self, parent, process group and every process 
- *                      belonging to process owner
- *
- * @param pid   Process(es) to send signal to
- * @param sig   Signal to be sent
- * @return      error status
+ * Records are buffered and written in batches, when the buffer fills up,
+ * at eval_complete(), before forking, at the end of each test case worker
+ * and when the report is closed.
  */
-int _eval_kill(pid_t pid, int sig) {
-    _eval_kill_data.status ++;
-    _eval_kill_data.pid = pid;
-    _eval_kill_data.sig = sig;
+void eval_report_flush( void ) {
+    sigset_t old;
+    _eval_report_lock( &old );
+    for( size_t pos = 0; pos < _eval_report.len; ) {
+        ssize_t n = write( _eval_report.fd, _eval_report.buffer + pos, _eval_report.len - pos );
+        if ( n < 0 ) {
+            if ( errno == EINTR ) continue;
+            break;
+        }
+        pos += n;
+    }
+    _eval_report.len = 0;
+    _eval_report_unlock( &old );
+}
 
-    int err;
+/**
+ * @brief Adds data to the report buffer
+ * 
+ * @param data      Data to add
+ * @param len       Data size
+ */
+static void _eval_report_put( const char *data, size_t len ) {
+    if ( _eval_report.len + len > sizeof( _eval_report.buffer ) ) {
+        eval_report_flush();
+        if ( len > sizeof( _eval_report.buffer ) ) {
+            // Record larger than the buffer, write it directly
+            memcpy( _eval_report.buffer, data, sizeof( _eval_report.buffer ) );
+            _eval_report.len = sizeof( _eval_report.buffer );
+            eval_report_flush();
+            data += sizeof( _eval_report.buffer );
+            len -= sizeof( _eval_report.buffer );
+            _eval_report_put( data, len );
+            return;
+        }
+    }
+    memcpy( _eval_report.buffer + _eval_report.len, data, len );
+    _eval_report.len += len;
+}
 
-    switch( _eval_kill_data.action ) {
-    case(ACTION_ERROR): // error
-        _eval_kill_data.ret = -1;
-        errno = EINVAL;
-        break;
+/**
+ * @brief Ends a report record
+ * 
+ * The buffer is written out once it is half full, so that records are
+ * (normally) written whole, and records from different processes do not
+ * get mixed.
+ * 
+ * @param tail      Record terminator
+ * @param len       Terminator size
+ */
+static void _eval_report_end( const char *tail, size_t len ) {
+    _eval_report_put( tail, len );
+    if ( _eval_report.len >= sizeof( _eval_report.buffer ) / 2 ) eval_report_flush();
+}
 
-    case(ACTION_LOG): // log
-        datalog("kill,%d,%d", pid, sig );
+/**
+ * @brief Adds formatted text to the report buffer
+ * 
+ * @param format    printf() style format
+ * @param ...       Format arguments
+ */
+static void _eval_report_printf( const char *restrict format, ... ) {
+    char buffer[ 512 ];
+    va_list ap;
+    va_start( ap, format );
+    int n = vsnprintf( buffer, sizeof( buffer ), format, ap );
+    va_end( ap );
+    if ( n < 0 ) return;
+    if ( (size_t) n >= sizeof( buffer ) ) n = sizeof( buffer ) - 1;
+    _eval_report_put( buffer, n );
+}
 
-    case(ACTION_SUCCESS): // success
-        _eval_kill_data.ret = 0;
-        break;
+/**
+ * @brief Gets the length of a valid UTF-8 sequence
+ * 
+ * Overlong encodings, surrogates and code points above U+10FFFF are invalid
+ * 
+ * @param s         Sequence start
+ * @param len       Bytes available
+ * @return size_t   Sequence length (1 to 4), 0 if the sequence is invalid
+ */
+static size_t _eval_utf8_len( const unsigned char *s, size_t len ) {
+    size_t n;
+    unsigned char lo = 0x80, hi = 0xBF;
+
+    if ( s[0] < 0x80 ) return 1;
+    if ( s[0] >= 0xC2 && s[0] <= 0xDF ) n = 2;
+    else if ( s[0] >= 0xE0 && s[0] <= 0xEF ) {
+        n = 3;
+        if ( s[0] == 0xE0 ) lo = 0xA0;
+        if ( s[0] == 0xED ) hi = 0x9F;
+    } else if ( s[0] >= 0xF0 && s[0] <= 0xF4 ) {
+        n = 4;
+        if ( s[0] == 0xF0 ) lo = 0x90;
+        if ( s[0] == 0xF4 ) hi = 0x8F;
+    } else return 0;
+
+    if ( len < n || s[1] < lo || s[1] > hi ) return 0;
+    for( size_t i = 2; i < n; i++ )
+        if ( s[i] < 0x80 || s[i] > 0xBF ) return 0;
+    return n;
+}
 
-    case(ACTION_BLOCK):
-        eval_error("kill() called, aborting");
-        siglongjmp(_eval_env.jmp, EVAL_CATCH_BLOCKED );
-        break;
+/**
+ * @brief Adds a string to the report buffer, escaped for the report format
+ * 
+ * JSON strings include surrounding quotes, 'null' is written for NULL
+ * strings. ANSI escape sequences are removed, and invalid UTF-8 sequences
+ * are replaced by U+FFFD.
+ * 
+ * @param str       String
+ * @param len       String length
+ */
+static void _eval_report_str( const char *str, size_t len ) {
+    const int json = ( _eval_report.format == EVAL_REPORT_JSONL );
 
-    case(ACTION_PROTECT): // Catch bad pid values
-        err = 0;
-        if ( getpid() == pid ) {
-            eval_error("(kill) prevented sending signal to self");
-            err = 1;
-        }
+    if ( str == NULL ) {
+        if ( json ) _eval_report_put( "null", 4 );
+        return;
+    }
 
-        if ( getppid() == pid ) {
-            eval_error("(kill) prevented sending signal to parent");
-            err = 1;
-        }
+    if ( json ) _eval_report_put( "\"", 1 );
+    for( size_t i = 0; i < len; i++ ) {
+        unsigned char c = str[i];
+        char esc[8];
 
-        if ( 0 == pid ) {
-            eval_error("(kill) prevented sending signal to every process in the process group");
-            err = 1;
+        // Skip ANSI escape sequences (e.g. colors)
+        if ( c == 0x1b && i + 1 < len && str[ i + 1 ] == '[' ) {
+            for( i += 2; i < len && ! isalpha( (unsigned char) str[i] ); i++ );
+            continue;
         }
 
-        if ( -1 == pid ) {
-            eval_error("(kill) prevented sending signal to to every process belonging to process owner");
-            err = 1;
-        }
-        
-        if ( err ) {
-            _eval_kill_data.ret = 0;
-            break;
+        if ( json ) {
+            switch( c ) {
+            case( '"' ):  _eval_report_put( "\\\"", 2 ); continue;
+            case( '\\' ): _eval_report_put( "\\\\", 2 ); continue;
+            case( '\n' ): _eval_report_put( "\\n", 2 ); continue;
+            case( '\t' ): _eval_report_put( "\\t", 2 ); continue;
+            }
+            if ( c < 0x20 ) {
+                snprintf( esc, sizeof( esc ), "\\u%04x", c );
+                _eval_report_put( esc, 6 );
+                continue;
+            }
+        } else {
+            switch( c ) {
+            case( '&' ): _eval_report_put( "&amp;", 5 ); continue;
+            case( '<' ): _eval_report_put( "&lt;", 4 ); continue;
+            case( '>' ): _eval_report_put( "&gt;", 4 ); continue;
+            case( '"' ): _eval_report_put( "&quot;", 6 ); continue;
+            case( '\'' ): _eval_report_put( "&apos;", 6 ); continue;
+            }
+            // Control characters are not allowed in XML 1.0
+            if ( c < 0x20 && c != '\n' && c != '\t' ) continue;
         }
 
-    default:    // send signal
-        _eval_kill_data.ret = kill( pid, sig );
+        size_t n = _eval_utf8_len( (const unsigned char *) &str[i], len - i );
+        if ( n == 0 ) {
+            _eval_report_put( "\xEF\xBF\xBD", 3 );
+            continue;
+        }
+        _eval_report_put( &str[i], n );
+        i += n - 1;
     }
-    return _eval_kill_data.ret;
+    if ( json ) _eval_report_put( "\"", 1 );
 }
 
 /**
- * @brief Global _eval_raise_data variable for the raise() function
+ * @brief Name of the test case for the next record
  * 
+ * @return const char*  Runner test case name, name set by eval_report_case(),
+ *                      or NULL if none
  */
-EVAL_VAR(raise);
+static const char *_eval_report_name( void ) {
+    if ( _eval_runner.current >= 0 && _eval_runner.current < _eval_runner.ntests )
+        return _eval_runner.tests[ _eval_runner.current ].name;
+    if ( _eval_report.name[0] ) return _eval_report.name;
+    return NULL;
+}
 
 /**
- * @brief Evaluate implementation calling of raise function
- * Requires data in global _eval_raise_data
+ * @brief Writes the common fields of a JSON record
  * 
- * Behavior:
- * + `ACTION_ERROR`   - (error) Return -1
- * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`
- * + `ACTION_SUCCESS` - (success) Return 0
- * + `ACTION_DEFAULT` - Capture parameters and call `raise(sig)`
- *
- * @param sig       Signal to be sent
- * @return int      error status
+ * @param event     Event type
  */
-int _eval_raise( int sig ) {
-    _eval_raise_data.status ++;
-    _eval_raise_data.sig = sig;
+static void _eval_report_begin( const char event[] ) {
+    const char *name = _eval_report_name();
+    _eval_report_printf( "{\"event\":\"%s\",\"pid\":%d,\"case\":", event, (int) getpid() );
+    _eval_report_str( name, name ? strlen( name ) : 0 );
+}
 
-    switch( _eval_raise_data.action ) {
-    case(ACTION_ERROR):    // error
-        _eval_raise_data.ret = -1;
-        errno = EINVAL;
-        break;
+/**
+ * @brief Writes the _eval_stats counts of a JSON record
+ * 
+ * @param stats     Statistics
+ */
+static void _eval_report_stats( const eval_stats_t *stats ) {
+    _eval_report_printf( ",\"errors\":%d,\"info\":%d,\"success\":%d",
+        stats -> error, stats -> info, stats -> success );
+}
 
-    case(ACTION_LOG): // log
-        datalog("raise,%d", sig );
+/**
+ * @brief Writes a JUnit test case element
+ * 
+ * @param classname     Test case class name
+ * @param name          Test case name
+ * @param time          Test case time (s)
+ * @param failure       Failure message, NULL if the test case passed
+ * @param detail        Failure details / standard output, may be NULL
+ */
+static void _eval_report_junit( const char classname[], const char name[], double time,
+    const char failure[], const char detail[] ) {
+    _eval_report_put( "  <testcase classname=\"", 23 );
+    _eval_report_str( classname, strlen( classname ) );
+    _eval_report_put( "\" name=\"", 8 );
+    _eval_report_str( name, strlen( name ) );
+    _eval_report_printf( "\" time=\"%.6f\"", time );
+    if ( failure ) {
+        _eval_report_put( ">\n    <failure message=\"", 24 );
+        _eval_report_str( failure, strlen( failure ) );
+        _eval_report_put( "\">", 2 );
+        if ( detail ) _eval_report_str( detail, strlen( detail ) );
+        _eval_report_end( "</failure>\n  </testcase>\n", 25 );
+    } else if ( detail ) {
+        _eval_report_put( ">\n    <system-out>", 18 );
+        _eval_report_str( detail, strlen( detail ) );
+        _eval_report_end( "</system-out>\n  </testcase>\n", 28 );
+    } else {
+        _eval_report_end( "/>\n", 3 );
+    }
+}
 
-    case(ACTION_SUCCESS):    // success
-        _eval_raise_data.ret = 0;
-        break;
+/**
+ * @brief Closes the structured report at program exit
+ * 
+ */
+static void _eval_report_atexit( void ) {
+    if ( _eval_report.fd >= 0 && getpid() == _eval_report.pid ) eval_report_close();
+}
 
-    case(ACTION_BLOCK):
-        eval_error("raise() called, aborting");
-        siglongjmp(_eval_env.jmp, EVAL_CATCH_BLOCKED );
-        break;
+/**
+ * @brief Opens a structured report
+ * 
+ * Report records are written to a dedicated file descriptor, so they are not
+ * affected by stdout redirection (EVAL_CATCH_IO()) or by the output of the
+ * code being tested. The specification has the form "format:target", where
+ * format is "jsonl" (JSON Lines) or "junit" (JUnit XML) and target is a file
+ * name or "fd:N" for an already open file descriptor (which is duplicated).
+ * 
+ * @param spec      Report specification, if NULL use the EVAL_REPORT
+ *                  environment variable
+ * @return int      0 on success, 1 if no report was requested (spec is NULL
+ *                  and EVAL_REPORT is not set), -1 on error
+ */
+int eval_report_open( const char spec[] ) {
+    if ( spec == NULL ) {
+        spec = getenv( "EVAL_REPORT" );
+        if ( spec == NULL || spec[0] == 0 ) return 1;
+    }
 
-    default:    // raise signal
-        _eval_raise_data.ret = raise( sig );
+    int format;
+    const char *target;
+    if ( ! strncmp( spec, "jsonl:", 6 ) ) {
+        format = EVAL_REPORT_JSONL;
+        target = spec + 6;
+    } else if ( ! strncmp( spec, "junit:", 6 ) ) {
+        format = EVAL_REPORT_JUNIT;
+        target = spec + 6;
+    } else {
+        eval_error("(eval_report_open) Invalid report specification '%s'", spec );
+        return -1;
     }
-    return _eval_raise_data.ret;
+
+    int fd;
+    if ( ! strncmp( target, "fd:", 3 ) ) {
+        char *end;
+        errno = 0;
+        long n = strtol( target + 3, &end, 10 );
+        if ( end == target + 3 || *end != 0 || errno || n < 0 || n > INT_MAX ) {
+            eval_error("(eval_report_open) Invalid file descriptor '%s'", target + 3 );
+            return -1;
+        }
+        fd = fcntl( (int) n, F_DUPFD_CLOEXEC, 0 );
+    } else {
+        fd = open( target, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644 );
+    }
+    if ( fd < 0 ) {
+        eval_error("(eval_report_open) Unable to open report %s: %s", target, strerror( errno ) );
+        return -1;
+    }
+
+    eval_report_close();
+
+    static int atexit_set = 0;
+    if ( ! atexit_set ) {
+        atexit( _eval_report_atexit );
+        atexit_set = 1;
+    }
+
+    _eval_report.fd = fd;
+    _eval_report.format = format;
+    _eval_report.pid = getpid();
+    _eval_report.ncatch = 0;
+    _eval_report.len = 0;
+
+    if ( format == EVAL_REPORT_JUNIT ) {
+        _eval_report_printf( "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<testsuites>\n"
+            "<testsuite name=\"eval\">\n" );
+    }
+
+    return 0;
 }
 
 /**
- * @brief Global _eval_signal_data variable for the signal() function
+ * @brief Closes the structured report, writing out any buffered records
  * 
  */
-EVAL_VAR(signal);
+void eval_report_close( void ) {
+    if ( _eval_report.fd < 0 ) return;
+
+    sigset_t old;
+    _eval_report_lock( &old );
+    if ( _eval_report.format == EVAL_REPORT_JUNIT ) {
+        _eval_report_printf( "</testsuite>\n</testsuites>\n" );
+    }
+    eval_report_flush();
+    _eval_report_unlock( &old );
+    close( _eval_report.fd );
+    _eval_report.fd = -1;
+}
 
 /**
- * @brief Evaluate implementation calling of signal function
- * Requires data in global _eval_signal_data
- *
- * Note: The use of SIGPROF is reserved for the eval programs
- *
- * Behavior:
- * + `ACTION_ERROR`   - (error) Return `SIG_ERR`
- * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`
- * + `ACTION_SUCCESS` - (success) Return `SIG_DFL`
- * + `ACTION_DEFAULT` - Capture parameters and call `signal(signum,handler)`
+ * @brief Sets the test case name used in subsequent report records
  * 
- * @param signum    Signal to be handled
- * @param handler   Signal handler
- * @return          Previous value of signal handler, SIG_ERR on error
+ * Inside the parallel runner the name of the running test case is used
+ * instead.
+ * 
+ * @param name      Test case name (e.g. question key), NULL to clear
  */
-sighandler_t _eval_signal(int signum, sighandler_t handler) {
-#ifdef _EVAL_DEBUG
-    printf( _EVAL_DEBUG_PREFIX "signal( %d, %p )\n", signum, (void *) handler );
-#endif
-
-    _eval_signal_data.status ++;
-    _eval_signal_data.signum = signum;
-    _eval_signal_data.handler = handler;
+void eval_report_case( const char name[] ) {
+    _eval_report.name[0] = 0;
+    if ( name ) {
+        strncpy( _eval_report.name, name, sizeof( _eval_report.name ) - 1 );
+        _eval_report.name[ sizeof( _eval_report.name ) - 1 ] = 0;
+    }
+}
 
-    int bad_signal = 0;
+/**
+ * @brief Reports an eval_error() / eval_info() / eval_success() message
+ * 
+ * Only reported in JSON Lines reports
+ * 
+ * @param type      Message type ("error", "info" or "success")
+ * @param msg       Message text
+ * @param len       Message length
+ */
+void _eval_report_message( const char type[], const char *msg, size_t len ) {
+    if ( _eval_report.fd < 0 || _eval_report.format != EVAL_REPORT_JSONL ) return;
 
-    switch( signum ) {
-        case( SIGPROF ):
-            eval_error("(signal) Use of SIGPROF signal is reserved for eval");
-            bad_signal = 1;
-            break;
-        case( SIGSEGV ):
-            eval_error("(signal) Use of SIGSEGV signal is reserved for eval");
-            bad_signal = 1;
-            break;
-        case( SIGBUS ):
-            eval_error("(signal) Use of SIGBUS signal is reserved for eval");
-            bad_signal = 1;
-            break;
-        case( SIGFPE ):
-            eval_error("(signal) Use of SIGFPE signal is reserved for eval");
-            bad_signal = 1;
-            break;
-        case( SIGILL ):
-            eval_error("(signal) Use of SIGILL signal is reserved for eval");
-            bad_signal = 1;
-            break;
+    sigset_t old;
+    _eval_report_lock( &old );
+
+    _eval_report_begin( "message" );
+    _eval_report_printf( ",\"type\":\"%s\",\"text\":", type );
+    _eval_report_str( msg, len );
+    _eval_report_end( "}\n", 2 );
+    _eval_report_unlock( &old );
+}
+
+/**
+ * @brief Reports the termination of an EVAL_CATCH* block
+ * 
+ * Called at the end of _eval_disarm_signals(). Only reported in JSON Lines
+ * reports.
+ */
+void _eval_report_catch( void ) {
+    if ( _eval_report.fd < 0 ) return;
+    _eval_report.ncatch++;
+    if ( _eval_report.format != EVAL_REPORT_JSONL ) return;
+
+    sigset_t old;
+    _eval_report_lock( &old );
+
+    const char *term = eval_termination();
+    _eval_report_begin( "catch" );
+    _eval_report_printf( ",\"seq\":%d,\"stat\":%d,\"signal\":%d,\"exit_status\":%d,\"termination\":",
+        _eval_report.ncatch, _eval_env.stat, _eval_env.signal, _eval_exit_data.status );
+    _eval_report_str( term, strlen( term ) );
+    _eval_report_printf( ",\"cpu_time\":%.6f,\"wall_time\":%.6f", _eval_env.cpu_time, _eval_env.wall_time );
+    _eval_report_stats( &_eval_stats );
+    _eval_report_end( "}\n", 2 );
+    _eval_report_unlock( &old );
+}
+
+/**
+ * @brief Reports a question grade, set by question_setgrade()
+ * 
+ * @param key       Question key
+ * @param grade     Grade
+ */
+void _eval_report_grade( const char key[], float grade ) {
+    if ( _eval_report.fd < 0 ) return;
+
+    sigset_t old;
+    _eval_report_lock( &old );
+
+    if ( _eval_report.format == EVAL_REPORT_JSONL ) {
+        _eval_report_begin( "grade" );
+        _eval_report_put( ",\"key\":", 7 );
+        _eval_report_str( key, strnlen( key, 16 ) );
+        // JSON has no NaN or infinity
+        if ( isfinite( grade ) ) _eval_report_printf( ",\"grade\":%g", grade );
+        else _eval_report_put( ",\"grade\":null", 13 );
+        _eval_report_end( "}\n", 2 );
+    } else {
+        char name[32], detail[32];
+        snprintf( name, sizeof( name ), "%.16s", key );
+        snprintf( detail, sizeof( detail ), "grade=%g", grade );
+        _eval_report_junit( "grade", name, 0, NULL, detail );
     }
+    _eval_report_unlock( &old );
+}
 
-    if ( bad_signal ) {
-        _eval_signal_data.ret = SIG_ERR;
-        errno = EINVAL;
+/**
+ * @brief Reports the completion of a section, by eval_complete()
+ * 
+ * @param name      Section name
+ */
+void _eval_report_section( const char name[] ) {
+    if ( _eval_report.fd < 0 ) return;
+
+    sigset_t old;
+    _eval_report_lock( &old );
+
+    if ( name == NULL ) name = "";
+    if ( _eval_report.format == EVAL_REPORT_JSONL ) {
+        _eval_report_begin( "section" );
+        _eval_report_put( ",\"name\":", 8 );
+        _eval_report_str( name, strlen( name ) );
+        _eval_report_stats( &_eval_stats );
+        _eval_report_end( "}\n", 2 );
     } else {
-        switch( _eval_signal_data.action ) {
-        case(ACTION_ERROR):
-            _eval_signal_data.ret = SIG_ERR;
-            break;
-        case(ACTION_LOG):
-            datalog("signal,%d,%p", signum, handler );
-        case(ACTION_SUCCESS):
-            _eval_signal_data.ret = SIG_DFL;
-            break;
-        case(ACTION_BLOCK):
-            eval_error("signal() called, aborting");
-            siglongjmp(_eval_env.jmp, EVAL_CATCH_BLOCKED );
-            break;
-        default:
-            _eval_signal_data.ret = signal( signum, handler );
+        char failure[64];
+        snprintf( failure, sizeof( failure ), "%d error(s)", _eval_stats.error );
+        _eval_report_junit( "section", name, 0, ( _eval_stats.error > 0 ) ? failure : NULL, NULL );
+    }
+    _eval_report_unlock( &old );
+}
+
+/**
+ * @brief Reports the results of a parallel runner test case
+ * 
+ * Called by the parent process once the worker finishes
+ * 
+ * @param t         Test case results
+ */
+void _eval_report_test( const eval_test_t *t ) {
+    if ( _eval_report.fd < 0 ) return;
+
+    sigset_t old;
+    _eval_report_lock( &old );
+
+    if ( _eval_report.format == EVAL_REPORT_JSONL ) {
+        _eval_report_printf( "{\"event\":\"test\",\"pid\":%d,\"case\":", (int) getpid() );
+        _eval_report_str( t -> name, strnlen( t -> name, sizeof( t -> name ) ) );
+        _eval_report_printf( ",\"stat\":%d,\"signal\":%d,\"exit_status\":%d,\"termination\":",
+            t -> stat, t -> signal, t -> exit_status );
+        _eval_report_str( t -> termination, strnlen( t -> termination, sizeof( t -> termination ) ) );
+        _eval_report_printf( ",\"wall_time\":%.6f", t -> wall_time );
+        _eval_report_stats( &t -> stats );
+        _eval_report_printf( ",\"completed\":%d,\"timeout\":%d,\"wstatus\":%d,\"failed\":%d",
+            t -> completed, t -> timeout, t -> wstatus, t -> failed );
+        _eval_report_end( "}\n", 2 );
+    } else {
+        char name[ sizeof( t -> name ) + 1 ], failure[ 192 ];
+        snprintf( name, sizeof( name ), "%s", t -> name );
+        if ( t -> timeout ) {
+            snprintf( failure, sizeof( failure ), "worker killed after %g second(s)", _eval_runner.timeout );
+        } else if ( WIFSIGNALED( t -> wstatus ) ) {
+            snprintf( failure, sizeof( failure ), "worker terminated by signal %d", WTERMSIG( t -> wstatus ) );
+        } else if ( ! t -> completed ) {
+            snprintf( failure, sizeof( failure ), "worker terminated abnormally" );
+        } else {
+            snprintf( failure, sizeof( failure ), "%d error(s), %.128s", t -> stats.error, t -> termination );
         }
+        _eval_report_junit( "test", name, t -> wall_time, t -> failed ? failure : NULL,
+            t -> failed ? NULL : t -> termination );
     }
-    return _eval_signal_data.ret;
+    _eval_report_unlock( &old );
 }
 
 /**
- * @brief Global _eval_sigaction_data variable for the sigaction() function
+ * @brief Reports the results of a submission tested by eval_batch_run()
  * 
+ * Only reported in JSON Lines reports
+ * 
+ * @param sub       Submission results
  */
-EVAL_VAR(sigaction);
+void _eval_report_submission( const eval_submission_t *sub ) {
+    if ( _eval_report.fd < 0 || _eval_report.format != EVAL_REPORT_JSONL ) return;
+
+    sigset_t old;
+    _eval_report_lock( &old );
+
+    _eval_report_printf( "{\"event\":\"submission\",\"pid\":%d,\"path\":", (int) getpid() );
+    _eval_report_str( sub -> path, strlen( sub -> path ) );
+    _eval_report_printf( ",\"loaded\":%d,\"missing\":%d,\"ntests\":%d,\"failed\":%d",
+        sub -> loaded, sub -> missing, sub -> ntests, sub -> failed );
+    _eval_report_stats( &sub -> stats );
+    _eval_report_end( "}\n", 2 );
+    _eval_report_unlock( &old );
+}
 
 /**
- * @brief Evaluate implementation calling of sigaction function
- * Requires data in global _eval_sigaction_data
- *
- * Note: The use of SIGPROF is reserved for the eval programs
- *
- * Behavior:
- * + `ACTION_ERROR`   - (error) Return -1
- * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
- *                      Unless `act -> sa_flags` had the `SA_SIGINFO` bit set, the
- *                      function will be logged as if the corresponding `signal()`
- *                      call was made.
- * + `ACTION_SUCCESS` - (success) Return 0
- * + `ACTION_DEFAULT` - Capture parameters and call `sigaction(signum,act,oldact)`
+ * @brief Variable holding stdin and stdout descriptors (previous and current)
  * 
- * @param signum    Signal to be handled
- * @param act       Signal handler
- * @param oldaction Signal handler
- * @return          0 on success, -1 on error
  */
-int _eval_sigaction(int signum, const struct sigaction *act, struct sigaction *oldact) {
+_eval_stdio_t _eval_stdio;
 
-    int err = 0;
-    if ( act != NULL ) {
-        if ( eval_checkconstptr( act ) != 0 ) {
-            eval_error("sigaction() called with invalid pointer (act)\n");
-            err++;
-        }
+/**
+ * @brief Variable holding the memory buffers for EVAL_CATCH_MEMIO()
+ * 
+ */
+_eval_memio_t _eval_memio = {
+    .infd = -1,
+    .outfd = -1
+};
+
+/**
+ * @brief Sets the next I/O redirection to use memory buffers
+ * 
+ * Used by the EVAL_CATCH_MEMIO() macro
+ * 
+ * @param in        stdin data, if NULL no stdin redirection takes place
+ * @param len       stdin data size
+ */
+void _eval_memio_arm( const char* in, size_t len ) {
+    _eval_memio.active = 1;
+    _eval_memio.in = in;
+    _eval_memio.inlen = len;
+}
+
+/**
+ * @brief Creates an anonymous memory backed file
+ * 
+ * Uses memfd_create() if available, otherwise uses tmpfile()
+ * 
+ * @param tmp       (out) Temporary file used, if any
+ * @return int      File descriptor on success, -1 on error
+ */
+static int _eval_memfd( FILE **tmp ) {
+    *tmp = NULL;
+#if defined(__linux__) && defined(MFD_CLOEXEC)
+    int fd = memfd_create( "eval", MFD_CLOEXEC );
+    if ( fd >= 0 ) return fd;
+#endif
+    *tmp = tmpfile();
+    return ( *tmp ) ? fileno( *tmp ) : -1;
+}
+
+/**
+ * @brief Closes a memory file opened by _eval_memfd()
+ * 
+ * @param fd        File descriptor
+ * @param tmp       Temporary file used, if any
+ */
+static void _eval_memfd_close( int *fd, FILE **tmp ) {
+    if ( *tmp ) {
+        fclose( *tmp );
+        *tmp = NULL;
+    } else if ( *fd >= 0 ) {
+        close( *fd );
     }
+    *fd = -1;
+}
 
-    if ( oldact != NULL ) {
-        if ( eval_checkptr( oldact ) != 0 ) {
-            eval_error("sigaction() called with invalid pointer (oldact)\n");
-            err++;
+/**
+ * @brief Redirects stdin and stdout to memory files
+ * 
+ * Requires data in _eval_memio and _eval_stdio. On error the memory files
+ * are closed.
+ * 
+ * @return int      0 on success, -1 on error
+ */
+static int _eval_memio_redirect( void ) {
+
+    _eval_stdio.old_stdin = -1;
+    _eval_stdio.old_stdout = -1;
+
+    if ( _eval_memio.in ) {
+        if ( (_eval_memio.infd = _eval_memfd( &_eval_memio.intmp )) < 0 ) {
+            eval_error("Unable to create memory file for stdin");
+            goto fail;
+        }
+
+        for( size_t pos = 0; pos < _eval_memio.inlen; ) {
+            ssize_t n = write( _eval_memio.infd, _eval_memio.in + pos, _eval_memio.inlen - pos );
+            if ( n < 0 ) {
+                if ( errno == EINTR ) continue;
+                eval_error("Unable to write stdin data to memory file");
+                goto fail;
+            }
+            pos += n;
+        }
+        lseek( _eval_memio.infd, 0, SEEK_SET );
+
+        if ( (_eval_stdio.old_stdin = dup( STDIN_FILENO )) < 0 ) {
+            eval_error("Unable to duplicate STDIN_FILENO");
+            goto fail;
+        }
+
+        if ( dup2( _eval_memio.infd, STDIN_FILENO ) < 0 ) {
+            eval_error("Unable to associate memory file with stdin");
+            goto fail;
         }
     }
 
-    _eval_sigaction_data.status ++;
-    _eval_sigaction_data.signum = signum;
-    _eval_sigaction_data.act = (struct sigaction *) act;
-    _eval_sigaction_data.oldact = oldact;
+    if ( (_eval_memio.outfd = _eval_memfd( &_eval_memio.outtmp )) < 0 ) {
+        eval_error("Unable to create memory file for stdout");
+        goto fail;
+    }
 
-    int bad_signal = 0;
+    if ( (_eval_stdio.old_stdout = dup( STDOUT_FILENO )) < 0 ) {
+        eval_error("Unable to duplicate STDOUT_FILENO");
+        goto fail;
+    }
 
-    switch( signum ) {
-        case( SIGPROF ):
-            eval_error("(sigaction) Use of SIGPROF signal is reserved for eval");
-            bad_signal = 1;
-            break;
-        case( SIGSEGV ):
-            eval_error("(sigaction) Use of SIGSEGV signal is reserved for eval");
-            bad_signal = 1;
-            break;
-        case( SIGBUS ):
-            eval_error("(sigaction) Use of SIGBUS signal is reserved for eval");
-            bad_signal = 1;
-            break;
-        case( SIGFPE ):
-            eval_error("(sigaction) Use of SIGFPE signal is reserved for eval");
-            bad_signal = 1;
-            break;
-        case( SIGILL ):
-            eval_error("(sigaction) Use of SIGILL signal is reserved for eval");
-            bad_signal = 1;
-            break;
+    if ( dup2( _eval_memio.outfd, STDOUT_FILENO ) < 0 ) {
+        fprintf(stderr, "Unable to associate memory file with stdout\n");
+        eval_error("Unable to associate memory file with stdout");
+        goto fail;
     }
 
-    if ( bad_signal ) {
-        _eval_sigaction_data.ret = -1;
-        errno = EINVAL;
-    } else {
-        switch( _eval_sigaction_data.action ) {
-        case(ACTION_ERROR):
-            _eval_sigaction_data.ret = -1;
-            break;
-        case(ACTION_LOG):
-            if ( act -> sa_flags & SA_SIGINFO ) {
-                datalog("sigaction,%d,%p", signum, act->sa_sigaction );
-            } else {
-                datalog("signal,%d,%p", signum, act->sa_handler );
+    return 0;
+
+fail:
+    // Stdin and stdout (if redirected) are restored by _eval_io_restore()
+    _eval_memfd_close( &_eval_memio.infd, &_eval_memio.intmp );
+    _eval_memfd_close( &_eval_memio.outfd, &_eval_memio.outtmp );
+    return -1;
+}
+
+/**
+ * @brief Copies the captured stdout data to _eval_memio.out and closes the
+ * memory files
+ * 
+ * Must be called after stdout has been restored
+ * 
+ * @return int      0 on success, -1 on error
+ */
+static int _eval_memio_close( void ) {
+    int ret = 0;
+
+    _eval_memio.outlen = 0;
+    if ( _eval_memio.outfd >= 0 ) {
+        off_t size = lseek( _eval_memio.outfd, 0, SEEK_END );
+        if ( size < 0 ) size = 0;
+
+        if ( _eval_memio.outsize < (size_t) size + 1 || _eval_memio.out == NULL ) {
+            char *out = realloc( _eval_memio.out, size + 1 );
+            if ( out == NULL ) {
+                perror("_eval_memio_close: (*critical*) Unable to allocate stdout buffer");
+                exit(1);
             }
-        case(ACTION_SUCCESS):
-            _eval_sigaction_data.ret = 0;
-            break;
-        case(ACTION_BLOCK):
-            eval_error("sigaction() called, aborting");
-            siglongjmp(_eval_env.jmp, EVAL_CATCH_BLOCKED );
-            break;
-        default:
-            if ( ! err ) {
-                _eval_sigaction_data.ret = sigaction( signum, act, oldact );
-            } else {
-                _eval_sigaction_data.ret = -1;
+            _eval_memio.out = out;
+            _eval_memio.outsize = size + 1;
+        }
+
+        while( _eval_memio.outlen < (size_t) size ) {
+            ssize_t n = pread( _eval_memio.outfd, _eval_memio.out + _eval_memio.outlen,
+                size - _eval_memio.outlen, _eval_memio.outlen );
+            if ( n < 0 && errno == EINTR ) continue;
+            if ( n <= 0 ) {
+                fprintf(stderr, "Unable to read stdout data from memory file\n");
+                ret = -1;
+                break;
             }
+            _eval_memio.outlen += n;
         }
+        _eval_memio.out[ _eval_memio.outlen ] = 0;
     }
-    return _eval_sigaction_data.ret;
+
+    _eval_memfd_close( &_eval_memio.infd, &_eval_memio.intmp );
+    _eval_memfd_close( &_eval_memio.outfd, &_eval_memio.outtmp );
+    _eval_memio.active = 0;
+
+    return ret;
 }
 
 /**
- * @brief Global _eval_pause_data variable for the pause() function
+ * @brief Redirects stdin and stdout to files
+ *
+ * Requires data in _eval_stdio
  * 
+ * @param stdin     File name for stdin. If set to NULL no redirection takes place
+ * @param stdout    File name for stdout. If set to NULL no redirection takes place
+ * @return int      0 on success
  */
-EVAL_VAR(pause);
+int _eval_io_redirect( const char* _fstdin, const char* _fstdout ) {
 
-/**
- * @brief Evaluate implementation calling of pause() function
- * Requires data in global _eval_pause_data
- * 
- * Behavior:
- * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
- * + `ACTION_SUCCESS` - (success) Return -1. Note: the `pause()` command always
- *                      returns -1.
- * + `ACTION_DEFAULT` - Call `pause()`
- *
- * @return          Always returns -1
- */
-int _eval_pause(void) {
-    _eval_pause_data.status ++;
+    // Flush any pending output to the console
+    fflush( stdout );
 
-    switch( _eval_pause_data.action ) {
-    case(ACTION_LOG):
-        datalog("pause");
-    case(ACTION_SUCCESS):
-        _eval_pause_data.ret = -1;
-        break;
-    case(ACTION_BLOCK):
-        eval_error("pause() called, aborting");
-        siglongjmp(_eval_env.jmp, EVAL_CATCH_BLOCKED );
-        break;
-    default:
-        _eval_pause_data.ret = pause( );
+    if ( _eval_memio.active ) return _eval_memio_redirect();
+
+    if ( _fstdin ) {
+        if ( (_eval_stdio.old_stdin = dup( STDIN_FILENO ))< 0 ) {
+            eval_error("Unable to duplicate STDIN_FILENO");
+            return -1;
+        }
+
+        int new_stdin;
+        if ( (new_stdin = open( _fstdin, O_RDONLY )) < 0 ) {
+            eval_error("Unable to open file %s as read-only", _fstdin);
+            return -1;
+        }
+        if ( (dup2( new_stdin, STDIN_FILENO )) < 0 ) {
+            eval_error("Unable to associate file %s with stdin", _fstdin);
+            return -1;
+        };
+
+        if ( close(new_stdin) < 0 ) {
+            eval_error("Unable to close fd %d", new_stdin );
+            return -1;
+        };
+
+    } else {
+        _eval_stdio.old_stdin = -1;
+    }
+
+    if ( _fstdout ) {
+        if ( (_eval_stdio.old_stdout = dup( STDOUT_FILENO )) < 0 ) {
+            fprintf(stderr, "Unable to duplicate STDOUT_FILENO\n");
+            eval_error("Unable to duplicate STDOUT_FILENO");
+            return -1;
+        }
+
+        int new_stdout;
+        if ( (new_stdout = open( _fstdout, O_CREAT | O_WRONLY | O_TRUNC, 0600 )) < 0 ) {
+            fprintf(stderr, "Unable to open file %s as write-only\n", _fstdout);
+            eval_error("Unable to open file %s as write-only", _fstdout);
+            return -1;
+        }
+
+        if ( (dup2( new_stdout, STDOUT_FILENO )) < 0 ) {
+            fprintf(stderr, "Unable to associate file %s with stdout\n", _fstdout);
+            eval_error("Unable to associate file %s with stdout", _fstdout);
+            return -1;
+        }
+
+        if ( close( new_stdout ) < 0 ) {
+            fprintf(stderr, "Unable to close new_stdout file descriptor\n");
+            return -1;
+        }
+
+    } else {
+        _eval_stdio.old_stdout = -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Restores stdin and stdout to console
+ *
+ * Requires data in _eval_stdio
+ *
+ * @return int      0 on success
+ */
+int _eval_io_restore( void ) {
+
+    if ( _eval_stdio.old_stdout != -1 ) {
+
+        // Flush any remaining data to disk
+        // If this is not done then this data will be sent to the next STDOUT device
+        fflush( stdout );
+
+        if ( dup2( _eval_stdio.old_stdout, STDOUT_FILENO ) < 0 ) {
+            fprintf(stderr, "Unable to reassociate STDOUT with console\n" );
+            return -1;
+        }
+
+        if ( close( _eval_stdio.old_stdout ) < 0 ) {
+            fprintf(stderr, "Unable to close old_stdout file\n" );
+            return -1;
+        }
+    }
+
+    if ( _eval_stdio.old_stdin != -1 ) {
+
+        // Clear any remaining data on stdin
+        // If this is not done then it will remain in STDIN
+        fflush( stdin );
+        clearerr( stdin );
+
+        if ( dup2( _eval_stdio.old_stdin, STDIN_FILENO ) < 0 ) {
+            fprintf(stderr, "Unable to reassociate STDIN with console\n" );
+            return -1;
+        }
+
+        if ( close( _eval_stdio.old_stdin ) < 0 ) {
+            fprintf(stderr, "Unable to close old_stdin file\n" );
+            return -1;
+        }
+    }
+
+    if ( _eval_memio.active ) return _eval_memio_close();
+
+    return 0;
+}
+
+/**
+ * @brief Initialize file monitor variable
+ * 
+ * This value will be used to check if the test routine left any files open
+ */
+void _eval_init_filemon( void ) {    
+    // Get the file descriptor value of a new file
+    // All files opened from test code should have a descriptor >= than this
+    _eval_env.filemon = dup(STDERR_FILENO);
+    close(_eval_env.filemon);
+}
+
+/**
+ * @brief Gets the path of the file associated with a file descriptor
+ * 
+ * @param fd        File descriptor
+ * @param path      (out) File path, "<unknown>" if not available
+ * @param size      Size of path buffer
+ */
+static void _eval_fd_path( int fd, char path[], size_t size ) {
+    ssize_t len = -1;
+#if defined(__linux__)
+    char link[64];
+    snprintf( link, sizeof(link), "/proc/self/fd/%d", fd );
+    len = readlink( link, path, size - 1 );
+    if ( len >= 0 ) path[len] = 0;
+#elif defined(F_GETPATH)
+    char buffer[PATH_MAX];
+    if ( fcntl( fd, F_GETPATH, buffer ) != -1 ) {
+        strncpy( path, buffer, size - 1 );
+        path[ size - 1 ] = 0;
+        len = strlen( path );
+    }
+#endif
+    if ( len < 0 ) {
+        strncpy( path, "<unknown>", size - 1 );
+        path[ size - 1 ] = 0;
+    }
+}
+
+/**
+ * @brief Gets the list of open file descriptors >= _eval_env.filemon
+ * 
+ * The list is obtained from the /proc/self/fd (Linux) or /dev/fd (macOS)
+ * directories.
+ * 
+ * @param fds       (out) List of open file descriptors, must be freed by the caller
+ * @return int      Number of open file descriptors or -1 if the list is not
+ *                  available
+ */
+static int _eval_open_fds( int **fds ) {
+#if defined(__linux__)
+    DIR *dir = opendir( "/proc/self/fd" );
+#elif defined(__APPLE__)
+    DIR *dir = opendir( "/dev/fd" );
+#else
+    DIR *dir = NULL;
+#endif
+    if ( dir == NULL ) return -1;
+
+    const int self = dirfd( dir );
+    int n = 0, size = 0;
+    *fds = NULL;
+
+    struct dirent *entry;
+    while( ( entry = readdir( dir ) ) != NULL ) {
+        char *end;
+        long fd = strtol( entry -> d_name, &end, 10 );
+        if ( *end != 0 || end == entry -> d_name ) continue;
+        if ( fd < _eval_env.filemon || fd == self || fd == _eval_report_fd() ) continue;
+
+        if ( n >= size ) {
+            size = ( size > 0 ) ? 2 * size : 16;
+            int *tmp = realloc( *fds, size * sizeof(int) );
+            if ( tmp == NULL ) {
+                free( *fds );
+                closedir( dir );
+                return -1;
+            }
+            *fds = tmp;
+        }
+        (*fds)[n++] = fd;
+    }
+    closedir( dir );
+
+    return n;
+}
+
+/**
+ * @brief Closes any files open (besides STDIN, STDOUT and STDERR)
+ * 
+ * Requires values in _eval_env.filemon
+ */
+void _eval_close_filemon( void ) {
+
+    // Inside a session only probe the first few descriptors from .filemon,
+    // with a full scan every EVAL_SESSION_FDSCAN blocks
+    if ( _eval_env.session ) {
+        static unsigned long blocks = 0;
+        int scan = ( ++blocks % EVAL_SESSION_FDSCAN == 0 );
+        for( int fd = _eval_env.filemon; ! scan && fd < _eval_env.filemon + EVAL_SESSION_FDPROBE; fd++ )
+            if ( fd != _eval_report_fd() && fcntl( fd, F_GETFD ) >= 0 ) scan = 1;
+        if ( ! scan ) return;
+    }
+
+    int *fds;
+    int nfiles = _eval_open_fds( &fds );
+
+    if ( nfiles >= 0 ) {
+        if ( nfiles > 0 ) {
+            if ( nfiles == 1 ) {
+                eval_error("1 file was not closed" );
+            } else {
+                eval_error("%d files were not closed", nfiles );
+            }
+
+            for( int i = 0; i < nfiles; i++ ) {
+                char path[PATH_MAX];
+                _eval_fd_path( fds[i], path, sizeof(path) );
+                printf("%3d - %s\n", fds[i], path );
+                if ( close( fds[i] ) && errno != EBADF ) {
+                    perror("_eval_close_filemon: Unable to close file");
+                }
+            }
+        }
+        free( fds );
+        return;
+    }
+
+    // File descriptor list is not available, go through all possible
+    // file descriptors starting from .filemon
+    const int maxfd=sysconf(_SC_OPEN_MAX);
+
+    nfiles = 0;
+    for( int fd = _eval_env.filemon; fd < maxfd; fd++ ) {
+        if ( fd == _eval_report_fd() ) continue;
+        if ( close(fd) ) {
+            // If file was not open, errno is set to EBADF
+            if ( errno != EBADF ) {
+                // File is opened but close failed for another reason
+                nfiles++;
+                perror("_eval_close_filemon: Unable to close file");
+            }
+        } else {
+            // File closed successfully
+            nfiles++;
+        }
+    }
+
+    if ( nfiles > 0 ) {
+        if ( nfiles == 1 ) {
+            eval_error("1 file was not closed" );
+        } else {
+            eval_error("%d files were not closed", nfiles );
+        }
+    }
+
+}
+
+/**
+ * @brief Resets the _eval_stats variable
+ * 
+ */
+void eval_reset_stats( void ) {
+    _eval_stats.error = 0;
+    _eval_stats.info = 0;
+}
+
+/**
+ * @brief Variable holding data for the signal based pointer check
+ * 
+ */
+struct {
+    int stat;
+    int sig;
+    sigjmp_buf jmp;
+    char buffer;
+    void *addr;
+}_eval_checkptr_data;
+
+/**
+ * @brief Signal handler for the signal based pointer check
+ * Requires data in the _eval_checkptr_data variable
+ * 
+ * @param sig 
+ * @param info 
+ * @param ucontext 
+ */
+void _eval_checkptr_sighndlr( int sig, siginfo_t *info, void *ucontext) {
+    _eval_checkptr_data.stat = 1;
+    _eval_checkptr_data.sig = sig;
+    siglongjmp( _eval_checkptr_data.jmp, 1 );
+}
+
+/**
+ * @brief Checks a memory range by accessing 1 byte in every page spanned by
+ * the range, catching any SIGSEGV / SIGBUS signals
+ * 
+ * @param ptr       Start of memory range
+ * @param len       Size of memory range (bytes), must be > 0
+ * @param mode      Access type to check, may be EVAL_CHECK_READ, EVAL_CHECK_WRITE
+ *                  or both
+ * @return int      0 on success, signal number raised otherwise
+ */
+static int _eval_checkrange_probe( const void *ptr, size_t len, int mode ) {
+
+    // Catch SIGSEGV and SIGBUS
+    struct sigaction act = {
+        .sa_flags = SA_SIGINFO | SA_RESTART,
+        .sa_sigaction = _eval_checkptr_sighndlr
+    };
+    struct sigaction tmp[2];
+
+    if ( sigaction( SIGSEGV, &act, &tmp[0] ) < 0 ) {
+        perror("eval_checkptr: (*critical*) Unable to set SIGSEGV handler");
+        exit(1);
+    };
+
+    if ( sigaction( SIGBUS, &act, &tmp[1] ) < 0 ) {
+        perror("eval_checkptr: (*critical*) Unable to set SIGBUS handler");
+        exit(1);
+    };
+
+    // Reset _eval_checkptr_data
+    _eval_checkptr_data.stat = 0;
+    _eval_checkptr_data.sig = -1;
+
+    const uintptr_t pagesize = sysconf( _SC_PAGESIZE );
+    const uintptr_t last = (uintptr_t) ptr + ( len - 1 );
+
+    // Access memory in the range, invalid pointers will throw a signal
+    _eval_checkptr_data.addr = (void *) ptr;
+    int stat = sigsetjmp( _eval_checkptr_data.jmp, 1 );
+    if ( !stat ) {
+        for(;;) {
+            volatile char *p = (volatile char *) _eval_checkptr_data.addr;
+            _eval_checkptr_data.buffer = *p;
+            if ( mode & EVAL_CHECK_WRITE ) *p = _eval_checkptr_data.buffer;
+
+            uintptr_t next = ( (uintptr_t) p & ~( pagesize - 1 ) ) + pagesize;
+            if ( (uintptr_t) p == last ) break;
+            _eval_checkptr_data.addr = (void *) (( next <= last && next > (uintptr_t) p ) ? next : last);
+        }
+    }
+
+    // Restore previous signal handlers
+    if ( sigaction( SIGSEGV, &tmp[0], NULL ) < 0 ) {
+        perror("eval_checkptr: (*critical*) Unable to reset SIGSEGV handler");
+        exit(1);
+    };
+
+    if ( sigaction( SIGBUS, &tmp[1], NULL ) < 0 ) {
+        perror("eval_checkptr: (*critical*) Unable to reset SIGBUS handler");
+        exit(1);
+    };
+
+    return ( _eval_checkptr_data.stat ) ? _eval_checkptr_data.sig : 0;
+}
+
+/**
+ * @brief Memory region from the process memory map
+ * 
+ */
+typedef struct {
+    uintptr_t start;
+    uintptr_t end;
+    int mode;
+} _eval_map_region_t;
+
+/**
+ * @brief Cached snapshot of the process memory map, used by eval_checkrange()
+ * 
+ * Regions are sorted by address. The snapshot is refreshed whenever a range
+ * check fails, and discarded by eval_checkrange_invalidate().
+ */
+struct {
+    int valid;
+    int n;
+    int size;
+    _eval_map_region_t *region;
+} _eval_maps;
+
+/**
+ * @brief Marks the cached process memory map as stale
+ * 
+ * Must be called after memory is unmapped, so that eval_checkrange() does not
+ * report the corresponding addresses as valid.
+ */
+void eval_checkrange_invalidate( void ) {
+    _eval_maps.valid = 0;
+}
+
+/**
+ * @brief Reloads the process memory map from /proc/self/maps
+ * 
+ * @return int  0 on success, -1 if the memory map is not available
+ */
+static int _eval_maps_refresh( void ) {
+#ifdef __linux__
+    _eval_maps.valid = 0;
+    _eval_maps.n = 0;
+
+    int fd = open( "/proc/self/maps", O_RDONLY | O_CLOEXEC );
+    if ( fd < 0 ) return -1;
+
+    char buffer[4096];
+    size_t len = 0;
+    ssize_t nread;
+
+    // Only the address range and permissions at the start of each line are
+    // needed, so overlong lines (long paths) are cut after this many bytes
+    const size_t head = 64;
+    int skip = 0;
+
+    while( ( nread = read( fd, buffer + len, sizeof(buffer) - 1 - len ) ) > 0 || 
+           ( nread < 0 && errno == EINTR ) ) {
+        if ( nread < 0 ) continue;
+
+        if ( skip ) {
+            // Discard the rest of an overlong line, up to the newline
+            char *eol = memchr( buffer + len, '\n', nread );
+            if ( eol == NULL ) continue;
+            nread = buffer + len + nread - eol;
+            memmove( buffer + len, eol, nread );
+            skip = 0;
+        }
+
+        len += nread;
+        buffer[len] = 0;
+
+        // Parse all complete lines in buffer
+        char *line = buffer, *eol;
+        while( ( eol = strchr( line, '\n' ) ) != NULL ) {
+            char *p;
+            uintptr_t start = strtoull( line, &p, 16 );
+            uintptr_t end = ( *p == '-' ) ? strtoull( p + 1, &p, 16 ) : 0;
+
+            if ( end > start && *p == ' ' ) {
+                int mode = ( p[1] == 'r' ? EVAL_CHECK_READ : 0 ) |
+                           ( p[2] == 'w' ? EVAL_CHECK_WRITE : 0 );
+
+                _eval_map_region_t *last = ( _eval_maps.n > 0 ) ? 
+                    &_eval_maps.region[ _eval_maps.n - 1 ] : NULL;
+
+                if ( last && last -> end == start && last -> mode == mode ) {
+                    // Merge contiguous regions with the same access mode
+                    last -> end = end;
+                } else {
+                    if ( _eval_maps.n >= _eval_maps.size ) {
+                        int size = ( _eval_maps.size > 0 ) ? 2 * _eval_maps.size : 256;
+                        _eval_map_region_t *region = realloc( _eval_maps.region, 
+                            size * sizeof( _eval_map_region_t ) );
+                        if ( region == NULL ) {
+                            close( fd );
+                            return -1;
+                        }
+                        _eval_maps.region = region;
+                        _eval_maps.size = size;
+                    }
+                    _eval_maps.region[ _eval_maps.n ].start = start;
+                    _eval_maps.region[ _eval_maps.n ].end = end;
+                    _eval_maps.region[ _eval_maps.n ].mode = mode;
+                    _eval_maps.n++;
+                }
+            }
+            line = eol + 1;
+        }
+
+        // Keep incomplete line for the next read
+        len -= line - buffer;
+        memmove( buffer, line, len );
+
+        if ( len == sizeof(buffer) - 1 ) {
+            // No newline in a full buffer: keep the head of the line only
+            len = head;
+            skip = 1;
+        }
+    }
+    close( fd );
+
+    if ( _eval_maps.n == 0 ) return -1;
+    _eval_maps.valid = 1;
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+/**
+ * @brief Checks a memory range against the cached process memory map
+ * 
+ * @param start     Start of memory range
+ * @param last      Last address in memory range
+ * @param mode      Access type to check
+ * @param fault     (out) First invalid address in range
+ * @return int      1 if the whole range is accessible, 0 otherwise
+ */
+static int _eval_maps_lookup( uintptr_t start, uintptr_t last, int mode, uintptr_t *fault ) {
+    
+    // Binary search for the region containing start
+    int lo = 0, hi = _eval_maps.n - 1;
+    while( lo < hi ) {
+        int mid = ( lo + hi + 1 ) / 2;
+        if ( _eval_maps.region[mid].start <= start ) lo = mid; else hi = mid - 1;
+    }
+
+    uintptr_t addr = start;
+    for( int i = lo; i < _eval_maps.n; i++ ) {
+        const _eval_map_region_t *r = &_eval_maps.region[i];
+        if ( addr < r -> start || addr >= r -> end || ( r -> mode & mode ) != mode ) break;
+        if ( last < r -> end ) return 1;
+        addr = r -> end;
+    }
+
+    *fault = addr;
+    return 0;
+}
+
+/**
+ * Checks if a memory range is valid for reading and/or writing
+ * 
+ * On Linux the range is checked against a cached snapshot of the process
+ * memory map (/proc/self/maps), which requires no system calls unless the
+ * check fails, in which case the snapshot is reloaded and the range checked
+ * again. On other systems (or if the memory map is not available) every
+ * page in the range is accessed, catching any SIGSEGV / SIGBUS signals.
+ * 
+ * @param ptr   Start of memory range
+ * @param len   Size of memory range (bytes)
+ * @param mode  Access type to check, may be EVAL_CHECK_READ, EVAL_CHECK_WRITE
+ *              or EVAL_CHECK_READ | EVAL_CHECK_WRITE
+ * @return      0 if range is valid
+ *              1 NULL pointer
+ *              2 (-1) pointer
+ *              3 Segmentation fault when accessing range
+ *              4 Bus Error when accessing range
+ *              5 Invalid signal caught (should never happen)
+ */
+int eval_checkrange( const void *ptr, size_t len, int mode ) {
+
+    if ( ptr == NULL ) {
+        eval_error("NULL pointer");
+        return 1;
+    }
+
+    if ( ptr == (void *) -1 ) {
+        eval_error("Invalid pointer %p", ptr );
+        return 2;
+    }
+
+    if ( len == 0 ) return 0;
+
+    const uintptr_t start = (uintptr_t) ptr;
+    const uintptr_t last = start + ( len - 1 );
+    uintptr_t fault = start;
+
+    int sig;
+    if ( last < start ) {
+        // Range wraps around the address space
+        fault = 0;
+        sig = SIGSEGV;
+    } else if ( _eval_maps.valid && _eval_maps_lookup( start, last, mode, &fault ) ) {
+        return 0;
+    } else if ( _eval_maps_refresh() == 0 ) {
+        if ( _eval_maps_lookup( start, last, mode, &fault ) ) return 0;
+        sig = SIGSEGV;
+    } else {
+        sig = _eval_checkrange_probe( ptr, len, mode );
+        if ( sig == 0 ) return 0;
+        fault = (uintptr_t) _eval_checkptr_data.addr;
+    }
+
+    switch( sig ) {
+    case(SIGSEGV):
+        eval_error("(checkptr) Accessing %p caused Segmentation Fault", (void *) fault);
+        return 3;
+    case(SIGBUS):
+        eval_error("(checkptr) Accessing %p caused Bus Error", (void *) fault);
+        return 4;
+    default:
+        eval_error("(checkptr) Accessing %p caused unknonown signal", (void *) fault);
+        return 5;
+    }
+}
+
+/**
+ * Checks if a pointer is valid for reading/writing 1 byte from/to address
+ * @param ptr   Pointer to be evaluated
+ * @return      0 is pointer is valid
+ *              1 NULL pointer
+ *              2 (-1) pointer
+ *              3 Segmentation fault when accessing pointer
+ *              4 Bus Error when accessing pointer
+ *              5 Invalid signal caught (should never happen)
+ */
+int eval_checkptr( void* ptr ) {
+    return eval_checkrange( ptr, 1, EVAL_CHECK_READ | EVAL_CHECK_WRITE );
+}
+
+/**
+ * Checks if a pointer is valid for reading 1 byte from address
+ * @param ptr   Pointer to be evaluated
+ * @return      0 is pointer is valid
+ *              1 NULL pointer
+ *              2 (-1) pointer
+ *              3 Segmentation fault when accessing pointer
+ *              4 Bus Error when accessing pointer
+ *              5 Invalid signal caught (should never happen)
+ */
+int eval_checkconstptr( const void * ptr ) {
+    return eval_checkrange( ptr, 1, EVAL_CHECK_READ );
+}
+
+/**
+ * @brief Reads a line from file f and compares it with the string s2
+ * 
+ * @param f 
+ * @param s2 
+ * @param n         Max. size for the comparison
+ * @return int      Returns
+ */
+int eval_fstrncmp( FILE *f, const char *s2, const size_t n ) {
+    int ret;
+    if (f) {
+        char buffer[ n + 1 ];
+        fgets( buffer, n, f );
+
+        size_t size = strlen( s2 );
+        if ( n < size ) size = n;
+
+        // printf( "eval_fstrncmp: %s, %s, %ld ", buffer, s2, n );
+
+        ret = strncmp( buffer, s2, size );
+    } else {
+        ret = -2;
+    }
+    return ret;
+}
+
+
+/******************************************************************************
+ * Output comparison
+ *****************************************************************************/
+
+/**
+ * @brief Configuration and results of the eval_compare_*() functions
+ * 
+ */
+_eval_cmp_type _eval_cmp = {
+    .tolerance = EVAL_CMP_TOLERANCE,
+    .maxdiffs = EVAL_CMP_MAXDIFFS
+};
+
+/**
+ * @brief Memory buffer being compared, split into lines
+ * 
+ */
+typedef struct {
+    const char *pos;    // Current position
+    const char *end;    // End of buffer
+    int line;           // Current line number
+} _eval_cmp_buf_t;
+
+/**
+ * @brief Gets the next line from a buffer, not including the '\n' character
+ * 
+ * @param buf       Buffer
+ * @param line      (out) Start of line
+ * @param len       (out) Line length
+ * @return int      1 if a line was found, 0 at end of buffer
+ */
+static int _eval_cmp_getline( _eval_cmp_buf_t* buf, const char **line, size_t *len ) {
+    if ( buf -> pos >= buf -> end ) return 0;
+
+    const char *nl = memchr( buf -> pos, '\n', buf -> end - buf -> pos );
+    *line = buf -> pos;
+    *len = ( nl ? nl : buf -> end ) - buf -> pos;
+    buf -> pos = nl ? nl + 1 : buf -> end;
+    buf -> line ++;
+    return 1;
+}
+
+/**
+ * @brief Returns the length of a string after removing trailing whitespace
+ * 
+ * @param s         String
+ * @param len       String length
+ * @return size_t   Length without trailing whitespace
+ */
+static size_t _eval_cmp_rtrim( const char *s, size_t len ) {
+    while( len > 0 && isspace( (unsigned char) s[len-1] ) ) len--;
+    return len;
+}
+
+/**
+ * @brief Reports a difference between output and expected lines
+ * 
+ * Only the first _eval_cmp.maxdiffs differences are printed
+ * 
+ * @param line      Line number
+ * @param col       Column number
+ * @param exp       Expected line (NULL if missing)
+ * @param explen    Expected line length
+ * @param out       Output line (NULL if missing)
+ * @param outlen    Output line length
+ */
+static void _eval_cmp_report( int line, int col, const char *exp, size_t explen,
+    const char *out, size_t outlen ) {
+    
+    _eval_cmp.ndiffs++;
+    if ( _eval_cmp.ndiffs == 1 ) {
+        _eval_cmp.line = line;
+        _eval_cmp.col = col;
+        eval_error("Output does not match expected output");
+    }
+
+    if ( _eval_cmp.ndiffs <= _eval_cmp.maxdiffs ) {
+        const size_t w = 64;
+        if ( exp == NULL ) {
+            printf("%6d:%-4d - unexpected line \"%.*s\"\n", line, col, 
+                (int) ( outlen < w ? outlen : w ), out );
+        } else if ( out == NULL ) {
+            printf("%6d:%-4d - missing line \"%.*s\"\n", line, col, 
+                (int) ( explen < w ? explen : w ), exp );
+        } else {
+            printf("%6d:%-4d - expected \"%.*s\", got \"%.*s\"\n", line, col,
+                (int) ( explen < w ? explen : w ), exp,
+                (int) ( outlen < w ? outlen : w ), out );
+        }
+    }
+}
+
+/**
+ * @brief Gets the next whitespace separated token in a line
+ * 
+ * @param s         Line
+ * @param len       Line length
+ * @param pos       (in/out) Current position in line
+ * @param tok       (out) Start of token
+ * @return size_t   Token length, 0 if no more tokens
+ */
+static size_t _eval_cmp_token( const char *s, size_t len, size_t *pos, const char **tok ) {
+    size_t i = *pos;
+    while( i < len && isspace( (unsigned char) s[i] ) ) i++;
+    size_t start = i;
+    while( i < len && ! isspace( (unsigned char) s[i] ) ) i++;
+    *tok = s + start;
+    *pos = i;
+    return i - start;
+}
+
+/**
+ * @brief Converts a token to a number
+ * 
+ * @param tok       Token
+ * @param len       Token length
+ * @param val       (out) Numeric value
+ * @return int      1 if the complete token is a number, 0 otherwise
+ */
+static int _eval_cmp_number( const char *tok, size_t len, double *val ) {
+    char buffer[64];
+    if ( len == 0 || len >= sizeof(buffer) ) return 0;
+    memcpy( buffer, tok, len );
+    buffer[len] = 0;
+
+    char *end;
+    *val = strtod( buffer, &end );
+    return ( *end == 0 );
+}
+
+/**
+ * @brief Compares two lines token by token, numeric tokens are compared
+ * using _eval_cmp.tolerance
+ * 
+ * @return int  0 if lines match, column of first differing token otherwise
+ */
+static int _eval_cmp_numeric_line( const char *exp, size_t explen, const char *out, size_t outlen ) {
+    size_t ep = 0, op = 0;
+    for(;;) {
+        const char *et, *ot;
+        size_t el = _eval_cmp_token( exp, explen, &ep, &et );
+        size_t ol = _eval_cmp_token( out, outlen, &op, &ot );
+        
+        if ( el == 0 && ol == 0 ) return 0;
+
+        int col = (int) ( ol > 0 ? (size_t) ( ot - out ) : op ) + 1;
+        if ( el == 0 || ol == 0 ) return col;
+
+        if ( el != ol || memcmp( et, ot, el ) ) {
+            double ev, ov;
+            if ( ! _eval_cmp_number( et, el, &ev ) || ! _eval_cmp_number( ot, ol, &ov ) ) 
+                return col;
+            if ( ! ( fabs( ov - ev ) <= _eval_cmp.tolerance * fmax( 1.0, fabs( ev ) ) ) ) 
+                return col;
+        }
+    }
+}
+
+/**
+ * @brief Compares output with expected data line by line
+ */
+static void _eval_cmp_lines( _eval_cmp_buf_t *out, _eval_cmp_buf_t *exp, int mode ) {
+    const char *el, *ol;
+    size_t elen, olen;
+
+    for(;;) {
+        int he = _eval_cmp_getline( exp, &el, &elen );
+        int ho = _eval_cmp_getline( out, &ol, &olen );
+
+        if ( !he && !ho ) break;
+        if ( !he ) {
+            _eval_cmp_report( out -> line, 1, NULL, 0, ol, olen );
+            continue;
+        }
+        if ( !ho ) {
+            _eval_cmp_report( exp -> line, 1, el, elen, NULL, 0 );
+            continue;
+        }
+
+        int col = 0;
+        switch( mode ) {
+        case( EVAL_CMP_NUMERIC ):
+            col = _eval_cmp_numeric_line( el, elen, ol, olen );
+            break;
+        case( EVAL_CMP_TRAILING_WS ):
+            elen = _eval_cmp_rtrim( el, elen );
+            olen = _eval_cmp_rtrim( ol, olen );
+            // fall through
+        default:
+            if ( elen != olen || memcmp( el, ol, elen ) ) {
+                size_t n = ( elen < olen ) ? elen : olen;
+                size_t i = 0;
+                while( i < n && el[i] == ol[i] ) i++;
+                col = i + 1;
+            }
+        }
+
+        if ( col ) _eval_cmp_report( out -> line, col, el, elen, ol, olen );
+    }
+}
+
+/**
+ * @brief Hash table entry for line order insensitive comparisons
+ * 
+ */
+typedef struct {
+    const char *line;
+    size_t len;
+    int count;
+} _eval_cmp_entry_t;
+
+/**
+ * @brief FNV-1a hash of a line
+ */
+static uint64_t _eval_cmp_hash( const char *s, size_t len ) {
+    uint64_t h = 14695981039346656037ULL;
+    for( size_t i = 0; i < len; i++ ) {
+        h ^= (unsigned char) s[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+/**
+ * @brief Finds the hash table entry for a line
+ * 
+ * @param table     Hash table
+ * @param size      Hash table size (power of 2)
+ * @param l         Line
+ * @param len       Line length
+ * @return _eval_cmp_entry_t*   Entry for the line, or the empty entry where
+ *                  it should be added
+ */
+static _eval_cmp_entry_t *_eval_cmp_lookup( _eval_cmp_entry_t *table, size_t size,
+    const char *l, size_t len ) {
+    size_t i = _eval_cmp_hash( l, len ) & ( size - 1 );
+    while( table[i].line && ( table[i].len != len || memcmp( table[i].line, l, len ) ) )
+        i = ( i + 1 ) & ( size - 1 );
+    return &table[i];
+}
+
+/**
+ * @brief Compares output with expected data ignoring line order
+ * 
+ * Missing lines are reported in expected output order
+ * 
+ * @return int  0 on success, -1 on error (unable to allocate table)
+ */
+static int _eval_cmp_unordered( _eval_cmp_buf_t *out, _eval_cmp_buf_t *exp ) {
+
+    const char *l;
+    size_t len;
+
+    // Count expected lines to size the hash table
+    size_t nlines = 0;
+    for( const char *p = exp -> pos; p < exp -> end; p++ ) if ( *p == '\n' ) nlines++;
+    nlines++;
+
+    size_t size = 16;
+    while( size < 2 * nlines ) size *= 2;
+
+    _eval_cmp_entry_t *table = calloc( size, sizeof( _eval_cmp_entry_t ) );
+    if ( table == NULL ) {
+        eval_error("Unable to allocate memory for output comparison");
+        return -1;
+    }
+
+    // Add expected lines
+    const _eval_cmp_buf_t start = *exp;
+    while( _eval_cmp_getline( exp, &l, &len ) ) {
+        len = _eval_cmp_rtrim( l, len );
+        _eval_cmp_entry_t *e = _eval_cmp_lookup( table, size, l, len );
+        if ( ! e -> line ) {
+            e -> line = l;
+            e -> len = len;
+        }
+        e -> count++;
+    }
+
+    // Remove output lines
+    while( _eval_cmp_getline( out, &l, &len ) ) {
+        len = _eval_cmp_rtrim( l, len );
+        _eval_cmp_entry_t *e = _eval_cmp_lookup( table, size, l, len );
+        if ( e -> line && e -> count > 0 ) {
+            e -> count--;
+        } else {
+            _eval_cmp_report( out -> line, 1, NULL, 0, l, len );
+        }
+    }
+
+    // Report missing lines, going through the expected data again
+    *exp = start;
+    while( _eval_cmp_getline( exp, &l, &len ) ) {
+        len = _eval_cmp_rtrim( l, len );
+        _eval_cmp_entry_t *e = _eval_cmp_lookup( table, size, l, len );
+        if ( e -> count > 0 ) {
+            e -> count--;
+            _eval_cmp_report( exp -> line, 1, l, len, NULL, 0 );
+        }
+    }
+
+    free( table );
+    return 0;
+}
+
+/**
+ * @brief Compares output data with the expected data
+ * 
+ * Up to _eval_cmp.maxdiffs differing lines are reported. The total number of
+ * differences is stored in _eval_cmp.ndiffs and the location of the first
+ * difference in _eval_cmp.line and _eval_cmp.col.
+ * 
+ * @param out       Output data
+ * @param outlen    Output data size
+ * @param exp       Expected data
+ * @param explen    Expected data size
+ * @param mode      Comparison mode, one of EVAL_CMP_EXACT, EVAL_CMP_TRAILING_WS,
+ *                  EVAL_CMP_NUMERIC or EVAL_CMP_UNORDERED
+ * @return int      Number of differing lines (0 if output matches), -1 on error
+ */
+int eval_compare_mem( const char *out, size_t outlen, const char *exp, size_t explen, int mode ) {
+
+    _eval_cmp.ndiffs = 0;
+    _eval_cmp.line = 0;
+    _eval_cmp.col = 0;
+
+    if ( out == NULL ) outlen = 0;
+    if ( exp == NULL ) explen = 0;
+
+    // Ignore trailing blank lines except in exact mode
+    if ( mode != EVAL_CMP_EXACT ) {
+        outlen = _eval_cmp_rtrim( out, outlen );
+        explen = _eval_cmp_rtrim( exp, explen );
+    }
+
+    _eval_cmp_buf_t ob = { .pos = out, .end = out + outlen, .line = 0 };
+    _eval_cmp_buf_t eb = { .pos = exp, .end = exp + explen, .line = 0 };
+
+    switch( mode ) {
+    case( EVAL_CMP_EXACT ):
+    case( EVAL_CMP_TRAILING_WS ):
+    case( EVAL_CMP_NUMERIC ):
+        _eval_cmp_lines( &ob, &eb, mode );
+        break;
+    case( EVAL_CMP_UNORDERED ):
+        if ( _eval_cmp_unordered( &ob, &eb ) ) return -1;
+        break;
+    default:
+        eval_error("Invalid comparison mode %d", mode );
+        return -1;
+    }
+
+    // Check for missing / extra newline at end of output
+    if ( mode == EVAL_CMP_EXACT && _eval_cmp.ndiffs == 0 && outlen != explen ) {
+        _eval_cmp.ndiffs = 1;
+        _eval_cmp.line = ob.line;
+        _eval_cmp.col = 1;
+        eval_error("Output does not match expected output");
+        if ( outlen < explen ) printf("%6d:%-4d - missing newline at end of output\n", ob.line, 1 );
+        else printf("%6d:%-4d - unexpected newline at end of output\n", ob.line, 1 );
+    }
+
+    if ( _eval_cmp.ndiffs > _eval_cmp.maxdiffs ) {
+        printf("         - %d more difference(s) not shown\n", _eval_cmp.ndiffs - _eval_cmp.maxdiffs );
+    }
+
+    return _eval_cmp.ndiffs;
+}
+
+/**
+ * @brief Maps a file into memory for reading
+ * 
+ * @param fname     File name
+ * @param size      (out) File size
+ * @return void*    Pointer to file data (NULL for empty files), MAP_FAILED on error
+ */
+static void *_eval_cmp_map( const char *fname, size_t *size ) {
+    int fd = open( fname, O_RDONLY );
+    if ( fd < 0 ) {
+        eval_error("Unable to open file %s", fname );
+        return MAP_FAILED;
+    }
+
+    struct stat st;
+    if ( fstat( fd, &st ) < 0 ) {
+        eval_error("Unable to stat file %s", fname );
+        close( fd );
+        return MAP_FAILED;
+    }
+
+    *size = st.st_size;
+    void *data = NULL;
+    if ( *size > 0 ) {
+        data = mmap( NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0 );
+        if ( data == MAP_FAILED ) eval_error("Unable to map file %s", fname );
+    }
+    close( fd );
+
+    return data;
+}
+
+/**
+ * @brief Compares the contents of two files
+ * 
+ * @param outfile   Output file
+ * @param expfile   File with the expected output
+ * @param mode      Comparison mode, see eval_compare_mem()
+ * @return int      Number of differing lines (0 if output matches), -1 on error
+ */
+int eval_compare_file( const char *outfile, const char *expfile, int mode ) {
+    size_t outlen, explen;
+
+    char *out = _eval_cmp_map( outfile, &outlen );
+    if ( out == MAP_FAILED ) return -1;
+
+    char *exp = _eval_cmp_map( expfile, &explen );
+    if ( exp == MAP_FAILED ) {
+        if ( out ) munmap( out, outlen );
+        return -1;
+    }
+
+    int ret = eval_compare_mem( out, outlen, exp, explen, mode );
+
+    if ( out ) munmap( out, outlen );
+    if ( exp ) munmap( exp, explen );
+
+    return ret;
+}
+
+/**
+ * @brief Compares the output captured by the last EVAL_CATCH_MEMIO() with the
+ * contents of a file
+ * 
+ * @param expfile   File with the expected output
+ * @param mode      Comparison mode, see eval_compare_mem()
+ * @return int      Number of differing lines (0 if output matches), -1 on error
+ */
+int eval_compare_stdout( const char *expfile, int mode ) {
+    size_t explen;
+
+    char *exp = _eval_cmp_map( expfile, &explen );
+    if ( exp == MAP_FAILED ) return -1;
+
+    int ret = eval_compare_mem( _eval_memio.out, _eval_memio.outlen, exp, explen, mode );
+
+    if ( exp ) munmap( exp, explen );
+
+    return ret;
+}
+
+/**
+ * @brief Creates a "locked" file, i.e. a file with 0000 permissions
+ *
+ * Note that this file can still be removed using unlink() or remove()
+ * 
+ * @param fname     Name of the file to create
+ *
+ * @return int      0 on success, -1 on error
+ */
+int create_lockfile( char *fname ) {
+       
+    // Open file and write magic bytes
+    FILE *f = fopen( fname, "w" );
+    if ( f ==  NULL ) {
+        perror("create_lockfile: Unable to create lock file");
+        return -1;
+    } else {
+        char magic[] = "LOCK";
+        if ( fwrite( magic, 1, 4, f ) != 4 ) {
+            perror("create_lockfile: Unable to write magic bytes to lock file");
+            return -1;
+        };
+
+        if ( fclose(f) ) {
+            perror("create_lockfile: Unable to close lock file");
+            return -1;
+        }
+
+        // Remove all permissions
+        if ( chmod( fname, 0000 ) ) {
+            perror("create_lockfile: Unable to set lock file permissions");
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Removes a "locked" file created by create_lockfile()
+ * 
+ * User must be file owner.
+ * 
+ * @param fname     Name of the file to create 
+ *
+ * @return int      0 on success, -1 on error
+ */
+int remove_lockfile( char *fname ) {
+    struct stat st;
+    if ( stat( fname, &st ) < 0 ) {
+        perror("remove_lockfile: File no longer exists" );
+        return -1;
+    }
+
+    // Unlink does not check write permission
+    if ( unlink( fname ) ) {
+        perror("remove_lockfile: Unable to remove lock file");
+        return -1;
+    };
+
+    return 0;
+}
+
+
+/**
+ * Global variable for use by the EVAL_CATCH* macros
+ */
+_eval_env_type _eval_env = {0};
+
+/**
+ * Global variable for use by the eval_termination() function
+ */
+char _eval_term_str[256] = {0};
+
+/**
+ * @brief Pointer to string describing the test code termination
+ *
+ * Requires values in _eval_env. Note that the function always returns a pointer
+ * to the same location, the global _eval_term_str variable is modified with the
+ * updated termination message.
+ * 
+ * @return const char*      Test code termination description
+ */
+const char* eval_termination( void ) {
+    char *signame;
+    
+    switch( _eval_env.stat ) {
+        case(0):
+            snprintf(_eval_term_str, 255, "code returned normally" );
+            break;
+        case(EVAL_CATCH_EXIT):
+            snprintf(_eval_term_str, 255, "exit(%d) called", _eval_exit_data.status );
+            break;
+        case(EVAL_CATCH_ABORT):
+            snprintf(_eval_term_str, 255, "abort() called" );
+            break;
+        case(EVAL_CATCH_BLOCKED):
+            snprintf(_eval_term_str, 255, "blocked function called" );
+            break;
+        case(EVAL_CATCH_SIGNAL):
+            signame = strsignal(_eval_env.signal);
+            if ( signame ) {
+                snprintf(_eval_term_str, 255, "signal %s caught", signame );
+            } else {
+                snprintf(_eval_term_str, 255, "Unknown signal %d caught", _eval_env.signal );
+            }
+            break;
+        case(EVAL_CATCH_LOG_OVERFLOW):
+            snprintf(_eval_term_str, 255, "log buffer full" );
+            break;
+        default:
+            snprintf(_eval_term_str, 255, "abnormal termination");
+    }
+    return _eval_term_str;
+}
+
+/**
+ * @brief Signal handler for the EVAL_CATCH* macros
+ *
+ * Requires data in the _eval_env variable
+ * 
+ * @param sig           Signal caught
+ * @param info          Pointer to object explaining the reason why the signal
+ *                      was generated
+ * @param ucontext      Additional information from the process sending the 
+ *                      signal
+ */
+void _eval_sighandler( int sig, siginfo_t *info, void *ucontext) {
+
+    char *name;
+
+    // Faults forwarded by other threads (tracked threads block SIGPROF)
+    if ( sig == SIGPROF && __atomic_load_n( &_eval_threads.live, __ATOMIC_ACQUIRE ) > 0 &&
+         pthread_equal( pthread_self(), _eval_threads.catch ) ) {
+        int code = __atomic_exchange_n( &_eval_threads.pending, 0, __ATOMIC_ACQ_REL );
+        if ( code ) {
+            if ( __atomic_load_n( &_eval_threads.closing, __ATOMIC_ACQUIRE ) ) return;
+            siglongjmp( _eval_env.jmp, code );
+        }
+    }
+
+    // Handlers stay armed between the EVAL_CATCH* blocks of a session
+    if ( _eval_env.session ) {
+#ifdef _EVAL_POSIX_TIMERS
+        if ( sig == SIGPROF && info && info -> si_code == SI_TIMER &&
+             ! _eval_session_expired( info -> si_value.sival_int ) ) return;
+#endif
+        if ( ! _eval_env.catch ) {
+            _eval_session_uncaught( sig, info );
+            return;
+        }
+    }
+
+    switch( sig ) {
+    case( SIGSEGV ):
+        eval_error("Segmentation fault (SIGSEGV)");
+        break;
+    case( SIGBUS ):
+        eval_error("Bus error (SIGBUS)");
+        break;
+    case( SIGFPE ):
+        eval_error("Floating point exception / division by 0 (SIGFPE)");
+        break;
+    case( SIGILL ):
+        eval_error("Illegal instruction (SIGILL)");
+        break;
+    case( SIGPROF ):
+#ifdef _EVAL_POSIX_TIMERS
+        if ( info && info -> si_code == SI_TIMER && 
+             info -> si_value.sival_int == EVAL_DEADLINE_WALL ) {
+            _eval_env.deadline = EVAL_DEADLINE_WALL;
+            eval_error("Wall clock timeout (SIGPROF)");
+            break;
+        }
+#endif
+        _eval_env.deadline = EVAL_DEADLINE_CPU;
+        eval_error("Timeout (SIGPROF)");
+        break;
+#ifndef _EVAL_POSIX_TIMERS
+    case( SIGALRM ):
+        if ( _eval_env.wall_timeout > 0 ) {
+            _eval_env.deadline = EVAL_DEADLINE_WALL;
+            eval_error("Wall clock timeout (SIGALRM)");
+            break;
+        }
+        eval_error("Unexepected signal %s (%d) caught!", strsignal(sig), sig);
+        break;
+#endif
+    default:
+        name = strsignal(sig);
+        if ( name ) {
+            eval_error("Unexepected signal %s (%d) caught!", name, sig);
+        } else {
+            eval_error("Unexepected signal %d caught!", sig);
+        }
+    }
+
+    // Make sure messages are not lost if the process terminates
+    fflush( stdout );
+
+    _eval_env.signal = sig;
+    _eval_longjmp( EVAL_CATCH_SIGNAL );
+}
+
+/**
+ * @brief Supervised child processes
+ * 
+ */
+_eval_children_type _eval_children = {0};
+
+/**
+ * @brief Terminates a supervised child process
+ * 
+ * Supervised children (processes forked by the fork() wrapper inside an
+ * EVAL_CATCH* block) must not return to the EVAL_CATCH* code of the parent.
+ * The child terminates instead, with an exit status (or signal) reflecting
+ * how the code being tested terminated: exit() calls use the same exit
+ * status, signals and abort() terminate the child with the same signal,
+ * blocked functions use EVAL_CHILD_BLOCKED and the child exits with status 0
+ * if the EVAL_CATCH* code returns normally.
+ * 
+ * @param code      EVAL_CATCH_* termination code, 0 if none
+ */
+static _EVAL_NORETURN void _eval_child_exit( int code ) {
+    int sig;
+
+    fflush( NULL );
+    eval_report_flush();
+    switch( code ) {
+    case( 0 ):
+        _exit( 0 );
+    case( EVAL_CATCH_EXIT ):
+        _exit( _eval_exit_data.status );
+    case( EVAL_CATCH_ABORT ):
+        sig = SIGABRT;
+        break;
+    case( EVAL_CATCH_SIGNAL ):
+        sig = _eval_env.signal;
+        break;
+    default:
+        _exit( EVAL_CHILD_BLOCKED );
+    }
+
+    // Terminate with the same signal, so the parent may check WTERMSIG()
+    struct sigaction act;
+    act.sa_flags = 0;
+    act.sa_handler = SIG_DFL;
+    sigemptyset( &act.sa_mask );
+    if ( sig > 0 && sigaction( sig, &act, NULL ) == 0 ) {
+        sigset_t set;
+        sigemptyset( &set );
+        sigaddset( &set, sig );
+        pthread_sigmask( SIG_UNBLOCK, &set, NULL );
+        raise( sig );
+    }
+    _exit( 128 + sig );
+}
+
+/**
+ * @brief Tracked threads
+ * 
+ */
+_eval_threads_type _eval_threads = {0};
+
+/**
+ * @brief Tracked thread running on the current thread, NULL on the catch
+ *        thread and on threads not created through the pthread_create() wrapper
+ * 
+ */
+_EVAL_THREAD_LOCAL _eval_thread_type *_eval_thread_self = NULL;
+
+/**
+ * @brief Jumps to the catch point of the current thread
+ * 
+ * On the thread running the EVAL_CATCH* code this jumps to _eval_env.jmp.
+ * On other threads the termination code is recorded, delivered to the catch
+ * thread (through SIGPROF) and the thread jumps to its own catch point
+ * inside the pthread_create() wrapper, terminating the thread. Threads not
+ * created by the wrapper are terminated by calling pthread_exit().
+ * 
+ * @param code      EVAL_CATCH_* termination code
+ */
+_EVAL_NORETURN void _eval_longjmp( int code ) {
+    _eval_thread_type *self = _eval_thread_self;
+
+    if ( _eval_children.child ) _eval_child_exit( code );
+
+    if ( self == NULL && ( __atomic_load_n( &_eval_threads.live, __ATOMIC_ACQUIRE ) == 0 ||
+        pthread_equal( pthread_self(), _eval_threads.catch ) ) ) {
+        siglongjmp( _eval_env.jmp, code );
+    }
+
+    int none = 0;
+    __atomic_compare_exchange_n( &_eval_threads.fault, &none, code, 0,
+        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE );
+
+    if ( ! __atomic_load_n( &_eval_threads.closing, __ATOMIC_ACQUIRE ) ) {
+        __atomic_store_n( &_eval_threads.pending, code, __ATOMIC_RELEASE );
+        pthread_kill( _eval_threads.catch, SIGPROF );
+    }
+
+    if ( self ) {
+        self -> stat = code;
+        siglongjmp( self -> jmp, code );
+    }
+    pthread_exit( NULL );
+}
+
+#ifdef _EVAL_POSIX_TIMERS
+
+/**
+ * @brief POSIX timers used for implementing timeouts
+ * 
+ * Timers are created on first use by each process
+ */
+static struct {
+    pid_t pid;      // Process that created the timers
+    timer_t cpu;    // CPU time timer (CLOCK_PROCESS_CPUTIME_ID)
+    timer_t wall;   // Wall clock timer (CLOCK_MONOTONIC)
+} _eval_timers;
+
+/**
+ * @brief Creates a timer delivering SIGPROF
+ * 
+ * @param clock     Clock to use
+ * @param id        Value to be stored in .si_value
+ * @param timer     (out) Timer
+ */
+static void _eval_timer_create( clockid_t clock, int id, timer_t *timer ) {
+    struct sigevent sev;
+    memset( &sev, 0, sizeof( sev ) );
+    sev.sigev_notify = SIGEV_SIGNAL;
+    sev.sigev_signo = SIGPROF;
+    sev.sigev_value.sival_int = id;
+
+    if ( timer_create( clock, &sev, timer ) < 0 ) {
+        perror("_eval_timer_create: (*critical*) Unable to create timer");
+        exit(1);
+    }
+}
+
+/**
+ * @brief Sets a timer to expire after the specified time
+ * 
+ * @param timer     Timer
+ * @param t         Time (s), 0 disarms the timer
+ */
+static void _eval_timer_set( timer_t timer, double t ) {
+    struct itimerspec value;
+    memset( &value, 0, sizeof( value ) );
+    value.it_value.tv_sec = floor( t );
+    value.it_value.tv_nsec = floor( ( t - value.it_value.tv_sec ) * 1.e9 );
+    
+    // Values below 1 ns would disarm the timer
+    if ( t > 0 && value.it_value.tv_sec == 0 && value.it_value.tv_nsec == 0 )
+        value.it_value.tv_nsec = 1;
+
+    if ( timer_settime( timer, 0, &value, NULL ) < 0 ) {
+        perror("_eval_timer_set: (*critical*) Unable to set timer");
+        exit(1);
+    }
+}
+
+#else
+
+/**
+ * @brief Sets an interval timer to expire after the specified time
+ * 
+ * @param which     Timer (ITIMER_PROF or ITIMER_REAL)
+ * @param t         Time (s), 0 disarms the timer
+ */
+static void _eval_itimer_set( int which, double t ) {
+    struct itimerval value;
+    value.it_value.tv_sec = floor( t );
+    value.it_value.tv_usec = floor( ( t - value.it_value.tv_sec ) * 1.e6 );
+    value.it_interval.tv_sec = 0;
+    value.it_interval.tv_usec = 0;
+
+    // Values below 1 us would disarm the timer
+    if ( t > 0 && value.it_value.tv_sec == 0 && value.it_value.tv_usec == 0 )
+        value.it_value.tv_usec = 1;
+
+    if ( setitimer( which, &value, NULL ) < 0 ) {
+        perror("_eval_itimer_set: (*critical*) Unable to set itimer");
+        exit(1);
+    }
+}
+
+#endif
+
+/**
+ * @brief Returns elapsed time in seconds since t0
+ * 
+ * @param clock     Clock to use (e.g. CLOCK_MONOTONIC for wall clock time)
+ * @param t0        Start time
+ * @return double   Elapsed time in seconds
+ */
+static double _eval_elapsed( clockid_t clock, const struct timespec *t0 ) {
+    struct timespec t1;
+    clock_gettime( clock, &t1 );
+    return ( t1.tv_sec - t0 -> tv_sec ) + 1.e-9 * ( t1.tv_nsec - t0 -> tv_nsec );
+}
+
+/******************************************************************************
+ * Seccomp sandbox
+ *****************************************************************************/
+
+#if defined(__linux__) && defined(__x86_64__)
+#define _EVAL_SECCOMP 1
+#endif
+
+#ifdef _EVAL_SECCOMP
+
+/**
+ * @brief Issues a system call that is always allowed by the seccomp filter
+ * 
+ * The filter allows every system call made from the instruction following the
+ * `syscall` instruction of this routine, which is used by the SIGSYS handler
+ * to run trapped system calls that are not blocked.
+ * 
+ * @param nr        System call number
+ * @param ...       System call arguments (6)
+ * @return long     System call return value (-errno on error)
+ */
+long _eval_seccomp_syscall( long nr, long a0, long a1, long a2, long a3, long a4, long a5 );
+extern const char _eval_seccomp_syscall_ret[];
+
+__asm__(
+    ".text\n"
+    ".globl _eval_seccomp_syscall\n"
+    ".hidden _eval_seccomp_syscall\n"
+    ".type _eval_seccomp_syscall, @function\n"
+    "_eval_seccomp_syscall:\n"
+    "    movq %rdi, %rax\n"
+    "    movq %rsi, %rdi\n"
+    "    movq %rdx, %rsi\n"
+    "    movq %rcx, %rdx\n"
+    "    movq %r8, %r10\n"
+    "    movq %r9, %r8\n"
+    "    movq 8(%rsp), %r9\n"
+    "    syscall\n"
+    ".globl _eval_seccomp_syscall_ret\n"
+    ".hidden _eval_seccomp_syscall_ret\n"
+    "_eval_seccomp_syscall_ret:\n"
+    "    ret\n"
+    ".size _eval_seccomp_syscall, .-_eval_seccomp_syscall\n"
+);
+
+/**
+ * @brief Seccomp filter state, inherited by child processes
+ * 
+ */
+static struct {
+    int installed;
+} _eval_seccomp;
+
+/**
+ * @brief Checks if a trapped system call is blocked by the wrapper policy
+ * 
+ * @param nr            System call number
+ * @param args          System call arguments
+ * @return const char*  Name of the blocked function, NULL if not blocked
+ */
+static const char *_eval_seccomp_blocked( long nr, const long args[] ) {
+    switch( nr ) {
+    case( SYS_execve ):
+    case( SYS_execveat ):
+        if ( _eval_execl_data.action == ACTION_BLOCK ) return "execve";
+        break;
+    case( SYS_fork ):
+    case( SYS_vfork ):
+        if ( _eval_fork_data.action == ACTION_BLOCK ) return "fork";
+        break;
+    case( SYS_clone ):
+        if ( _eval_fork_data.action == ACTION_BLOCK ) return "fork";
+        break;
+    case( SYS_kill ):
+        if ( _eval_kill_data.action == ACTION_BLOCK ) return "kill";
+        break;
+    }
+    return NULL;
+}
+
+/**
+ * @brief SIGSYS handler for system calls trapped by the seccomp filter
+ * 
+ * Inside EVAL_CATCH* blocks, system calls blocked by the current wrapper
+ * policy (see _eval_seccomp_blocked()) terminate the code being tested with
+ * EVAL_CATCH_BLOCKED. Other system calls are run through
+ * _eval_seccomp_syscall() and their result returned to the caller.
+ * 
+ * @param sig           Signal caught (SIGSYS)
+ * @param info          Signal information (system call number)
+ * @param ucontext      Interrupted context (system call arguments / result)
+ */
+static void _eval_seccomp_handler( int sig, siginfo_t *info, void *ucontext ) {
+    (void) sig;
+    ucontext_t *uc = ucontext;
+    greg_t *regs = uc -> uc_mcontext.gregs;
+
+    long nr = info -> si_syscall;
+    long args[6] = { regs[ REG_RDI ], regs[ REG_RSI ], regs[ REG_RDX ],
+                     regs[ REG_R10 ], regs[ REG_R8 ], regs[ REG_R9 ] };
+
+    if ( _eval_env.catch ) {
+        const char *name = _eval_seccomp_blocked( nr, args );
+        if ( name ) {
+            eval_error("%s system call (%ld) blocked, aborting", name, nr );
+            fflush( stdout );
+            _eval_longjmp( EVAL_CATCH_BLOCKED );
+        }
+
+        // Same protection as the kill() wrapper, refused signals are not sent
+        if ( nr == SYS_kill && _eval_kill_data.action == ACTION_PROTECT &&
+             _eval_kill_refused( args[0] ) ) {
+            regs[ REG_RAX ] = 0;
+            return;
+        }
+    }
+
+    int err = errno;
+    long ret;
+    int forking = ( nr == SYS_fork || nr == SYS_vfork || nr == SYS_clone );
+    if ( forking && _eval_env.catch && ! _eval_children.forking &&
+                ! _eval_children.child && _eval_children.n >= EVAL_CHILDREN_MAX ) {
+        ret = -EAGAIN;
+    } else if ( nr == SYS_vfork ) {
+        // The child of vfork() would run on the stack of this handler
+        if ( ! _eval_children.forking ) {
+            fflush( NULL );
+            eval_report_flush();
+        }
+        ret = _eval_seccomp_syscall( SYS_fork, 0, 0, 0, 0, 0, 0 );
+    } else {
+        // As in the fork() wrapper, children must not repeat buffered output
+        if ( forking && ! _eval_children.forking ) {
+            fflush( NULL );
+            eval_report_flush();
+        }
+        ret = _eval_seccomp_syscall( nr, args[0], args[1], args[2], args[3], args[4], args[5] );
+    }
+
+    // Supervise children forked without going through the fork() wrapper
+    if ( forking && ret >= 0 && _eval_env.catch && ! _eval_children.forking )
+        _eval_child_forked( ret );
+
+    regs[ REG_RAX ] = ret;
+    errno = err;
+}
+
+/**
+ * @brief Installs the seccomp filter
+ * 
+ * The filter traps (SIGSYS) execve(), execveat(), fork(), vfork(), kill()
+ * and clone() calls creating a new process. Since seccomp filters cannot be
+ * removed, the filter is installed only once (in a test runner worker, see
+ * _eval_seccomp_arm()) and is inherited by child processes; whether a trapped system call is blocked is decided by
+ * _eval_seccomp_handler() using the current wrapper policy. clone3() calls
+ * fail with ENOSYS, so that the C library falls back to clone(), and so do
+ * clone() calls sharing memory with a new process (used by posix_spawn()
+ * and system()), since these run with all signals blocked.
+ * 
+ * @return int      0 on success, -1 on error
+ */
+static int _eval_seccomp_install( void ) {
+    uint64_t ip = (uintptr_t) _eval_seccomp_syscall_ret;
+
+    struct sock_filter filter[] = {
+        BPF_STMT( BPF_LD | BPF_W | BPF_ABS, offsetof( struct seccomp_data, arch ) ),
+        BPF_JUMP( BPF_JMP | BPF_JEQ | BPF_K, AUDIT_ARCH_X86_64, 0, 18 ),
+        BPF_STMT( BPF_LD | BPF_W | BPF_ABS, offsetof( struct seccomp_data, instruction_pointer ) ),
+        BPF_JUMP( BPF_JMP | BPF_JEQ | BPF_K, (uint32_t) ip, 0, 2 ),
+        BPF_STMT( BPF_LD | BPF_W | BPF_ABS, offsetof( struct seccomp_data, instruction_pointer ) + 4 ),
+        BPF_JUMP( BPF_JMP | BPF_JEQ | BPF_K, (uint32_t) ( ip >> 32 ), 13, 0 ),
+        BPF_STMT( BPF_LD | BPF_W | BPF_ABS, offsetof( struct seccomp_data, nr ) ),
+        BPF_JUMP( BPF_JMP | BPF_JGE | BPF_K, 0x40000000, 12, 0 ),     // x32 ABI
+        BPF_JUMP( BPF_JMP | BPF_JEQ | BPF_K, SYS_clone3, 11, 0 ),
+        BPF_JUMP( BPF_JMP | BPF_JEQ | BPF_K, SYS_execve, 8, 0 ),
+        BPF_JUMP( BPF_JMP | BPF_JEQ | BPF_K, SYS_execveat, 7, 0 ),
+        BPF_JUMP( BPF_JMP | BPF_JEQ | BPF_K, SYS_fork, 6, 0 ),
+        BPF_JUMP( BPF_JMP | BPF_JEQ | BPF_K, SYS_vfork, 5, 0 ),
+        BPF_JUMP( BPF_JMP | BPF_JEQ | BPF_K, SYS_kill, 4, 0 ),
+        BPF_JUMP( BPF_JMP | BPF_JEQ | BPF_K, SYS_clone, 0, 4 ),
+        BPF_STMT( BPF_LD | BPF_W | BPF_ABS, offsetof( struct seccomp_data, args[0] ) ),
+        BPF_JUMP( BPF_JMP | BPF_JSET | BPF_K, CLONE_THREAD, 2, 0 ),
+        // posix_spawn() clones with all signals blocked, so SIGSYS cannot be caught
+        BPF_JUMP( BPF_JMP | BPF_JSET | BPF_K, CLONE_VM, 2, 0 ),
+        BPF_STMT( BPF_RET | BPF_K, SECCOMP_RET_TRAP ),
+        BPF_STMT( BPF_RET | BPF_K, SECCOMP_RET_ALLOW ),
+        BPF_STMT( BPF_RET | BPF_K, SECCOMP_RET_ERRNO | ( ENOSYS & SECCOMP_RET_DATA ) ),
+    };
+
+    struct sock_fprog prog = {
+        .len = sizeof( filter ) / sizeof( filter[0] ),
+        .filter = filter
+    };
+
+    struct sigaction act;
+    // Blocked calls jump out of the handler, see eval_session_begin()
+    act.sa_flags = SA_SIGINFO | SA_RESTART | SA_ONSTACK | SA_NODEFER;
+    act.sa_sigaction = _eval_seccomp_handler;
+    sigemptyset( &act.sa_mask );
+    if ( sigaction( SIGSYS, &act, NULL ) < 0 ) {
+        eval_error("(seccomp) Unable to set signal handler for SIGSYS");
+        return -1;
+    }
+
+    if ( prctl( PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0 ) < 0 ||
+         prctl( PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &prog, 0, 0 ) < 0 ) {
+        eval_error("(seccomp) Unable to install filter: %s", strerror( errno ) );
+        return -1;
+    }
+
+    return 0;
+}
+
+#endif
+
+/**
+ * @brief Arms the seccomp filter (if enabled by _eval_env.seccomp)
+ * 
+ * Called by _eval_arm_signals(). Since the filter cannot be removed, and
+ * makes posix_spawn() and system() fail, it is only installed in test runner
+ * workers (see eval_run_parallel()), which exit at the end of the test case.
+ * If the filter is not available (not Linux x86_64, not in a worker, or the
+ * kernel refuses it) an error is issued and _eval_env.seccomp is cleared.
+ */
+static void _eval_seccomp_arm( void ) {
+#ifdef _EVAL_SECCOMP
+    if ( _eval_seccomp.installed ) return;
+    if ( _eval_runner.current < 0 ) {
+        eval_error("(seccomp) The system call filter is only installed in test runner workers");
+    } else if ( _eval_seccomp_install() == 0 ) {
+        _eval_seccomp.installed = 1;
+        return;
+    }
+#else
+    eval_error("(seccomp) System call filtering is not available on this platform");
+#endif
+    _eval_env.seccomp = 0;
+}
+
+/**
+ * @brief Catch session state, see eval_session_begin()
+ */
+static struct {
+    struct sigaction sigactions[6];     // Signal handlers replaced by the session
+#ifdef _EVAL_POSIX_TIMERS
+    struct timespec cpu_deadline;       // Deadlines of the current EVAL_CATCH*, 0 if none
+    struct timespec wall_deadline;
+    struct timespec cpu_expiry;         // Expiration of the armed timers, 0 if disarmed
+    struct timespec wall_expiry;
+#endif
+    volatile sig_atomic_t restored;     // Fault handlers restored by _eval_session_uncaught() (bit mask)
+} _eval_session;
+
+/**
+ * @brief Sets up an alternate signal stack for the current thread
+ * 
+ * Signal handlers installed with SA_ONSTACK run on this stack, so that stack
+ * overflows (SIGSEGV on the stack guard page) can also be caught. An
+ * alternate stack already set up by the user code is kept. Only the first
+ * call on each thread does any work.
+ * 
+ * @return void*    Stack allocated by this call, NULL if none
+ */
+static void *_eval_altstack( void ) {
+    static _EVAL_THREAD_LOCAL int done = 0;
+    if ( done ) return NULL;
+    done = 1;
+
+    stack_t ss;
+    if ( sigaltstack( NULL, &ss ) == 0 && !( ss.ss_flags & SS_DISABLE ) ) return NULL;
+
+    ss.ss_sp = malloc( EVAL_ALTSTACK_SIZE );
+    ss.ss_size = EVAL_ALTSTACK_SIZE;
+    ss.ss_flags = 0;
+    if ( ss.ss_sp == NULL || sigaltstack( &ss, NULL ) < 0 ) {
+        perror("_eval_altstack: Unable to set alternate signal stack");
+        free( ss.ss_sp );
+        return NULL;
+    }
+    return ss.ss_sp;
+}
+
+#ifdef _EVAL_POSIX_TIMERS
+
+/**
+ * @brief Sets a timer to expire at the specified (absolute) time
+ * 
+ * @param timer     Timer
+ * @param t         Expiration time, on the timer clock
+ */
+static void _eval_timer_set_abs( timer_t timer, const struct timespec *t ) {
+    struct itimerspec value;
+    memset( &value, 0, sizeof( value ) );
+    value.it_value = *t;
+
+    if ( timer_settime( timer, TIMER_ABSTIME, &value, NULL ) < 0 ) {
+        perror("_eval_timer_set_abs: (*critical*) Unable to set timer");
+        exit(1);
+    }
+}
+
+/**
+ * @brief Compares two times
+ * 
+ * @return int      < 0, 0 or > 0 if a is earlier, equal to or later than b
+ */
+static int _eval_timespec_cmp( const struct timespec *a, const struct timespec *b ) {
+    if ( a -> tv_sec != b -> tv_sec ) return ( a -> tv_sec < b -> tv_sec ) ? -1 : 1;
+    if ( a -> tv_nsec != b -> tv_nsec ) return ( a -> tv_nsec < b -> tv_nsec ) ? -1 : 1;
+    return 0;
+}
+
+/**
+ * @brief Sets the deadline of the current EVAL_CATCH* inside a session
+ * 
+ * Timers are left running between EVAL_CATCH* blocks, and are only
+ * reprogrammed when they would expire after the new deadline. A timer
+ * expiring before the deadline is rearmed by _eval_session_expired().
+ * 
+ * @param timer     Timer
+ * @param start     Start time of the EVAL_CATCH*, on the timer clock
+ * @param t         Time limit (s), <= 0 for none
+ * @param deadline  (out) Deadline, 0 if none
+ * @param expiry    (in/out) Expiration of the timer, 0 if disarmed
+ */
+static void _eval_session_deadline( timer_t timer, const struct timespec *start, double t,
+    struct timespec *deadline, struct timespec *expiry ) {
+
+    if ( t <= 0 ) {
+        deadline -> tv_sec = deadline -> tv_nsec = 0;
+        return;
+    }
+
+    deadline -> tv_sec = start -> tv_sec + floor( t );
+    deadline -> tv_nsec = start -> tv_nsec + floor( ( t - floor( t ) ) * 1.e9 );
+    if ( deadline -> tv_nsec >= 1000000000L ) {
+        deadline -> tv_sec++;
+        deadline -> tv_nsec -= 1000000000L;
+    }
+
+    if ( ( expiry -> tv_sec == 0 && expiry -> tv_nsec == 0 ) ||
+         _eval_timespec_cmp( expiry, deadline ) > 0 ) {
+        _eval_timer_set_abs( timer, deadline );
+        *expiry = *deadline;
+    }
+}
+
+/**
+ * @brief Checks if a timer expiration inside a session is a timeout
+ * 
+ * Called by _eval_sighandler(). Expirations with no deadline pending are
+ * ignored. Expirations before the deadline are ignored and the timer is
+ * rearmed for the deadline; expirations after the deadline but before the
+ * block has started (e.g. during the EVAL_CATCH_IO() redirection) rearm the
+ * timer shortly, so that the timeout is not lost.
+ * 
+ * @param id        Timer expired (EVAL_DEADLINE_*)
+ * @return int      1 if the deadline has expired, 0 otherwise
+ */
+int _eval_session_expired( int id ) {
+    clockid_t clock;
+    timer_t timer;
+    struct timespec *deadline, *expiry;
+
+    if ( id == EVAL_DEADLINE_WALL ) {
+        clock = CLOCK_MONOTONIC;
+        timer = _eval_timers.wall;
+        deadline = &_eval_session.wall_deadline;
+        expiry = &_eval_session.wall_expiry;
+    } else {
+        clock = CLOCK_PROCESS_CPUTIME_ID;
+        timer = _eval_timers.cpu;
+        deadline = &_eval_session.cpu_deadline;
+        expiry = &_eval_session.cpu_expiry;
+    }
+
+    expiry -> tv_sec = expiry -> tv_nsec = 0;
+    if ( deadline -> tv_sec == 0 && deadline -> tv_nsec == 0 ) return 0;
+
+    struct timespec now;
+    clock_gettime( clock, &now );
+    if ( _eval_timespec_cmp( &now, deadline ) < 0 ) {
+        _eval_timer_set_abs( timer, deadline );
+        *expiry = *deadline;
+        return 0;
+    }
+
+    if ( ! _eval_env.catch ) {
+        // The jump target is not set yet, try again in 1 ms
+        _eval_timer_set( timer, 1.e-3 );
+        return 0;
+    }
+    return 1;
+}
+
+#endif
+
+/**
+ * @brief Handles signals received outside EVAL_CATCH* blocks inside a session
+ * 
+ * Called by _eval_sighandler(). Timer signals are ignored; for other signals
+ * the signal handler replaced by the session is restored and the signal is
+ * delivered again, so that faults in the evaluation code itself are not
+ * caught. The session handler is installed again by the next EVAL_CATCH*
+ * block, see _eval_arm_signals().
+ * 
+ * @param sig       Signal caught
+ * @param info      Signal information
+ */
+void _eval_session_uncaught( int sig, siginfo_t *info ) {
+    int idx;
+    switch( sig ) {
+    case( SIGSEGV ): idx = 0; break;
+    case( SIGBUS ):  idx = 1; break;
+    case( SIGFPE ):  idx = 2; break;
+    case( SIGILL ):  idx = 3; break;
+    default:
+        return;
+    }
+
+    sigaction( sig, &_eval_session.sigactions[idx], NULL );
+    _eval_session.restored |= 1 << idx;
+
+    // Faults are raised again when the instruction is restarted
+    if ( info == NULL || info -> si_code <= 0 ) raise( sig );
+}
+
+/**
+ * @brief Arms signals for the EVAL_CATCH* macros and sets timeout alarms
+ * 
+ * Requires data in the _eval_env variable
+ *
+ * Specifically, SIGSEGV, SIGBUS, SIGFPE and SIGILL will be caught.
+ *
+ * If _eval_env.timeout > 0 then a timeout for _eval_env.timeout seconds of
+ * CPU time will be set. If _eval_env.wall_timeout > 0 then a timeout for
+ * _eval_env.wall_timeout seconds of wall clock time will also be set. Both
+ * timeouts use POSIX per-process timers delivering the SIGPROF signal. If
+ * these are not available (e.g. macOS) then ITIMER_PROF (SIGPROF) and 
+ * ITIMER_REAL (SIGALRM) interval timers are used instead.
+ *
+ * The routine will also store any previous signal handlers in 
+ * _eval_env.sigactions[*] so that these may be restored later, and the
+ * starting CPU and wall clock times. Inside a session (see
+ * eval_session_begin()) the handlers are already armed and only the timer
+ * deadlines are set.
+ */
+void _eval_arm_signals( void ) {
+
+    struct sigaction act;
+
+    act.sa_flags = SA_SIGINFO | SA_RESTART | SA_ONSTACK;
+    act.sa_sigaction = _eval_sighandler;
+    sigemptyset( &act.sa_mask );
+
+    // Stack overflows are caught on the alternate signal stack
+    _eval_altstack();
+
+    // Inside a session the signal handlers are already armed
+    const int session = _eval_env.session;
+
+    if ( ! session ) {
+        if ( sigaction( SIGSEGV, &act, &_eval_env.sigactions[0] ) < 0) {
+            perror("_eval_arm_signals: (*critical*) Unable to set signal handler for SIGSEGV");
+            exit(1);
+        }
+
+        if ( sigaction( SIGBUS, &act, &_eval_env.sigactions[1] ) < 0) {
+            perror("_eval_arm_signals: (*critical*) Unable to set signal handler for SIGBUS");
+            exit(1);
+        }
+
+        if ( sigaction( SIGFPE, &act, &_eval_env.sigactions[2] ) < 0) {
+            perror("_eval_arm_signals: (*critical*) Unable to set signal handler for SIGFPE");
+            exit(1);
+        }
+
+        if ( sigaction( SIGILL, &act, &_eval_env.sigactions[3] ) < 0) {
+            perror("_eval_arm_signals: (*critical*) Unable to set signal handler for SIGILL");
+            exit(1);
+        }
+    } else if ( _eval_session.restored ) {
+        // Handlers restored for a fault received outside the previous blocks
+        const int sigs[4] = { SIGSEGV, SIGBUS, SIGFPE, SIGILL };
+        act.sa_flags |= SA_NODEFER;
+        for( int i = 0; i < 4; i++ ) {
+            if ( ( _eval_session.restored & ( 1 << i ) ) && sigaction( sigs[i], &act, NULL ) < 0 ) {
+                perror("_eval_arm_signals: (*critical*) Unable to set signal handler");
+                exit(1);
+            }
+        }
+        _eval_session.restored = 0;
+    }
+
+    // Kernel-enforced blocking of system calls
+    if ( _eval_env.seccomp ) _eval_seccomp_arm();
+
+    // Reset _eval_env.signal and _eval_env.deadline
+    _eval_env.signal = -1;
+    _eval_env.deadline = 0;
+
+    // Supervised child processes
+    _eval_children.n = 0;
+    _eval_children.killed = 0;
+
+    // Faults raised by tracked threads are delivered to this thread
+    _eval_threads.catch = pthread_self();
+    _eval_threads.created = 0;
+    _eval_threads.fault = 0;
+    _eval_threads.pending = 0;
+
+    // Timeouts
+#ifdef _EVAL_POSIX_TIMERS
+    if ( _eval_env.timeout > 0 || _eval_env.wall_timeout > 0 ) {
+        if ( ! session && sigaction( SIGPROF, &act, &_eval_env.sigactions[4] ) < 0) {
+            perror("_eval_arm_signals: (*critical*) Unable to set signal handler for SIGPROF");
+            exit(1);
+        }
+
+        // Timers are not inherited by child processes
+        pid_t pid = getpid();
+        if ( _eval_timers.pid != pid ) {
+            _eval_timer_create( CLOCK_PROCESS_CPUTIME_ID, EVAL_DEADLINE_CPU, &_eval_timers.cpu );
+            _eval_timer_create( CLOCK_MONOTONIC, EVAL_DEADLINE_WALL, &_eval_timers.wall );
+            _eval_timers.pid = pid;
+            memset( &_eval_session.cpu_expiry, 0, sizeof( struct timespec ) );
+            memset( &_eval_session.wall_expiry, 0, sizeof( struct timespec ) );
+        }
+    }
+#else
+    if ( _eval_env.timeout > 0 && ! session ) {
+        if ( sigaction( SIGPROF, &act, &_eval_env.sigactions[4] ) < 0) {
+            perror("_eval_arm_signals: (*critical*) Unable to set signal handler for SIGPROF");
+            exit(1);
+        }
+    }
+
+    if ( _eval_env.wall_timeout > 0 && ! session ) {
+        if ( sigaction( SIGALRM, &act, &_eval_env.sigactions[5] ) < 0) {
+            perror("_eval_arm_signals: (*critical*) Unable to set signal handler for SIGALRM");
+            exit(1);
+        }
+    }
+#endif
+
+    // Start times
+    clock_gettime( CLOCK_PROCESS_CPUTIME_ID, &_eval_env.cpu_start );
+    clock_gettime( CLOCK_MONOTONIC, &_eval_env.wall_start );
+    _eval_usage_start();
+    _eval_heap_start();
+
+#ifdef _EVAL_POSIX_TIMERS
+    if ( session ) {
+        if ( _eval_env.timeout > 0 || _eval_env.wall_timeout > 0 ) {
+            _eval_session_deadline( _eval_timers.cpu, &_eval_env.cpu_start, _eval_env.timeout,
+                &_eval_session.cpu_deadline, &_eval_session.cpu_expiry );
+            _eval_session_deadline( _eval_timers.wall, &_eval_env.wall_start, _eval_env.wall_timeout,
+                &_eval_session.wall_deadline, &_eval_session.wall_expiry );
+        } else {
+            memset( &_eval_session.cpu_deadline, 0, sizeof( struct timespec ) );
+            memset( &_eval_session.wall_deadline, 0, sizeof( struct timespec ) );
+        }
+    } else {
+        if ( _eval_env.timeout > 0 ) _eval_timer_set( _eval_timers.cpu, _eval_env.timeout );
+        if ( _eval_env.wall_timeout > 0 ) _eval_timer_set( _eval_timers.wall, _eval_env.wall_timeout );
+    }
+#else
+    if ( _eval_env.timeout > 0 ) _eval_itimer_set( ITIMER_PROF, _eval_env.timeout );
+    if ( _eval_env.wall_timeout > 0 ) _eval_itimer_set( ITIMER_REAL, _eval_env.wall_timeout );
+#endif
+}
+
+/**
+ * @brief Restores previous signal handlers
+ * 
+ * Requires data in the _eval_env variable
+ * 
+ * The CPU and wall clock times used since _eval_arm_signals() was called are
+ * stored in _eval_env.cpu_time and _eval_env.wall_time. Threads created
+ * through the pthread_create() wrapper that are still running are cancelled,
+ * see _eval_threads_stop(), and child processes forked through the fork()
+ * wrapper are killed and reaped, see _eval_children_stop(). In supervised
+ * child processes the function terminates the process instead.
+ */
+void _eval_disarm_signals( void ) {
+
+    // Supervised children do not return to the parent code
+    if ( _eval_children.child ) _eval_child_exit( 0 );
+
+    // Inside a session timers keep running and handlers stay armed
+    const int session = _eval_env.session;
+
+#ifdef _EVAL_POSIX_TIMERS
+    if ( session ) {
+        // Expirations after this point are ignored
+        memset( &_eval_session.cpu_deadline, 0, sizeof( struct timespec ) );
+        memset( &_eval_session.wall_deadline, 0, sizeof( struct timespec ) );
+    } else {
+        if ( _eval_env.timeout > 0 ) _eval_timer_set( _eval_timers.cpu, 0 );
+        if ( _eval_env.wall_timeout > 0 ) _eval_timer_set( _eval_timers.wall, 0 );
+    }
+#else
+    if ( _eval_env.timeout > 0 ) _eval_itimer_set( ITIMER_PROF, 0 );
+    if ( _eval_env.wall_timeout > 0 ) _eval_itimer_set( ITIMER_REAL, 0 );
+#endif
+
+    // Cancel any threads still running and kill any child processes
+    _eval_threads_stop();
+    _eval_children_stop();
+
+    _eval_env.cpu_time = _eval_elapsed( CLOCK_PROCESS_CPUTIME_ID, &_eval_env.cpu_start );
+    _eval_env.wall_time = _eval_elapsed( CLOCK_MONOTONIC, &_eval_env.wall_start );
+    _eval_usage_stop();
+    _eval_heap_stop();
+
+    if ( ! session ) {
+#ifdef _EVAL_POSIX_TIMERS
+        if ( _eval_env.timeout > 0 || _eval_env.wall_timeout > 0 ) {
+#else
+        if ( _eval_env.timeout > 0 ) {
+#endif
+            if ( sigaction( SIGPROF, &_eval_env.sigactions[4], NULL ) < 0) {
+                perror("_eval_disarm_signals: (*critical*) Unable to reset signal handler for SIGPROF");
+                exit(1);
+            }
+        }
+
+#ifndef _EVAL_POSIX_TIMERS
+        if ( _eval_env.wall_timeout > 0 ) {
+            if ( sigaction( SIGALRM, &_eval_env.sigactions[5], NULL ) < 0) {
+                perror("_eval_disarm_signals: (*critical*) Unable to reset signal handler for SIGALRM");
+                exit(1);
+            }
+        }
+#endif
+
+        if ( sigaction( SIGSEGV, &_eval_env.sigactions[0], NULL ) < 0) {
+            perror("_eval_disarm_signals: (*critical*) Unable to reset signal handler for SIGSEGV");
+            exit(1);
+        }
+
+        if ( sigaction( SIGBUS, &_eval_env.sigactions[1], NULL ) < 0) {
+            perror("_eval_disarm_signals: (*critical*) Unable to reset signal handler for SIGBUS");
+            exit(1);
+        }
+
+        if ( sigaction( SIGFPE, &_eval_env.sigactions[2], NULL ) < 0) {
+            perror("_eval_disarm_signals: (*critical*) Unable to reset signal handler for SIGFPE");
+            exit(1);
+        }
+
+        if ( sigaction( SIGILL, &_eval_env.sigactions[3], NULL ) < 0) {
+            perror("_eval_disarm_signals: (*critical*) Unable to reset signal handler for SIGILL");
+            exit(1);
+        }
+    }
+
+    _eval_report_catch();
+}
+
+/**
+ * @brief Starts a catch session
+ * 
+ * The EVAL_CATCH* signal handlers are armed once, for all EVAL_CATCH* blocks
+ * until eval_session_end() is called, and run on an alternate signal stack.
+ * Inside the session each EVAL_CATCH* block only sets its jump target and
+ * timer deadlines: timers are left running between blocks and only
+ * reprogrammed when needed, the signal mask is not saved / restored (the
+ * handlers are installed with SA_NODEFER) and the check for files left open
+ * only probes the first free file descriptor. Resource usage from
+ * getrusage() is not sampled (only the wall clock time and call counters are
+ * stored in _eval_usage). Signals received outside EVAL_CATCH* blocks are
+ * not caught.
+ * 
+ * @return int      0 on success, -1 if a session is already active
+ */
+int eval_session_begin( void ) {
+    if ( _eval_env.session ) {
+        eval_error("(session) A catch session is already active");
+        return -1;
+    }
+
+    _eval_altstack();
+
+    struct sigaction act;
+    act.sa_flags = SA_SIGINFO | SA_RESTART | SA_ONSTACK | SA_NODEFER;
+    act.sa_sigaction = _eval_sighandler;
+    sigemptyset( &act.sa_mask );
+
+#ifdef _EVAL_POSIX_TIMERS
+    const int nsig = 5;
+#else
+    const int nsig = 6;
+#endif
+    const int sigs[6] = { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGPROF, SIGALRM };
+    for( int i = 0; i < nsig; i++ ) {
+        if ( sigaction( sigs[i], &act, &_eval_session.sigactions[i] ) < 0 ) {
+            perror("eval_session_begin: (*critical*) Unable to set signal handler");
+            exit(1);
+        }
+    }
+
+#ifdef _EVAL_POSIX_TIMERS
+    memset( &_eval_session.cpu_deadline, 0, sizeof( struct timespec ) );
+    memset( &_eval_session.wall_deadline, 0, sizeof( struct timespec ) );
+    memset( &_eval_session.cpu_expiry, 0, sizeof( struct timespec ) );
+    memset( &_eval_session.wall_expiry, 0, sizeof( struct timespec ) );
+#endif
+    _eval_session.restored = 0;
+
+    _eval_env.session = 1;
+    return 0;
+}
+
+/**
+ * @brief Ends a catch session
+ * 
+ * Disarms the timers and restores the signal handlers replaced by
+ * eval_session_begin(). Does nothing if no session is active.
+ */
+void eval_session_end( void ) {
+    if ( ! _eval_env.session ) return;
+
+#ifdef _EVAL_POSIX_TIMERS
+    const int nsig = 5;
+    if ( _eval_timers.pid == getpid() ) {
+        _eval_timer_set( _eval_timers.cpu, 0 );
+        _eval_timer_set( _eval_timers.wall, 0 );
+    }
+#else
+    const int nsig = 6;
+#endif
+    const int sigs[6] = { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGPROF, SIGALRM };
+    for( int i = 0; i < nsig; i++ ) {
+        if ( sigaction( sigs[i], &_eval_session.sigactions[i], NULL ) < 0 ) {
+            perror("eval_session_end: (*critical*) Unable to reset signal handler");
+            exit(1);
+        }
+    }
+
+    _eval_env.session = 0;
+}
+
+/******************************************************************************
+ * Call trace
+ *****************************************************************************/
+
+/**
+ * @brief Records a call to a wrapped function in the call trace ring buffer
+ * 
+ * Arguments are converted to intptr_t, pointers must be cast explicitly
+ */
+#define _EVAL_TRACE( fn, ... ) do { \
+    if ( _eval_trace.enabled ) \
+        _eval_trace_call( EVAL_TRACE_##fn, (intptr_t[ EVAL_TRACE_NARGS ]){ __VA_ARGS__ } ); \
+} while(0)
+
+/**
+ * @brief Global variable holding the call trace
+ * 
+ */
+_eval_trace_type _eval_trace = {
+    .pending = -1
+};
+
+/**
+ * @brief Names and argument types of traced functions
+ * 
+ * Argument types are: d (int), u (unsigned), l (long), z (size_t),
+ * x (hexadecimal), o (octal), p (pointer) and s (string argument, stored
+ * in the event .str field).
+ */
+static const struct {
+    const char *name;
+    const char *args;
+    char ret;
+} _eval_trace_funcs[] = {
+    { "exit", "d", 0 },
+    { "abort", "", 0 },
+    { "sleep", "u", 'u' },
+    { "fork", "", 'd' },
+    { "wait", "p", 'd' },
+    { "waitpid", "dpd", 'd' },
+    { "kill", "dd", 'd' },
+    { "raise", "d", 'd' },
+    { "signal", "dp", 'p' },
+    { "sigaction", "dpp", 'd' },
+    { "pause", "", 'd' },
+    { "alarm", "u", 'u' },
+    { "msgget", "xd", 'd' },
+    { "msgsnd", "dpzd", 'd' },
+    { "msgrcv", "dpzld", 'l' },
+    { "msgctl", "ddp", 'd' },
+    { "semget", "xdo", 'd' },
+    { "semctl", "ddd", 'd' },
+    { "semop", "ddddd", 'd' },
+    { "shmget", "xzd", 'd' },
+    { "shmat", "dpd", 'p' },
+    { "shmdt", "p", 'd' },
+    { "shmctl", "ddp", 'd' },
+    { "mkfifo", "so", 'd' },
+    { "S_ISFIFO", "o", 'd' },
+    { "remove", "s", 'd' },
+    { "unlink", "s", 'd' },
+    { "atoi", "s", 'd' },
+    { "fclose", "p", 'd' },
+    { "fread", "pzzp", 'z' },
+    { "fwrite", "pzzp", 'z' },
+    { "fseek", "pld", 'd' },
+    { "execl", "s", 'd' },
+    { "malloc", "z", 'p' },
+    { "calloc", "zz", 'p' },
+    { "realloc", "pz", 'p' },
+    { "free", "p", 0 },
+    { "fopen", "s", 'p' },
+    { "pthread_create", "pppp", 'd' },
+    { "pthread_join", "xp", 'd' },
+    { "pthread_mutex_lock", "p", 'd' },
+    { "pthread_mutex_trylock", "p", 'd' },
+    { "pthread_mutex_unlock", "p", 'd' }
+};
+
+_Static_assert( sizeof( _eval_trace_funcs ) / sizeof( _eval_trace_funcs[0] ) == EVAL_TRACE_NFUNCS,
+    "_eval_trace_funcs does not match EVAL_TRACE_FUNCS" );
+
+/**
+ * @brief Enables the call trace
+ * 
+ * The ring buffer is allocated once, when the trace is first enabled or its
+ * capacity changes. Once full, new events overwrite the oldest ones.
+ * 
+ * @param capacity  Size of ring buffer (events), EVAL_TRACE_SIZE if <= 0
+ * @return int      0 on success, -1 on error
+ */
+int eval_trace_enable( int capacity ) {
+    if ( capacity <= 0 ) capacity = EVAL_TRACE_SIZE;
+
+    if ( _eval_trace.events == NULL || _eval_trace.capacity != capacity ) {
+        eval_trace_event_t *events = realloc( _eval_trace.events, capacity * sizeof( eval_trace_event_t ) );
+        if ( events == NULL ) {
+            eval_error("Unable to allocate call trace buffer");
+            return -1;
+        }
+        _eval_trace.events = events;
+        _eval_trace.capacity = capacity;
+    }
+
+    eval_trace_clear();
+    _eval_trace.enabled = 1;
+    return 0;
+}
+
+/**
+ * @brief Disables the call trace and frees the ring buffer
+ * 
+ */
+void eval_trace_disable( void ) {
+    _eval_trace.enabled = 0;
+    free( _eval_trace.events );
+    _eval_trace.events = NULL;
+    _eval_trace.capacity = 0;
+    eval_trace_clear();
+}
+
+/**
+ * @brief Removes all events from the call trace and resets the trace clock
+ * 
+ */
+void eval_trace_clear( void ) {
+    _eval_trace.total = 0;
+    _eval_trace.pending = -1;
+    clock_gettime( CLOCK_MONOTONIC, &_eval_trace.t0 );
+}
+
+/**
+ * @brief Records a call to a wrapped function. Use the _EVAL_TRACE() macro
+ * instead of calling this function directly.
+ * 
+ * @param func      Function id
+ * @param args      Function arguments (EVAL_TRACE_NARGS values)
+ */
+void _eval_trace_call( int func, const intptr_t args[] ) {
+    eval_trace_event_t *ev = &_eval_trace.events[ _eval_trace.total % _eval_trace.capacity ];
+
+    struct timespec t;
+    clock_gettime( CLOCK_MONOTONIC, &t );
+
+    ev -> func = func;
+    ev -> err = -1;
+    ev -> ret = 0;
+    memcpy( ev -> args, args, sizeof( ev -> args ) );
+    ev -> t = ( t.tv_sec - _eval_trace.t0.tv_sec ) + 1.e-9 * ( t.tv_nsec - _eval_trace.t0.tv_nsec );
+    ev -> str[0] = 0;
+
+    _eval_trace.pending = _eval_trace.total++;
+
+    // Clear errno so that only errors from the call itself are recorded
+    _eval_trace.saved_errno = errno;
+    errno = 0;
+}
+
+/**
+ * @brief Stores the string argument of the last call recorded
+ * 
+ * @param str   String (must be a valid pointer)
+ */
+void _eval_trace_str( const char *str ) {
+    if ( ! _eval_trace.enabled || _eval_trace.pending < 0 ) return;
+    eval_trace_event_t *ev = &_eval_trace.events[ _eval_trace.pending % _eval_trace.capacity ];
+
+    size_t len = strnlen( str, EVAL_TRACE_STRLEN - 1 );
+    memcpy( ev -> str, str, len );
+    ev -> str[ len ] = 0;
+}
+
+/**
+ * @brief Stores the return value and errno of the last call recorded
+ * 
+ * @param ret   Return value
+ */
+void _eval_trace_ret( intptr_t ret ) {
+    if ( ! _eval_trace.enabled || _eval_trace.pending < 0 ) return;
+
+    // Event may have been overwritten
+    if ( _eval_trace.pending >= _eval_trace.total - _eval_trace.capacity ) {
+        eval_trace_event_t *ev = &_eval_trace.events[ _eval_trace.pending % _eval_trace.capacity ];
+        ev -> ret = ret;
+        ev -> err = errno;
+    }
+
+    // Restore previous errno if the call did not set it
+    if ( errno == 0 ) errno = _eval_trace.saved_errno;
+    _eval_trace.pending = -1;
+}
+
+/**
+ * @brief Returns the name of a traced function
+ * 
+ * @param func          Function id
+ * @return const char*  Function name, "<unknown>" if invalid
+ */
+const char * eval_trace_name( int func ) {
+    if ( func < 0 || func >= EVAL_TRACE_NFUNCS ) return "<unknown>";
+    return _eval_trace_funcs[ func ].name;
+}
+
+/**
+ * @brief Returns the number of events available in the call trace
+ * 
+ * @return int  Number of events
+ */
+int eval_trace_size( void ) {
+    return ( _eval_trace.total < _eval_trace.capacity ) ? _eval_trace.total : _eval_trace.capacity;
+}
+
+/**
+ * @brief Returns an event from the call trace
+ * 
+ * @param idx       Event index, 0 is the oldest event available
+ * @return          Pointer to event or NULL if idx is not valid
+ */
+const eval_trace_event_t * eval_trace_get( int idx ) {
+    if ( idx < 0 || idx >= eval_trace_size() ) return NULL;
+    long first = _eval_trace.total - eval_trace_size();
+    return &_eval_trace.events[ ( first + idx ) % _eval_trace.capacity ];
+}
+
+/**
+ * @brief Returns the number of calls to a function found in the call trace
+ * 
+ * @param func      Function id
+ * @return int      Number of calls
+ */
+int eval_trace_count( int func ) {
+    int count = 0;
+    for( int i = 0; i < eval_trace_size(); i++ )
+        if ( eval_trace_get( i ) -> func == func ) count++;
+    return count;
+}
+
+/**
+ * @brief Returns the n-th call to a function found in the call trace
+ * 
+ * @param func      Function id
+ * @param n         Call number (0 is the first call)
+ * @return          Pointer to event or NULL if not found
+ */
+const eval_trace_event_t * eval_trace_nth( int func, int n ) {
+    for( int i = 0; i < eval_trace_size(); i++ ) {
+        const eval_trace_event_t *ev = eval_trace_get( i );
+        if ( ev -> func == func && n-- == 0 ) return ev;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Looks for a call to a function with the specified argument value
+ * 
+ * @param start     Index of first event to check
+ * @param func      Function id
+ * @param arg       Argument position (0 is the first argument)
+ * @param value     Argument value
+ * @return int      Event index or -1 if not found
+ */
+int eval_trace_find( int start, int func, int arg, intptr_t value ) {
+    if ( arg < 0 || arg >= EVAL_TRACE_NARGS ) return -1;
+    if ( start < 0 ) start = 0;
+    for( int i = start; i < eval_trace_size(); i++ ) {
+        const eval_trace_event_t *ev = eval_trace_get( i );
+        if ( ev -> func == func && ev -> args[ arg ] == value ) return i;
+    }
+    return -1;
+}
+
+/**
+ * @brief Formats a single value according to the type specifier
+ */
+static int _eval_trace_value( char buf[], size_t size, char type, intptr_t v, const char *str ) {
+    switch( type ) {
+    case 'u': return snprintf( buf, size, "%u", (unsigned) v );
+    case 'l': return snprintf( buf, size, "%ld", (long) v );
+    case 'z': return snprintf( buf, size, "%zu", (size_t) v );
+    case 'x': return snprintf( buf, size, "%x", (unsigned) v );
+    case 'o': return snprintf( buf, size, "%o", (unsigned) v );
+    case 'p': return snprintf( buf, size, "%p", (void *) v );
+    case 's': return snprintf( buf, size, "%s", str );
+    default:  return snprintf( buf, size, "%d", (int) v );
+    }
+}
+
+/**
+ * @brief Formats an event as a text line
+ * 
+ * The line uses the same format as the data log entries generated by
+ * ACTION_LOG, e.g. "msgsnd,3,0x7ffd5c3c,16,0".
+ * 
+ * @param ev        Event
+ * @param buf       Output buffer
+ * @param size      Size of output buffer
+ * @return int      Number of characters written (excluding '\0')
+ */
+int eval_trace_format( const eval_trace_event_t *ev, char buf[], size_t size ) {
+    if ( size == 0 ) return 0;
+
+    size_t n = snprintf( buf, size, "%s", eval_trace_name( ev -> func ) );
+    if ( ev -> func < 0 || ev -> func >= EVAL_TRACE_NFUNCS ) return n < size ? n : size - 1;
+
+    const char *args = _eval_trace_funcs[ ev -> func ].args;
+    for( int i = 0, a = 0; args[i] && n < size - 1; i++ ) {
+        buf[n++] = ',';
+        buf[n] = 0;
+        intptr_t v = ( args[i] == 's' ) ? 0 : ev -> args[ a++ ];
+        n += _eval_trace_value( buf + n, size - n, args[i], v, ev -> str );
+    }
+
+    return n < size ? n : size - 1;
+}
+
+/**
+ * @brief Looks for an event matching the message specified by the format and
+ * optional arguments, starting at event start. Events are formatted using
+ * eval_trace_format().
+ * 
+ * @param start     Index of first event to check
+ * @param format    Format for message
+ * @param ...       Optional message values
+ * @return int      Event index or -1 if not found
+ */
+int eval_trace_match( int start, const char *restrict format, ... ) {
+    char msg[LOGLINE];
+    char line[LOGLINE];
+
+    va_list ap;
+    va_start(ap, format);
+    vsnprintf(msg, LOGLINE-1, format, ap);
+    va_end(ap);
+
+    if ( start < 0 ) start = 0;
+    for( int i = start; i < eval_trace_size(); i++ ) {
+        eval_trace_format( eval_trace_get( i ), line, LOGLINE );
+        if ( !strncmp( msg, line, LOGLINE-1 ) ) return i;
+    }
+    return -1;
+}
+
+/**
+ * @brief Prints the complete call trace
+ * 
+ */
+void eval_trace_print( void ) {
+    if ( eval_trace_size() == 0 ) {
+        printf("<empty>\n");
+        return;
+    }
+
+    if ( _eval_trace.total > _eval_trace.capacity )
+        printf("(%ld earlier events overwritten)\n", _eval_trace.total - _eval_trace.capacity );
+
+    char line[LOGLINE];
+    for( int i = 0; i < eval_trace_size(); i++ ) {
+        const eval_trace_event_t *ev = eval_trace_get( i );
+        eval_trace_format( ev, line, LOGLINE );
+
+        if ( ev -> err < 0 ) {
+            printf("%3d - %10.6f %s (did not return)\n", i, ev -> t, line );
+        } else {
+            char ret[32] = "";
+            char type = _eval_trace_funcs[ ev -> func ].ret;
+            if ( type ) {
+                _eval_trace_value( ret, sizeof(ret), type, ev -> ret, "" );
+                printf("%3d - %10.6f %s -> %s", i, ev -> t, line, ret );
+            } else {
+                printf("%3d - %10.6f %s", i, ev -> t, line );
+            }
+            if ( ev -> err ) printf(" (errno %d)", ev -> err );
+            printf("\n");
+        }
+    }
+}
+
+/******************************************************************************
+ * Function wrappers
+ *****************************************************************************/
+
+/**
+ * @brief Global _eval_exit_data variable for the exit() function
+ * 
+ */
+EVAL_VAR(exit);
+
+/**
+ * @brief Evaluate implementation calling of exit function
+ *
+ * Requires data in global _eval_exit_data and _eval_env
+ *
+ * Note that in this case the wrapped function will never be called. Instead,
+ * execution will be returned to the EVAL_CATCH macro,setting the appropriate
+ * _eval_env and _eval_exit_data values.
+ *
+ * Behavior:
+ *   .action = 1    Issue info message and return to EVAL_CATCH macro
+ *   default        return to EVAL_CATCH macro
+ * 
+ * @param status    Exit status
+ */
+void _eval_exit( int status ) {
+    _eval_exit_data.status = status;
+    _EVAL_TRACE( EXIT, status );
+    _eval_script_begin( EVAL_WRAPPER_EXIT );
+    if ( _eval_exit_data.action == ACTION_WARN )
+         eval_info("exit(%d) caught!", status );
+    
+    _eval_longjmp( EVAL_CATCH_EXIT );
+}
+
+/**
+ * @brief Global _eval_abort_data variable for the abort() function
+ * 
+ */
+EVAL_VAR(abort);
+
+/**
+ * @brief Evaluate implementation calling of abort function
+ *
+ * Requires data in global _eval_abort_data and _eval_env
+ *
+ * Note that in this case the wrapped function will never be called. Instead,
+ * execution will be returned to the EVAL_CATCH macro,setting the appropriate
+ * _eval_env and _eval_abort_data values.
+ *
+ * Behavior:
+ *   .action = 1    Issue info message and return to EVAL_CATCH macro
+ *   default        return to EVAL_CATCH macro
+ * 
+ * @param status    Exit status
+ */
+void _eval_abort( void ) {
+    _eval_abort_data.status = 1;
+    _EVAL_TRACE( ABORT, 0 );
+    _eval_script_begin( EVAL_WRAPPER_ABORT );
+    if ( _eval_abort_data.action == ACTION_WARN )
+         eval_info("abort() caught!" );
+    
+    _eval_longjmp( EVAL_CATCH_ABORT );
+}
+
+/******************************************************************************
+ * Virtual clock
+ *****************************************************************************/
+
+/**
+ * @brief Virtual clock state
+ * 
+ */
+eval_vclock_t _eval_vclock = {
+    .now = 0,
+    .alarm = -1,
+    .alarms = 0
+};
+
+/**
+ * @brief Sets the sleep(), alarm() and pause() wrappers to use the virtual
+ * clock (ACTION_VIRTUAL)
+ * 
+ */
+void eval_vclock_enable( void ) {
+    _eval_sleep_data.action = ACTION_VIRTUAL;
+    _eval_alarm_data.action = ACTION_VIRTUAL;
+    _eval_pause_data.action = ACTION_VIRTUAL;
+}
+
+/**
+ * @brief Returns the current virtual time
+ * 
+ * @return double   Virtual time (s) since the last reset
+ */
+double eval_vclock( void ) {
+    return _eval_vclock.now;
+}
+
+/**
+ * @brief Resets the virtual clock to 0 and cancels any pending alarm. This is
+ * called by eval_reset_vars()
+ * 
+ */
+void eval_vclock_reset( void ) {
+    _eval_vclock.now = 0;
+    _eval_vclock.alarm = -1;
+    _eval_vclock.alarms = 0;
+}
+
+/**
+ * @brief Delivers the pending virtual SIGALRM
+ * 
+ * The signal is delivered using the currently installed disposition: if a
+ * handler was installed it is called (through raise()) before returning; if
+ * the disposition is SIG_DFL the test terminates as if SIGALRM had been caught.
+ * 
+ * @return int      1 if the signal was handled (interrupting a blocking call),
+ *                  0 if it was ignored
+ */
+static int _eval_vclock_fire( void ) {
+    _eval_vclock.now = _eval_vclock.alarm;
+    _eval_vclock.alarm = -1;
+    _eval_vclock.alarms++;
+
+    struct sigaction sa;
+    if ( sigaction( SIGALRM, NULL, &sa ) == 0 ) {
+        if ( !( sa.sa_flags & SA_SIGINFO ) && sa.sa_handler == SIG_IGN ) return 0;
+        if ( !( sa.sa_flags & SA_SIGINFO ) && sa.sa_handler == SIG_DFL ) {
+            eval_error("Alarm clock (SIGALRM) at virtual time %g s", _eval_vclock.now );
+            _eval_env.signal = SIGALRM;
+            _eval_longjmp( EVAL_CATCH_SIGNAL );
+        }
+    }
+
+    raise( SIGALRM );
+    return 1;
+}
+
+/**
+ * @brief Advances the virtual clock, delivering the pending alarm if it
+ * expires in the interval
+ * 
+ * @param seconds   Time interval (s)
+ */
+void eval_vclock_advance( double seconds ) {
+    double target = _eval_vclock.now + seconds;
+    if ( _eval_vclock.alarm >= 0 && _eval_vclock.alarm <= target ) _eval_vclock_fire();
+    if ( _eval_vclock.now < target ) _eval_vclock.now = target;
+}
+
+/**
+ * @brief Virtual sleep(). Sleeps until the requested time or until an alarm
+ * interrupts the sleep.
+ * 
+ * @param seconds       Number of seconds to sleep
+ * @return unsigned int Number of seconds left to sleep
+ */
+static unsigned int _eval_vclock_sleep( unsigned int seconds ) {
+    double target = _eval_vclock.now + seconds;
+    while( _eval_vclock.alarm >= 0 && _eval_vclock.alarm <= target ) {
+        if ( _eval_vclock_fire() ) return ceil( target - _eval_vclock.now );
+    }
+    _eval_vclock.now = target;
+    return 0;
+}
+
+/**
+ * @brief Virtual alarm()
+ * 
+ * @param seconds       Number of seconds until SIGALRM, 0 cancels the pending
+ *                      alarm
+ * @return unsigned int Number of seconds remaining on the previous alarm
+ */
+static unsigned int _eval_vclock_alarm( unsigned int seconds ) {
+    unsigned int left = 0;
+    if ( _eval_vclock.alarm >= 0 ) {
+        left = ceil( _eval_vclock.alarm - _eval_vclock.now );
+        if ( left == 0 ) left = 1;
+    }
+    _eval_vclock.alarm = ( seconds > 0 ) ? _eval_vclock.now + seconds : -1;
+    return left;
+}
+
+/**
+ * @brief Virtual pause(). Waits until the pending alarm is handled; if there
+ * is no pending alarm the call would block forever and the test is aborted.
+ * 
+ * @return int  Always -1 (EINTR)
+ */
+static int _eval_vclock_pause( void ) {
+    while( _eval_vclock.alarm >= 0 ) {
+        if ( _eval_vclock_fire() ) {
+            errno = EINTR;
+            return -1;
+        }
+    }
+    eval_error("pause() called with no pending alarm, would block forever, aborting");
+    _eval_longjmp( EVAL_CATCH_BLOCKED );
+}
+
+/**
+ * @brief Global _eval_sleep_data variable for the sleep() function
+ * 
+ */
+EVAL_VAR(sleep);
+
+/**
+ * @brief Evaluate implementation calling of sleep function
+ * Requires data in global _eval_sleep_data
+ * 
+ * .action behavior:
+ *   ACTION_ERROR       (interrupted by signal) Return 1
+ *   ACTION_LOG         (log) Log function call and proceed with ACTION_SUCCESS
+ *   ACTION_SUCCESS     (success) Return 0
+ *   ACTION_VIRTUAL     Advance the virtual clock, see eval_vclock_enable()
+ *   ACTION_DEFAULT     call sleep(seconds)
+ * 
+ * @param seconds   Number of seconds to sleep
+ * @return          Evalation result or result of sleep operation
+ */
+unsigned int _eval_sleep(unsigned int seconds) {
+
+#ifdef _EVAL_DEBUG
+    printf( _EVAL_DEBUG_PREFIX "sleep( %d )\n", seconds );
+#endif
+
+    _eval_sleep_data.status ++;
+    _EVAL_TRACE( SLEEP, seconds );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_SLEEP );
+    _eval_sleep_data.seconds = seconds;
+    switch( _eval_sleep_data.action ) {
+    case(ACTION_ERROR): // Interrupted by signal
+        _eval_sleep_data.ret = 1;
+        break;
+    case(ACTION_LOG):
+        datalog("sleep,%d", seconds );
+    case(ACTION_SUCCESS): // success (finished sleep)
+        _eval_sleep_data.ret = 0;
+        break;
+    case(ACTION_BLOCK):
+        eval_error("sleep() called, aborting");
+        _eval_longjmp( EVAL_CATCH_BLOCKED );
+        break;
+    case(ACTION_VIRTUAL):
+        _eval_sleep_data.ret = _eval_vclock_sleep( seconds );
+        break;
+    default:
+        _eval_sleep_data.ret = sleep( seconds );
+    }
+    if ( _eval_step ) _eval_sleep_data.ret = (int) _eval_script_end( _eval_step, (intptr_t) _eval_sleep_data.ret );
+    _eval_trace_ret( (intptr_t) _eval_sleep_data.ret );
+    return _eval_sleep_data.ret;
+}
+
+/******************************************************************************
+ * Child process supervision
+ *****************************************************************************/
+
+/**
+ * @brief Sets up supervision of a child process just forked
+ * 
+ * Must be called on both sides of the fork, inside an EVAL_CATCH* block
+ * 
+ * @param pid       Value returned by fork()
+ */
+void _eval_child_forked( pid_t pid ) {
+    if ( pid == 0 ) {
+        // Children of supervised children stay in the same process group
+        if ( ! _eval_children.child ) setpgid( 0, 0 );
+        _eval_children.child = 1;
+        _eval_children.forking = 0;
+        _eval_children.n = 0;
+        _eval_threads.live = 0;
+        _eval_threads.heap_lock = 0;
+    } else if ( pid > 0 && ! _eval_children.child && _eval_children.n < EVAL_CHILDREN_MAX ) {
+        // Set on both sides, the order in which they run is unknown
+        setpgid( pid, pid );
+
+        eval_child_t *c = &_eval_children.list[ _eval_children.n++ ];
+        c -> pid = pid;
+        c -> status = 0;
+        c -> reaped = 0;
+        c -> killed = 0;
+        c -> runtime = 0;
+        clock_gettime( CLOCK_MONOTONIC, &c -> start );
+    }
+}
+
+/**
+ * @brief Records the termination of a supervised child
+ * 
+ * @param pid       Child process (ignored if not tracked)
+ * @param status    Termination status
+ */
+static void _eval_child_reaped( pid_t pid, int status ) {
+    for( int i = 0; i < _eval_children.n; i++ ) {
+        eval_child_t *c = &_eval_children.list[i];
+        if ( c -> pid == pid && ! c -> reaped ) {
+            c -> status = status;
+            c -> reaped = 1;
+            c -> runtime = _eval_elapsed( CLOCK_MONOTONIC, &c -> start );
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Kills and reaps supervised child processes
+ * 
+ * Called by _eval_disarm_signals() at the end of every EVAL_CATCH* block.
+ * Each supervised child is the leader of its own process group, which is
+ * inherited by all its descendants. Children still running are flagged as
+ * killed, and the process group of every child is sent SIGKILL, so that
+ * orphaned descendants are terminated as well. The children are then
+ * reaped, so no zombies are left behind.
+ */
+void _eval_children_stop( void ) {
+    for( int i = 0; i < _eval_children.n; i++ ) {
+        eval_child_t *c = &_eval_children.list[i];
+        if ( ! c -> reaped ) {
+            int status;
+            pid_t ret = waitpid( c -> pid, &status, WNOHANG );
+            if ( ret == c -> pid ) {
+                _eval_child_reaped( c -> pid, status );
+            } else if ( ret == 0 ) {
+                c -> killed = 1;
+                _eval_children.killed++;
+            } else {
+                // Reaped elsewhere, status is unknown
+                c -> status = -1;
+                c -> reaped = 1;
+            }
+        }
+        kill( -c -> pid, SIGKILL );
+    }
+
+    for( int i = 0; i < _eval_children.n; i++ ) {
+        eval_child_t *c = &_eval_children.list[i];
+        if ( ! c -> reaped ) {
+            int status;
+            pid_t ret;
+            while( ( ret = waitpid( c -> pid, &status, 0 ) ) < 0 && errno == EINTR );
+            if ( ret == c -> pid ) {
+                _eval_child_reaped( c -> pid, status );
+            } else {
+                c -> status = -1;
+                c -> reaped = 1;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Gets information on a child process forked in the last EVAL_CATCH*
+ *        block
+ * 
+ * @param pid                   Child process
+ * @return const eval_child_t*  Child information, NULL if the process was not
+ *                              forked by the fork() wrapper
+ */
+const eval_child_t *eval_child( pid_t pid ) {
+    for( int i = 0; i < _eval_children.n; i++ ) {
+        if ( _eval_children.list[i].pid == pid ) return &_eval_children.list[i];
+    }
+    return NULL;
+}
+
+/**
+ * @brief Prints out the child processes forked in the last EVAL_CATCH* block
+ * 
+ */
+void eval_children_print( void ) {
+    printf("children forked = %d, killed = %d\n", _eval_children.n, _eval_children.killed );
+    for( int i = 0; i < _eval_children.n; i++ ) {
+        const eval_child_t *c = &_eval_children.list[i];
+        printf("  pid %d: ", c -> pid );
+        if ( c -> killed ) {
+            printf("killed");
+        } else if ( c -> status < 0 ) {
+            printf("unknown status");
+        } else if ( WIFEXITED( c -> status ) ) {
+            printf("exit status %d", WEXITSTATUS( c -> status ) );
+        } else if ( WIFSIGNALED( c -> status ) ) {
+            printf("signal %d", WTERMSIG( c -> status ) );
+        }
+        printf(", runtime %g s\n", c -> runtime );
+    }
+}
+
+/**
+ * @brief Global _eval_fork_data variable for the fork() function
+ * 
+ */
+EVAL_VAR(fork);
+
+/**
+ * @brief Evaluate implementation calling of fork function
+ * Requires data in global _eval_fork_data
+ * 
+ * .action behavior:
+ * + `ACTION_ERROR`   - (error) Return -1
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`
+ * + `ACTION_SUCCESS` - (success) Return value previously set in `_eval_fork_data.ret`.
+ *                      If the value was less than 0 it is set to 0. If we want the 
+ *                      command to behave as if it returns in the parent process, we 
+ *                      should set this to a value `>= 1`.
+ * + `ACTION_DEFAULT` - Capture parameters and call `fork()`. Inside EVAL_CATCH*
+ *                      blocks the child is supervised, see _eval_children_stop()
+ *                      and _eval_child_exit()
+ * 
+ * @return          Evalation result or result of fork operation
+ */
+pid_t _eval_fork(void) {
+    _eval_fork_data.status ++;
+    _EVAL_TRACE( FORK, 0 );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_FORK );
+    switch( _eval_fork_data.action ) {
+    case(ACTION_ERROR): // error
+        _eval_fork_data.ret = -1;
+        break;
+    case(ACTION_LOG):
+        datalog("fork");
+    case(ACTION_SUCCESS): // success
+        // Returns the value present in _eval_fork_data.ret
+        if ( _eval_fork_data.ret < 0 ) _eval_fork_data.ret = 0;
+        break;
+    case(ACTION_BLOCK):
+        eval_error("fork() called, aborting");
+        _eval_longjmp( EVAL_CATCH_BLOCKED );
+        break;
+    default:
+        if ( ! _eval_env.catch ) {
+            // Prevent buffered output from being duplicated in the child
+            fflush( stdout );
+            _eval_fork_data.ret = fork( );
+            break;
+        }
+
+        if ( ! _eval_children.child && _eval_children.n >= EVAL_CHILDREN_MAX ) {
+            eval_error("fork() called with %d child processes, the maximum is %d",
+                _eval_children.n, EVAL_CHILDREN_MAX );
+            _eval_fork_data.ret = -1;
+            errno = EAGAIN;
+            break;
+        }
+
+        fflush( NULL );
+        eval_report_flush();
+        _eval_children.forking = 1;
+        _eval_fork_data.ret = fork( );
+        _eval_children.forking = 0;
+        _eval_child_forked( _eval_fork_data.ret );
+    }
+    if ( _eval_step ) _eval_fork_data.ret = (pid_t) _eval_script_end( _eval_step, (intptr_t) _eval_fork_data.ret );
+    _eval_trace_ret( (intptr_t) _eval_fork_data.ret );
+    return _eval_fork_data.ret;
+}
+
+/**
+ * @brief Global _eval_wait_data variable for the wait() function
+ * 
+ */
+EVAL_VAR(wait);
+
+/**
+ * Evaluate implementation calling of wait function
+ * Requires data in global _eval_wait_data
+ * 
+ * .action behavior:
+ * + `ACTION_ERROR`   - (error) Return -1
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`
+ * + `ACTION_SUCCESS` - (success) Return value previously set in `_eval_fork_data.ret`. 
+ *                      If the value was less than 0 it is set to 0.
+ * + `ACTION_DEFAULT` - Capture parameters and call `wait(stat_loc)`
+ *
+ * @return          Evalation result or result of wait operation
+ */
+pid_t _eval_wait(int *stat_loc) {
+
+    _eval_wait_data.status ++;
+    _EVAL_TRACE( WAIT, (intptr_t) stat_loc );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_WAIT );
+
+    int err = 0;
+    if ( stat_loc != NULL ) {
+        if ( eval_checkrange( stat_loc, sizeof( int ), EVAL_CHECK_WRITE ) != 0 ) {
+            eval_error("wait() called with invalid pointer (stat_loc)\n");
+            err++;
+        }
+    }
+
+    switch( _eval_wait_data.action ) {
+
+    case(ACTION_ERROR): // error
+        _eval_wait_data.ret = -1;
+        errno = EINVAL;
+        break;
+
+    case(ACTION_LOG):
+        datalog("wait,%p", stat_loc);
+
+    case(ACTION_SUCCESS): // success
+        if ( _eval_wait_data.ret < 0 ) _eval_wait_data.ret = 0;
+        if ( !err && stat_loc ) {
+            if ( _eval_wait_data.stat_loc ) *stat_loc = *_eval_wait_data.stat_loc;
+            else *stat_loc = 0;
+        }
+        break;
+
+    case(ACTION_BLOCK):
+        eval_error("wait() called, aborting");
+        _eval_longjmp( EVAL_CATCH_BLOCKED );
+        break;
+
+    default:
+        if ( ! err ) {
+            int status;
+            _eval_wait_data.ret = wait( &status );
+            if ( _eval_wait_data.ret > 0 ) {
+                _eval_child_reaped( _eval_wait_data.ret, status );
+                if ( stat_loc ) *stat_loc = status;
+            }
+        } else {
+            _eval_wait_data.ret = -1;
+        }
+    }
+
+    _eval_wait_data.stat_loc = stat_loc;
+    if ( _eval_step ) _eval_wait_data.ret = (pid_t) _eval_script_end( _eval_step, (intptr_t) _eval_wait_data.ret );
+    _eval_trace_ret( (intptr_t) _eval_wait_data.ret );
+    return _eval_wait_data.ret;
+}
+
+/**
+ * @brief Global _eval_waipid_data variable for the waitpid() function
+ * 
+ */
+EVAL_VAR(waitpid);
+
+/**
+ * Evaluate implementation calling of waitpid function
+ * Requires data in global _eval_waitpid_data
+ * 
+ * Behavior:
+ * + `ACTION_ERROR`   - (error) Return -1
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`
+ * + `ACTION_SUCCESS` - (success) Return value previously set in `_eval_fork_data.ret`.
+ *                      If the value was less than 0 it is set to 0. If `stat_loc` is
+ *                      not NULL then `*stat_loc` will be set to `*_eval_wait_data.stat_loc`,
+ *                      if this is not NULL, or 0 otherwise
+ * + `ACTION_DEFAULT` - Capture parameters and call `waitpid(pid,stat_loc,options)`
+ *
+ * @return          Evalation result or result of wait operation
+ */
+pid_t _eval_waitpid(pid_t pid, int *stat_loc, int options) {
+
+    int err = 0;
+    if ( stat_loc != NULL ) {
+        if ( eval_checkptr( stat_loc ) != 0 ) {
+            eval_error("waitpid() called with invalid pointer (stat_loc)\n");
+            err ++;
+        }
+    }
+
+    _eval_waitpid_data.status ++;
+    _EVAL_TRACE( WAITPID, pid, (intptr_t) stat_loc, options );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_WAITPID );
+
+
+    switch( _eval_waitpid_data.action ) {
+
+    case(ACTION_ERROR):
+        _eval_waitpid_data.stat_loc = stat_loc;
+        _eval_waitpid_data.ret = -1;
+        errno = EINVAL;
+        break;
+
+    case(ACTION_LOG):
+        datalog("waitpid,%d,%p,%d", pid,stat_loc,options);
+
+    case(ACTION_SUCCESS):
+        if ( pid <= 0 ) {
+            _eval_waitpid_data.ret = _eval_waitpid_data.pid;
+        } else {
+            _eval_waitpid_data.ret = pid;
+        }
+        if ( !err && stat_loc ) {
+            if ( _eval_waitpid_data.stat_loc ) *stat_loc = *_eval_waitpid_data.stat_loc;
+            else *stat_loc = 0;
+        }
+        break;
+
+    case(ACTION_BLOCK):
+        eval_error("waitpid() called, aborting");
+        _eval_longjmp( EVAL_CATCH_BLOCKED );
+        break;
+
+    default:
+        if ( ! err ) {
+            int status;
+            _eval_waitpid_data.ret = waitpid( pid, &status, options );
+            if ( _eval_waitpid_data.ret > 0 ) {
+                if ( WIFEXITED( status ) || WIFSIGNALED( status ) )
+                    _eval_child_reaped( _eval_waitpid_data.ret, status );
+                if ( stat_loc ) *stat_loc = status;
+            }
+        } else {
+            _eval_waitpid_data.ret = -1;
+        }
+    }
+
+    _eval_waitpid_data.pid = pid;
+    _eval_waitpid_data.options = options;
+    _eval_waitpid_data.stat_loc = stat_loc;
+
+    if ( _eval_step ) _eval_waitpid_data.ret = (pid_t) _eval_script_end( _eval_step, (intptr_t) _eval_waitpid_data.ret );
+    _eval_trace_ret( (intptr_t) _eval_waitpid_data.ret );
+    return _eval_waitpid_data.ret;
+}
+
+/**
+ * @brief Global _eval_kill_data variable for the kill() function
+ * 
+ */
+EVAL_VAR(kill);
+
+/**
+ * @brief Checks if a kill() call is refused by ACTION_PROTECT
+ * 
+ * Signals to self, the parent process, the process group (0) and every
+ * process belonging to the process owner (-1) are refused, issuing an error.
+ * Used by the kill() wrapper and the seccomp filter.
+ * 
+ * @param pid       Process(es) to send signal to
+ * @return int      1 if the signal must not be sent, 0 otherwise
+ */
+int _eval_kill_refused( pid_t pid ) {
+    int err = 0;
+    if ( getpid() == pid ) {
+        eval_error("(kill) prevented sending signal to self");
+        err = 1;
+    }
+
+    if ( getppid() == pid ) {
+        eval_error("(kill) prevented sending signal to parent");
+        err = 1;
+    }
+
+    if ( 0 == pid ) {
+        eval_error("(kill) prevented sending signal to every process in the process group");
+        err = 1;
+    }
+
+    if ( -1 == pid ) {
+        eval_error("(kill) prevented sending signal to to every process belonging to process owner");
+        err = 1;
+    }
+    return err;
+}
+
+/**
+ * Evaluate implementation calling of kill function
+ * Requires data in global _eval_kill_data
+ * 
+ * Behavior:
+ * + `ACTION_ERROR`   - (error) Return -1
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`
+ * + `ACTION_SUCCESS` - (success) Return 0
+ * + `ACTION_DEFAULT` - Capture parameters and call `kill(pid,sig)`
+ * + `ACTION_PROTECT` - Same as default `ACTION_DEFAULT` but prevent routine from
+ *                      signaling self, parent, process group and every process 
+ *                      belonging to process owner
+ *
+ * @param pid   Process(es) to send signal to
+ * @param sig   Signal to be sent
+ * @return      error status
+ */
+int _eval_kill(pid_t pid, int sig) {
+    _eval_kill_data.status ++;
+    _EVAL_TRACE( KILL, pid, sig );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_KILL );
+    _eval_kill_data.pid = pid;
+    _eval_kill_data.sig = sig;
+
+    switch( _eval_kill_data.action ) {
+    case(ACTION_ERROR): // error
+        _eval_kill_data.ret = -1;
+        errno = EINVAL;
+        break;
+
+    case(ACTION_LOG): // log
+        datalog("kill,%d,%d", pid, sig );
+
+    case(ACTION_SUCCESS): // success
+        _eval_kill_data.ret = 0;
+        break;
+
+    case(ACTION_BLOCK):
+        eval_error("kill() called, aborting");
+        _eval_longjmp( EVAL_CATCH_BLOCKED );
+        break;
+
+    case(ACTION_PROTECT): // Catch bad pid values
+        if ( _eval_kill_refused( pid ) ) {
+            _eval_kill_data.ret = 0;
+            break;
+        }
+
+    default:    // send signal
+        _eval_kill_data.ret = kill( pid, sig );
+    }
+    if ( _eval_step ) _eval_kill_data.ret = (int) _eval_script_end( _eval_step, (intptr_t) _eval_kill_data.ret );
+    _eval_trace_ret( (intptr_t) _eval_kill_data.ret );
+    return _eval_kill_data.ret;
+}
+
+/**
+ * @brief Global _eval_raise_data variable for the raise() function
+ * 
+ */
+EVAL_VAR(raise);
+
+/**
+ * @brief Evaluate implementation calling of raise function
+ * Requires data in global _eval_raise_data
+ * 
+ * Behavior:
+ * + `ACTION_ERROR`   - (error) Return -1
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`
+ * + `ACTION_SUCCESS` - (success) Return 0
+ * + `ACTION_DEFAULT` - Capture parameters and call `raise(sig)`
+ *
+ * @param sig       Signal to be sent
+ * @return int      error status
+ */
+int _eval_raise( int sig ) {
+    _eval_raise_data.status ++;
+    _EVAL_TRACE( RAISE, sig );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_RAISE );
+    _eval_raise_data.sig = sig;
+
+    switch( _eval_raise_data.action ) {
+    case(ACTION_ERROR):    // error
+        _eval_raise_data.ret = -1;
+        errno = EINVAL;
+        break;
+
+    case(ACTION_LOG): // log
+        datalog("raise,%d", sig );
+
+    case(ACTION_SUCCESS):    // success
+        _eval_raise_data.ret = 0;
+        break;
+
+    case(ACTION_BLOCK):
+        eval_error("raise() called, aborting");
+        _eval_longjmp( EVAL_CATCH_BLOCKED );
+        break;
+
+    default:    // raise signal
+        _eval_raise_data.ret = raise( sig );
+    }
+    if ( _eval_step ) _eval_raise_data.ret = (int) _eval_script_end( _eval_step, (intptr_t) _eval_raise_data.ret );
+    _eval_trace_ret( (intptr_t) _eval_raise_data.ret );
+    return _eval_raise_data.ret;
+}
+
+/**
+ * @brief Global _eval_signal_data variable for the signal() function
+ * 
+ */
+EVAL_VAR(signal);
+
+/**
+ * @brief Evaluate implementation calling of signal function
+ * Requires data in global _eval_signal_data
+ *
+ * Note: The use of SIGPROF is reserved for the eval programs
+ *
+ * Behavior:
+ * + `ACTION_ERROR`   - (error) Return `SIG_ERR`
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`
+ * + `ACTION_SUCCESS` - (success) Return `SIG_DFL`
+ * + `ACTION_DEFAULT` - Capture parameters and call `signal(signum,handler)`
+ * 
+ * @param signum    Signal to be handled
+ * @param handler   Signal handler
+ * @return          Previous value of signal handler, SIG_ERR on error
+ */
+sighandler_t _eval_signal(int signum, sighandler_t handler) {
+#ifdef _EVAL_DEBUG
+    printf( _EVAL_DEBUG_PREFIX "signal( %d, %p )\n", signum, (void *) handler );
+#endif
+
+    _eval_signal_data.status ++;
+    _EVAL_TRACE( SIGNAL, signum, (intptr_t) handler );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_SIGNAL );
+    _eval_signal_data.signum = signum;
+    _eval_signal_data.handler = handler;
+
+    int bad_signal = 0;
+
+    switch( signum ) {
+        case( SIGPROF ):
+            eval_error("(signal) Use of SIGPROF signal is reserved for eval");
+            bad_signal = 1;
+            break;
+        case( SIGSEGV ):
+            eval_error("(signal) Use of SIGSEGV signal is reserved for eval");
+            bad_signal = 1;
+            break;
+        case( SIGBUS ):
+            eval_error("(signal) Use of SIGBUS signal is reserved for eval");
+            bad_signal = 1;
+            break;
+        case( SIGFPE ):
+            eval_error("(signal) Use of SIGFPE signal is reserved for eval");
+            bad_signal = 1;
+            break;
+        case( SIGILL ):
+            eval_error("(signal) Use of SIGILL signal is reserved for eval");
+            bad_signal = 1;
+            break;
+    }
+
+    if ( bad_signal ) {
+        _eval_signal_data.ret = SIG_ERR;
+        errno = EINVAL;
+    } else {
+        switch( _eval_signal_data.action ) {
+        case(ACTION_ERROR):
+            _eval_signal_data.ret = SIG_ERR;
+            break;
+        case(ACTION_LOG):
+            datalog("signal,%d,%p", signum, handler );
+        case(ACTION_SUCCESS):
+            _eval_signal_data.ret = SIG_DFL;
+            break;
+        case(ACTION_BLOCK):
+            eval_error("signal() called, aborting");
+            _eval_longjmp( EVAL_CATCH_BLOCKED );
+            break;
+        default:
+            _eval_signal_data.ret = signal( signum, handler );
+        }
+    }
+    if ( _eval_step ) _eval_signal_data.ret = (sighandler_t) _eval_script_end( _eval_step, (intptr_t) _eval_signal_data.ret );
+    _eval_trace_ret( (intptr_t) _eval_signal_data.ret );
+    return _eval_signal_data.ret;
+}
+
+/**
+ * @brief Global _eval_sigaction_data variable for the sigaction() function
+ * 
+ */
+EVAL_VAR(sigaction);
+
+/**
+ * @brief Evaluate implementation calling of sigaction function
+ * Requires data in global _eval_sigaction_data
+ *
+ * Note: The use of SIGPROF is reserved for the eval programs
+ *
+ * Behavior:
+ * + `ACTION_ERROR`   - (error) Return -1
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
+ *                      Unless `act -> sa_flags` had the `SA_SIGINFO` bit set, the
+ *                      function will be logged as if the corresponding `signal()`
+ *                      call was made.
+ * + `ACTION_SUCCESS` - (success) Return 0
+ * + `ACTION_DEFAULT` - Capture parameters and call `sigaction(signum,act,oldact)`
+ * 
+ * @param signum    Signal to be handled
+ * @param act       Signal handler
+ * @param oldaction Signal handler
+ * @return          0 on success, -1 on error
+ */
+int _eval_sigaction(int signum, const struct sigaction *act, struct sigaction *oldact) {
+
+    int err = 0;
+    if ( act != NULL ) {
+        if ( eval_checkrange( act, sizeof( struct sigaction ), EVAL_CHECK_READ ) != 0 ) {
+            eval_error("sigaction() called with invalid pointer (act)\n");
+            err++;
+        }
+    }
+
+    if ( oldact != NULL ) {
+        if ( eval_checkrange( oldact, sizeof( struct sigaction ), EVAL_CHECK_WRITE ) != 0 ) {
+            eval_error("sigaction() called with invalid pointer (oldact)\n");
+            err++;
+        }
+    }
+
+    _eval_sigaction_data.status ++;
+    _EVAL_TRACE( SIGACTION, signum, (intptr_t) act, (intptr_t) oldact );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_SIGACTION );
+    _eval_sigaction_data.signum = signum;
+    _eval_sigaction_data.act = (struct sigaction *) act;
+    _eval_sigaction_data.oldact = oldact;
+
+    int bad_signal = 0;
+
+    switch( signum ) {
+        case( SIGPROF ):
+            eval_error("(sigaction) Use of SIGPROF signal is reserved for eval");
+            bad_signal = 1;
+            break;
+        case( SIGSEGV ):
+            eval_error("(sigaction) Use of SIGSEGV signal is reserved for eval");
+            bad_signal = 1;
+            break;
+        case( SIGBUS ):
+            eval_error("(sigaction) Use of SIGBUS signal is reserved for eval");
+            bad_signal = 1;
+            break;
+        case( SIGFPE ):
+            eval_error("(sigaction) Use of SIGFPE signal is reserved for eval");
+            bad_signal = 1;
+            break;
+        case( SIGILL ):
+            eval_error("(sigaction) Use of SIGILL signal is reserved for eval");
+            bad_signal = 1;
+            break;
+    }
+
+    if ( bad_signal ) {
+        _eval_sigaction_data.ret = -1;
+        errno = EINVAL;
+    } else {
+        switch( _eval_sigaction_data.action ) {
+        case(ACTION_ERROR):
+            _eval_sigaction_data.ret = -1;
+            break;
+        case(ACTION_LOG):
+            if ( act -> sa_flags & SA_SIGINFO ) {
+                datalog("sigaction,%d,%p", signum, act->sa_sigaction );
+            } else {
+                datalog("signal,%d,%p", signum, act->sa_handler );
+            }
+        case(ACTION_SUCCESS):
+            _eval_sigaction_data.ret = 0;
+            break;
+        case(ACTION_BLOCK):
+            eval_error("sigaction() called, aborting");
+            _eval_longjmp( EVAL_CATCH_BLOCKED );
+            break;
+        default:
+            if ( ! err ) {
+                _eval_sigaction_data.ret = sigaction( signum, act, oldact );
+            } else {
+                _eval_sigaction_data.ret = -1;
+            }
+        }
+    }
+    if ( _eval_step ) _eval_sigaction_data.ret = (int) _eval_script_end( _eval_step, (intptr_t) _eval_sigaction_data.ret );
+    _eval_trace_ret( (intptr_t) _eval_sigaction_data.ret );
+    return _eval_sigaction_data.ret;
+}
+
+/**
+ * @brief Global _eval_pause_data variable for the pause() function
+ * 
+ */
+EVAL_VAR(pause);
+
+/**
+ * @brief Evaluate implementation calling of pause() function
+ * Requires data in global _eval_pause_data
+ * 
+ * Behavior:
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
+ * + `ACTION_SUCCESS` - (success) Return -1. Note: the `pause()` command always
+ *                      returns -1.
+ * + `ACTION_VIRTUAL` - Advance the virtual clock to the pending alarm, see
+ *                      eval_vclock_enable()
+ * + `ACTION_DEFAULT` - Call `pause()`
+ *
+ * @return          Always returns -1
+ */
+int _eval_pause(void) {
+    _eval_pause_data.status ++;
+    _EVAL_TRACE( PAUSE, 0 );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_PAUSE );
+
+    switch( _eval_pause_data.action ) {
+    case(ACTION_LOG):
+        datalog("pause");
+    case(ACTION_SUCCESS):
+        _eval_pause_data.ret = -1;
+        break;
+    case(ACTION_BLOCK):
+        eval_error("pause() called, aborting");
+        _eval_longjmp( EVAL_CATCH_BLOCKED );
+        break;
+    case(ACTION_VIRTUAL):
+        _eval_pause_data.ret = _eval_vclock_pause( );
+        break;
+    default:
+        _eval_pause_data.ret = pause( );
+    }
+    if ( _eval_step ) _eval_pause_data.ret = (int) _eval_script_end( _eval_step, (intptr_t) _eval_pause_data.ret );
+    _eval_trace_ret( (intptr_t) _eval_pause_data.ret );
+    return _eval_pause_data.ret;
+}
+
+/**
+ * @brief Global _eval_alarm_data variable for the alarm() function
+ * 
+ */
+EVAL_VAR(alarm);
+
+/**
+ * @brief Evaluate implementation calling of alarm() function
+ * Requires data in global _eval_alarm_data
+ * 
+ * Behavior:
+ * + `ACTION_ERROR`   - (previous alarm running) Return 1 (1s left on previous alarm)
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
+ * + `ACTION_SUCCESS` - (success) Return 0 (no previous alarm running)
+ * + `ACTION_VIRTUAL` - Schedule SIGALRM on the virtual clock, see
+ *                      eval_vclock_enable()
+ *
+ * @param seconds       Number of seconds until SIGALARM
+ * @return              Number of seconds remaining on previous alarm 
+ */
+unsigned int _eval_alarm( unsigned int seconds ) {
+    _eval_alarm_data.status ++;
+    _EVAL_TRACE( ALARM, seconds );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_ALARM );
+    _eval_alarm_data.ret = _eval_alarm_data.seconds;
+    _eval_alarm_data.seconds = seconds;
+
+    switch( _eval_alarm_data.action ) {
+    case(ACTION_ERROR):
+        _eval_alarm_data.ret = 1;
+        break;
+    case(ACTION_LOG):
+        datalog("alarm,%d",seconds);
+    case(ACTION_SUCCESS):
+        _eval_alarm_data.ret = 0;
+        break;
+    case(ACTION_BLOCK):
+        eval_error("alarm() called, aborting");
+        _eval_longjmp( EVAL_CATCH_BLOCKED );
+        break;
+    case(ACTION_VIRTUAL):
+        _eval_alarm_data.ret = _eval_vclock_alarm( seconds );
+        break;
+    default:
+        _eval_alarm_data.ret = alarm( seconds );
+    }
+    if ( _eval_step ) _eval_alarm_data.ret = (unsigned int) _eval_script_end( _eval_step, (intptr_t) _eval_alarm_data.ret );
+    _eval_trace_ret( (intptr_t) _eval_alarm_data.ret );
+    return _eval_alarm_data.ret;
+}
+
+/**
+ * @brief Global _eval_msgget_data variable for the msgget() function
+ * 
+ */
+EVAL_VAR(msgget);
+
+/**
+ * Evaluate implementation calling of msgget function
+ * 
+ * Function `.action` options:
+ * + `ACTION_RETRY`   - (retry) Fail on first try (ENOENT), behave as `ACTION_SUCCESS`
+ *                       on 2nd try, fail on remaining attempts (EINVAL)
+ * + `ACTION_CREATE`  - (must create) If `IPC_CREAT` was specified then behave as
+ *                      `ACTION_SUCCESS` otherwise return -1 (ENOENT)
+ * + `ACTION_ERROR`   - (error) Return -1 (EINVAL)
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
+ * + `ACTION_SUCCESS` - (success) Return the value set in `_eval_msgget_data.msqid`
+ * + `ACTION_DEFAULT` - Capture parameters and call `msgget(key,msgflg)`
+ * 
+ * @param key       IPC key of msg queue
+ * @param msgflg    Flag controlling msg queue creation / connection
+ * @return          Result or result of msgget operation
+ */
+int _eval_msgget(key_t key, int msgflg) {
+
+#ifdef _EVAL_DEBUG
+    printf( _EVAL_DEBUG_PREFIX "msgget( 0x%x, 0%04o )\n", key, msgflg );
+#endif
+
+    _eval_msgget_data.status ++;
+    _EVAL_TRACE( MSGGET, key, msgflg );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_MSGGET );
+
+    _eval_msgget_data.key = key;
+    _eval_msgget_data.msgflg = msgflg;
+
+    switch( _eval_msgget_data.action ) {
+    case(ACTION_RETRY): // error (ENOENT) on first try, inject on 2nd try
+        switch( _eval_msgget_data.status ) {
+        case (1):
+            errno = ENOENT;
+            _eval_msgget_data.ret = -1;
+            break;
+        case (2):
+            errno = 0;
+            _eval_msgget_data.ret = _eval_msgget_data.msqid;
+            break;
+        default:
+            _eval_shmget_data.ret = -1;
+            errno = EINVAL;
+        }
+        break;
+
+    case(ACTION_CREATE): // inject on create only
+        if ( ! (msgflg & IPC_CREAT ) ) {
+            _eval_msgget_data.ret = -1;
+            errno = ENOENT;
+        } else {
+            _eval_msgget_data.ret = _eval_msgget_data.msqid;
+        }
+        break;
+
+    case(ACTION_ERROR): // error (EINVAL)
+        _eval_msgget_data.ret = -1;
+        errno = EINVAL;
+        break;
+    case(ACTION_LOG):
+        datalog("msgget,%x,%d",key,msgflg);
+    case(ACTION_SUCCESS): // inject
+        _eval_msgget_data.ret = _eval_msgget_data.msqid;
+        break;
+    case(ACTION_BLOCK):
+        eval_error("msgget() called, aborting");
+        _eval_longjmp( EVAL_CATCH_BLOCKED );
+        break;
+    case(ACTION_VIRTUAL):
+        _eval_msgget_data.ret = _eval_vipc_msgget( key, msgflg );
+        break;
+    default:
+        _eval_msgget_data.ret = msgget( key, msgflg );
+    }
+    
+    if ( _eval_step ) _eval_msgget_data.ret = (int) _eval_script_end( _eval_step, (intptr_t) _eval_msgget_data.ret );
+    _eval_trace_ret( (intptr_t) _eval_msgget_data.ret );
+    return _eval_msgget_data.ret;
+}
+
+/**
+ * @brief Global _eval_msgsnd_data variable for the msgsnd() function
+ * 
+ */
+EVAL_VAR(msgsnd);
+
+/**
+ * Evaluate implementation calling of msgsnd function
+ * Requires data in global _eval_msgsnd_data
+ * 
+ * Function `.action` options:
+ * 
+ * + `ACTION_INJECT`  - (inject) Call `msgsnd()` but using the parameters specified
+ *                      in `_eval_msgsnd_data`
+ * + `ACTION_ERROR`   - (error) Return -1
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
+ * + `ACTION_SUCCESS` - (success) Return `msgsz`. If `msgp` was a valid pointer,
+ *                      then the data in `*msgp` is appended to the capture
+ *                      store and `_eval_msgsnd_data.msgp` points to the copy.
+ *                      This buffer must not be freed.
+ * + `ACTION_VIRTUAL` - Use the virtual IPC backend, see `eval_ipc_virtual()`
+ * + `ACTION_DEFAULT` - Capture parameters and call `msgsnd(msqid,msgp,msgsz,msgflg)`
+ * 
+ * @param msqid     Queue ID to use
+ * @param msgp      Pointer to message structure
+ * @param msgsz     Size of message body
+ * @param msgflg    
+ * @return          Result of msgsnd operation
+ */
+int _eval_msgsnd(int msqid, const void *msgp, size_t msgsz, int msgflg) {
+
+#ifdef _EVAL_DEBUG
+    printf( _EVAL_DEBUG_PREFIX "msgsnd( %d, %p, %zu, %d )\n", msqid, msgp, msgsz, msgflg );
+#endif
+
+    int err = 0;
+    if ( eval_checkrange( msgp, sizeof( long ) + msgsz, EVAL_CHECK_READ ) != 0 ) {
+        eval_error("msgsnd() called with invalid pointer (msgp)\n");
+        err++;
+    }
+
+    _eval_msgsnd_data.status ++;
+    _EVAL_TRACE( MSGSND, msqid, (intptr_t) msgp, msgsz, msgflg );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_MSGSND );
+    if ( _eval_step && _eval_step -> payload ) {
+        // The payload may not remain valid, store a copy in the capture arena
+        void *payload = _eval_capture_alloc( sizeof(long) + _eval_step -> size );
+        if ( payload ) {
+            memcpy( payload, _eval_step -> payload, sizeof(long) + _eval_step -> size );
+            _eval_msgsnd_data.msgp = payload;
+            _eval_msgsnd_data.msgsz = _eval_step -> size;
+        }
+    }
+
+    switch( _eval_msgsnd_data.action ) {
+
+    case(ACTION_INJECT): // inject
+        _eval_msgsnd_data.ret = msgsnd( 
+            _eval_msgsnd_data.msqid, _eval_msgsnd_data.msgp,
+            _eval_msgsnd_data.msgsz, _eval_msgsnd_data.msgflg );
+        break;
+
+    case(ACTION_ERROR): // error
+        _eval_msgsnd_data.msqid = msqid;
+        _eval_msgsnd_data.msgp = (void *) msgp;
+        _eval_msgsnd_data.msgsz = msgsz;
+        _eval_msgsnd_data.msgflg = msgflg;
+
+        _eval_msgsnd_data.ret = -1;
+        break;
+
+    case(ACTION_LOG):
+        datalog("msgsnd,%d,%p,%zu,%d",msqid,msgp,msgsz,msgflg);
+
+    case(ACTION_SUCCESS): // capture
+        _eval_msgsnd_data.msqid = msqid;
+        _eval_msgsnd_data.msgsz = msgsz;
+        _eval_msgsnd_data.msgflg = msgflg;
+
+        // Message is appended to the capture store, .msgp points to the copy
+        _eval_msgsnd_data.msgp = NULL;
+        if ( ! err ) {
+            _eval_msgsnd_data.msgp = _eval_capture_add( EVAL_WRAPPER_MSGSND,
+                _eval_msgsnd_data.status, msgp, sizeof(long) + msgsz );
+        }
+
+        _eval_msgsnd_data.ret = 0;
+        break;
+
+    case(ACTION_BLOCK):
+        eval_error("msgsnd() called, aborting");
+        _eval_longjmp( EVAL_CATCH_BLOCKED );
+        break;
+
+    case(ACTION_VIRTUAL):
+        _eval_msgsnd_data.msqid = msqid;
+        _eval_msgsnd_data.msgp = (void *) msgp;
+        _eval_msgsnd_data.msgsz = msgsz;
+        _eval_msgsnd_data.msgflg = msgflg;
+
+        if ( ! err ) {
+            _eval_msgsnd_data.ret = _eval_vipc_msgsnd( msqid, msgp, msgsz, msgflg );
+        } else {
+            _eval_msgsnd_data.ret = -1;
+            errno = EFAULT;
+        }
+        break;
+
+    default:
+        _eval_msgsnd_data.msqid = msqid;
+        _eval_msgsnd_data.msgp = (void *) msgp;
+        _eval_msgsnd_data.msgsz = msgsz;
+        _eval_msgsnd_data.msgflg = msgflg;
+
+        if ( ! err ) {
+            _eval_msgsnd_data.ret = msgsnd( msqid, msgp, msgsz, msgflg );
+        } else {
+            _eval_msgsnd_data.ret = -1;
+        }
+        break;
+    }
+
+    if ( _eval_step ) _eval_msgsnd_data.ret = (int) _eval_script_end( _eval_step, (intptr_t) _eval_msgsnd_data.ret );
+    _eval_trace_ret( (intptr_t) _eval_msgsnd_data.ret );
+    return _eval_msgsnd_data.ret;
+}
+
+/**
+ * @brief Global _eval_msgrcv_data variable for the msgrcv() function
+ * 
+ */
+EVAL_VAR(msgrcv);
+
+/**
+ * Evaluate implementation calling of msgsnd function
+ * Requires data in global _eval_msgrcv_data
+ * 
+ * Function `.action` options:
+ * 
+ * + `ACTION_INJECT`  - (inject) Copy data in `*_eval_msgsnd_data.msgp` to `*msgp`.
+ *                      The pointer `msgp` is checked before copying.
+ * + `ACTION_ERROR`   - (error) Return -1
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
+ * + `ACTION_SUCCESS` - (success) Return `msgsz`.
+ * + `ACTION_VIRTUAL` - Use the virtual IPC backend, see `eval_ipc_virtual()`
+ * + `ACTION_DEFAULT` - Capture parameters and call `msgrcv( msqid, msgp, msgsz, msgtyp, msgflg )`
+ * 
+ * @param msqid     Queue ID to use
+ * @param msgp      Pointer to message structure
+ * @param msgsz     Size of message body
+ * @param msgflg    
+ * @return          Evalation result or result of msgsnd operation
+ */
+ssize_t _eval_msgrcv(int msqid, void *msgp, size_t msgsz, long msgtyp, int msgflg) {
+
+#ifdef _EVAL_DEBUG
+    printf( _EVAL_DEBUG_PREFIX "msgrcv( %d, %p, %zu, %ld, %d )\n", msqid, msgp, msgsz, msgtyp, msgflg );
+#endif
+
+    int err = 0;
+    if ( eval_checkrange( msgp, sizeof( long ) + msgsz, EVAL_CHECK_WRITE ) != 0 ) {
+        eval_error("msgrcv() called with invalid pointer (msgp)\n");
+        err++;
+    }
+
+    _eval_msgrcv_data.status ++;
+    _EVAL_TRACE( MSGRCV, msqid, (intptr_t) msgp, msgsz, msgtyp, msgflg );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_MSGRCV );
+    if ( _eval_step && _eval_step -> payload ) {
+        _eval_msgrcv_data.msgp = (void *) _eval_step -> payload;
+        _eval_msgrcv_data.msgsz = _eval_step -> size;
+    }
+
+    switch( _eval_msgrcv_data.action ) {
+
+    case(ACTION_INJECT): // inject
+        _eval_msgrcv_data.msqid = msqid;
+        _eval_msgrcv_data.msgtyp = msgtyp;
+        _eval_msgrcv_data.msgflg = msgflg;
+
+        if ( !err ) {
+            size_t bytes = sizeof(long);
+            if ( msgsz >= _eval_msgrcv_data.msgsz ) {
+                bytes += _eval_msgrcv_data.msgsz;
+            } else if ( msgsz >= 0 ) {
+                bytes += msgsz;
+            }
+            memcpy( msgp, _eval_msgrcv_data.msgp, bytes );
+        }
+
+        _eval_msgrcv_data.msgp = msgp;
+        _eval_msgrcv_data.msgsz = msgsz;
+        _eval_msgrcv_data.ret = msgsz;
+
+        break;
+
+    case(ACTION_ERROR): // error
+        _eval_msgrcv_data.msqid = msqid;
+        _eval_msgrcv_data.msgp = msgp;
+        _eval_msgrcv_data.msgsz = msgsz;
+        _eval_msgrcv_data.msgtyp = msgtyp;
+        _eval_msgrcv_data.msgflg = msgflg;
+
+        errno = ( _eval_msgrcv_data._errno ) ? _eval_msgrcv_data._errno : EINVAL;
+
+        _eval_msgrcv_data.ret = -1;
+        break;
+
+    case(ACTION_LOG):
+        datalog("msgrcv,%d,%p,%zu,%ld,%d",msqid,msgp,msgsz,msgtyp,msgflg);
+
+    case(ACTION_SUCCESS): // capture
+        _eval_msgrcv_data.msqid = msqid;
+        _eval_msgrcv_data.msgp = msgp;
+        _eval_msgrcv_data.msgsz = msgsz;
+        _eval_msgrcv_data.msgtyp = msgtyp;
+        _eval_msgrcv_data.msgflg = msgflg;
+        
+        _eval_msgrcv_data.ret = msgsz;
+
+        break;
+
+    case(ACTION_BLOCK):
+        eval_error("msgrcv() called, aborting");
+        _eval_longjmp( EVAL_CATCH_BLOCKED );
+        break;
+
+    case(ACTION_VIRTUAL):
+        _eval_msgrcv_data.msqid = msqid;
+        _eval_msgrcv_data.msgp = msgp;
+        _eval_msgrcv_data.msgsz = msgsz;
+        _eval_msgrcv_data.msgtyp = msgtyp;
+        _eval_msgrcv_data.msgflg = msgflg;
+
+        if ( ! err ) {
+            _eval_msgrcv_data.ret = _eval_vipc_msgrcv( msqid, msgp, msgsz, msgtyp, msgflg );
+        } else {
+            _eval_msgrcv_data.ret = -1;
+            errno = EFAULT;
+        }
+        break;
+
+    default:
+        _eval_msgrcv_data.msqid = msqid;
+        _eval_msgrcv_data.msgp = msgp;
+        _eval_msgrcv_data.msgsz = msgsz;
+        _eval_msgrcv_data.msgtyp = msgtyp;
+        _eval_msgrcv_data.msgflg = msgflg;
+        
+        if ( ! err ) {
+            _eval_msgrcv_data.ret =  msgrcv( msqid, msgp, msgsz, msgtyp, msgflg );
+        } else {
+            _eval_msgrcv_data.ret = -1;
+        }
+    }
+
+    if ( _eval_step ) _eval_msgrcv_data.ret = (ssize_t) _eval_script_end( _eval_step, (intptr_t) _eval_msgrcv_data.ret );
+    _eval_trace_ret( (intptr_t) _eval_msgrcv_data.ret );
+    return _eval_msgrcv_data.ret;
+}
+
+/**
+ * @brief Global _eval_msgctl_data variable for the msgctl() function
+ * 
+ */
+EVAL_VAR(msgctl);
+
+/**
+ * Evaluate implementation calling of msgctl function
+ * Requires data in global _eval_msgctl_data
+ * 
+ * Function `.action` options:
+ * 
+ * + `ACTION_ERROR`   - (error) Return -1 (EINVAL)
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
+ * + `ACTION_SUCCESS` - (success) Return 0
+ * + `ACTION_VIRTUAL` - Use the virtual IPC backend, see `eval_ipc_virtual()`
+ * + `ACTION_DEFAULT` - Capture parameters and call `msgctl( msqid, cmd, buf )`
+ * 
+ * @param msqid     Message queue id
+ * @param cmd       Command to perform
+ * @param buf       struct msqid_ds for input / output of command
+ * @return int      success
+ */
+int _eval_msgctl(int msqid, int cmd, struct msqid_ds *buf) {
+
+#ifdef _EVAL_DEBUG
+    printf( _EVAL_DEBUG_PREFIX "msgctl( %d, %d, %p )\n", msqid, cmd, (void *) buf );
+#endif
+
+    _eval_msgctl_data.status ++;
+    _EVAL_TRACE( MSGCTL, msqid, cmd, (intptr_t) buf );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_MSGCTL );
+    _eval_msgctl_data.msqid = msqid;
+    _eval_msgctl_data.cmd = cmd;
+    _eval_msgctl_data.buf = buf;
+    
+    switch( _eval_msgctl_data.action ) {
+
+    case(ACTION_ERROR):
+        _eval_msgctl_data.ret = -1;
+        errno = EINVAL;
+        break;
+    case(ACTION_LOG):
+        datalog("msgctl,%d,%d,%p",msqid,cmd,(void*)buf);
+    case(ACTION_SUCCESS):
+        _eval_msgctl_data.ret = 0;
+        break;
+    case(ACTION_BLOCK):
+        eval_error("msgctl() called, aborting");
+        _eval_longjmp( EVAL_CATCH_BLOCKED );
+        break;
+
+    case(ACTION_VIRTUAL):
+        _eval_msgctl_data.ret = _eval_vipc_msgctl( msqid, cmd, buf );
+        break;
+
+    default:
+        _eval_msgctl_data.ret = msgctl( msqid, cmd, buf );
+    }
+    
+
+    if ( _eval_step ) _eval_msgctl_data.ret = (int) _eval_script_end( _eval_step, (intptr_t) _eval_msgctl_data.ret );
+    _eval_trace_ret( (intptr_t) _eval_msgctl_data.ret );
+    return _eval_msgctl_data.ret;
+}
+
+/**
+ * @brief Global _eval_semget_data variable for the semget() function
+ * 
+ */
+EVAL_VAR(semget);
+
+/**
+ * Evaluate implementation calling of semget function
+ * Requires data in global _eval_semget_data
+ * 
+ * @param key       IPC key
+ * @param nsems     Number of semaphores in the array
+ * @param semflg    Flags for semaphore creation / connection
+ * @return          semaphore id
+ */
+int _eval_semget(key_t key, int nsems, int semflg) {
+
+#ifdef _EVAL_DEBUG
+    printf( _EVAL_DEBUG_PREFIX "semget( 0x%x, %d, 0%o )\n", key, nsems, semflg );
+#endif
+
+    _eval_semget_data.status ++;
+    _EVAL_TRACE( SEMGET, key, nsems, semflg );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_SEMGET );
+
+    _eval_semget_data.key = key;
+    _eval_semget_data.nsems = nsems;
+    _eval_semget_data.semflg = semflg;
+
+    switch( _eval_semget_data.action ) {
+        case(ACTION_RETRY): // error (ENOENT) on first try, inject on 2nd try
+            switch( _eval_semget_data.status ) {
+            case (1):
+                errno = ENOENT;
+                _eval_semget_data.ret = -1;
+                break;
+            case (2):
+                errno = 0;
+                _eval_semget_data.ret = _eval_semget_data.semid;
+                break;
+            default:
+                _eval_semget_data.ret = -1;
+                errno = EINVAL;
+            }
+            break;
+        
+        case(ACTION_CREATE): // inject on create only
+            if ( nsems == 0  && ( semflg & IPC_CREAT ) ) {
+                _eval_semget_data.ret = -1;
+                errno = EINVAL;
+            } else {
+                _eval_semget_data.ret = _eval_semget_data.semid;
+            }
+            break;
+
+        case(ACTION_ERROR): // error (EINVAL)
+            _eval_semget_data.ret = -1;
+            errno = EINVAL;
+            break;
+
+        case(ACTION_LOG):
+            datalog("semget,%x,%d,%o",key,nsems,semflg);
+
+        case(ACTION_SUCCESS): // inject
+            _eval_semget_data.ret = _eval_semget_data.semid;
+            break;
+
+        case(ACTION_BLOCK):
+            eval_error("semget() called, aborting");
+            _eval_longjmp( EVAL_CATCH_BLOCKED );
+            break;
+
+        case(ACTION_VIRTUAL):
+            _eval_semget_data.ret = _eval_vipc_semget( key, nsems, semflg );
+            break;
+
+        default:
+            _eval_semget_data.ret = semget( key, nsems, semflg );
+    }
+    
+    if ( _eval_step ) _eval_semget_data.ret = (int) _eval_script_end( _eval_step, (intptr_t) _eval_semget_data.ret );
+    _eval_trace_ret( (intptr_t) _eval_semget_data.ret );
+    return _eval_semget_data.ret;
+}
+
+/**
+ * @brief Global _eval_semctl_data variable for the semctl() function
+ * 
+ */
+EVAL_VAR(semctl);
+
+/**
+ * @brief Evaluate implementation calling of semctl function
+ * Requires data in global _eval_semctl_data
+ * 
+ * Function `.action` options:
+ * 
+ * + `ACTION_ERROR`   - (error) Return -1 (EINVAL)
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
+ * + `ACTION_SUCCESS` - (success) Return the 0
+ * + `ACTION_VIRTUAL` - Use the virtual IPC backend, see `eval_ipc_virtual()`
+ * + `ACTION_DEFAULT` - Capture parameters and call `semctl(semid,semnum,cmd,...)`
+ * 
+ * @param semid     semaphore id
+ * @param semnum    semaphore value index
+ * @param cmd       command
+ * @param ...       extra parameters
+ * @return          semctl result
+ */
+int _eval_semctl(int semid, int semnum, int cmd, ... ) {
+
+    _eval_semctl_data.status ++;
+    _EVAL_TRACE( SEMCTL, semid, semnum, cmd );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_SEMCTL );
+
+    _eval_semctl_data.semid = semid;
+    _eval_semctl_data.semnum = semnum;
+    _eval_semctl_data.cmd = cmd;
+
+    switch (cmd) {
+    case(SETVAL):
+    case(IPC_STAT):
+    case(IPC_SET):
+    case(GETALL):
+    case(SETALL): 
+        {
+            va_list valist;
+            va_start(valist, cmd );
+            _eval_semctl_data.arg = va_arg(valist, union semun );
+            va_end(valist);
+        }
+    }
+
+#ifdef _EVAL_DEBUG
+    if (cmd == SETVAL) {
+        printf( _EVAL_DEBUG_PREFIX "semctl( %d, %d, %d, %d )\n", semid, semnum, cmd, _eval_semctl_data.arg.val );
+    } else {
+        printf( _EVAL_DEBUG_PREFIX "semctl( %d, %d, %d, ... )\n", semid, semnum, cmd );
+    }
+#endif
+
+    switch (_eval_semctl_data.action) {
+
+    case(ACTION_ERROR): // error
+        _eval_semctl_data.ret = -1;
+        errno = EINVAL;
+        break;
+    case(ACTION_LOG): // log
+        if ( cmd == SETVAL ) {
+            datalog("semctl,%d,%d,%d,%d", semid, semnum, cmd, _eval_semctl_data.arg, _eval_semctl_data.arg.val );
+        } else {
+            datalog("semctl,%d,%d,%d", semid, semnum, cmd );
+        }
+    case(ACTION_SUCCESS): // success
+        _eval_semctl_data.ret = 0;
+        break;
+    case(ACTION_BLOCK):
+        eval_error("semctl() called, aborting");
+        _eval_longjmp( EVAL_CATCH_BLOCKED );
+        break;
+
+    case(ACTION_VIRTUAL):
+        _eval_semctl_data.ret = _eval_vipc_semctl( semid, semnum, cmd, _eval_semctl_data.arg );
+        break;
+
+    default:
+        switch (cmd) {
+        case(SETVAL):
+        case(IPC_STAT):
+        case(IPC_SET):
+        case(GETALL):
+        case(SETALL):
+            _eval_semctl_data.ret = semctl( semid, semnum, cmd, _eval_semctl_data.arg );
+            break;
+        default:
+            _eval_semctl_data.ret = semctl( semid, semnum, cmd );
+        }
+    }
+
+    if ( _eval_step ) _eval_semctl_data.ret = (int) _eval_script_end( _eval_step, (intptr_t) _eval_semctl_data.ret );
+    _eval_trace_ret( (intptr_t) _eval_semctl_data.ret );
+    return _eval_semctl_data.ret;
+}
+
+/**
+ * @brief Global _eval_semop_data variable for the semop() function
+ * 
+ */
+EVAL_VAR(semop);
+
+/**
+ * @brief Evaluate implementation calling of semop function
+ * Requires data in global _eval_semop_data
+ * 
+ * Function `.action` options:
+ * 
+ * + `ACTION_ERROR`   - (error) Return -1 (EINVAL)
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
+ * + `ACTION_SUCCESS` - (success) Return the 0
+ * + `ACTION_VIRTUAL` - Use the virtual IPC backend, see `eval_ipc_virtual()`
+ * + `ACTION_DEFAULT` - Capture parameters and call `semop(semid,sops,nsops)`
+ * 
+ * @param semid     semaphore id
+ * @param sops      Semaphore operations
+ * @param nsops     nsops
+ * @return          semop result
+ */
+int _eval_semop(int semid, struct sembuf *sops, size_t nsops) {
+
+    int err = 0;
+    if ( eval_checkrange( sops, nsops * sizeof( struct sembuf ), EVAL_CHECK_READ ) != 0 ) {
+        eval_error("semop() called with invalid pointer (sops)\n");
+        err++;
+    }
+
+#ifdef _EVAL_DEBUG
+    printf( _EVAL_DEBUG_PREFIX "semop( %d, %p, %zu )\n", semid, (void *) sops ,nsops );
+    if ( nsops > 0 && !err ) {
+        for( int i = 0; i < nsops; i++ ) {
+            printf( "    ↳ op(%d) = {num:%d, op:%+d, flag:%d}\n", i, sops[i].sem_num, sops[i].sem_op, sops[i].sem_flg );
+        }
+    }
+#endif
+
+    _eval_semop_data.status ++;
+    _EVAL_TRACE( SEMOP, semid, ( !err && nsops > 0 ) ? sops[0].sem_num : 0, ( !err && nsops > 0 ) ? sops[0].sem_op : 0, ( !err && nsops > 0 ) ? sops[0].sem_flg : 0, nsops );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_SEMOP );
+
+    _eval_semop_data.semid = semid;
+    _eval_semop_data.sops = sops;
+    _eval_semop_data.nsops = nsops;
+
+    switch( _eval_semop_data.action ) {
+    case(ACTION_ERROR): // error
+        _eval_semop_data.ret = -1;
+        errno = EINVAL;
+        break;
+    case(ACTION_LOG):
+        if ( !err ) {
+            for( int i = 0; i < nsops; i++ ) {
+                datalog("semop,%d,%d,%d,%d", semid, sops[i].sem_num, sops[i].sem_op, sops[i].sem_flg );
+            }
+        }
+    case(ACTION_SUCCESS): // success
+        _eval_semop_data.ret = 0;
+        break;
+    case(ACTION_BLOCK):
+        eval_error("semop() called, aborting");
+        _eval_longjmp( EVAL_CATCH_BLOCKED );
+        break;
+
+    case(ACTION_VIRTUAL):
+        if ( ! err ) {
+            _eval_semop_data.ret = _eval_vipc_semop( semid, sops, nsops );
+        } else {
+            _eval_semop_data.ret = -1;
+            errno = EFAULT;
+        }
+        break;
+
+    default:
+        if ( ! err ) {
+            _eval_semop_data.ret = semop( semid, sops, nsops );
+        } else {
+            _eval_semop_data.ret = -1;
+            errno = EINVAL;
+        }
+    }
+
+    
+
+    if ( _eval_step ) _eval_semop_data.ret = (int) _eval_script_end( _eval_step, (intptr_t) _eval_semop_data.ret );
+    _eval_trace_ret( (intptr_t) _eval_semop_data.ret );
+    return _eval_semop_data.ret;
+}
+
+/**
+ * @brief Global _eval_shmget_data variable for the shmget() function
+ * 
+ */
+EVAL_VAR(shmget);
+
+/**
+ * @brief Evaluate implementation calling of shmget function
+ * Requires data in global _eval_semget_data
+ * 
+ * Function `.action` options:
+ * 
+ * + `ACTION_RETRY`   - (retry) Fail on first try (ENOENT), behave as `ACTION_SUCCESS`
+ *                      on 2nd try, fail on remaining attempts (EINVAL)
+ * + `ACTION_CREATE`  - (must create) If `IPC_CREAT` was specified then behave as
+ *                      `ACTION_SUCCESS` otherwise return -1 (ENOENT)
+ * + `ACTION_ERROR`   - (error) Return -1 (EINVAL)
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
+ * + `ACTION_SUCCESS` - (success) Return the value set in `_eval_shmget_data.shmid`
+ * + `ACTION_VIRTUAL` - Use the virtual IPC backend, see `eval_ipc_virtual()`
+ * + `ACTION_DEFAULT` - Capture parameters and call `shmget( key, size, shmflg )`
+ * 
+ * @param key       IPC key
+ * @param size      Size of shared memory region
+ * @param semflg    Flags for shmem creation / connection
+ * @return          shm id
+ */
+int _eval_shmget(key_t key, size_t size, int shmflg) {
+
+#ifdef _EVAL_DEBUG
+    printf( _EVAL_DEBUG_PREFIX "shmget( 0x%x, %zu, 0%04o )\n", key, size, shmflg );
+#endif
+
+    _eval_shmget_data.status ++;
+    _EVAL_TRACE( SHMGET, key, size, shmflg );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_SHMGET );
+
+    _eval_shmget_data.key = key;
+    _eval_shmget_data.size = size;
+    _eval_shmget_data.shmflg = shmflg;
+
+    switch( _eval_shmget_data.action ) {
+    case(ACTION_RETRY): // error (ENOENT) on first try, inject on 2nd try
+        switch( _eval_shmget_data.status ) {
+        case (1):
+            errno = ENOENT;
+            _eval_shmget_data.ret = -1;
+            break;
+        case (2):
+            if ( size == 0  && ( shmflg & IPC_CREAT ) ) {
+                    _eval_shmget_data.ret = -1;
+            } else {
+                _eval_shmget_data.ret = _eval_shmget_data.shmid;
+            }
+            break;
+        default:
+            _eval_shmget_data.ret = -1;
+        }
+        break;
+    case(ACTION_CREATE): // inject on create only
+        if ( size == 0  && ( shmflg & IPC_CREAT ) ) {
+                _eval_shmget_data.ret = -1;
+        } else {
+            _eval_shmget_data.ret = _eval_shmget_data.shmid;
+        }
+        break;
+    case(ACTION_ERROR): // error
+        _eval_shmget_data.ret = -1;
+        errno = EINVAL;
+        break;
+    case(ACTION_LOG): // log
+        datalog("shmget,%x,%ld,%d", key, size, shmflg );
+    case(ACTION_SUCCESS): // success
+        _eval_shmget_data.ret = _eval_shmget_data.shmid;
+        break;
+    case(ACTION_BLOCK):
+        eval_error("shmget() called, aborting");
+        _eval_longjmp( EVAL_CATCH_BLOCKED );
+        break;
+    case(ACTION_VIRTUAL):
+        _eval_shmget_data.shmid = _eval_vipc_shmget( key, size, shmflg );
+        _eval_shmget_data.ret = _eval_shmget_data.shmid;
+        break;
+    default:
+        _eval_shmget_data.shmid = shmget( key, size, shmflg );
+        _eval_shmget_data.ret = _eval_shmget_data.shmid;
+    }
+
+    if ( _eval_step ) _eval_shmget_data.ret = (int) _eval_script_end( _eval_step, (intptr_t) _eval_shmget_data.ret );
+    _eval_trace_ret( (intptr_t) _eval_shmget_data.ret );
+    return _eval_shmget_data.ret;
+}
+
+/**
+ * @brief Global _eval_shmat_data variable for the shmat() function
+ * 
+ */
+EVAL_VAR(shmat);
+
+/**
+ * @brief Evaluate implementation calling of shmat function
+ * Requires data in global _eval_shmat_data
+ * 
+ * Function `.action` options:
+ * 
+ * + `ACTION_ERROR`   - (error) Return `(void *) -1` (EINVAL)
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
+ * + `ACTION_SUCCESS` - (success) Return the value set in `_eval_shmat_data.shmaddr`
+ * + `ACTION_VIRTUAL` - Use the virtual IPC backend, see `eval_ipc_virtual()`
+ * + `ACTION_DEFAULT` - Capture parameters and call `shmat( shmid, shmaddr, shmflg )`
+ * 
+ * @param shmid     Shared memory ID
+ * @param shmaddr   Choice for logical address
+ * @param shmflg    Flags for address choice
+ * @return          Logical address of shared memory region
+ */
+void *_eval_shmat( int shmid, const void *shmaddr, int shmflg) {
+
+#ifdef _EVAL_DEBUG
+    printf( _EVAL_DEBUG_PREFIX "shmat( %d, %p, %d )\n", shmid, shmaddr, shmflg );
+#endif
+
+    _eval_shmat_data.status ++;
+    _EVAL_TRACE( SHMAT, shmid, (intptr_t) shmaddr, shmflg );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_SHMAT );
+    _eval_shmat_data.shmid = shmid;
+    _eval_shmat_data.shmflg = shmflg;
+
+    switch( _eval_shmat_data.action ) {
+    case(ACTION_ERROR):
+        _eval_shmat_data.ret = (void *) -1;
+        errno=EINVAL;
+        break;
+    case(ACTION_LOG): // log
+        datalog("shmat,%d,%p,%d", shmid, shmaddr, shmflg );
+    case(ACTION_SUCCESS): // inject
+        _eval_shmat_data.ret = _eval_shmat_data.shmaddr;
+        break;
+
+    case(ACTION_BLOCK):
+        eval_error("shmat() called, aborting");
+        _eval_longjmp( EVAL_CATCH_BLOCKED );
+        break;
+
+    case(ACTION_VIRTUAL):
+        _eval_shmat_data.ret = _eval_vipc_shmat( shmid, shmaddr, shmflg );
+        break;
+
+    default:
+        _eval_shmat_data.ret = shmat( shmid, shmaddr, shmflg );
+        _eval_capture_shmat( _eval_shmat_data.ret, shmid );
+        eval_checkrange_invalidate();
+    }
+
+    _eval_shmat_data.shmaddr = (void *) shmaddr;
+
+    if ( _eval_step ) _eval_shmat_data.ret = (void *) _eval_script_end( _eval_step, (intptr_t) _eval_shmat_data.ret );
+    _eval_trace_ret( (intptr_t) _eval_shmat_data.ret );
+    return _eval_shmat_data.ret;
+}
+
+/**
+ * @brief Global _eval_shmdt_data variable for the shmdt() function
+ * 
+ */
+EVAL_VAR(shmdt);
+
+/**
+ * Evaluate implementation calling of shmdt function
+ * Requires data in global _eval_shmdt_data
+ * 
+ * Function `.action` options:
+ * 
+ * + `ACTION_ERROR`   - (error) Return -1 (EINVAL)
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
+ * + `ACTION_SUCCESS` - (success) Return 0
+ * + `ACTION_VIRTUAL` - Use the virtual IPC backend, see `eval_ipc_virtual()`
+ * + `ACTION_DEFAULT` - Capture parameters and call `shmdt( shmaddr )`
+ * 
+ * @param shmaddr   Logical address of shared memory region to detach
+ * @return          success
+ */
+int _eval_shmdt(const void *shmaddr) {
+
+#ifdef _EVAL_DEBUG
+    printf( _EVAL_DEBUG_PREFIX "shmdt( %p )\n", shmaddr );
+#endif
+
+    _eval_shmdt_data.status ++;
+    _EVAL_TRACE( SHMDT, (intptr_t) shmaddr );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_SHMDT );
+    _eval_shmdt_data.shmaddr = (void *) shmaddr;
+    
+    switch( _eval_shmdt_data.action ) {
+
+    case( ACTION_ERROR ): // error
+        _eval_shmdt_data.ret = -1;
+        errno = EINVAL;
+        break;
+
+    case( ACTION_LOG ): // log
+        datalog("shmdt,%p", shmaddr );
+
+    case( ACTION_SUCCESS ): // success
+        _eval_capture_shmdt( shmaddr, _eval_shmdt_data.status, 0 );
+        _eval_shmdt_data.ret = 0;
+        break;
+
+    case(ACTION_BLOCK):
+        eval_error("shmdt() called, aborting");
+        _eval_longjmp( EVAL_CATCH_BLOCKED );
+        break;
+
+    case(ACTION_VIRTUAL):
+        _eval_shmdt_data.ret = _eval_vipc_shmdt( shmaddr );
+        break;
+
+    default:
+        // Snapshot the segment while it is still attached
+        _eval_capture_shmdt( shmaddr, _eval_shmdt_data.status, 0 );
+        _eval_shmdt_data.ret = shmdt( shmaddr );
+        if ( _eval_shmdt_data.ret == 0 ) _eval_capture_shmdt( shmaddr, 0, 1 );
+        eval_checkrange_invalidate();
+    }
+
+    if ( _eval_step ) _eval_shmdt_data.ret = (int) _eval_script_end( _eval_step, (intptr_t) _eval_shmdt_data.ret );
+    _eval_trace_ret( (intptr_t) _eval_shmdt_data.ret );
+    return _eval_shmdt_data.ret;
+}
+
+/**
+ * @brief Global _eval_shmctl_data variable for the shmctl() function
+ * 
+ */
+EVAL_VAR(shmctl);
+
+/**
+ * Evaluate implementation calling of shmctl function
+ * Requires data in global _eval_shmctl_data
+ * 
+ * Function `.action` options:
+ * 
+ * + `ACTION_ERROR`   - (error) Return -1 (EINVAL)
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
+ * + `ACTION_SUCCESS` - (success) Return 0
+ * + `ACTION_VIRTUAL` - Use the virtual IPC backend, see `eval_ipc_virtual()`
+ * + `ACTION_DEFAULT` - Capture parameters and call `shmdt( shmaddr )`
+ * 
+ * @param shmid     Shared memory ID
+ * @param cmd       Command to perform
+ * @param buf       struct shmid_ds for input / output of command
+ * @return          success
+ */
+int _eval_shmctl(int shmid, int cmd, struct shmid_ds *buf) {
+
+#ifdef _EVAL_DEBUG
+    printf( _EVAL_DEBUG_PREFIX "shmctl( %d, %d, %p )\n", shmid, cmd, (void *) buf );
+#endif
+
+    _eval_shmctl_data.status ++;
+    _EVAL_TRACE( SHMCTL, shmid, cmd, (intptr_t) buf );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_SHMCTL );
+    _eval_shmctl_data.shmid = shmid;
+    _eval_shmctl_data.cmd = cmd;
+    _eval_shmctl_data.buf = buf;
+
+    switch( _eval_shmctl_data.action ) {
+    case( ACTION_ERROR ):
+        _eval_shmctl_data.ret = -1;
+        errno = EINVAL;
+        break;
+    case( ACTION_LOG ): //log
+        datalog("shmctl,%d,%d,%p", shmid, cmd, buf );
+    case( ACTION_SUCCESS ): // success
+        _eval_shmctl_data.ret = 0;
+        break;
+    case( ACTION_BLOCK ):
+        eval_error("shmctl() called, aborting");
+        _eval_longjmp( EVAL_CATCH_BLOCKED );
+        break;
+
+    case( ACTION_VIRTUAL ):
+        _eval_shmctl_data.ret = _eval_vipc_shmctl( shmid, cmd, buf );
+        break;
+
+    default:
+    _eval_shmctl_data.ret = shmctl( shmid, cmd, buf );
+    }
+
+    if ( _eval_step ) _eval_shmctl_data.ret = (int) _eval_script_end( _eval_step, (intptr_t) _eval_shmctl_data.ret );
+    _eval_trace_ret( (intptr_t) _eval_shmctl_data.ret );
+    return _eval_shmctl_data.ret;
+}
+
+/**
+ * @brief Global _eval_mkfifo_data variable for the mkfifo() function
+ * 
+ */
+EVAL_VAR(mkfifo);
+
+/**
+ * @brief Evaluate implementation calling of mkfifo function
+ * Requires data in global _eval_mkfifo_data
+ *
+ * Function `.action` options:
+ * 
+ * + `ACTION_ERROR`   - (error) Return -1 (EINVAL)
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
+ * + `ACTION_SUCCESS` - (success) Return 0
+ * + `ACTION_VIRTUAL` - Create the file in the virtual filesystem
+ * + `ACTION_DEFAULT` - Capture parameters and call `mkfifo( path, mode )`
+ *
+ * @param path      Path to FIFO
+ * @param mode      Creation mode
+ * @return int      Success
+ */
+int _eval_mkfifo(const char *path, mode_t mode) {
+    
+    _eval_mkfifo_data.status ++;
+    _EVAL_TRACE( MKFIFO, mode );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_MKFIFO );
+    _eval_mkfifo_data.mode = mode;
+
+    int err = 0;
+    if ( eval_checkconstptr(path) ) {
+        eval_error("mkfifo(path,mode) invalid path");
+        _eval_mkfifo_data.path[0] = 0;
+        err++;
+    } else {
+        strncpy( _eval_mkfifo_data.path, path, PATH_MAX );
+    }
+
+    _eval_trace_str( _eval_mkfifo_data.path );
+
+    switch( _eval_mkfifo_data.action ) {
+        case( ACTION_ERROR ):
+            _eval_mkfifo_data.ret = -1;
+            errno = EINVAL;
+            break;
+        case( ACTION_LOG ): //log
+            datalog("mkfifo,%s,%o", _eval_mkfifo_data.path, mode );
+        case( ACTION_SUCCESS ):
+            _eval_mkfifo_data.ret = 0;
+            break;
+        case(ACTION_BLOCK):
+            eval_error("mkfifo() called, aborting");
+            _eval_longjmp( EVAL_CATCH_BLOCKED );
+            break;
+        case(ACTION_VIRTUAL):
+            if ( !err ) {
+                _eval_mkfifo_data.ret = _eval_vfs_mkfifo( path, mode );
+            } else {
+                _eval_mkfifo_data.ret = -1;
+                errno = EINVAL;
+            }
+            break;
+        default:
+            if ( !err ) {
+                _eval_mkfifo_data.ret = mkfifo( path, mode );
+            } else {
+                _eval_mkfifo_data.ret = -1;
+                errno = EINVAL;
+            }
+    }
+    if ( _eval_step ) _eval_mkfifo_data.ret = (int) _eval_script_end( _eval_step, (intptr_t) _eval_mkfifo_data.ret );
+    _eval_trace_ret( (intptr_t) _eval_mkfifo_data.ret );
+    return _eval_mkfifo_data.ret;
+}
+
+/**
+ * @brief Global _eval_mkfifo_data variable for the S_ISFIFO() macro
+ * 
+ */
+EVAL_VAR(isfifo);
+
+/**
+ * @brief Evaluate implementation calling of S_ISFIFO macro
+ *
+ * Requires data in global _eval_isfifo_data
+ *
+ * Function `.action` options:
+ * 
+ * + `ACTION_ERROR`   - (not a FIFO) Return 0
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
+ * + `ACTION_SUCCESS` - (is a FIFO) Return 1
+ * + `ACTION_DEFAULT` - Capture parameters and call `S_ISFIFO( mode )`
+ *
+ * @param mode  File mode from stat or fstat
+ * @return      For action = 1 always returns true, for action = 0
+ *              has the same behavior as the S_ISFIFO macro
+ */
+int _eval_isfifo(mode_t mode) {
+    
+    _eval_isfifo_data.status ++;
+    _EVAL_TRACE( ISFIFO, mode );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_ISFIFO );
+    _eval_isfifo_data.mode = mode;
+
+    switch( _eval_isfifo_data.action ) {
+        case(ACTION_ERROR):
+            _eval_isfifo_data.ret = 0;
+            break;
+        case( ACTION_LOG ): //log
+            datalog("S_ISFIFO,%o", mode );
+        case(ACTION_SUCCESS):
+            _eval_isfifo_data.ret = 1;
+            break;
+        case(ACTION_BLOCK):
+            eval_error("S_ISFIFO() called, aborting");
+            _eval_longjmp( EVAL_CATCH_BLOCKED );
+            break;
+        default:
+            _eval_isfifo_data.ret = S_ISFIFO(mode);
+    }
+    if ( _eval_step ) _eval_isfifo_data.ret = (int) _eval_script_end( _eval_step, (intptr_t) _eval_isfifo_data.ret );
+    _eval_trace_ret( (intptr_t) _eval_isfifo_data.ret );
+    return _eval_isfifo_data.ret;
+}
+
+/**
+ * @brief Global _eval_remove_data variable for the remove() function
+ * 
+ */
+EVAL_VAR(remove);
+
+/**
+ * @brief Evaluate implementation calling of remove() function
+ *
+ * Requires data in global _eval_remove_data
+ *
+ * Function `.action` options:
+ * 
+ * + `ACTION_ERROR`   - (error) Return -1 (EINVAL)
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
+ *                      Note that the function call is logged as if the
+ *                      corresponding `unlink()` function call was made.
+ * + `ACTION_SUCCESS` - (success) Return 0
+ * + `ACTION_VIRTUAL` - Remove the file from the virtual filesystem
+ * + `ACTION_DEFAULT` - Capture parameters and call `remove( path )`
+ *
+ * @param path      File name
+ * @return int      0 on success, -1 on error
+ */
+int _eval_remove(const char * path) {
+    _eval_remove_data.status ++;
+    _EVAL_TRACE( REMOVE, 0 );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_REMOVE );
+
+    int err = 0;
+    if ( eval_checkconstptr(path) ) {
+        eval_error("remove(path) invalid path");
+        _eval_remove_data.path[0] = 0;
+        err++;
+    } else {
+        strncpy( _eval_remove_data.path, path, PATH_MAX );
+    }
+
+    _eval_remove_data.ret = 0;
+
+    _eval_trace_str( _eval_remove_data.path );
+
+    switch( _eval_remove_data.action ) {
+    case(ACTION_ERROR): // error
+        _eval_remove_data.ret = -1;
+        errno = EINVAL;
+        break;
+    case( ACTION_LOG ): //log
+        // We use "unlink" deliberately
+        datalog("unlink,%s", _eval_remove_data.path );
+    case(ACTION_SUCCESS): // success
+        _eval_remove_data.ret = 0;
+        break;
+    case(ACTION_BLOCK):
+        eval_error("remove() called, aborting");
+        _eval_longjmp( EVAL_CATCH_BLOCKED );
+        break;
+
+    case(ACTION_VIRTUAL):
+        if ( !err ) {
+            _eval_remove_data.ret = _eval_vfs_unlink( path );
+        } else {
+            _eval_remove_data.ret = -1;
+            errno = EINVAL;
+        }
+        break;
+
+    default:
+        if ( !err ) {
+            _eval_remove_data.ret = remove( path );
+        } else {
+            _eval_remove_data.ret = -1;
+            errno = EINVAL;
+        }
+    }
+    if ( _eval_step ) _eval_remove_data.ret = (int) _eval_script_end( _eval_step, (intptr_t) _eval_remove_data.ret );
+    _eval_trace_ret( (intptr_t) _eval_remove_data.ret );
+    return _eval_remove_data.ret;
+}
+
+/**
+ * @brief Global _eval_unlink_data variable for the unlink() function
+ * 
+ */
+EVAL_VAR(unlink);
+
+/**
+ * @brief Evaluate implementation calling of unlink() function
+ *
+ * Requires data in global _eval_unlink_data
+ *
+ *  Behavior:
+ *    .action = 3 - Log call parameters and return 0 without calling unlink().
+ *    .action = 2 - Return -1 without calling unlink()
+ *    .action = 1 - Return 0 without calling unlink()
+ *    ACTION_VIRTUAL - Remove the file from the virtual filesystem
+ *    default     - Call unlink()
+ * 
+ * @param path      File name
+ * @return int      0 on success, -1 on error
+ */
+int _eval_unlink(const char * path) {
+    _eval_unlink_data.status ++;
+    _EVAL_TRACE( UNLINK, 0 );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_UNLINK );
+    _eval_unlink_data.ret = 0;
+
+    int err = 0;
+    if ( eval_checkconstptr(path) ) {
+        eval_error("unlink(path) invalid path");
+        _eval_unlink_data.path[0] = 0;
+        err++;
+    } else {
+        strncpy( _eval_unlink_data.path, path, PATH_MAX );
+    }
+
+    _eval_trace_str( _eval_unlink_data.path );
+
+    switch( _eval_unlink_data.action ) {
+    case(ACTION_ERROR):
+        _eval_unlink_data.ret = -1;
+        errno = EINVAL;
+        break;
+    case(ACTION_LOG):
+        datalog("unlink,%s", _eval_unlink_data.path );
+    case(ACTION_SUCCESS):
+        _eval_unlink_data.ret = 0;
+        break;
+    case(ACTION_BLOCK):
+        eval_error("unlink() called, aborting");
+        _eval_longjmp( EVAL_CATCH_BLOCKED );
+        break;
+
+    case(ACTION_VIRTUAL):
+        if ( !err ) {
+            _eval_unlink_data.ret = _eval_vfs_unlink( path );
+        } else {
+            _eval_unlink_data.ret = -1;
+            errno = EINVAL;
+        }
+        break;
+
+    default:
+        if ( !err ) {
+            _eval_unlink_data.ret = unlink( path );
+        } else {
+            _eval_unlink_data.ret = -1;
+            errno = EINVAL;
+        }
+    }
+    if ( _eval_step ) _eval_unlink_data.ret = (int) _eval_script_end( _eval_step, (intptr_t) _eval_unlink_data.ret );
+    _eval_trace_ret( (intptr_t) _eval_unlink_data.ret );
+    return _eval_unlink_data.ret;
+}
+
+/**
+ * @brief Global _eval_atoi_data variable for the atoi() function
+ * 
+ */
+EVAL_VAR(atoi);
+
+/**
+ * @brief Evaluate implementation calling of atoi() function
+ *
+ * Requires data in global _eval_atoi_data
+ *
+ * The nptr pointer is checked before calling atoi(). On failure the value -1
+ * is returned.
+ * 
+ * Function `.action` options:
+ * 
+ * + `ACTION_ERROR`   - (error) Return INT32_MIN
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
+ * + `ACTION_SUCCESS` - (success) Return previous `_eval_atoi_data.ret` value
+ * + `ACTION_DEFAULT` - Capture parameters and call `atoi( nptr )`
+ * 
+ * @param nptr      String to be converted to integer
+ * @return int      Converted value
+ */
+int _eval_atoi( const char *nptr ) {
+    _eval_atoi_data.status++;
+    _EVAL_TRACE( ATOI, 0 );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_ATOI );
+
+    _eval_atoi_data.ret = -1;
+
+    int err = 0;
+    if ( ! eval_checkconstptr( nptr ) ) {
+        eval_error("atoi(nptr) called with invalid nptr");
+        _eval_atoi_data.nptr[0] = 0;
+        err++;
+    } else {
+        strncpy( _eval_atoi_data.nptr, nptr, 32 );
+        // atoi() is unsafe, we first check if the supplied string
+        // has a length of up to 32 characters
+        eval_error("atoi(nptr) called with invalid string");
+        err++;
+    }
+
+    _eval_trace_str( _eval_atoi_data.nptr );
+
+    switch( _eval_atoi_data.action ) {
+    case( ACTION_ERROR ):
+        _eval_atoi_data.ret = INT32_MIN;
+        break;
+    case( ACTION_LOG ):
+        datalog("atoi,%s", _eval_atoi_data.nptr );
+    case( ACTION_SUCCESS ):
+        // Keep _eval_atoi_data.ret value
+        // _eval_atoi_data.ret;
+        break;
+    case(ACTION_BLOCK):
+        eval_error("atoi() called, aborting");
+        _eval_longjmp( EVAL_CATCH_BLOCKED );
+        break;
+
+    default:
+        if ( ! err ) {
+            _eval_atoi_data.ret = atoi( nptr );
+        }  else {
+            _eval_atoi_data.ret = -1;
+        }
+    }
+
+    if ( _eval_step ) _eval_atoi_data.ret = (int) _eval_script_end( _eval_step, (intptr_t) _eval_atoi_data.ret );
+    _eval_trace_ret( (intptr_t) _eval_atoi_data.ret );
+    return _eval_atoi_data.ret;
+}
+
+/**
+ * @brief Global _eval_fopen_data variable for the fopen() function
+ * 
+ */
+EVAL_VAR(fopen);
+
+/**
+ * @brief Evaluate implementation calling of fopen() function
+ *
+ * Requires data in global _eval_fopen_data
+ * 
+ * Function `.action` options:
+ * 
+ * + `ACTION_ERROR`   - (error) Return NULL (ENOENT)
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
+ * + `ACTION_SUCCESS` - (success) Open the file in the virtual filesystem,
+ *                      creating it if required (regardless of mode)
+ * + `ACTION_VIRTUAL` - Open the file in the virtual filesystem, following the
+ *                      semantics of `fopen()`, see `eval_vfs_enable()`
+ * + `ACTION_DEFAULT` - Capture parameters and call `fopen( path, mode )`
+ * 
+ * @param path      File name
+ * @param mode      Open mode
+ * @return FILE*    Stream, NULL on error
+ */
+FILE *_eval_fopen( const char *restrict path, const char *restrict mode ) {
+    _eval_fopen_data.status++;
+    _EVAL_TRACE( FOPEN, 0 );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_FOPEN );
+
+    int err = 0;
+    if ( eval_checkconstptr(path) ) {
+        eval_error("fopen(path,mode) invalid path");
+        _eval_fopen_data.path[0] = 0;
+        err++;
+    } else {
+        strncpy( _eval_fopen_data.path, path, PATH_MAX - 1 );
+    }
+
+    if ( eval_checkconstptr(mode) ) {
+        eval_error("fopen(path,mode) invalid mode");
+        _eval_fopen_data.mode[0] = 0;
+        err++;
+    } else {
+        strncpy( _eval_fopen_data.mode, mode, sizeof( _eval_fopen_data.mode ) - 1 );
+    }
+
+    _eval_trace_str( _eval_fopen_data.path );
+
+    switch( _eval_fopen_data.action ) {
+    case( ACTION_ERROR ):
+        _eval_fopen_data.ret = NULL;
+        errno = ENOENT;
+        break;
+    case( ACTION_LOG ):
+        datalog("fopen,%s,%s", _eval_fopen_data.path, _eval_fopen_data.mode );
+    case( ACTION_SUCCESS ):
+    case( ACTION_VIRTUAL ):
+        if ( ! err ) {
+            _eval_fopen_data.ret = _eval_vfs_fopen( path, mode,
+                _eval_fopen_data.action != ACTION_VIRTUAL );
+        } else {
+            _eval_fopen_data.ret = NULL;
+            errno = EINVAL;
+        }
+        break;
+    case(ACTION_BLOCK):
+        eval_error("fopen() called, aborting");
+        _eval_longjmp( EVAL_CATCH_BLOCKED );
+        break;
+
+    default:
+        if ( ! err ) {
+            _eval_fopen_data.ret = fopen( path, mode );
+        } else {
+            _eval_fopen_data.ret = NULL;
+            errno = EINVAL;
+        }
+    }
+
+    if ( _eval_step ) _eval_fopen_data.ret = (FILE *) _eval_script_end( _eval_step, (intptr_t) _eval_fopen_data.ret );
+    _eval_trace_ret( (intptr_t) _eval_fopen_data.ret );
+    return _eval_fopen_data.ret;
+}
+
+/**
+ * @brief Global _eval_fclose_data variable for the fclose() function
+ * 
+ */
+EVAL_VAR(fclose);
+
+/**
+ * @brief Evaluate implementation calling of fclose() function
+ *
+ * Requires data in global _eval_fclose_data
+ *
+ * @param stream 
+ * @return int      0 on success, < 0 on error
+ */
+int _eval_fclose( FILE* stream ) {
+    _eval_fclose_data.status++;
+    _EVAL_TRACE( FCLOSE, (intptr_t) stream );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_FCLOSE );
+    _eval_fclose_data.ret = -1;
+    _eval_fclose_data.stream = stream;
+
+    switch( _eval_fclose_data.action ) {
+
+    case( ACTION_ERROR ): // error
+        _eval_fclose_data.ret = EOF;
+        errno = EINVAL;
+        break;
+    case(ACTION_LOG):
+        datalog("fclose,%p", stream );
+    case( ACTION_SUCCESS ): // success
+        _eval_fclose_data.ret = 0;
+        break;
+    case(ACTION_BLOCK):
+        eval_error("fclose() called, aborting");
+        _eval_longjmp( EVAL_CATCH_BLOCKED );
+        break;
+
+    default:
+        _eval_fclose_data.ret = fclose(stream);
+    }
+
+    if ( _eval_step ) _eval_fclose_data.ret = (int) _eval_script_end( _eval_step, (intptr_t) _eval_fclose_data.ret );
+    _eval_trace_ret( (intptr_t) _eval_fclose_data.ret );
+    return _eval_fclose_data.ret;
+}
+
+/**
+ * @brief Global _eval_fread_data variable for the fread() function
+ * 
+ */
+EVAL_VAR(fread);
+
+/**
+ * @brief  Evaluate implementation calling of fread() function
+ *
+ * Requires data in global _eval_fread_data
+ * 
+ * Function `.action` options:
+ * 
+ * + `ACTION_ERROR`   - (error) Return 0 (EINVAL)
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
+ * + `ACTION_SUCCESS` - (success) Return `nmemb`
+ * + `ACTION_DEFAULT` - Capture parameters and call `fread( ptr, size, nmemb, stream )`
+ * 
+ * @param ptr       Target memory location
+ * @param size      Item size in bytes
+ * @param nmemb     Number of items
+ * @param stream    Stream to read data from
+ * @return size_t   Number of items read
+ */
+size_t _eval_fread(void *restrict ptr, size_t size, size_t nmemb,
+                    FILE *restrict stream) {
+
+    _eval_fread_data.status++;
+    _EVAL_TRACE( FREAD, (intptr_t) ptr, size, nmemb, (intptr_t) stream );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_FREAD );
+
+    _eval_fread_data.ptr = ptr;
+    _eval_fread_data.size = size;
+    _eval_fread_data.nmemb = nmemb;
+    _eval_fread_data.stream = stream;
+
+
+    // catch common errors
+    int err = 0;
+    if ( (void *) ptr == (void *) stream ) {
+        eval_error("fread(ptr,size,nmemb,stream) ptr must not have the same value as stream");
+        err++;
+    } else {
+        if ( eval_checkrange( ptr, size * nmemb, EVAL_CHECK_WRITE ) ) {
+            eval_error("fread(ptr,size,nmemb,stream) invalid ptr (%p)", ptr);
+            err++;
+        }
+
+        if ( eval_checkptr(stream) ) {
+            eval_error("fread(ptr,size,nmemb,stream) invalid stream (%p)", stream);
+            err++;
+        }
+    }
+
+    if ( size * nmemb <= 0  ) {
+        eval_error("fread(ptr,size,nmemb,stream) invalid size or nmemb");
+        err++;
+    }
+
+    _eval_fread_data.ret = 0;
+        
+    switch( _eval_fread_data.action ) {
+
+    case( ACTION_ERROR ):
+        _eval_fread_data.ret = 0;
+        errno = EINVAL;
+        break;
+    case( ACTION_LOG ):
+        datalog("fread,%p,%ld,%ld,%p", ptr, size, nmemb, stream );
+    case( ACTION_SUCCESS ):
+        _eval_fread_data.ret = nmemb;
+        break;
+
+    case(ACTION_BLOCK):
+        eval_error("fread() called, aborting");
+        _eval_longjmp( EVAL_CATCH_BLOCKED );
+        break;
+
+    default:
+        if ( ! err ) {
+            _eval_fread_data.ret = fread( ptr, size, nmemb, stream );
+        } else {
+            _eval_fread_data.ret = 0;
+            errno = EINVAL;
+        }
+    }
+
+    if ( _eval_step ) _eval_fread_data.ret = (int) _eval_script_end( _eval_step, (intptr_t) _eval_fread_data.ret );
+    _eval_trace_ret( (intptr_t) _eval_fread_data.ret );
+    return _eval_fread_data.ret;
+
+}
+
+/**
+ * @brief Global _eval_fwrite_data variable for the fwrite() function
+ * 
+ */
+EVAL_VAR(fwrite);
+
+/**
+ * @brief  Evaluate implementation calling of fwrite() function
+ *
+ * Requires data in global _eval_fwrite_data
+ * 
+ * Function `.action` options:
+ * 
+ * + `ACTION_ERROR`   - (error) Return 0 (EINVAL)
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
+ * + `ACTION_SUCCESS` - (success) Return `nmemb`
+ * + `ACTION_DEFAULT` - Capture parameters and call `fwrite( ptr, size, nmemb, stream )`
+ * 
+ * @param ptr       Source memory location
+ * @param size      Item size in bytes
+ * @param nmemb     Number of items
+ * @param stream    Stream to write data to
+ * @return size_t   Number of items written
+ */
+size_t _eval_fwrite(const void *ptr, size_t size, size_t nmemb,
+                     FILE *stream) {
+
+    _eval_fwrite_data.status++;
+    _EVAL_TRACE( FWRITE, (intptr_t) ptr, size, nmemb, (intptr_t) stream );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_FWRITE );
+    _eval_fwrite_data.ptr = (void *) ptr;
+    _eval_fwrite_data.size = size;
+    _eval_fwrite_data.nmemb = nmemb;
+    _eval_fwrite_data.stream = stream;
+
+
+    // catch common errors
+    int err = 0;
+    if ( (void *) ptr == (void *) stream ) {
+        eval_error("fwrite(ptr,size,nmemb,stream) ptr must not have the same value as stream");
+        err++;
+    } else {
+        if ( eval_checkrange( ptr, size * nmemb, EVAL_CHECK_READ ) ) {
+            eval_error("fwrite(ptr,size,nmemb,stream) invalid ptr (%p)", ptr);
+            err++;
+        }
+
+        if ( eval_checkptr(stream) ) {
+            eval_error("fwrite(ptr,size,nmemb,stream) invalid stream (%p)", stream);
+            err++;
+        }
+    }
+
+    if ( size * nmemb <= 0  ) {
+        eval_error("fwrite(ptr,size,nmemb,stream) invalid size or nmemb");
+        err++;
+    }
+
+    _eval_fwrite_data.ret = 0;
+        
+    switch( _eval_fwrite_data.action ) {
+
+    case( ACTION_ERROR ):
+        _eval_fwrite_data.ret = 0;
+        errno = EINVAL;
+        break;
+    case( ACTION_LOG ):
+        datalog("fwrite,%p,%ld,%ld,%p", ptr, size, nmemb, stream );
+    case( ACTION_SUCCESS ):
+        if ( ! err ) _eval_capture_add( EVAL_WRAPPER_FWRITE, _eval_fwrite_data.status, ptr, size * nmemb );
+        _eval_fwrite_data.ret = nmemb;
+        break;
+
+    case(ACTION_BLOCK):
+        eval_error("fwrite() called, aborting");
+        _eval_longjmp( EVAL_CATCH_BLOCKED );
+        break;
+
+    default:
+        if ( ! err ) {
+            _eval_fwrite_data.ret = fwrite( ptr, size, nmemb, stream );
+        } else {
+            _eval_fwrite_data.ret = 0;
+            errno = EINVAL;
+        }
+    }
+
+    if ( _eval_step ) _eval_fwrite_data.ret = (int) _eval_script_end( _eval_step, (intptr_t) _eval_fwrite_data.ret );
+    _eval_trace_ret( (intptr_t) _eval_fwrite_data.ret );
+    return _eval_fwrite_data.ret;
+}
+
+/**
+ * @brief Global _eval_fseek_data variable for the fseek() function
+ * 
+ */
+EVAL_VAR(fseek);
+
+/**
+ * @brief Evaluate implementation calling of fseek() function
+ *
+ * Requires data in global _eval_fseek_data
+ * 
+ * Function `.action` options:
+ * 
+ * + `ACTION_ERROR`   - (error) Return -1 (EINVAL)
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
+ * + `ACTION_SUCCESS` - (success) Return 0
+ * + `ACTION_DEFAULT` - Capture parameters and call `fseek( stream, offset, whence )`
+ * 
+ * @param stream 
+ * @param offset 
+ * @param whence 
+ * @return int 
+ */
+int _eval_fseek(FILE *stream, long offset, int whence) {
+
+    _eval_fseek_data.status++;
+    _EVAL_TRACE( FSEEK, (intptr_t) stream, offset, whence );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_FSEEK );
+    _eval_fseek_data.stream = stream;
+    _eval_fseek_data.offset = offset;
+    _eval_fseek_data.whence = whence;
+
+    // catch common errors
+    int err = 0;
+    if ( eval_checkptr( stream ) ) {
+        eval_error("fseek(stream, offset, whence) invalid stream");
+        err ++;
+    }
+
+    switch( whence ) {
+    case(SEEK_SET):
+    case(SEEK_CUR):
+    case(SEEK_END):
+        break;
+    default: 
+        eval_error("fseek(stream, offset, whence) invalid value for whence");
+        err ++;
+    }
+
+    _eval_fseek_data.ret = -1;
+    switch( _eval_fseek_data.action ) {
+
+    case( ACTION_ERROR ): // error
+        _eval_fseek_data.ret = -1;
+        errno = EINVAL;
+        break;
+    case( ACTION_LOG ):
+        datalog("fseek,%p,%ld,%p", stream, offset, whence );
+    case( ACTION_SUCCESS ): // success
+        _eval_fseek_data.ret = 0;
+        break;
+
+    case(ACTION_BLOCK):
+        eval_error("fseek() called, aborting");
+        _eval_longjmp( EVAL_CATCH_BLOCKED );
+        break;
+
+    default:
+        if ( !err ) {
+            _eval_fseek_data.ret = fseek( stream, offset, whence );
+        } else {
+            _eval_fseek_data.ret = -1;
+            errno = EINVAL;
+        }
+    }
+    if ( _eval_step ) _eval_fseek_data.ret = (int) _eval_script_end( _eval_step, (intptr_t) _eval_fseek_data.ret );
+    _eval_trace_ret( (intptr_t) _eval_fseek_data.ret );
+    return _eval_fseek_data.ret;
+}
+
+/**
+ * @brief Global _eval_execl_data variable for the execl() function
+ * 
+ */
+EVAL_VAR(execl);
+
+/**
+ * @brief Evaluate implementation calling of execl() function
+ *
+ * Requires data in global _eval_execl_data
+ *
+ * The default settings implemented by the eval_reset() function will prevent
+ * the execl() function from being called, instead issuing an error and
+ * terminating the code.
+ *
+ * The function can be made to call `execl()` by setting `.action = 0` but
+ * unless the call fails this will replace the current process with a new one.
+ * Unless a new process was forked before this happens, this will of course
+ * stop the execution of the current process.
+ * 
+ * @param path      Path to the binary being called
+ * @param ...       Additional parameter to the binary being calledf
+ * @return int      -1 on error. The function does not return on success.
+ */
+int _eval_execl(const char *path, ... ) {
+
+    _eval_execl_data.status ++;
+    _EVAL_TRACE( EXECL, 0 );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_EXECL );
+
+    int err = 0;
+    if ( eval_checkconstptr( path ) ) {
+        eval_error("execl(path, ...) invalid path");
+        _eval_execl_data.path[0] = 0;
+        err++ ;
+    } else {
+        strncpy( _eval_execl_data.path, path, PATH_MAX );
+    }
+
+    _eval_trace_str( _eval_execl_data.path );
+
+    switch( _eval_execl_data.action ) {
+
+    
+    case( ACTION_LOG ):
+        datalog("execl,%s", _eval_execl_data.path );
+    case(ACTION_ERROR):
+        _eval_execl_data.ret = -1;
+        break;
+
+    case(ACTION_BLOCK):
+        eval_error("execl() called, aborting");
+        _eval_execl_data.ret = -1;
+        _eval_longjmp( EVAL_CATCH_BLOCKED );
+        break;
+
+    default:
+        if ( ! err ) {
+            va_list args;
+            va_start( args, path );
+            _eval_execl_data.ret = execv( path, (char **)args );
+            va_end( args );
+        } else {
+            _eval_execl_data.ret = -1;
+        }
+    }
+    if ( _eval_step ) _eval_execl_data.ret = (int) _eval_script_end( _eval_step, (intptr_t) _eval_execl_data.ret );
+    _eval_trace_ret( (intptr_t) _eval_execl_data.ret );
+    return _eval_execl_data.ret;
+}
+
+/******************************************************************************
+ * Heap tracking
+ *****************************************************************************/
+
+/**
+ * @brief Global variable holding the heap usage of the code being tested
+ * 
+ */
+eval_heap_t _eval_heap = {
+    .leakcheck = EVAL_LEAK_CHECK
+};
+
+/**
+ * @brief Heap block states
+ * 
+ */
+enum {
+    _EVAL_BLOCK_EMPTY = 0,
+    _EVAL_BLOCK_LIVE,
+    _EVAL_BLOCK_FREED,  // Tombstone, the address may be reused by untracked allocations
+    _EVAL_BLOCK_HELD,   // Marked as freed but not freed (ACTION_SUCCESS), used to detect double frees
+    _EVAL_BLOCK_QUARANTINE  // Freed, actual free() delayed, used to detect double frees
+};
+
+typedef struct {
+    const void *ptr;
+    size_t size;
+    unsigned int catch;     // EVAL_CATCH* where the block was allocated (0 if none)
+    int state;
+} _eval_block_type;
+
+/**
+ * @brief Open addressing (linear probing) hash table of heap blocks
+ * 
+ */
+static struct {
+    _eval_block_type *blocks;
+    size_t capacity;        // Always a power of 2
+    size_t used;            // Live blocks + held blocks + tombstones
+    size_t nheld;           // Held blocks, including blocks in quarantine
+    unsigned int catch;     // Current EVAL_CATCH* id, 0 if outside EVAL_CATCH*
+    unsigned int ncatch;    // Number of EVAL_CATCH* macros so far
+
+    // Ring of blocks in quarantine, oldest first
+    const void *quarantine[ EVAL_HEAP_QUARANTINE ];
+    int qhead;
+    int qlen;
+    size_t qbytes;
+} _eval_blocks;
+
+/**
+ * @brief Cancellation state saved by _eval_heap_lock()
+ * 
+ */
+static _EVAL_THREAD_LOCAL int _eval_heap_cancelstate;
+
+/**
+ * @brief Locks the heap tracking table if tracked threads are running
+ * 
+ * Cancellation is disabled while the lock is held, so that a thread
+ * cancelled by _eval_threads_stop() does not terminate holding it.
+ * 
+ * @return int      1 if the lock was taken, 0 otherwise
+ */
+static int _eval_heap_lock( void ) {
+    if ( __atomic_load_n( &_eval_threads.live, __ATOMIC_ACQUIRE ) == 0 ) return 0;
+    pthread_setcancelstate( PTHREAD_CANCEL_DISABLE, &_eval_heap_cancelstate );
+    while( __atomic_exchange_n( &_eval_threads.heap_lock, 1, __ATOMIC_ACQUIRE ) )
+        sched_yield();
+    return 1;
+}
+
+/**
+ * @brief Unlocks the heap tracking table
+ * 
+ * @param locked    Value returned by the matching _eval_heap_lock() call
+ */
+static void _eval_heap_unlock( int locked ) {
+    if ( locked ) {
+        __atomic_store_n( &_eval_threads.heap_lock, 0, __ATOMIC_RELEASE );
+        pthread_setcancelstate( _eval_heap_cancelstate, NULL );
+    }
+}
+
+/**
+ * @brief Hash function for block addresses
+ */
+static inline size_t _eval_block_hash( const void *ptr ) {
+    uintptr_t h = (uintptr_t) ptr;
+    h ^= h >> 17;
+    h *= (uintptr_t) 0x9E3779B97F4A7C15ULL;
+    return h ^ ( h >> 29 );
+}
+
+/**
+ * @brief Finds the slot for ptr: either the slot holding ptr or the first
+ * free slot in its probe sequence
+ */
+static _eval_block_type * _eval_block_find( const void *ptr ) {
+    size_t mask = _eval_blocks.capacity - 1;
+    size_t i = _eval_block_hash( ptr ) & mask;
+    while( _eval_blocks.blocks[i].state != _EVAL_BLOCK_EMPTY &&
+           _eval_blocks.blocks[i].ptr != ptr ) i = ( i + 1 ) & mask;
+    return &_eval_blocks.blocks[i];
+}
+
+/**
+ * @brief Checks if a block table entry is kept across rehashes
+ */
+static inline int _eval_block_kept( const _eval_block_type *b ) {
+    return b -> state == _EVAL_BLOCK_LIVE || b -> state == _EVAL_BLOCK_HELD ||
+           b -> state == _EVAL_BLOCK_QUARANTINE;
+}
+
+/**
+ * @brief Grows or rehashes the block table. Tombstones are always dropped,
+ * live, held and quarantined blocks are kept.
+ * 
+ * @return int  0 on success, -1 on error
+ */
+static int _eval_block_rehash( void ) {
+    size_t nlive = _eval_heap.nlive + _eval_blocks.nheld;
+    size_t capacity = ( _eval_blocks.capacity > 0 ) ? _eval_blocks.capacity : 1024;
+    while ( 4 * nlive >= capacity ) capacity *= 2;
+
+    _eval_block_type *old = _eval_blocks.blocks;
+    size_t oldcap = _eval_blocks.capacity;
+
+    _eval_blocks.blocks = calloc( capacity, sizeof( _eval_block_type ) );
+    if ( _eval_blocks.blocks == NULL ) {
+        _eval_blocks.blocks = old;
+        return -1;
+    }
+    _eval_blocks.capacity = capacity;
+    _eval_blocks.used = 0;
+
+    for( size_t i = 0; i < oldcap; i++ ) {
+        if ( _eval_block_kept( &old[i] ) ) {
+            *_eval_block_find( old[i].ptr ) = old[i];
+            _eval_blocks.used++;
+        }
+    }
+    free( old );
+    return 0;
+}
+
+/**
+ * @brief Registers a newly allocated block
+ */
+static void _eval_block_add( const void *ptr, size_t size ) {
+    if ( ptr == NULL ) return;
+
+    if ( 2 * ( _eval_blocks.used + 1 ) > _eval_blocks.capacity ) {
+        if ( _eval_block_rehash() ) return;
+    }
+
+    _eval_block_type *b = _eval_block_find( ptr );
+    if ( b -> state == _EVAL_BLOCK_EMPTY ) _eval_blocks.used++;
+    if ( b -> state == _EVAL_BLOCK_HELD || b -> state == _EVAL_BLOCK_QUARANTINE ) _eval_blocks.nheld--;
+    *b = (_eval_block_type) {
+        .ptr = ptr,
+        .size = size,
+        .catch = _eval_blocks.catch,
+        .state = _EVAL_BLOCK_LIVE
+    };
+
+    _eval_heap.allocs++;
+    _eval_heap.bytes += size;
+    _eval_heap.nlive++;
+    _eval_heap.live += size;
+    if ( _eval_heap.live > _eval_heap.peak ) _eval_heap.peak = _eval_heap.live;
+}
+
+/**
+ * @brief Checks a block before freeing it
+ * 
+ * Only blocks whose memory was not yet released to the C library (held by
+ * ACTION_SUCCESS, or in quarantine) are reported: the address of a block
+ * that was actually freed may since have been reused by an allocation the
+ * wrappers did not see (e.g. inside strdup() or fopen()).
+ * 
+ * @param ptr       Block address
+ * @param func      Name of calling function (for error messages)
+ * @return int      1 if ptr was already freed, 0 otherwise
+ */
+static int _eval_block_check( const void *ptr, const char *func ) {
+    if ( ptr == NULL || _eval_blocks.capacity == 0 ) return 0;
+    _eval_block_type *b = _eval_block_find( ptr );
+    if ( b -> state == _EVAL_BLOCK_HELD || b -> state == _EVAL_BLOCK_QUARANTINE ) {
+        eval_error("%s() called on already freed pointer %p", func, ptr );
+        _eval_heap.double_frees++;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Marks a block table entry as freed
+ */
+static void _eval_block_release( _eval_block_type *b ) {
+    if ( b && b -> state == _EVAL_BLOCK_LIVE ) {
+        b -> state = _EVAL_BLOCK_FREED;
+        _eval_heap.frees++;
+        _eval_heap.nlive--;
+        _eval_heap.live -= b -> size;
+    }
+}
+
+/**
+ * @brief Marks a block as freed without freeing it (ACTION_SUCCESS)
+ * 
+ * Since the address cannot be reused, freeing the block again is reported as
+ * a double free. Blocks not allocated through the wrappers are ignored.
+ */
+static void _eval_block_hold( const void *ptr ) {
+    if ( ptr == NULL || _eval_blocks.capacity == 0 ) return;
+    _eval_block_type *b = _eval_block_find( ptr );
+    if ( b -> state == _EVAL_BLOCK_LIVE ) {
+        _eval_block_release( b );
+        b -> state = _EVAL_BLOCK_HELD;
+        _eval_blocks.nheld++;
+    }
+}
+
+/**
+ * @brief Frees a block, delaying the actual free() while the block is in
+ * quarantine
+ * 
+ * Tracked blocks are kept allocated until EVAL_HEAP_QUARANTINE later blocks
+ * have been freed (or EVAL_HEAP_QUARANTINE_BYTES are in quarantine), so their
+ * addresses cannot be reused and freeing them again is reported as a double
+ * free. Blocks not allocated through the wrappers are freed immediately.
+ * 
+ * @param ptr       Block address
+ */
+static void _eval_block_free( void *ptr ) {
+    _eval_block_type *b = ( ptr && _eval_blocks.capacity > 0 ) ? _eval_block_find( ptr ) : NULL;
+    if ( b == NULL || b -> state != _EVAL_BLOCK_LIVE || b -> size > EVAL_HEAP_QUARANTINE_BYTES ) {
+        _eval_block_release( b );
+        free( ptr );
+        return;
+    }
+
+    size_t size = b -> size;
+    _eval_block_release( b );
+    b -> state = _EVAL_BLOCK_QUARANTINE;
+    _eval_blocks.nheld++;
+
+    // Release the oldest blocks
+    while( _eval_blocks.qlen == EVAL_HEAP_QUARANTINE ||
+           ( _eval_blocks.qlen > 0 && _eval_blocks.qbytes + size > EVAL_HEAP_QUARANTINE_BYTES ) ) {
+        const void *old = _eval_blocks.quarantine[ _eval_blocks.qhead ];
+        _eval_blocks.qhead = ( _eval_blocks.qhead + 1 ) % EVAL_HEAP_QUARANTINE;
+        _eval_blocks.qlen--;
+
+        _eval_block_type *q = _eval_block_find( old );
+        if ( q -> state == _EVAL_BLOCK_QUARANTINE ) {
+            _eval_blocks.qbytes -= q -> size;
+            q -> state = _EVAL_BLOCK_FREED;
+            _eval_blocks.nheld--;
+            free( (void *) old );
+        }
+    }
+
+    _eval_blocks.quarantine[ ( _eval_blocks.qhead + _eval_blocks.qlen ) % EVAL_HEAP_QUARANTINE ] = ptr;
+    _eval_blocks.qlen++;
+    _eval_blocks.qbytes += size;
+}
+
+/**
+ * @brief Updates the block table after a successful realloc()
+ * 
+ * @param old       Table entry of the original block, found before calling
+ *                  realloc() (may be NULL)
+ * @param ptr       New block address (may be NULL, if size was 0)
+ * @param size      New block size
+ */
+static void _eval_block_resize( _eval_block_type *old, const void *ptr, size_t size ) {
+    int allocs = _eval_heap.allocs;
+    size_t bytes = _eval_heap.bytes;
+    int frees = _eval_heap.frees;
+    int resized = ( old && old -> state == _EVAL_BLOCK_LIVE );
+
+    _eval_block_release( old );
+    _eval_block_add( ptr, size );
+
+    // Resizing an existing block is not counted as a free / new allocation
+    if ( resized && ptr ) {
+        _eval_heap.frees = frees;
+        _eval_heap.allocs = allocs;
+        _eval_heap.bytes = bytes + size;
+    }
+}
+
+/**
+ * @brief Resets the per EVAL_CATCH* heap statistics
+ * 
+ * Called by _eval_arm_signals()
+ */
+void _eval_heap_start( void ) {
+    _eval_heap.allocs = 0;
+    _eval_heap.frees = 0;
+    _eval_heap.bytes = 0;
+    _eval_heap.peak = _eval_heap.live;
+    _eval_heap.nleaks = 0;
+    _eval_heap.leaked = 0;
+    _eval_heap.double_frees = 0;
+
+    if ( ++_eval_blocks.ncatch == 0 ) _eval_blocks.ncatch = 1;
+    _eval_blocks.catch = _eval_blocks.ncatch;
+}
+
+/**
+ * @brief Counts blocks allocated inside the current EVAL_CATCH* that were not
+ * freed and reports them if _eval_heap.leakcheck is set
+ * 
+ * Called by _eval_disarm_signals()
+ */
+void _eval_heap_stop( void ) {
+    unsigned int catch = _eval_blocks.catch;
+    _eval_blocks.catch = 0;
+
+    if ( _eval_heap.allocs == 0 ) return;
+
+    for( size_t i = 0; i < _eval_blocks.capacity; i++ ) {
+        _eval_block_type *b = &_eval_blocks.blocks[i];
+        if ( b -> state == _EVAL_BLOCK_LIVE && b -> catch == catch ) {
+            _eval_heap.nleaks++;
+            _eval_heap.leaked += b -> size;
+        }
+    }
+
+    if ( _eval_heap.leakcheck && _eval_heap.nleaks > 0 ) {
+        // List (up to 10) leaked blocks in the error message
+        char list[ 512 ] = "";
+        size_t len = 0;
+        if ( _eval_heap.nleaks <= 10 ) {
+            for( size_t i = 0; i < _eval_blocks.capacity && len < sizeof( list ); i++ ) {
+                _eval_block_type *b = &_eval_blocks.blocks[i];
+                if ( b -> state == _EVAL_BLOCK_LIVE && b -> catch == catch )
+                    len += snprintf( list + len, sizeof( list ) - len, "%s%p (%zu byte(s))",
+                        len ? ", " : ": ", b -> ptr, b -> size );
+            }
+        }
+        eval_error("%zu byte(s) in %d block(s) were not freed%s", _eval_heap.leaked, _eval_heap.nleaks, list );
+    }
+}
+
+/**
+ * @brief Prints heap usage for the last EVAL_CATCH* macro
+ * 
+ */
+void eval_heap_print( void ) {
+    printf("allocs = %d, frees = %d, bytes = %zu, peak = %zu, leaks = %zu byte(s) in %d block(s)",
+        _eval_heap.allocs, _eval_heap.frees, _eval_heap.bytes, _eval_heap.peak,
+        _eval_heap.leaked, _eval_heap.nleaks );
+    if ( _eval_heap.double_frees ) printf(", double frees = %d", _eval_heap.double_frees );
+    printf("\n");
+}
+
+/**
+ * @brief Global _eval_malloc_data variable for the malloc() function
+ * 
+ */
+EVAL_VAR(malloc);
+
+/**
+ * @brief Evaluate implementation calling of malloc() function
+ * 
+ * Requires data in global _eval_malloc_data
+ * 
+ * Function `.action` options:
+ * 
+ * + `ACTION_ERROR`   - (error) Return NULL (ENOMEM), nothing is allocated
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_DEFAULT`
+ * + `ACTION_DEFAULT` - Capture parameters, call `malloc( size )` and track
+ *                      allocated block
+ * 
+ * @param size      Number of bytes
+ * @return void*    Allocated memory
+ */
+void *_eval_malloc( size_t size ) {
+    _eval_malloc_data.status++;
+    _EVAL_TRACE( MALLOC, size );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_MALLOC );
+    // Returned through a local, the wrapper may run on several threads
+    void *ret = NULL;
+    _eval_malloc_data.size = size;
+
+    switch( _eval_malloc_data.action ) {
+    case( ACTION_ERROR ):
+        ret = NULL;
+        errno = ENOMEM;
+        break;
+
+    case( ACTION_BLOCK ):
+        eval_error("malloc() called, aborting");
+        _eval_longjmp( EVAL_CATCH_BLOCKED );
+        break;
+
+    case( ACTION_LOG ):
+        datalog("malloc,%zu", size );
+    default: {
+        int locked = _eval_heap_lock();
+        ret = malloc( size );
+        _eval_block_add( ret, size );
+        _eval_heap_unlock( locked );
+        }
+    }
+
+    if ( _eval_step ) ret = (void *) _eval_script_end( _eval_step, (intptr_t) ret );
+    _eval_trace_ret( (intptr_t) ret );
+    _eval_malloc_data.ret = ret;
+    return ret;
+}
+
+/**
+ * @brief Global _eval_calloc_data variable for the calloc() function
+ * 
+ */
+EVAL_VAR(calloc);
+
+/**
+ * @brief Evaluate implementation calling of calloc() function
+ * 
+ * Requires data in global _eval_calloc_data
+ * 
+ * Function `.action` options:
+ * 
+ * + `ACTION_ERROR`   - (error) Return NULL (ENOMEM), nothing is allocated
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_DEFAULT`
+ * + `ACTION_DEFAULT` - Capture parameters, call `calloc( nmemb, size )` and
+ *                      track allocated block
+ * 
+ * @param nmemb     Number of elements
+ * @param size      Size of each element
+ * @return void*    Allocated memory
+ */
+void *_eval_calloc( size_t nmemb, size_t size ) {
+    _eval_calloc_data.status++;
+    _EVAL_TRACE( CALLOC, nmemb, size );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_CALLOC );
+    void *ret = NULL;
+    _eval_calloc_data.nmemb = nmemb;
+    _eval_calloc_data.size = size;
+
+    switch( _eval_calloc_data.action ) {
+    case( ACTION_ERROR ):
+        ret = NULL;
+        errno = ENOMEM;
+        break;
+
+    case( ACTION_BLOCK ):
+        eval_error("calloc() called, aborting");
+        _eval_longjmp( EVAL_CATCH_BLOCKED );
+        break;
+
+    case( ACTION_LOG ):
+        datalog("calloc,%zu,%zu", nmemb, size );
+    default: {
+        int locked = _eval_heap_lock();
+        ret = calloc( nmemb, size );
+        if ( ret ) _eval_block_add( ret, nmemb * size );
+        _eval_heap_unlock( locked );
+        }
+    }
+
+    if ( _eval_step ) ret = (void *) _eval_script_end( _eval_step, (intptr_t) ret );
+    _eval_trace_ret( (intptr_t) ret );
+    _eval_calloc_data.ret = ret;
+    return ret;
+}
+
+/**
+ * @brief Global _eval_realloc_data variable for the realloc() function
+ * 
+ */
+EVAL_VAR(realloc);
+
+/**
+ * @brief Evaluate implementation calling of realloc() function
+ * 
+ * Requires data in global _eval_realloc_data
+ * 
+ * Function `.action` options:
+ * 
+ * + `ACTION_ERROR`   - (error) Return NULL (ENOMEM), the original block is
+ *                      left untouched
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_DEFAULT`
+ * + `ACTION_DEFAULT` - Capture parameters, call `realloc( ptr, size )` and
+ *                      track allocated block
+ * 
+ * @param ptr       Block to resize
+ * @param size      New size
+ * @return void*    Allocated memory
+ */
+void *_eval_realloc( void *ptr, size_t size ) {
+    _eval_realloc_data.status++;
+    _EVAL_TRACE( REALLOC, (intptr_t) ptr, size );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_REALLOC );
+    void *ret = NULL;
+    _eval_realloc_data.ptr = ptr;
+    _eval_realloc_data.size = size;
+
+    switch( _eval_realloc_data.action ) {
+    case( ACTION_ERROR ):
+        ret = NULL;
+        errno = ENOMEM;
+        break;
+
+    case( ACTION_BLOCK ):
+        eval_error("realloc() called, aborting");
+        _eval_longjmp( EVAL_CATCH_BLOCKED );
+        break;
+
+    case( ACTION_LOG ):
+        datalog("realloc,%p,%zu", ptr, size );
+    default: {
+        int locked = _eval_heap_lock();
+        if ( _eval_block_check( ptr, "realloc" ) ) {
+            _eval_heap_unlock( locked );
+            ret = NULL;
+            errno = EINVAL;
+            break;
+        }
+        // Look up the original block first, ptr must not be used after realloc()
+        _eval_block_type *old = ( ptr && _eval_blocks.capacity > 0 ) ? _eval_block_find( ptr ) : NULL;
+        ret = realloc( ptr, size );
+        if ( ret || size == 0 ) {
+            // The original block was resized (or freed)
+            _eval_block_resize( old, ret, size );
+        }
+        _eval_heap_unlock( locked );
+        }
+    }
+
+    if ( _eval_step ) ret = (void *) _eval_script_end( _eval_step, (intptr_t) ret );
+    _eval_trace_ret( (intptr_t) ret );
+    _eval_realloc_data.ret = ret;
+    return ret;
+}
+
+/**
+ * @brief Global _eval_free_data variable for the free() function
+ * 
+ */
+EVAL_VAR(free);
+
+/**
+ * @brief Evaluate implementation calling of free() function
+ * 
+ * Requires data in global _eval_free_data
+ * 
+ * Freeing a block that was already freed, while it is still in quarantine
+ * (see _eval_block_free()) or marked as freed by ACTION_SUCCESS, issues an
+ * error and the block is not freed again.
+ * 
+ * Function `.action` options:
+ * 
+ * + `ACTION_SUCCESS` - (success) Do not free the block but mark it as freed
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_DEFAULT`
+ * + `ACTION_DEFAULT` - Capture parameters and call `free( ptr )`, delayed
+ *                      while the block is in quarantine
+ * 
+ * @param ptr       Block to free
+ */
+void _eval_free( void *ptr ) {
+    _eval_free_data.status++;
+    _EVAL_TRACE( FREE, (intptr_t) ptr );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_FREE );
+    _eval_free_data.ptr = ptr;
+
+    int locked = _eval_heap_lock();
+    if ( ! _eval_block_check( ptr, "free" ) ) {
+        switch( _eval_free_data.action ) {
+        case( ACTION_BLOCK ):
+            _eval_heap_unlock( locked );
+            eval_error("free() called, aborting");
+            _eval_longjmp( EVAL_CATCH_BLOCKED );
+            break;
+
+        case( ACTION_SUCCESS ):
+            _eval_block_hold( ptr );
+            break;
+
+        case( ACTION_LOG ):
+            datalog("free,%p", ptr );
+        default:
+            _eval_block_free( ptr );
+        }
+    }
+    _eval_heap_unlock( locked );
+
+    if ( _eval_step ) _eval_script_end( _eval_step, 0 );
+    _eval_trace_ret( 0 );
+}
+
+/******************************************************************************
+ * Threads
+ *****************************************************************************/
+
+/**
+ * @brief Key used to detect tracked threads calling pthread_exit()
+ * 
+ */
+static pthread_key_t _eval_thread_key;
+static pthread_once_t _eval_thread_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Marks a tracked thread as terminated
+ * 
+ * Called by _eval_thread_start() and, as the _eval_thread_key destructor,
+ * when the thread calls pthread_exit()
+ * 
+ * @param arg       Tracked thread
+ */
+static void _eval_thread_done( void *arg ) {
+    _eval_thread_type *t = arg;
+
+    // Called on the terminating thread, which is not running on this stack
+    if ( t -> altstack ) {
+        stack_t ss = { .ss_flags = SS_DISABLE };
+        sigaltstack( &ss, NULL );
+        free( t -> altstack );
+        t -> altstack = NULL;
+    }
+
+    __atomic_store_n( &t -> state, EVAL_THREAD_DONE, __ATOMIC_RELEASE );
+}
+
+static void _eval_thread_key_create( void ) {
+    if ( pthread_key_create( &_eval_thread_key, _eval_thread_done ) ) {
+        perror("_eval_thread_key_create: (*critical*) Unable to create thread key");
+        exit(1);
+    }
+}
+
+/**
+ * @brief Start routine of tracked threads
+ * 
+ * Sets the catch point of the thread, used by _eval_longjmp() to terminate
+ * the thread on faults, and an alternate signal stack, released when the
+ * thread terminates. SIGPROF, blocked by _eval_pthread_create(), stays
+ * blocked so that timer expirations and fault deliveries always reach the
+ * catch thread; cancellation uses pthread_cancel(), see _eval_threads_stop().
+ * 
+ * @param arg       Tracked thread
+ * @return void*    Value returned by the thread, PTHREAD_CANCELED if the
+ *                  thread was terminated
+ */
+static void *_eval_thread_start( void *arg ) {
+    _eval_thread_type *t = arg;
+    _eval_thread_self = t;
+    pthread_setspecific( _eval_thread_key, t );
+
+    // Stack overflows in the thread are caught on its alternate signal stack
+    t -> altstack = _eval_altstack();
+
+    if ( ! sigsetjmp( t -> jmp, 1 ) ) {
+        t -> ret = t -> start( t -> arg );
+    } else {
+        t -> ret = PTHREAD_CANCELED;
+    }
+
+    pthread_setspecific( _eval_thread_key, NULL );
+    _eval_thread_self = NULL;
+    _eval_thread_done( t );
+    return t -> ret;
+}
+
+/**
+ * @brief Finds a tracked thread
+ * 
+ * @param thread            Thread id
+ * @return _eval_thread_type*   Tracked thread, NULL if not found
+ */
+static _eval_thread_type *_eval_thread_find( pthread_t thread ) {
+    for( int i = 0; i < EVAL_THREADS_MAX; i++ ) {
+        _eval_thread_type *t = &_eval_threads.list[i];
+        if ( __atomic_load_n( &t -> state, __ATOMIC_ACQUIRE ) != EVAL_THREAD_FREE &&
+             pthread_equal( t -> thread, thread ) ) return t;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Releases a tracked thread slot
+ * 
+ * @param t     Tracked thread
+ */
+static void _eval_thread_release( _eval_thread_type *t ) {
+    __atomic_store_n( &t -> state, EVAL_THREAD_FREE, __ATOMIC_RELEASE );
+    __atomic_sub_fetch( &_eval_threads.live, 1, __ATOMIC_ACQ_REL );
+}
+
+/**
+ * @brief Waits for tracked threads to terminate
+ * 
+ * @param only      Only wait for threads marked in this array, all running
+ *                  threads if NULL
+ */
+static void _eval_threads_wait( const char only[] ) {
+    struct timespec start;
+    clock_gettime( CLOCK_MONOTONIC, &start );
+    for( int i = 0; i < EVAL_THREADS_MAX; i++ ) {
+        _eval_thread_type *t = &_eval_threads.list[i];
+        if ( only && ! only[i] ) continue;
+        while( __atomic_load_n( &t -> state, __ATOMIC_ACQUIRE ) == EVAL_THREAD_RUNNING &&
+            ! ( only == NULL && t -> cancel ) &&
+            _eval_elapsed( CLOCK_MONOTONIC, &start ) < EVAL_THREADS_GRACE ) {
+            nanosleep( &(struct timespec){ .tv_sec = 0, .tv_nsec = 100000 }, NULL );
+        }
+    }
+}
+
+/**
+ * @brief Cancels all tracked threads
+ * 
+ * Called by _eval_disarm_signals() at the end of every EVAL_CATCH* block.
+ * If the code being tested returned normally, running threads are first
+ * given EVAL_THREADS_GRACE seconds to finish. Threads still running are then
+ * cancelled with pthread_cancel(), so they terminate at a cancellation point
+ * (or at the next wrapped function call) without leaving library locks
+ * held; threads that do not terminate within EVAL_THREADS_GRACE seconds
+ * (e.g. because they never reach a cancellation point) are reported and
+ * left running. Threads that were not joined are joined, and a fault raised
+ * by any thread is reported in _eval_env.stat if the code being tested
+ * otherwise returned normally.
+ */
+void _eval_threads_stop( void ) {
+    _eval_threads.cancelled = 0;
+    if ( __atomic_load_n( &_eval_threads.live, __ATOMIC_ACQUIRE ) == 0 ) goto done;
+
+    __atomic_store_n( &_eval_threads.closing, 1, __ATOMIC_RELEASE );
+
+    const int normal = ( _eval_env.stat == 0 && _eval_threads.fault == 0 );
+    if ( normal ) _eval_threads_wait( NULL );
+
+    // Threads that were already cancelled in a previous block are not waited for again
+    char cancelled[ EVAL_THREADS_MAX ] = {0};
+    for( int i = 0; i < EVAL_THREADS_MAX; i++ ) {
+        _eval_thread_type *t = &_eval_threads.list[i];
+        if ( __atomic_load_n( &t -> state, __ATOMIC_ACQUIRE ) == EVAL_THREAD_RUNNING &&
+             ! __atomic_exchange_n( &t -> cancel, 1, __ATOMIC_ACQ_REL ) ) {
+            if ( pthread_cancel( t -> thread ) == 0 ) {
+                cancelled[i] = 1;
+                _eval_threads.cancelled++;
+            }
+        }
+    }
+
+    if ( normal && _eval_threads.cancelled )
+        eval_error("%d thread(s) still running at the end of the block were cancelled",
+            _eval_threads.cancelled );
+
+    // Wait for cancelled threads to terminate
+    _eval_threads_wait( cancelled );
+
+    int stuck = 0;
+    _eval_threads.stuck = 0;
+    for( int i = 0; i < EVAL_THREADS_MAX; i++ ) {
+        _eval_thread_type *t = &_eval_threads.list[i];
+        switch( __atomic_load_n( &t -> state, __ATOMIC_ACQUIRE ) ) {
+        case( EVAL_THREAD_DONE ):
+            if ( ! t -> detached ) pthread_join( t -> thread, NULL );
+            _eval_thread_release( t );
+            break;
+        case( EVAL_THREAD_RUNNING ):
+            _eval_threads.stuck++;
+            stuck += cancelled[i];
+            break;
+        }
+    }
+
+    if ( stuck ) eval_error("%d thread(s) could not be cancelled", stuck );
+
+    // Discard a pending fault delivery, the catch thread is no longer running the code
+    if ( _eval_threads.sigprof ) {
+        sigset_t set, pending;
+        sigemptyset( &set );
+        sigaddset( &set, SIGPROF );
+        pthread_sigmask( SIG_BLOCK, &set, NULL );
+        sigpending( &pending );
+        if ( sigismember( &pending, SIGPROF ) ) {
+            int sig;
+            sigwait( &set, &sig );
+#ifdef _EVAL_POSIX_TIMERS
+            // This may have been a session timer expiration
+            memset( &_eval_session.cpu_expiry, 0, sizeof( struct timespec ) );
+            memset( &_eval_session.wall_expiry, 0, sizeof( struct timespec ) );
+#endif
+        }
+        pthread_sigmask( SIG_UNBLOCK, &set, NULL );
+
+        if ( sigaction( SIGPROF, &_eval_threads.sigaction, NULL ) < 0) {
+            perror("_eval_threads_stop: (*critical*) Unable to reset signal handler for SIGPROF");
+            exit(1);
+        }
+        _eval_threads.sigprof = 0;
+    }
+
+    // A thread terminated by a fault may have been holding the lock
+    if ( _eval_threads.stuck == 0 ) __atomic_store_n( &_eval_threads.heap_lock, 0, __ATOMIC_RELEASE );
+
+    _eval_threads.pending = 0;
+    __atomic_store_n( &_eval_threads.closing, 0, __ATOMIC_RELEASE );
+
+done:
+    if ( _eval_threads.fault && _eval_env.stat == 0 ) _eval_env.stat = _eval_threads.fault;
+}
+
+/**
+ * @brief Prints out thread statistics for the last EVAL_CATCH* block
+ * 
+ */
+void eval_threads_print( void ) {
+    printf("threads created = %d, cancelled = %d, stuck = %d, lock contention = %d\n",
+        _eval_threads.created, _eval_threads.cancelled, _eval_threads.stuck,
+        _eval_pthread_mutex_lock_data.contended );
+}
+
+/**
+ * @brief Global _eval_pthread_create_data variable for the pthread_create() function
+ * 
+ */
+EVAL_VAR(pthread_create);
+
+/**
+ * @brief Evaluate implementation calling of pthread_create() function
+ * 
+ * Requires data in global _eval_pthread_create_data
+ * 
+ * Inside EVAL_CATCH* blocks, threads are tracked: faults (signals, exit(),
+ * blocked functions) on the new thread terminate the thread and are delivered
+ * to the thread running the EVAL_CATCH* code, and threads still running at
+ * the end of the block (e.g. on timeout) are cancelled.
+ * 
+ * Function `.action` options:
+ * 
+ * + `ACTION_ERROR`   - (error) Return EAGAIN, no thread is created
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_DEFAULT`
+ * + `ACTION_DEFAULT` - Capture parameters, call `pthread_create()` and track
+ *                      the new thread
+ * 
+ * @param thread    Thread id (out)
+ * @param attr      Thread attributes
+ * @param start     Start routine
+ * @param arg       Start routine argument
+ * @return int      0 on success, error code otherwise
+ */
+int _eval_pthread_create( pthread_t *restrict thread, const pthread_attr_t *restrict attr,
+    void *(*start)( void * ), void *restrict arg ) {
+
+    __atomic_add_fetch( &_eval_pthread_create_data.status, 1, __ATOMIC_RELAXED );
+    _EVAL_TRACE( PTHREAD_CREATE, (intptr_t) thread, (intptr_t) attr, (intptr_t) start, (intptr_t) arg );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_PTHREAD_CREATE );
+
+    switch( _eval_pthread_create_data.action ) {
+    case( ACTION_ERROR ):
+        _eval_pthread_create_data.ret = EAGAIN;
+        break;
+
+    case( ACTION_BLOCK ):
+        eval_error("pthread_create() called, aborting");
+        _eval_longjmp( EVAL_CATCH_BLOCKED );
+        break;
+
+    case( ACTION_LOG ):
+        datalog("pthread_create");
+    default:
+        if ( ! _eval_env.catch ) {
+            _eval_pthread_create_data.ret = pthread_create( thread, attr, start, arg );
+            break;
+        }
+
+        pthread_once( &_eval_thread_once, _eval_thread_key_create );
+
+        // Faults on the new thread are delivered through SIGPROF
+        if ( ! _eval_threads.sigprof ) {
+            struct sigaction act;
+            act.sa_flags = SA_SIGINFO | SA_RESTART | SA_ONSTACK;
+            // Inside a session the signal mask is not restored by siglongjmp()
+            if ( _eval_env.session ) act.sa_flags |= SA_NODEFER;
+            act.sa_sigaction = _eval_sighandler;
+            sigemptyset( &act.sa_mask );
+            if ( sigaction( SIGPROF, &act, &_eval_threads.sigaction ) < 0) {
+                perror("_eval_pthread_create: (*critical*) Unable to set signal handler for SIGPROF");
+                exit(1);
+            }
+            _eval_threads.sigprof = 1;
+        }
+
+        _eval_thread_type *t = NULL;
+        for( int i = 0; i < EVAL_THREADS_MAX; i++ ) {
+            int free_state = EVAL_THREAD_FREE;
+            if ( __atomic_compare_exchange_n( &_eval_threads.list[i].state, &free_state,
+                EVAL_THREAD_RUNNING, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) ) {
+                t = &_eval_threads.list[i];
+                break;
+            }
+        }
+
+        if ( t == NULL ) {
+            eval_error("pthread_create() called with %d threads running, the maximum is %d",
+                EVAL_THREADS_MAX, EVAL_THREADS_MAX );
+            _eval_pthread_create_data.ret = EAGAIN;
+            break;
+        }
+
+        t -> start = start;
+        t -> arg = arg;
+        t -> ret = NULL;
+        t -> cancel = 0;
+        t -> stat = 0;
+        t -> detached = 0;
+        if ( attr ) {
+            int state;
+            if ( pthread_attr_getdetachstate( attr, &state ) == 0 )
+                t -> detached = ( state == PTHREAD_CREATE_DETACHED );
+        }
+
+        // The new thread inherits the signal mask, see _eval_thread_start()
+        sigset_t set, mask;
+        sigemptyset( &set );
+        sigaddset( &set, SIGPROF );
+        pthread_sigmask( SIG_BLOCK, &set, &mask );
+
+        __atomic_add_fetch( &_eval_threads.live, 1, __ATOMIC_ACQ_REL );
+        _eval_pthread_create_data.ret = pthread_create( &t -> thread, attr, _eval_thread_start, t );
+        pthread_sigmask( SIG_SETMASK, &mask, NULL );
+        if ( _eval_pthread_create_data.ret ) {
+            _eval_thread_release( t );
+        } else {
+            __atomic_add_fetch( &_eval_threads.created, 1, __ATOMIC_RELAXED );
+            if ( thread ) *thread = t -> thread;
+        }
+    }
+
+    if ( _eval_step ) _eval_pthread_create_data.ret = (int) _eval_script_end( _eval_step, (intptr_t) _eval_pthread_create_data.ret );
+    _eval_trace_ret( (intptr_t) _eval_pthread_create_data.ret );
+    return _eval_pthread_create_data.ret;
+}
+
+/**
+ * @brief Global _eval_pthread_join_data variable for the pthread_join() function
+ * 
+ */
+EVAL_VAR(pthread_join);
+
+/**
+ * @brief Evaluate implementation calling of pthread_join() function
+ * 
+ * Requires data in global _eval_pthread_join_data
+ * 
+ * Function `.action` options:
+ * 
+ * + `ACTION_ERROR`   - (error) Return ESRCH, the thread is not joined
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_DEFAULT`
+ * + `ACTION_DEFAULT` - Capture parameters and call `pthread_join()`. Joining a
+ *                      tracked thread that was terminated by a fault sets
+ *                      `*retval` to PTHREAD_CANCELED and increments `.faulted`
+ * 
+ * @param thread    Thread to join
+ * @param retval    Thread return value (out)
+ * @return int      0 on success, error code otherwise
+ */
+int _eval_pthread_join( pthread_t thread, void **retval ) {
+    __atomic_add_fetch( &_eval_pthread_join_data.status, 1, __ATOMIC_RELAXED );
+    _EVAL_TRACE( PTHREAD_JOIN, (intptr_t) thread, (intptr_t) retval );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_PTHREAD_JOIN );
+
+    switch( _eval_pthread_join_data.action ) {
+    case( ACTION_ERROR ):
+        _eval_pthread_join_data.ret = ESRCH;
+        break;
+
+    case( ACTION_BLOCK ):
+        eval_error("pthread_join() called, aborting");
+        _eval_longjmp( EVAL_CATCH_BLOCKED );
+        break;
+
+    case( ACTION_LOG ):
+        datalog("pthread_join");
+    default: {
+        _eval_thread_type *t = _eval_thread_find( thread );
+        _eval_pthread_join_data.ret = pthread_join( thread, retval );
+        if ( t && _eval_pthread_join_data.ret == 0 ) {
+            if ( t -> stat ) __atomic_add_fetch( &_eval_pthread_join_data.faulted, 1, __ATOMIC_RELAXED );
+            _eval_thread_release( t );
+        }
+        }
+    }
+
+    if ( _eval_step ) _eval_pthread_join_data.ret = (int) _eval_script_end( _eval_step, (intptr_t) _eval_pthread_join_data.ret );
+    _eval_trace_ret( (intptr_t) _eval_pthread_join_data.ret );
+    return _eval_pthread_join_data.ret;
+}
+
+/**
+ * @brief Global _eval_pthread_mutex_lock_data variable for the pthread_mutex_lock() function
+ * 
+ */
+EVAL_VAR(pthread_mutex_lock);
+
+/**
+ * @brief Evaluate implementation calling of pthread_mutex_lock() function
+ * 
+ * Requires data in global _eval_pthread_mutex_lock_data
+ * 
+ * Function `.action` options:
+ * 
+ * + `ACTION_ERROR`   - (error) Return EINVAL, the mutex is not locked
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_DEFAULT`
+ * + `ACTION_DEFAULT` - Call `pthread_mutex_lock()`. Calls that find the mutex
+ *                      locked increment `.contended`
+ * 
+ * @param mutex     Mutex
+ * @return int      0 on success, error code otherwise
+ */
+int _eval_pthread_mutex_lock( pthread_mutex_t *mutex ) {
+    __atomic_add_fetch( &_eval_pthread_mutex_lock_data.status, 1, __ATOMIC_RELAXED );
+    _EVAL_TRACE( PTHREAD_MUTEX_LOCK, (intptr_t) mutex );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_PTHREAD_MUTEX_LOCK );
+    int ret;
+
+    switch( _eval_pthread_mutex_lock_data.action ) {
+    case( ACTION_ERROR ):
+        ret = EINVAL;
+        break;
+
+    case( ACTION_BLOCK ):
+        eval_error("pthread_mutex_lock() called, aborting");
+        _eval_longjmp( EVAL_CATCH_BLOCKED );
+        break;
+
+    case( ACTION_LOG ):
+        datalog("pthread_mutex_lock,%p", (void *) mutex );
+    default:
+        ret = pthread_mutex_trylock( mutex );
+        if ( ret == EBUSY ) {
+            __atomic_add_fetch( &_eval_pthread_mutex_lock_data.contended, 1, __ATOMIC_RELAXED );
+            ret = pthread_mutex_lock( mutex );
+        }
+    }
+
+    if ( _eval_step ) ret = (int) _eval_script_end( _eval_step, (intptr_t) ret );
+    _eval_pthread_mutex_lock_data.ret = ret;
+    _eval_trace_ret( (intptr_t) ret );
+    return ret;
+}
+
+/**
+ * @brief Global _eval_pthread_mutex_trylock_data variable for the pthread_mutex_trylock() function
+ * 
+ */
+EVAL_VAR(pthread_mutex_trylock);
+
+/**
+ * @brief Evaluate implementation calling of pthread_mutex_trylock() function
+ * 
+ * Requires data in global _eval_pthread_mutex_trylock_data
+ * 
+ * Function `.action` options:
+ * 
+ * + `ACTION_ERROR`   - (error) Return EBUSY, the mutex is not locked
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_DEFAULT`
+ * + `ACTION_DEFAULT` - Call `pthread_mutex_trylock()`. Calls returning EBUSY
+ *                      increment `.busy`
+ * 
+ * @param mutex     Mutex
+ * @return int      0 on success, error code otherwise
+ */
+int _eval_pthread_mutex_trylock( pthread_mutex_t *mutex ) {
+    __atomic_add_fetch( &_eval_pthread_mutex_trylock_data.status, 1, __ATOMIC_RELAXED );
+    _EVAL_TRACE( PTHREAD_MUTEX_TRYLOCK, (intptr_t) mutex );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_PTHREAD_MUTEX_TRYLOCK );
+    int ret;
+
+    switch( _eval_pthread_mutex_trylock_data.action ) {
+    case( ACTION_ERROR ):
+        ret = EBUSY;
+        break;
+
+    case( ACTION_BLOCK ):
+        eval_error("pthread_mutex_trylock() called, aborting");
+        _eval_longjmp( EVAL_CATCH_BLOCKED );
+        break;
+
+    case( ACTION_LOG ):
+        datalog("pthread_mutex_trylock,%p", (void *) mutex );
+    default:
+        ret = pthread_mutex_trylock( mutex );
+        if ( ret == EBUSY )
+            __atomic_add_fetch( &_eval_pthread_mutex_trylock_data.busy, 1, __ATOMIC_RELAXED );
+    }
+
+    if ( _eval_step ) ret = (int) _eval_script_end( _eval_step, (intptr_t) ret );
+    _eval_pthread_mutex_trylock_data.ret = ret;
+    _eval_trace_ret( (intptr_t) ret );
+    return ret;
+}
+
+/**
+ * @brief Global _eval_pthread_mutex_unlock_data variable for the pthread_mutex_unlock() function
+ * 
+ */
+EVAL_VAR(pthread_mutex_unlock);
+
+/**
+ * @brief Evaluate implementation calling of pthread_mutex_unlock() function
+ * 
+ * Requires data in global _eval_pthread_mutex_unlock_data
+ * 
+ * Function `.action` options:
+ * 
+ * + `ACTION_ERROR`   - (error) Return EPERM, the mutex is not unlocked
+ * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_DEFAULT`
+ * + `ACTION_DEFAULT` - Call `pthread_mutex_unlock()`
+ * 
+ * @param mutex     Mutex
+ * @return int      0 on success, error code otherwise
+ */
+int _eval_pthread_mutex_unlock( pthread_mutex_t *mutex ) {
+    __atomic_add_fetch( &_eval_pthread_mutex_unlock_data.status, 1, __ATOMIC_RELAXED );
+    _EVAL_TRACE( PTHREAD_MUTEX_UNLOCK, (intptr_t) mutex );
+    const eval_step_t *_eval_step = _eval_script_begin( EVAL_WRAPPER_PTHREAD_MUTEX_UNLOCK );
+    int ret;
+
+    switch( _eval_pthread_mutex_unlock_data.action ) {
+    case( ACTION_ERROR ):
+        ret = EPERM;
+        break;
+
+    case( ACTION_BLOCK ):
+        eval_error("pthread_mutex_unlock() called, aborting");
+        _eval_longjmp( EVAL_CATCH_BLOCKED );
+        break;
+
+    case( ACTION_LOG ):
+        datalog("pthread_mutex_unlock,%p", (void *) mutex );
+    default:
+        ret = pthread_mutex_unlock( mutex );
+    }
+
+    if ( _eval_step ) ret = (int) _eval_script_end( _eval_step, (intptr_t) ret );
+    _eval_pthread_mutex_unlock_data.ret = ret;
+    _eval_trace_ret( (intptr_t) ret );
+    return ret;
+}
+
+/******************************************************************************
+ * Wrapper registry
+ *****************************************************************************/
+
+/**
+ * @brief Current wrapper state generation. Starts at 1 so that all wrappers
+ * are initialized on first access.
+ * 
+ */
+unsigned int _eval_wrapper_gen = 1;
+
+/**
+ * @brief Generation of the state of each wrapper
+ * 
+ */
+unsigned int _eval_wrapper_gens[ EVAL_WRAPPER_NFUNCS ];
+
+/**
+ * @brief Use default actions (eval_reset()) when reinitializing wrapper state
+ * 
+ */
+static int _eval_wrapper_defaults = 0;
+
+#define _EVAL_WRAPPER_ENTRY( name, ID, action ) \
+    { #name, &_eval_##name##_store, sizeof( _eval_##name##_store ), action },
+
+/**
+ * @brief Wrapper registry
+ * 
+ */
+static const struct {
+    const char *name;
+    void *data;
+    size_t size;
+    int action;
+} _eval_wrappers[] = {
+    EVAL_WRAPPERS( _EVAL_WRAPPER_ENTRY )
+};
+
+/**
+ * @brief Serializes wrapper reinitialization while tracked threads are running
+ * 
+ */
+static int _eval_wrapper_lock;
+
+/**
+ * @brief Reinitializes the state of a wrapper. Called from the
+ * _eval_*_touch() accessors on first access after a reset.
+ * 
+ * While tracked threads are running the state is reinitialized under a lock,
+ * so that only the first thread to access the wrapper resets it and the
+ * others do not see partially reset data.
+ * 
+ * @param id    Wrapper id
+ */
+void _eval_wrapper_init( int id ) {
+    int locked = 0;
+    if ( __atomic_load_n( &_eval_threads.live, __ATOMIC_ACQUIRE ) > 0 ) {
+        while( __atomic_exchange_n( &_eval_wrapper_lock, 1, __ATOMIC_ACQUIRE ) )
+            sched_yield();
+        locked = 1;
+    }
+
+    if ( __atomic_load_n( &_eval_wrapper_gens[id], __ATOMIC_ACQUIRE ) != _eval_wrapper_gen ) {
+        memset( _eval_wrappers[id].data, 0, _eval_wrappers[id].size );
+        if ( _eval_wrapper_defaults )
+            ( (_eval_wrapper_head_type *) _eval_wrappers[id].data ) -> action = _eval_wrappers[id].action;
+        __atomic_store_n( &_eval_wrapper_gens[id], _eval_wrapper_gen, __ATOMIC_RELEASE );
+    }
+
+    if ( locked ) __atomic_store_n( &_eval_wrapper_lock, 0, __ATOMIC_RELEASE );
+}
+
+/**
+ * @brief Resets the state of all wrappers
+ * 
+ * @param defaults  Set default actions (1) or ACTION_DEFAULT (0)
+ */
+static void _eval_wrapper_reset( int defaults ) {
+    _eval_wrapper_defaults = defaults;
+    if ( ++_eval_wrapper_gen == 0 ) {
+        // Generation counter wrapped around, force reinitialization
+        memset( _eval_wrapper_gens, 0, sizeof( _eval_wrapper_gens ) );
+        _eval_wrapper_gen = 1;
+    }
+}
+
+/**
+ * @brief Returns the id of a wrapper
+ * 
+ * @param name      Name of the wrapped function, e.g. "kill"
+ * @return int      Wrapper id (EVAL_WRAPPER_*) or -1 if not found
+ */
+int eval_wrapper_find( const char *name ) {
+    if ( name == NULL ) return -1;
+    for( int i = 0; i < EVAL_WRAPPER_NFUNCS; i++ )
+        if ( ! strcmp( _eval_wrappers[i].name, name ) ) return i;
+    return -1;
+}
+
+/**
+ * @brief Returns the name of a wrapped function
+ * 
+ * @param id            Wrapper id
+ * @return const char*  Function name, NULL if id is not valid
+ */
+const char * eval_wrapper_name( int id ) {
+    if ( id < 0 || id >= EVAL_WRAPPER_NFUNCS ) return NULL;
+    return _eval_wrappers[id].name;
+}
+
+/**
+ * @brief Returns a pointer to the _eval_*_data variable of a wrapper
+ * 
+ * The pointer may be cast to _eval_wrapper_head_type * to access the
+ * .action and .status fields, and is only valid until the next reset.
+ * 
+ * @param id        Wrapper id
+ * @return void*    Pointer to wrapper data, NULL if id is not valid
+ */
+void * eval_wrapper_data( int id ) {
+    if ( id < 0 || id >= EVAL_WRAPPER_NFUNCS ) return NULL;
+    if ( __atomic_load_n( &_eval_wrapper_gens[id], __ATOMIC_ACQUIRE ) != _eval_wrapper_gen )
+        _eval_wrapper_init( id );
+    return _eval_wrappers[id].data;
+}
+
+/**
+ * @brief Returns the common fields of a wrapper by name
+ */
+static _eval_wrapper_head_type * _eval_wrapper_head( const char *name ) {
+    int id = eval_wrapper_find( name );
+    if ( id < 0 ) {
+        eval_error("Unknown wrapped function %s()", name ? name : "(null)" );
+        return NULL;
+    }
+    return eval_wrapper_data( id );
+}
+
+/**
+ * @brief Sets the action of a wrapper
+ * 
+ * @param name      Name of the wrapped function, e.g. "kill"
+ * @param action    New action (ACTION_*)
+ * @return int      0 on success, -1 if the function is not wrapped
+ */
+int eval_wrapper_set_action( const char *name, int action ) {
+    _eval_wrapper_head_type *head = _eval_wrapper_head( name );
+    if ( head == NULL ) return -1;
+    head -> action = action;
+    return 0;
+}
+
+/**
+ * @brief Returns the action of a wrapper
+ * 
+ * @param name      Name of the wrapped function, e.g. "kill"
+ * @return int      Current action, or ACTION_DEFAULT if the function is not wrapped
+ */
+int eval_wrapper_get_action( const char *name ) {
+    _eval_wrapper_head_type *head = _eval_wrapper_head( name );
+    return ( head ) ? head -> action : ACTION_DEFAULT;
+}
+
+/**
+ * @brief Returns the .status field of a wrapper, usually the number of times
+ * the function was called
+ * 
+ * @param name      Name of the wrapped function, e.g. "kill"
+ * @return int      .status value, or -1 if the function is not wrapped
+ */
+int eval_wrapper_status( const char *name ) {
+    _eval_wrapper_head_type *head = _eval_wrapper_head( name );
+    return ( head ) ? head -> status : -1;
+}
+
+/**
+ * @brief Prints the action and status of all wrappers
+ * 
+ */
+void eval_wrapper_print( void ) {
+    for( int i = 0; i < EVAL_WRAPPER_NFUNCS; i++ ) {
+        _eval_wrapper_head_type *head = eval_wrapper_data( i );
+        printf("%-10s action = %2d, status = %d\n", _eval_wrappers[i].name,
+            head -> action, head -> status );
+    }
+}
+
+/******************************************************************************
+ * Wrapper scripts
+ *****************************************************************************/
+
+/**
+ * @brief Scripts for all wrappers. A script is only valid if its generation
+ * matches the current wrapper generation, so it is discarded by eval_reset().
+ * 
+ */
+static _eval_script_type _eval_scripts[ EVAL_WRAPPER_NFUNCS ];
+
+/**
+ * @brief Returns the script for wrapper id, discarding stale scripts
+ */
+static _eval_script_type * _eval_script_get( int id ) {
+    if ( id < 0 || id >= EVAL_WRAPPER_NFUNCS ) {
+        eval_error("Invalid wrapper id %d", id );
+        return NULL;
+    }
+    _eval_script_type *script = &_eval_scripts[id];
+    if ( script -> gen != _eval_wrapper_gen ) {
+        script -> gen = _eval_wrapper_gen;
+        script -> mode = EVAL_SCRIPT_FALLBACK;
+        script -> nsteps = 0;
+        script -> pos = script -> count = 0;
+        script -> started = 0;
+    }
+    return script;
+}
+
+/**
+ * @brief Gets the next script step for a wrapper call and sets the wrapper
+ * .action accordingly. Called by the wrapper after updating .status.
+ * 
+ * @param id        Wrapper id
+ * @return          Step being used, or NULL if there is no active script
+ */
+const eval_step_t * _eval_script_begin( int id ) {
+    // Wrapped calls are cancellation points for cancelled tracked threads
+    _eval_thread_type *self = _eval_thread_self;
+    if ( self && __atomic_load_n( &self -> cancel, __ATOMIC_ACQUIRE ) ) pthread_testcancel();
+
+    _eval_script_type *script = &_eval_scripts[id];
+    if ( script -> gen != _eval_wrapper_gen || script -> nsteps == 0 ) return NULL;
+
+    _eval_wrapper_head_type *head = eval_wrapper_data( id );
+    if ( ! script -> started ) {
+        script -> fallback = head -> action;
+        script -> started = 1;
+    }
+
+    if ( script -> pos >= script -> nsteps ) {
+        switch( script -> mode ) {
+        case( EVAL_SCRIPT_LAST ):
+            script -> pos = script -> nsteps - 1;
+            break;
+        case( EVAL_SCRIPT_CYCLE ):
+            script -> pos = 0;
+            break;
+        default:
+            // Script is finished
+            head -> action = script -> fallback;
+            script -> nsteps = 0;
+            return NULL;
+        }
+        script -> count = 0;
+    }
+
+    const eval_step_t *step = &script -> steps[ script -> pos ];
+    if ( ++script -> count >= step -> repeat ) {
+        script -> pos++;
+        script -> count = 0;
     }
-    return _eval_pause_data.ret;
+
+    head -> action = step -> action;
+    return step;
 }
 
 /**
- * @brief Global _eval_alarm_data variable for the alarm() function
+ * @brief Applies the script step return value and errno at the end of a
+ * wrapper call.
  * 
+ * @param step      Step being used
+ * @param ret       Return value set by the wrapper
+ * @return intptr_t Return value to use
  */
-EVAL_VAR(alarm);
+intptr_t _eval_script_end( const eval_step_t *step, intptr_t ret ) {
+    if ( step -> err ) errno = step -> err;
+    return ( step -> setret ) ? step -> ret : ret;
+}
 
 /**
- * @brief Evaluate implementation calling of alarm() function
- * Requires data in global _eval_alarm_data
+ * @brief Adds a step to the script of a wrapper
  * 
- * Behavior:
- * + `ACTION_ERROR`   - (previous alarm running) Return 1 (1s left on previous alarm)
- * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
- * + `ACTION_SUCCESS` - (success) Return 0 (no previous alarm running)
- *
- * @param seconds       Number of seconds until SIGALARM
- * @return              Number of seconds remaining on previous alarm 
+ * Scripts are discarded by eval_reset() / eval_reset_vars(), so they must be
+ * set afterwards.
+ * 
+ * @param id        Wrapper id (EVAL_WRAPPER_*)
+ * @param step      Script step
+ * @return int      0 on success, -1 on error
  */
-unsigned int _eval_alarm( unsigned int seconds ) {
-    _eval_alarm_data.status ++;
-    _eval_alarm_data.ret = _eval_alarm_data.seconds;
-    _eval_alarm_data.seconds = seconds;
+int eval_script_push( int id, eval_step_t step ) {
+    _eval_script_type *script = _eval_script_get( id );
+    if ( script == NULL ) return -1;
 
-    switch( _eval_alarm_data.action ) {
-    case(ACTION_ERROR):
-        _eval_alarm_data.ret = 1;
-        break;
-    case(ACTION_LOG):
-        datalog("alarm,%d",seconds);
-    case(ACTION_SUCCESS):
-        _eval_alarm_data.ret = 0;
-        break;
-    case(ACTION_BLOCK):
-        eval_error("alarm() called, aborting");
-        siglongjmp(_eval_env.jmp, EVAL_CATCH_BLOCKED );
-        break;
-    default:
-        _eval_alarm_data.ret = alarm( seconds );
+    if ( script -> nsteps >= EVAL_SCRIPT_SIZE ) {
+        eval_error("Script for %s() is full (%d steps)", eval_wrapper_name( id ), EVAL_SCRIPT_SIZE );
+        return -1;
     }
-    return _eval_alarm_data.ret;
+
+    // A script that finished (fallback) may be restarted
+    if ( script -> nsteps == 0 ) {
+        script -> pos = script -> count = 0;
+        script -> started = 0;
+    }
+
+    script -> steps[ script -> nsteps++ ] = step;
+    return 0;
 }
 
 /**
- * @brief Global _eval_msgget_data variable for the msgget() function
+ * @brief Adds a step using the specified action for the next repeat calls
  * 
+ * @param id        Wrapper id (EVAL_WRAPPER_*)
+ * @param action    Action (ACTION_*)
+ * @param repeat    Number of calls
+ * @return int      0 on success, -1 on error
  */
-EVAL_VAR(msgget);
+int eval_script_action( int id, int action, int repeat ) {
+    return eval_script_push( id, (eval_step_t) { .action = action, .repeat = repeat } );
+}
 
 /**
- * Evaluate implementation calling of msgget function
- * 
- * Function `.action` options:
- * + `ACTION_RETRY`   - (retry) Fail on first try (ENOENT), behave as `ACTION_SUCCESS`
- *                       on 2nd try, fail on remaining attempts (EINVAL)
- * + `ACTION_CREATE`  - (must create) If `IPC_CREAT` was specified then behave as
- *                      `ACTION_SUCCESS` otherwise return -1 (ENOENT)
- * + `ACTION_ERROR`   - (error) Return -1 (EINVAL)
- * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
- * + `ACTION_SUCCESS` - (success) Return the value set in `_eval_msgget_data.msqid`
- * + `ACTION_DEFAULT` - Capture parameters and call `msgget(key,msgflg)`
+ * @brief Adds a step that returns the specified value and errno without
+ * calling the function (ACTION_SUCCESS)
  * 
- * @param key       IPC key of msg queue
- * @param msgflg    Flag controlling msg queue creation / connection
- * @return          Result or result of msgget operation
+ * @param id        Wrapper id (EVAL_WRAPPER_*)
+ * @param ret       Return value
+ * @param err       errno value (0 to keep errno unchanged)
+ * @return int      0 on success, -1 on error
  */
-int _eval_msgget(key_t key, int msgflg) {
-
-#ifdef _EVAL_DEBUG
-    printf( _EVAL_DEBUG_PREFIX "msgget( 0x%x, 0%04o )\n", key, msgflg );
-#endif
-
-    _eval_msgget_data.status ++;
-
-    _eval_msgget_data.key = key;
-    _eval_msgget_data.msgflg = msgflg;
-
-    switch( _eval_msgget_data.action ) {
-    case(ACTION_RETRY): // error (ENOENT) on first try, inject on 2nd try
-        switch( _eval_msgget_data.status ) {
-        case (1):
-            errno = ENOENT;
-            _eval_msgget_data.ret = -1;
-            break;
-        case (2):
-            errno = 0;
-            _eval_msgget_data.ret = _eval_msgget_data.msqid;
-            break;
-        default:
-            _eval_shmget_data.ret = -1;
-            errno = EINVAL;
-        }
-        break;
-
-    case(ACTION_CREATE): // inject on create only
-        if ( ! (msgflg & IPC_CREAT ) ) {
-            _eval_msgget_data.ret = -1;
-            errno = ENOENT;
-        } else {
-            _eval_msgget_data.ret = _eval_msgget_data.msqid;
-        }
-        break;
+int eval_script_return( int id, intptr_t ret, int err ) {
+    return eval_script_push( id, (eval_step_t) { .action = ACTION_SUCCESS, .setret = 1, .ret = ret, .err = err } );
+}
 
-    case(ACTION_ERROR): // error (EINVAL)
-        _eval_msgget_data.ret = -1;
-        errno = EINVAL;
-        break;
-    case(ACTION_LOG):
-        datalog("msgget,%x,%d",key,msgflg);
-    case(ACTION_SUCCESS): // inject
-        _eval_msgget_data.ret = _eval_msgget_data.msqid;
-        break;
-    case(ACTION_BLOCK):
-        eval_error("msgget() called, aborting");
-        siglongjmp(_eval_env.jmp, EVAL_CATCH_BLOCKED );
-        break;
-    default:
-        _eval_msgget_data.ret = msgget( key, msgflg );
+/**
+ * @brief Sets the behavior of a wrapper script once all steps are consumed
+ * 
+ * @param id        Wrapper id (EVAL_WRAPPER_*)
+ * @param mode      EVAL_SCRIPT_FALLBACK (default), EVAL_SCRIPT_LAST or EVAL_SCRIPT_CYCLE
+ * @return int      0 on success, -1 on error
+ */
+int eval_script_mode( int id, int mode ) {
+    _eval_script_type *script = _eval_script_get( id );
+    if ( script == NULL ) return -1;
+    if ( mode < EVAL_SCRIPT_FALLBACK || mode > EVAL_SCRIPT_CYCLE ) {
+        eval_error("Invalid script mode %d", mode );
+        return -1;
     }
-    
-    return _eval_msgget_data.ret;
+    script -> mode = mode;
+    return 0;
 }
 
 /**
- * @brief Global _eval_msgsnd_data variable for the msgsnd() function
+ * @brief Discards the script of a wrapper, restoring the previous .action
+ * value if the script had already started
  * 
+ * @param id        Wrapper id (EVAL_WRAPPER_*)
  */
-EVAL_VAR(msgsnd);
+void eval_script_clear( int id ) {
+    _eval_script_type *script = _eval_script_get( id );
+    if ( script == NULL ) return;
+    if ( script -> started && script -> nsteps > 0 )
+        ( (_eval_wrapper_head_type *) eval_wrapper_data( id ) ) -> action = script -> fallback;
+    script -> nsteps = 0;
+    script -> pos = script -> count = 0;
+    script -> started = 0;
+}
 
 /**
- * Evaluate implementation calling of msgsnd function
- * Requires data in global _eval_msgsnd_data
+ * @brief Returns the number of calls remaining in the current pass of a
+ * wrapper script
  * 
- * Function `.action` options:
+ * @param id        Wrapper id (EVAL_WRAPPER_*)
+ * @return int      Number of calls remaining, -1 on error
+ */
+int eval_script_remaining( int id ) {
+    _eval_script_type *script = _eval_script_get( id );
+    if ( script == NULL ) return -1;
+
+    int n = 0;
+    for( int i = script -> pos; i < script -> nsteps; i++ )
+        n += ( script -> steps[i].repeat > 1 ) ? script -> steps[i].repeat : 1;
+    if ( script -> pos < script -> nsteps ) n -= script -> count;
+    return n;
+}
+
+/******************************************************************************
+ * Capture store
+ *****************************************************************************/
+
+/**
+ * @brief Strictest fundamental alignment (max_align_t is C11 only)
  * 
- * + `ACTION_INJECT`  - (inject) Call `msgsnd()` but using the parameters specified
- *                      in `_eval_msgsnd_data`
- * + `ACTION_ERROR`   - (error) Return -1
- * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
- * + `ACTION_SUCCESS` - (success) Return `msgsz`. If `msgp` was a valid pointer,
- *                      then the data in `*msgp` is copied to a newly allocated
- *                      buffer at `_eval_msgsnd_data.msgp`. This buffer __must__
- *                      be freed afterwards.
- * + `ACTION_DEFAULT` - Capture parameters and call `msgsnd(msqid,msgp,msgsz,msgflg)`
+ */
+typedef union {
+    long long l;
+    long double d;
+    void *p;
+} _eval_align_type;
+
+/**
+ * @brief Capture arena chunk. Chunks are never moved, so pointers to
+ * captured data remain valid until the arena is released.
  * 
- * @param msqid     Queue ID to use
- * @param msgp      Pointer to message structure
- * @param msgsz     Size of message body
- * @param msgflg    
- * @return          Result of msgsnd operation
  */
-int _eval_msgsnd(int msqid, const void *msgp, size_t msgsz, int msgflg) {
+typedef struct _eval_chunk {
+    struct _eval_chunk *next;
+    size_t size;
+    size_t used;
+    _eval_align_type data[];
+} _eval_chunk_type;
 
-#ifdef _EVAL_DEBUG
-    printf( _EVAL_DEBUG_PREFIX "msgsnd( %d, %p, %zu, %d )\n", msqid, msgp, msgsz, msgflg );
-#endif
+/**
+ * @brief Capture index for a single wrapper
+ * 
+ */
+typedef struct {
+    eval_capture_t *entries;
+    int n;
+    int size;
+} _eval_capture_index_type;
 
-    int err = 0;
-    if ( eval_checkconstptr( msgp ) != 0 ) {
-        eval_error("msgsnd() called with invalid pointer (msgp)\n");
-        err++;
-    }
+/**
+ * @brief Capture store: arena chunks, per wrapper indexes and tracked shared
+ * memory attachments
+ * 
+ */
+static struct {
+    _eval_chunk_type *chunks;
+    size_t bytes;
+    long seq;
+    _eval_capture_index_type index[ EVAL_WRAPPER_NFUNCS ];
+    struct {
+        const void *addr;
+        size_t size;
+    } shm[ EVAL_CAPTURE_SHMS ];
+} _eval_capture;
 
-    _eval_msgsnd_data.status ++;
+/**
+ * @brief Allocates memory from the capture arena. The memory is released by
+ * eval_capture_release().
+ * 
+ * @param size      Number of bytes
+ * @return void*    Pointer to allocated memory, NULL on error
+ */
+void * _eval_capture_alloc( size_t size ) {
+    // Keep allocations aligned
+    size = ( size + sizeof( _eval_align_type ) - 1 ) & ~( sizeof( _eval_align_type ) - 1 );
+
+    _eval_chunk_type *chunk = _eval_capture.chunks;
+    if ( chunk == NULL || chunk -> size - chunk -> used < size ) {
+        size_t csize = ( size > EVAL_CAPTURE_CHUNK ) ? size : EVAL_CAPTURE_CHUNK;
+        chunk = malloc( sizeof( _eval_chunk_type ) + csize );
+        if ( chunk == NULL ) {
+            eval_error("Unable to allocate capture memory");
+            return NULL;
+        }
+        chunk -> size = csize;
+        chunk -> used = 0;
+        chunk -> next = _eval_capture.chunks;
+        _eval_capture.chunks = chunk;
+    }
 
-    switch( _eval_msgsnd_data.action ) {
+    void *p = (char *) chunk -> data + chunk -> used;
+    chunk -> used += size;
+    return p;
+}
 
-    case(ACTION_INJECT): // inject
-        _eval_msgsnd_data.ret = msgsnd( 
-            _eval_msgsnd_data.msqid, _eval_msgsnd_data.msgp,
-            _eval_msgsnd_data.msgsz, _eval_msgsnd_data.msgflg );
-        break;
+/**
+ * @brief Appends a copy of data to the capture store
+ * 
+ * @param id        Wrapper id
+ * @param call      Call number
+ * @param data      Data to capture
+ * @param size      Size of data (bytes)
+ * @return void*    Pointer to captured copy, NULL on error
+ */
+void * _eval_capture_add( int id, int call, const void *data, size_t size ) {
+    _eval_capture_index_type *index = &_eval_capture.index[id];
+
+    if ( index -> n >= index -> size ) {
+        int nsize = ( index -> size > 0 ) ? 2 * index -> size : 64;
+        eval_capture_t *entries = realloc( index -> entries, nsize * sizeof( eval_capture_t ) );
+        if ( entries == NULL ) {
+            eval_error("Unable to allocate capture index");
+            return NULL;
+        }
+        index -> entries = entries;
+        index -> size = nsize;
+    }
 
-    case(ACTION_ERROR): // error
-        _eval_msgsnd_data.msqid = msqid;
-        _eval_msgsnd_data.msgp = (void *) msgp;
-        _eval_msgsnd_data.msgsz = msgsz;
-        _eval_msgsnd_data.msgflg = msgflg;
+    void *copy = _eval_capture_alloc( size );
+    if ( copy == NULL ) return NULL;
+    memcpy( copy, data, size );
 
-        _eval_msgsnd_data.ret = -1;
-        break;
+    index -> entries[ index -> n++ ] = (eval_capture_t) {
+        .call = call,
+        .seq = _eval_capture.seq++,
+        .data = copy,
+        .size = size
+    };
+    _eval_capture.bytes += size;
 
-    case(ACTION_LOG):
-        datalog("msgsnd,%d,%p,%zu,%d",msqid,msgp,msgsz,msgflg);
+    return copy;
+}
 
-    case(ACTION_SUCCESS): // capture
-        _eval_msgsnd_data.msqid = msqid;
-        _eval_msgsnd_data.msgsz = msgsz;
-        _eval_msgsnd_data.msgflg = msgflg;
+/**
+ * @brief Records a shared memory attachment so that shmdt() may snapshot the
+ * segment
+ * 
+ * @param shmaddr   Attachment address
+ * @param shmid     Shared memory segment id
+ */
+void _eval_capture_shmat( const void *shmaddr, int shmid ) {
+    struct shmid_ds ds;
+    if ( shmaddr == (void *) -1 || shmctl( shmid, IPC_STAT, &ds ) ) return;
+    _eval_capture_shm_track( shmaddr, ds.shm_segsz );
+}
 
-        if ( _eval_msgsnd_data.msgp )
-            free (_eval_msgsnd_data.msgp);
-        
-        _eval_msgsnd_data.msgp = NULL;
+/**
+ * @brief Records a shared memory attachment of known size
+ * 
+ * @param shmaddr   Attachment address
+ * @param size      Segment size
+ */
+void _eval_capture_shm_track( const void *shmaddr, size_t size ) {
+    for( int i = 0; i < EVAL_CAPTURE_SHMS; i++ ) {
+        if ( _eval_capture.shm[i].addr == NULL || _eval_capture.shm[i].addr == shmaddr ) {
+            _eval_capture.shm[i].addr = shmaddr;
+            _eval_capture.shm[i].size = size;
+            return;
+        }
+    }
+}
 
-        if ( ! err ) {
-            size_t bytes = sizeof(long);
-            if ( msgsz >= 0 ) bytes += msgsz;
-            _eval_msgsnd_data.msgp = malloc( bytes );
-            memcpy( _eval_msgsnd_data.msgp, msgp, bytes );
+/**
+ * @brief Captures a snapshot of a shared memory segment attached through
+ * shmat(), or stops tracking the segment if it was detached
+ * 
+ * @param shmaddr   Attachment address
+ * @param call      shmdt() call number
+ * @param detached  Segment was detached, stop tracking it
+ */
+void _eval_capture_shmdt( const void *shmaddr, int call, int detached ) {
+    for( int i = 0; i < EVAL_CAPTURE_SHMS; i++ ) {
+        if ( shmaddr && _eval_capture.shm[i].addr == shmaddr ) {
+            if ( detached ) {
+                _eval_capture.shm[i].addr = NULL;
+            } else {
+                _eval_capture_add( EVAL_WRAPPER_SHMDT, call, shmaddr, _eval_capture.shm[i].size );
+            }
+            return;
         }
+    }
+}
 
-        _eval_msgsnd_data.ret = 0;
-        break;
+/**
+ * @brief Returns the number of payloads captured by a wrapper
+ * 
+ * @param id        Wrapper id (EVAL_WRAPPER_*)
+ * @return int      Number of captures
+ */
+int eval_capture_count( int id ) {
+    if ( id < 0 || id >= EVAL_WRAPPER_NFUNCS ) return 0;
+    return _eval_capture.index[id].n;
+}
 
-    case(ACTION_BLOCK):
-        eval_error("msgsnd() called, aborting");
-        siglongjmp(_eval_env.jmp, EVAL_CATCH_BLOCKED );
-        break;
+/**
+ * @brief Returns a payload captured by a wrapper
+ * 
+ * @param id        Wrapper id (EVAL_WRAPPER_*)
+ * @param n         Capture number (0 is the first capture)
+ * @return          Pointer to capture, NULL if not found
+ */
+const eval_capture_t * eval_capture_get( int id, int n ) {
+    if ( n < 0 || n >= eval_capture_count( id ) ) return NULL;
+    return &_eval_capture.index[id].entries[n];
+}
 
-    default:
-        _eval_msgsnd_data.msqid = msqid;
-        _eval_msgsnd_data.msgp = (void *) msgp;
-        _eval_msgsnd_data.msgsz = msgsz;
-        _eval_msgsnd_data.msgflg = msgflg;
+/**
+ * @brief Returns the payload captured by a specific call to a wrapped
+ * function
+ * 
+ * @param id        Wrapper id (EVAL_WRAPPER_*)
+ * @param call      Call number (.status value when the call was made)
+ * @return          Pointer to capture, NULL if not found
+ */
+const eval_capture_t * eval_capture_call( int id, int call ) {
+    int lo = 0, hi = eval_capture_count( id ) - 1;
+
+    // Call numbers are increasing
+    while ( lo <= hi ) {
+        int mid = ( lo + hi ) / 2;
+        const eval_capture_t *c = &_eval_capture.index[id].entries[mid];
+        if ( c -> call == call ) return c;
+        if ( c -> call < call ) lo = mid + 1; else hi = mid - 1;
+    }
+    return NULL;
+}
 
-        if ( ! err ) {
-            _eval_msgsnd_data.ret = msgsnd( msqid, msgp, msgsz, msgflg );
-        } else {
-            _eval_msgsnd_data.ret = -1;
+/**
+ * @brief Returns the total size of captured payloads
+ * 
+ * @return size_t   Number of bytes
+ */
+size_t eval_capture_bytes( void ) {
+    return _eval_capture.bytes;
+}
+
+/**
+ * @brief Releases all captured payloads. This is called by eval_reset() and
+ * eval_reset_vars().
+ * 
+ * The first (most recent) arena chunk is kept for reuse.
+ */
+void eval_capture_release( void ) {
+    _eval_chunk_type *chunk = _eval_capture.chunks;
+    if ( chunk ) {
+        _eval_chunk_type *next = chunk -> next;
+        while( next ) {
+            _eval_chunk_type *tmp = next -> next;
+            free( next );
+            next = tmp;
         }
-        break;
+        chunk -> next = NULL;
+        chunk -> used = 0;
     }
 
-    return _eval_msgsnd_data.ret;
+    if ( _eval_capture.seq > 0 ) {
+        for( int i = 0; i < EVAL_WRAPPER_NFUNCS; i++ ) _eval_capture.index[i].n = 0;
+    }
+    _eval_capture.bytes = 0;
+    _eval_capture.seq = 0;
 }
 
+/******************************************************************************
+ * Virtual filesystem
+ *****************************************************************************/
+
 /**
- * @brief Global _eval_msgrcv_data variable for the msgrcv() function
+ * @brief Virtual file
  * 
  */
-EVAL_VAR(msgrcv);
+typedef struct {
+    char path[ PATH_MAX ];
+    char *data;
+    size_t size;
+    size_t capacity;
+    mode_t mode;
+    int nopen;          // Number of open streams
+    int removed;        // File was removed, destroy after the last stream is closed
+} _eval_vfile_type;
 
 /**
- * Evaluate implementation calling of msgsnd function
- * Requires data in global _eval_msgrcv_data
- * 
- * Function `.action` options:
- * 
- * + `ACTION_INJECT`  - (inject) Copy data in `*_eval_msgsnd_data.msgp` to `*msgp`.
- *                      The pointer `msgp` is checked before copying.
- * + `ACTION_ERROR`   - (error) Return -1
- * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
- * + `ACTION_SUCCESS` - (success) Return `msgsz`.
- * + `ACTION_DEFAULT` - Capture parameters and call `msgrcv( msqid, msgp, msgsz, msgtyp, msgflg )`
+ * @brief Virtual filesystem table
  * 
- * @param msqid     Queue ID to use
- * @param msgp      Pointer to message structure
- * @param msgsz     Size of message body
- * @param msgflg    
- * @return          Evalation result or result of msgsnd operation
  */
-ssize_t _eval_msgrcv(int msqid, void *msgp, size_t msgsz, long msgtyp, int msgflg) {
+static struct {
+    int nfiles;
+    int size;
+    _eval_vfile_type **files;
+} _eval_vfs;
 
-#ifdef _EVAL_DEBUG
-    printf( _EVAL_DEBUG_PREFIX "msgrcv( %d, %p, %zu, %ld, %d )\n", msqid, msgp, msgsz, msgtyp, msgflg );
+/**
+ * @brief Virtual stream state (cookie)
+ * 
+ */
+typedef struct {
+    _eval_vfile_type *file;
+    size_t pos;
+    int readable;
+    int writable;
+    int append;
+} _eval_vstream_type;
+
+// File offsets used by the stream seek function
+#ifdef __linux__
+typedef off64_t _eval_voff_t;
+#else
+typedef off_t _eval_voff_t;
 #endif
 
-    int err = 0;
-    if ( eval_checkptr( msgp ) != 0 ) {
-        eval_error("msgrcv() called with invalid pointer (msgp)\n");
-        err++;
+/**
+ * @brief Finds a virtual file
+ * 
+ * @param path      File path
+ * @return int      File index, -1 if not found
+ */
+static int _eval_vfs_find( const char *path ) {
+    for( int i = 0; i < _eval_vfs.nfiles; i++ ) {
+        if ( ! strncmp( _eval_vfs.files[i] -> path, path, PATH_MAX ) ) return i;
     }
+    return -1;
+}
 
-    _eval_msgrcv_data.status ++;
+/**
+ * @brief Releases a virtual file once it is no longer in the table and no
+ * stream is using it
+ */
+static void _eval_vfile_release( _eval_vfile_type *file ) {
+    if ( file -> removed && file -> nopen == 0 ) {
+        free( file -> data );
+        free( file );
+    }
+}
 
-    switch( _eval_msgrcv_data.action ) {
+/**
+ * @brief Removes file idx from the virtual filesystem table
+ */
+static void _eval_vfs_drop( int idx ) {
+    _eval_vfile_type *file = _eval_vfs.files[ idx ];
+    _eval_vfs.files[ idx ] = _eval_vfs.files[ --_eval_vfs.nfiles ];
+    file -> removed = 1;
+    _eval_vfile_release( file );
+}
 
-    case(ACTION_INJECT): // inject
-        _eval_msgrcv_data.msqid = msqid;
-        _eval_msgrcv_data.msgtyp = msgtyp;
-        _eval_msgrcv_data.msgflg = msgflg;
+/**
+ * @brief Creates a new (empty) virtual file
+ * 
+ * @param path      File path
+ * @return          New file, NULL on error (ENOMEM / ENAMETOOLONG)
+ */
+static _eval_vfile_type * _eval_vfs_create( const char *path, mode_t mode ) {
+    if ( strnlen( path, PATH_MAX ) >= PATH_MAX ) {
+        errno = ENAMETOOLONG;
+        return NULL;
+    }
 
-        if ( !err ) {
-            size_t bytes = sizeof(long);
-            if ( msgsz >= _eval_msgrcv_data.msgsz ) {
-                bytes += _eval_msgrcv_data.msgsz;
-            } else if ( msgsz >= 0 ) {
-                bytes += msgsz;
-            }
-            memcpy( msgp, _eval_msgrcv_data.msgp, bytes );
+    if ( _eval_vfs.nfiles == _eval_vfs.size ) {
+        int size = ( _eval_vfs.size > 0 ) ? 2 * _eval_vfs.size : 16;
+        _eval_vfile_type **files = realloc( _eval_vfs.files, size * sizeof( _eval_vfile_type * ) );
+        if ( files == NULL ) {
+            errno = ENOMEM;
+            return NULL;
         }
+        _eval_vfs.files = files;
+        _eval_vfs.size = size;
+    }
 
-        _eval_msgrcv_data.msgp = msgp;
-        _eval_msgrcv_data.msgsz = msgsz;
-        _eval_msgrcv_data.ret = msgsz;
-
-        break;
-
-    case(ACTION_ERROR): // error
-        _eval_msgrcv_data.msqid = msqid;
-        _eval_msgrcv_data.msgp = msgp;
-        _eval_msgrcv_data.msgsz = msgsz;
-        _eval_msgrcv_data.msgtyp = msgtyp;
-        _eval_msgrcv_data.msgflg = msgflg;
-
-        errno = ( _eval_msgrcv_data._errno ) ? _eval_msgrcv_data._errno : EINVAL;
-
-        _eval_msgrcv_data.ret = -1;
-        break;
-
-    case(ACTION_LOG):
-        datalog("msgrcv,%d,%p,%zu,%ld,%d",msqid,msgp,msgsz,msgtyp,msgflg);
+    _eval_vfile_type *file = calloc( 1, sizeof( _eval_vfile_type ) );
+    if ( file == NULL ) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    strcpy( file -> path, path );
+    file -> mode = mode;
+    _eval_vfs.files[ _eval_vfs.nfiles++ ] = file;
+    return file;
+}
 
-    case(ACTION_SUCCESS): // capture
-        _eval_msgrcv_data.msqid = msqid;
-        _eval_msgrcv_data.msgp = msgp;
-        _eval_msgrcv_data.msgsz = msgsz;
-        _eval_msgrcv_data.msgtyp = msgtyp;
-        _eval_msgrcv_data.msgflg = msgflg;
-        
-        _eval_msgrcv_data.ret = msgsz;
+/**
+ * @brief Resizes the file buffer to hold at least size bytes
+ * 
+ * @return int  0 on success, -1 on error
+ */
+static int _eval_vfile_reserve( _eval_vfile_type *file, size_t size ) {
+    if ( size <= file -> capacity ) return 0;
+    size_t capacity = ( file -> capacity > 0 ) ? file -> capacity : 256;
+    while( capacity < size ) capacity *= 2;
+
+    char *data = realloc( file -> data, capacity );
+    if ( data == NULL ) return -1;
+    file -> data = data;
+    file -> capacity = capacity;
+    return 0;
+}
 
-        break;
+/**
+ * @brief Adds (or replaces) a file in the virtual filesystem
+ * 
+ * @param path      File path
+ * @param data      File contents (may be NULL if size is 0)
+ * @param size      File size
+ * @return int      0 on success, -1 on error
+ */
+int eval_vfs_put( const char *path, const void *data, size_t size ) {
+    int idx = _eval_vfs_find( path );
+    if ( idx >= 0 ) _eval_vfs_drop( idx );
 
-    case(ACTION_BLOCK):
-        eval_error("msgrcv() called, aborting");
-        siglongjmp(_eval_env.jmp, EVAL_CATCH_BLOCKED );
-        break;
+    _eval_vfile_type *file = _eval_vfs_create( path, 0644 );
+    if ( file == NULL || _eval_vfile_reserve( file, size ) ) {
+        perror("eval_vfs_put: Unable to create virtual file");
+        return -1;
+    }
+    if ( size > 0 ) memcpy( file -> data, data, size );
+    file -> size = size;
+    return 0;
+}
 
-    default:
-        _eval_msgrcv_data.msqid = msqid;
-        _eval_msgrcv_data.msgp = msgp;
-        _eval_msgrcv_data.msgsz = msgsz;
-        _eval_msgrcv_data.msgtyp = msgtyp;
-        _eval_msgrcv_data.msgflg = msgflg;
-        
-        if ( ! err ) {
-            _eval_msgrcv_data.ret =  msgrcv( msqid, msgp, msgsz, msgtyp, msgflg );
-        } else {
-            _eval_msgrcv_data.ret = -1;
-        }
+/**
+ * @brief Gets the contents of a file in the virtual filesystem. Data still
+ * buffered in open streams is not included until the stream is flushed or
+ * closed.
+ * 
+ * @param path      File path
+ * @param size      (out) File size, may be NULL
+ * @return          Pointer to file contents (valid until the file is next
+ *                  modified), NULL if the file does not exist
+ */
+const void * eval_vfs_get( const char *path, size_t *size ) {
+    int idx = _eval_vfs_find( path );
+    if ( idx < 0 ) {
+        if ( size ) *size = 0;
+        return NULL;
     }
 
-    return _eval_msgrcv_data.ret;
+    _eval_vfile_type *file = _eval_vfs.files[ idx ];
+    if ( size ) *size = file -> size;
+
+    // Always return a valid pointer for existing (possibly empty) files
+    if ( file -> data == NULL && _eval_vfile_reserve( file, 1 ) ) return NULL;
+    return file -> data;
 }
 
 /**
- * @brief Global _eval_msgctl_data variable for the msgctl() function
+ * @brief Checks if a file exists in the virtual filesystem
  * 
+ * @param path      File path
+ * @return int      1 if the file exists, 0 otherwise
  */
-EVAL_VAR(msgctl);
+int eval_vfs_exists( const char *path ) {
+    return _eval_vfs_find( path ) >= 0;
+}
 
 /**
- * Evaluate implementation calling of msgctl function
- * Requires data in global _eval_msgctl_data
+ * @brief Removes a file from the virtual filesystem. Streams that have the
+ * file open remain valid until they are closed.
  * 
- * Function `.action` options:
+ * @param path      File path
+ * @return int      0 on success, -1 if the file does not exist
+ */
+int eval_vfs_remove( const char *path ) {
+    int idx = _eval_vfs_find( path );
+    if ( idx < 0 ) return -1;
+    _eval_vfs_drop( idx );
+    return 0;
+}
+
+/**
+ * @brief Removes all files from the virtual filesystem. This is called by
+ * eval_reset_vars() and eval_reset().
  * 
- * + `ACTION_ERROR`   - (error) Return -1 (EINVAL)
- * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
- * + `ACTION_SUCCESS` - (success) Return 0
- * + `ACTION_DEFAULT` - Capture parameters and call `msgctl( msqid, cmd, buf )`
+ */
+void eval_vfs_clear( void ) {
+    while( _eval_vfs.nfiles > 0 ) _eval_vfs_drop( _eval_vfs.nfiles - 1 );
+}
+
+/**
+ * @brief Sets the fopen(), remove(), unlink() and mkfifo() wrappers to use the
+ * virtual filesystem (ACTION_VIRTUAL)
  * 
- * @param msqid     Message queue id
- * @param cmd       Command to perform
- * @param buf       struct msqid_ds for input / output of command
- * @return int      success
  */
-int _eval_msgctl(int msqid, int cmd, struct msqid_ds *buf) {
+void eval_vfs_enable( void ) {
+    _eval_fopen_data.action = ACTION_VIRTUAL;
+    _eval_remove_data.action = ACTION_VIRTUAL;
+    _eval_unlink_data.action = ACTION_VIRTUAL;
+    _eval_mkfifo_data.action = ACTION_VIRTUAL;
+}
 
-#ifdef _EVAL_DEBUG
-    printf( _EVAL_DEBUG_PREFIX "msgctl( %d, %d, %p )\n", msqid, cmd, (void *) buf );
-#endif
+/**
+ * @brief Virtual mkfifo(). Creates an empty virtual file
+ */
+int _eval_vfs_mkfifo( const char *path, mode_t mode ) {
+    if ( _eval_vfs_find( path ) >= 0 ) {
+        errno = EEXIST;
+        return -1;
+    }
+    return _eval_vfs_create( path, S_IFIFO | ( mode & 0777 ) ) ? 0 : -1;
+}
 
-    _eval_msgctl_data.status ++;
-    _eval_msgctl_data.msqid = msqid;
-    _eval_msgctl_data.cmd = cmd;
-    _eval_msgctl_data.buf = buf;
-    
-    switch( _eval_msgctl_data.action ) {
+/**
+ * @brief Virtual unlink() / remove()
+ */
+int _eval_vfs_unlink( const char *path ) {
+    if ( eval_vfs_remove( path ) ) {
+        errno = ENOENT;
+        return -1;
+    }
+    return 0;
+}
 
-    case(ACTION_ERROR):
-        _eval_msgctl_data.ret = -1;
-        errno = EINVAL;
-        break;
-    case(ACTION_LOG):
-        datalog("msgctl,%d,%d,%p",msqid,cmd,(void*)buf);
-    case(ACTION_SUCCESS):
-        _eval_msgctl_data.ret = 0;
-        break;
-    case(ACTION_BLOCK):
-        eval_error("msgctl() called, aborting");
-        siglongjmp(_eval_env.jmp, EVAL_CATCH_BLOCKED );
-        break;
+/**
+ * @brief Reads from a virtual stream
+ */
+static ssize_t _eval_vstream_read( void *cookie, char *buf, size_t size ) {
+    _eval_vstream_type *vs = cookie;
+    if ( ! vs -> readable ) {
+        errno = EBADF;
+        return -1;
+    }
+    _eval_vfile_type *file = vs -> file;
+    if ( vs -> pos >= file -> size ) return 0;
 
-    default:
-        _eval_msgctl_data.ret = msgctl( msqid, cmd, buf );
+    size_t n = file -> size - vs -> pos;
+    if ( n > size ) n = size;
+    memcpy( buf, file -> data + vs -> pos, n );
+    vs -> pos += n;
+    return n;
+}
+
+/**
+ * @brief Writes to a virtual stream
+ */
+static ssize_t _eval_vstream_write( void *cookie, const char *buf, size_t size ) {
+    _eval_vstream_type *vs = cookie;
+    if ( ! vs -> writable ) {
+        errno = EBADF;
+        return -1;
     }
-    
+    _eval_vfile_type *file = vs -> file;
+    if ( vs -> append ) vs -> pos = file -> size;
 
-    return _eval_msgctl_data.ret;
+    if ( _eval_vfile_reserve( file, vs -> pos + size ) ) {
+        errno = ENOSPC;
+        return -1;
+    }
+
+    // Seeking past the end of file leaves a hole filled with zeros
+    if ( vs -> pos > file -> size ) memset( file -> data + file -> size, 0, vs -> pos - file -> size );
+
+    memcpy( file -> data + vs -> pos, buf, size );
+    vs -> pos += size;
+    if ( vs -> pos > file -> size ) file -> size = vs -> pos;
+    return size;
 }
 
 /**
- * @brief Global _eval_semget_data variable for the semget() function
- * 
+ * @brief Repositions a virtual stream
  */
-EVAL_VAR(semget);
+static int _eval_vstream_seek( void *cookie, _eval_voff_t *offset, int whence ) {
+    _eval_vstream_type *vs = cookie;
+    _eval_voff_t base;
+    switch( whence ) {
+    case( SEEK_SET ): base = 0; break;
+    case( SEEK_CUR ): base = vs -> pos; break;
+    case( SEEK_END ): base = vs -> file -> size; break;
+    default:
+        errno = EINVAL;
+        return -1;
+    }
+    if ( base + *offset < 0 ) {
+        errno = EINVAL;
+        return -1;
+    }
+    vs -> pos = base + *offset;
+    *offset = vs -> pos;
+    return 0;
+}
 
 /**
- * Evaluate implementation calling of semget function
- * Requires data in global _eval_semget_data
- * 
- * @param key       IPC key
- * @param nsems     Number of semaphores in the array
- * @param semflg    Flags for semaphore creation / connection
- * @return          semaphore id
+ * @brief Closes a virtual stream
  */
-int _eval_semget(key_t key, int nsems, int semflg) {
+static int _eval_vstream_close( void *cookie ) {
+    _eval_vstream_type *vs = cookie;
+    vs -> file -> nopen--;
+    _eval_vfile_release( vs -> file );
+    free( vs );
+    return 0;
+}
 
-#ifdef _EVAL_DEBUG
-    printf( _EVAL_DEBUG_PREFIX "semget( 0x%x, %d, 0%o )\n", key, nsems, semflg );
-#endif
+#ifndef __linux__
 
-    _eval_semget_data.status ++;
+// BSD / macOS streams are created with funopen(), which uses int sizes and
+// fpos_t offsets
 
-    _eval_semget_data.key = key;
-    _eval_semget_data.nsems = nsems;
-    _eval_semget_data.semflg = semflg;
+static int _eval_vstream_readfn( void *cookie, char *buf, int size ) {
+    return _eval_vstream_read( cookie, buf, size );
+}
 
-    switch( _eval_semget_data.action ) {
-        case(ACTION_RETRY): // error (ENOENT) on first try, inject on 2nd try
-            switch( _eval_semget_data.status ) {
-            case (1):
-                errno = ENOENT;
-                _eval_semget_data.ret = -1;
-                break;
-            case (2):
-                errno = 0;
-                _eval_semget_data.ret = _eval_semget_data.semid;
-                break;
-            default:
-                _eval_semget_data.ret = -1;
-                errno = EINVAL;
-            }
-            break;
-        
-        case(ACTION_CREATE): // inject on create only
-            if ( nsems == 0  && ( semflg & IPC_CREAT ) ) {
-                _eval_semget_data.ret = -1;
-                errno = EINVAL;
-            } else {
-                _eval_semget_data.ret = _eval_semget_data.semid;
-            }
-            break;
+static int _eval_vstream_writefn( void *cookie, const char *buf, int size ) {
+    return _eval_vstream_write( cookie, buf, size );
+}
+
+static fpos_t _eval_vstream_seekfn( void *cookie, fpos_t offset, int whence ) {
+    _eval_voff_t off = offset;
+    if ( _eval_vstream_seek( cookie, &off, whence ) ) return -1;
+    return off;
+}
+
+#endif
 
-        case(ACTION_ERROR): // error (EINVAL)
-            _eval_semget_data.ret = -1;
-            errno = EINVAL;
-            break;
+/**
+ * @brief Opens a stream on a virtual file
+ * 
+ * @param path      File path
+ * @param mode      Open mode, as in fopen()
+ * @param create    Create the file if it does not exist, regardless of mode
+ * @return          Stream, NULL on error
+ */
+FILE * _eval_vfs_fopen( const char *path, const char *mode, int create ) {
+    int readable = 0, writable = 0, append = 0, truncate = 0, mustcreate = 0, excl = 0;
+    switch( mode[0] ) {
+    case 'r': readable = 1; break;
+    case 'w': writable = truncate = mustcreate = 1; break;
+    case 'a': writable = append = mustcreate = 1; break;
+    default:
+        errno = EINVAL;
+        return NULL;
+    }
+    for( const char *m = mode + 1; *m; m++ ) {
+        if ( *m == '+' ) readable = writable = 1;
+        if ( *m == 'x' ) excl = 1;
+    }
 
-        case(ACTION_LOG):
-            datalog("semget,%x,%d,%o",key,nsems,semflg);
+    int idx = _eval_vfs_find( path );
+    if ( idx >= 0 && excl && mustcreate ) {
+        errno = EEXIST;
+        return NULL;
+    }
 
-        case(ACTION_SUCCESS): // inject
-            _eval_semget_data.ret = _eval_semget_data.semid;
-            break;
+    _eval_vfile_type *file;
+    if ( idx >= 0 ) {
+        file = _eval_vfs.files[ idx ];
+    } else {
+        if ( ! ( mustcreate || create ) ) {
+            errno = ENOENT;
+            return NULL;
+        }
+        if ( ( file = _eval_vfs_create( path, 0644 ) ) == NULL ) return NULL;
+    }
 
-        case(ACTION_BLOCK):
-            eval_error("semget() called, aborting");
-            siglongjmp(_eval_env.jmp, EVAL_CATCH_BLOCKED );
-            break;
+    _eval_vstream_type *vs = calloc( 1, sizeof( _eval_vstream_type ) );
+    if ( vs == NULL ) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    vs -> file = file;
+    vs -> readable = readable;
+    vs -> writable = writable;
+    vs -> append = append;
+
+#ifdef __linux__
+    cookie_io_functions_t io = {
+        .read = _eval_vstream_read,
+        .write = _eval_vstream_write,
+        .seek = _eval_vstream_seek,
+        .close = _eval_vstream_close
+    };
+    FILE *stream = fopencookie( vs, mode, io );
+#else
+    FILE *stream = funopen( vs, _eval_vstream_readfn, _eval_vstream_writefn,
+        _eval_vstream_seekfn, _eval_vstream_close );
+#endif
 
-        default:
-            _eval_semget_data.ret = semget( key, nsems, semflg );
+    if ( stream == NULL ) {
+        free( vs );
+        return NULL;
     }
-    
-    return _eval_semget_data.ret;
+
+    if ( truncate ) file -> size = 0;
+    file -> nopen++;
+    return stream;
 }
 
+/******************************************************************************
+ * Virtual System V IPC
+ *****************************************************************************/
+
 /**
- * @brief Global _eval_semctl_data variable for the semctl() function
+ * @brief Virtual IPC object types
  * 
  */
-EVAL_VAR(semctl);
+enum {
+    _EVAL_VIPC_MSG = 0,
+    _EVAL_VIPC_SEM,
+    _EVAL_VIPC_SHM,
+    _EVAL_VIPC_NTYPES
+};
 
 /**
- * @brief Evaluate implementation calling of semctl function
- * Requires data in global _eval_semctl_data
+ * @brief Virtual message
  * 
- * Function `.action` options:
+ */
+typedef struct _eval_vmsg {
+    struct _eval_vmsg *next;
+    long mtype;
+    size_t size;
+    char mtext[];
+} _eval_vmsg_type;
+
+/**
+ * @brief Virtual IPC object
  * 
- * + `ACTION_ERROR`   - (error) Return -1 (EINVAL)
- * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
- * + `ACTION_SUCCESS` - (success) Return the 0
- * + `ACTION_DEFAULT` - Capture parameters and call `semctl(semid,semnum,cmd,...)`
+ */
+typedef struct {
+    int used;
+    int seq;            // Sequence number, used to generate the object id
+    key_t key;
+    int mode;
+
+    // Message queues
+    _eval_vmsg_type *head, *tail;
+    size_t qbytes;      // Maximum queue size
+    size_t cbytes;      // Current queue size
+    int qnum;           // Number of messages in queue
+    pid_t lspid, lrpid;
+
+    // Semaphore arrays
+    int nsems;
+    unsigned short *semval;
+    pid_t sempid;
+
+    // Shared memory segments
+    void *addr;
+    size_t size;
+    size_t mapsize;
+    int nattch;
+    int removed;        // IPC_RMID was called, destroy when no longer attached
+} _eval_vipc_obj_type;
+
+/**
+ * @brief Virtual IPC objects. These exist only in the memory of the current
+ * process and are released by eval_reset().
  * 
- * @param semid     semaphore id
- * @param semnum    semaphore value index
- * @param cmd       command
- * @param ...       extra parameters
- * @return          semctl result
  */
-int _eval_semctl(int semid, int semnum, int cmd, ... ) {
+static struct {
+    int active;
+    _eval_vipc_obj_type obj[ _EVAL_VIPC_NTYPES ][ EVAL_VIPC_MAX ];
+} _eval_vipc;
 
-    _eval_semctl_data.status ++;
+/**
+ * @brief Virtual IPC ids encode the object type, slot and sequence number, so
+ * that ids of removed objects (or of other types) are detected as invalid
+ */
+#define _EVAL_VIPC_ID( type, slot, seq ) \
+    ( ( (type) + 1 ) << 24 | ( (seq) & 0xFFFF ) << 8 | (slot) )
 
-    _eval_semctl_data.semid = semid;
-    _eval_semctl_data.semnum = semnum;
-    _eval_semctl_data.cmd = cmd;
+/**
+ * @brief Returns the virtual object with the specified type and id, or NULL
+ * (EINVAL) if not found
+ */
+static _eval_vipc_obj_type * _eval_vipc_get( int type, int id ) {
+    int slot = id & 0xFF;
+    if ( id < 0 || ( id >> 24 ) != type + 1 || slot >= EVAL_VIPC_MAX ) {
+        errno = EINVAL;
+        return NULL;
+    }
+    _eval_vipc_obj_type *obj = &_eval_vipc.obj[ type ][ slot ];
+    if ( ! obj -> used || _EVAL_VIPC_ID( type, slot, obj -> seq ) != id ) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return obj;
+}
 
-    switch (cmd) {
-    case(SETVAL):
-    case(IPC_STAT):
-    case(IPC_SET):
-    case(GETALL):
-    case(SETALL): 
-        {
-            va_list valist;
-            va_start(valist, cmd );
-            _eval_semctl_data.arg = va_arg(valist, union semun );
-            va_end(valist);
+/**
+ * @brief Looks for or creates a virtual object, following the semantics of
+ * msgget() / semget() / shmget()
+ * 
+ * @param type      Object type
+ * @param key       Object key
+ * @param flg       Creation flags
+ * @param created   Set to 1 if a new object was created
+ * @return          Object id, -1 on error
+ */
+static int _eval_vipc_lookup( int type, key_t key, int flg, int *created ) {
+    *created = 0;
+
+    int free = -1;
+    for( int i = 0; i < EVAL_VIPC_MAX; i++ ) {
+        _eval_vipc_obj_type *obj = &_eval_vipc.obj[ type ][ i ];
+        if ( ! obj -> used ) {
+            if ( free < 0 ) free = i;
+        } else if ( key != IPC_PRIVATE && obj -> key == key && ! obj -> removed ) {
+            if ( ( flg & IPC_CREAT ) && ( flg & IPC_EXCL ) ) {
+                errno = EEXIST;
+                return -1;
+            }
+            return _EVAL_VIPC_ID( type, i, obj -> seq );
         }
     }
 
-#ifdef _EVAL_DEBUG
-    if (cmd == SETVAL) {
-        printf( _EVAL_DEBUG_PREFIX "semctl( %d, %d, %d, %d )\n", semid, semnum, cmd, _eval_semctl_data.arg.val );
-    } else {
-        printf( _EVAL_DEBUG_PREFIX "semctl( %d, %d, %d, ... )\n", semid, semnum, cmd );
+    if ( key != IPC_PRIVATE && ! ( flg & IPC_CREAT ) ) {
+        errno = ENOENT;
+        return -1;
     }
-#endif
 
-    switch (_eval_semctl_data.action) {
+    if ( free < 0 ) {
+        errno = ENOSPC;
+        return -1;
+    }
 
-    case(ACTION_ERROR): // error
-        _eval_semctl_data.ret = -1;
-        errno = EINVAL;
-        break;
-    case(ACTION_LOG): // log
-        if ( cmd == SETVAL ) {
-            datalog("semctl,%d,%d,%d,%d", semid, semnum, cmd, _eval_semctl_data.arg, _eval_semctl_data.arg.val );
-        } else {
-            datalog("semctl,%d,%d,%d", semid, semnum, cmd );
-        }
-    case(ACTION_SUCCESS): // success
-        _eval_semctl_data.ret = 0;
-        break;
-    case(ACTION_BLOCK):
-        eval_error("semctl() called, aborting");
-        siglongjmp(_eval_env.jmp, EVAL_CATCH_BLOCKED );
-        break;
+    _eval_vipc_obj_type *obj = &_eval_vipc.obj[ type ][ free ];
+    int seq = obj -> seq + 1;
+    memset( obj, 0, sizeof( _eval_vipc_obj_type ) );
+    obj -> used = 1;
+    obj -> seq = seq;
+    obj -> key = key;
+    obj -> mode = flg & 0777;
+    _eval_vipc.active = 1;
+
+    *created = 1;
+    return _EVAL_VIPC_ID( type, free, seq );
+}
 
-    default:
-        switch (cmd) {
-        case(SETVAL):
-        case(IPC_STAT):
-        case(IPC_SET):
-        case(GETALL):
-        case(SETALL):
-            _eval_semctl_data.ret = semctl( semid, semnum, cmd, _eval_semctl_data.arg );
-            break;
-        default:
-            _eval_semctl_data.ret = semctl( semid, semnum, cmd );
-        }
+/**
+ * @brief Destroys a virtual object, releasing all associated memory
+ */
+static void _eval_vipc_destroy( _eval_vipc_obj_type *obj ) {
+    while( obj -> head ) {
+        _eval_vmsg_type *next = obj -> head -> next;
+        free( obj -> head );
+        obj -> head = next;
+    }
+    free( obj -> semval );
+    if ( obj -> addr ) {
+        munmap( obj -> addr, obj -> mapsize );
+        eval_checkrange_invalidate();
     }
 
-    return _eval_semctl_data.ret;
+    int seq = obj -> seq;
+    memset( obj, 0, sizeof( _eval_vipc_obj_type ) );
+    obj -> seq = seq;
 }
 
 /**
- * @brief Global _eval_semop_data variable for the semop() function
- * 
+ * @brief Aborts the test because the operation would block forever (there
+ * are no other processes / threads sharing the virtual object)
  */
-EVAL_VAR(semop);
+static void _eval_vipc_wouldblock( const char *func ) {
+    eval_error("%s() would block forever on a virtual IPC object, aborting", func );
+    _eval_longjmp( EVAL_CATCH_BLOCKED );
+}
 
 /**
- * @brief Evaluate implementation calling of semop function
- * Requires data in global _eval_semop_data
- * 
- * Function `.action` options:
- * 
- * + `ACTION_ERROR`   - (error) Return -1 (EINVAL)
- * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
- * + `ACTION_SUCCESS` - (success) Return the 0
- * + `ACTION_DEFAULT` - Capture parameters and call `semop(semid,sops,nsops)`
- * 
- * @param semid     semaphore id
- * @param sops      Semaphore operations
- * @param nsops     nsops
- * @return          semop result
+ * @brief Virtual msgget()
  */
-int _eval_semop(int semid, struct sembuf *sops, size_t nsops) {
+int _eval_vipc_msgget( key_t key, int msgflg ) {
+    int created;
+    int msqid = _eval_vipc_lookup( _EVAL_VIPC_MSG, key, msgflg, &created );
+    if ( msqid >= 0 && created ) {
+        _eval_vipc_get( _EVAL_VIPC_MSG, msqid ) -> qbytes = EVAL_VIPC_MSGMNB;
+    }
+    return msqid;
+}
 
-    int err = 0;
-    if ( eval_checkptr( sops ) != 0 ) {
-        eval_error("semop() called with invalid pointer (sops)\n");
-        err++;
+/**
+ * @brief Virtual msgsnd()
+ */
+int _eval_vipc_msgsnd( int msqid, const void *msgp, size_t msgsz, int msgflg ) {
+    _eval_vipc_obj_type *q = _eval_vipc_get( _EVAL_VIPC_MSG, msqid );
+    if ( q == NULL ) return -1;
+
+    long mtype = *(const long *) msgp;
+    if ( mtype < 1 || msgsz > EVAL_VIPC_MSGMAX ) {
+        errno = EINVAL;
+        return -1;
     }
 
-#ifdef _EVAL_DEBUG
-    printf( _EVAL_DEBUG_PREFIX "semop( %d, %p, %zu )\n", semid, (void *) sops ,nsops );
-    if ( nsops > 0 && !err ) {
-        for( int i = 0; i < nsops; i++ ) {
-            printf( "    ↳ op(%d) = {num:%d, op:%+d, flag:%d}\n", i, sops[i].sem_num, sops[i].sem_op, sops[i].sem_flg );
+    if ( q -> cbytes + msgsz > q -> qbytes ) {
+        if ( msgflg & IPC_NOWAIT ) {
+            errno = EAGAIN;
+            return -1;
         }
+        _eval_vipc_wouldblock( "msgsnd" );
     }
-#endif
 
-    _eval_semop_data.status ++;
+    _eval_vmsg_type *msg = malloc( sizeof( _eval_vmsg_type ) + msgsz );
+    if ( msg == NULL ) {
+        errno = ENOMEM;
+        return -1;
+    }
+    msg -> next = NULL;
+    msg -> mtype = mtype;
+    msg -> size = msgsz;
+    memcpy( msg -> mtext, (const char *) msgp + sizeof(long), msgsz );
 
-    _eval_semop_data.semid = semid;
-    _eval_semop_data.sops = sops;
-    _eval_semop_data.nsops = nsops;
+    if ( q -> tail ) q -> tail -> next = msg; else q -> head = msg;
+    q -> tail = msg;
+    q -> cbytes += msgsz;
+    q -> qnum++;
+    q -> lspid = getpid();
 
-    switch( _eval_semop_data.action ) {
-    case(ACTION_ERROR): // error
-        _eval_semop_data.ret = -1;
-        errno = EINVAL;
-        break;
-    case(ACTION_LOG):
-        if ( !err ) {
-            for( int i = 0; i < nsops; i++ ) {
-                datalog("semop,%d,%d,%d,%d", semid, sops[i].sem_num, sops[i].sem_op, sops[i].sem_flg );
+    return 0;
+}
+
+/**
+ * @brief Virtual msgrcv()
+ * 
+ * Message selection follows msgrcv(): msgtyp == 0 selects the first message,
+ * msgtyp > 0 the first message of type msgtyp (or not of type msgtyp if
+ * MSG_EXCEPT is set) and msgtyp < 0 the first message with the lowest type
+ * <= |msgtyp|.
+ */
+ssize_t _eval_vipc_msgrcv( int msqid, void *msgp, size_t msgsz, long msgtyp, int msgflg ) {
+    _eval_vipc_obj_type *q = _eval_vipc_get( _EVAL_VIPC_MSG, msqid );
+    if ( q == NULL ) return -1;
+
+    // Largest type selected by msgtyp < 0 (-LONG_MIN does not fit in a long)
+    const long maxtyp = ( msgtyp == LONG_MIN ) ? LONG_MAX : -msgtyp;
+
+    _eval_vmsg_type *prev = NULL, *sel = NULL, *selprev = NULL;
+    for( _eval_vmsg_type *m = q -> head; m; prev = m, m = m -> next ) {
+        if ( msgtyp == 0 ) {
+            sel = m; selprev = prev;
+            break;
+        } else if ( msgtyp > 0 ) {
+#ifdef MSG_EXCEPT
+            int match = ( msgflg & MSG_EXCEPT ) ? ( m -> mtype != msgtyp ) : ( m -> mtype == msgtyp );
+#else
+            int match = ( m -> mtype == msgtyp );
+#endif
+            if ( match ) {
+                sel = m; selprev = prev;
+                break;
             }
+        } else if ( m -> mtype <= maxtyp && ( sel == NULL || m -> mtype < sel -> mtype ) ) {
+            sel = m; selprev = prev;
         }
-    case(ACTION_SUCCESS): // success
-        _eval_semop_data.ret = 0;
-        break;
-    case(ACTION_BLOCK):
-        eval_error("semop() called, aborting");
-        siglongjmp(_eval_env.jmp, EVAL_CATCH_BLOCKED );
-        break;
+    }
 
-    default:
-        if ( ! err ) {
-            _eval_semop_data.ret = semop( semid, sops, nsops );
-        } else {
-            _eval_semop_data.ret = -1;
-            errno = EINVAL;
+    if ( sel == NULL ) {
+        if ( msgflg & IPC_NOWAIT ) {
+            errno = ENOMSG;
+            return -1;
         }
+        _eval_vipc_wouldblock( "msgrcv" );
     }
 
-    
+    size_t bytes = sel -> size;
+    if ( bytes > msgsz ) {
+        if ( ! ( msgflg & MSG_NOERROR ) ) {
+            errno = E2BIG;
+            return -1;
+        }
+        bytes = msgsz;
+    }
 
-    return _eval_semop_data.ret;
+    *(long *) msgp = sel -> mtype;
+    memcpy( (char *) msgp + sizeof(long), sel -> mtext, bytes );
+
+    if ( selprev ) selprev -> next = sel -> next; else q -> head = sel -> next;
+    if ( q -> tail == sel ) q -> tail = selprev;
+    q -> cbytes -= sel -> size;
+    q -> qnum--;
+    q -> lrpid = getpid();
+    free( sel );
+
+    return bytes;
 }
 
 /**
- * @brief Global _eval_shmget_data variable for the shmget() function
- * 
+ * @brief Virtual msgctl(), supports IPC_STAT, IPC_SET and IPC_RMID
  */
-EVAL_VAR(shmget);
+int _eval_vipc_msgctl( int msqid, int cmd, struct msqid_ds *buf ) {
+    _eval_vipc_obj_type *q = _eval_vipc_get( _EVAL_VIPC_MSG, msqid );
+    if ( q == NULL ) return -1;
+
+    switch( cmd ) {
+    case( IPC_STAT ):
+        if ( buf == NULL ) { errno = EFAULT; return -1; }
+        memset( buf, 0, sizeof( struct msqid_ds ) );
+        buf -> msg_perm.uid = buf -> msg_perm.cuid = getuid();
+        buf -> msg_perm.gid = buf -> msg_perm.cgid = getgid();
+        buf -> msg_perm.mode = q -> mode;
+        buf -> msg_qnum = q -> qnum;
+        buf -> msg_qbytes = q -> qbytes;
+        buf -> msg_lspid = q -> lspid;
+        buf -> msg_lrpid = q -> lrpid;
+        return 0;
+    case( IPC_SET ):
+        if ( buf == NULL ) { errno = EFAULT; return -1; }
+        q -> mode = buf -> msg_perm.mode & 0777;
+        q -> qbytes = buf -> msg_qbytes;
+        return 0;
+    case( IPC_RMID ):
+        _eval_vipc_destroy( q );
+        return 0;
+    default:
+        errno = EINVAL;
+        return -1;
+    }
+}
+
+/**
+ * @brief Virtual semget()
+ */
+int _eval_vipc_semget( key_t key, int nsems, int semflg ) {
+    if ( nsems < 0 ) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int created;
+    int semid = _eval_vipc_lookup( _EVAL_VIPC_SEM, key, semflg, &created );
+    if ( semid < 0 ) return -1;
+
+    _eval_vipc_obj_type *s = _eval_vipc_get( _EVAL_VIPC_SEM, semid );
+    if ( created ) {
+        if ( nsems == 0 || ( s -> semval = calloc( nsems, sizeof( unsigned short ) ) ) == NULL ) {
+            errno = ( nsems == 0 ) ? EINVAL : ENOMEM;
+            _eval_vipc_destroy( s );
+            return -1;
+        }
+        s -> nsems = nsems;
+    } else if ( nsems > s -> nsems ) {
+        errno = EINVAL;
+        return -1;
+    }
+    return semid;
+}
+
+/**
+ * @brief Virtual semctl(), supports GETVAL, SETVAL, GETALL, SETALL, GETPID,
+ * GETNCNT, GETZCNT, IPC_STAT and IPC_RMID
+ */
+int _eval_vipc_semctl( int semid, int semnum, int cmd, union semun arg ) {
+    _eval_vipc_obj_type *s = _eval_vipc_get( _EVAL_VIPC_SEM, semid );
+    if ( s == NULL ) return -1;
+
+    switch( cmd ) {
+    case( GETVAL ):
+    case( SETVAL ):
+    case( GETPID ):
+    case( GETNCNT ):
+    case( GETZCNT ):
+        if ( semnum < 0 || semnum >= s -> nsems ) {
+            errno = EINVAL;
+            return -1;
+        }
+    }
+
+    switch( cmd ) {
+    case( GETVAL ):
+        return s -> semval[ semnum ];
+    case( SETVAL ):
+        if ( arg.val < 0 || arg.val > EVAL_VIPC_SEMVMX ) {
+            errno = ERANGE;
+            return -1;
+        }
+        s -> semval[ semnum ] = arg.val;
+        return 0;
+    case( GETALL ):
+        memcpy( arg.array, s -> semval, s -> nsems * sizeof( unsigned short ) );
+        return 0;
+    case( SETALL ):
+        for( int i = 0; i < s -> nsems; i++ ) {
+            if ( arg.array[i] > EVAL_VIPC_SEMVMX ) {
+                errno = ERANGE;
+                return -1;
+            }
+        }
+        memcpy( s -> semval, arg.array, s -> nsems * sizeof( unsigned short ) );
+        return 0;
+    case( GETPID ):
+        return s -> sempid;
+    case( GETNCNT ):
+    case( GETZCNT ):
+        // There are never other processes waiting on a virtual semaphore
+        return 0;
+    case( IPC_STAT ):
+        if ( arg.buf == NULL ) { errno = EFAULT; return -1; }
+        memset( arg.buf, 0, sizeof( struct semid_ds ) );
+        arg.buf -> sem_perm.uid = arg.buf -> sem_perm.cuid = getuid();
+        arg.buf -> sem_perm.gid = arg.buf -> sem_perm.cgid = getgid();
+        arg.buf -> sem_perm.mode = s -> mode;
+        arg.buf -> sem_nsems = s -> nsems;
+        return 0;
+    case( IPC_RMID ):
+        _eval_vipc_destroy( s );
+        return 0;
+    default:
+        errno = EINVAL;
+        return -1;
+    }
+}
 
 /**
- * @brief Evaluate implementation calling of shmget function
- * Requires data in global _eval_semget_data
- * 
- * Function `.action` options:
- * 
- * + `ACTION_RETRY`   - (retry) Fail on first try (ENOENT), behave as `ACTION_SUCCESS`
- *                      on 2nd try, fail on remaining attempts (EINVAL)
- * + `ACTION_CREATE`  - (must create) If `IPC_CREAT` was specified then behave as
- *                      `ACTION_SUCCESS` otherwise return -1 (ENOENT)
- * + `ACTION_ERROR`   - (error) Return -1 (EINVAL)
- * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
- * + `ACTION_SUCCESS` - (success) Return the value set in `_eval_shmget_data.shmid`
- * + `ACTION_DEFAULT` - Capture parameters and call `shmget( key, size, shmflg )`
- * 
- * @param key       IPC key
- * @param size      Size of shared memory region
- * @param semflg    Flags for shmem creation / connection
- * @return          shm id
+ * @brief Virtual semop(). All operations are performed atomically, i.e.,
+ * either all or none are performed.
  */
-int _eval_shmget(key_t key, size_t size, int shmflg) {
+int _eval_vipc_semop( int semid, struct sembuf *sops, size_t nsops ) {
+    _eval_vipc_obj_type *s = _eval_vipc_get( _EVAL_VIPC_SEM, semid );
+    if ( s == NULL ) return -1;
 
-#ifdef _EVAL_DEBUG
-    printf( _EVAL_DEBUG_PREFIX "shmget( 0x%x, %zu, 0%04o )\n", key, size, shmflg );
-#endif
+    if ( nsops == 0 || nsops > EVAL_VIPC_SEMOPM ) {
+        errno = ( nsops == 0 ) ? EINVAL : E2BIG;
+        return -1;
+    }
 
-    _eval_shmget_data.status ++;
+    // Validate all operations on a copy of the semaphore values
+    int val[ s -> nsems ];
+    for( int i = 0; i < s -> nsems; i++ ) val[i] = s -> semval[i];
 
-    _eval_shmget_data.key = key;
-    _eval_shmget_data.size = size;
-    _eval_shmget_data.shmflg = shmflg;
+    for( size_t i = 0; i < nsops; i++ ) {
+        int n = sops[i].sem_num;
+        if ( n >= s -> nsems ) {
+            errno = EFBIG;
+            return -1;
+        }
 
-    switch( _eval_shmget_data.action ) {
-    case(ACTION_RETRY): // error (ENOENT) on first try, inject on 2nd try
-        switch( _eval_shmget_data.status ) {
-        case (1):
-            errno = ENOENT;
-            _eval_shmget_data.ret = -1;
-            break;
-        case (2):
-            if ( size == 0  && ( shmflg & IPC_CREAT ) ) {
-                    _eval_shmget_data.ret = -1;
-            } else {
-                _eval_shmget_data.ret = _eval_shmget_data.shmid;
+        int op = sops[i].sem_op;
+        if ( ( op < 0 && val[n] + op < 0 ) || ( op == 0 && val[n] != 0 ) ) {
+            if ( sops[i].sem_flg & IPC_NOWAIT ) {
+                errno = EAGAIN;
+                return -1;
             }
-            break;
-        default:
-            _eval_shmget_data.ret = -1;
+            _eval_vipc_wouldblock( "semop" );
         }
-        break;
-    case(ACTION_CREATE): // inject on create only
-        if ( size == 0  && ( shmflg & IPC_CREAT ) ) {
-                _eval_shmget_data.ret = -1;
-        } else {
-            _eval_shmget_data.ret = _eval_shmget_data.shmid;
+        if ( val[n] + op > EVAL_VIPC_SEMVMX ) {
+            errno = ERANGE;
+            return -1;
         }
-        break;
-    case(ACTION_ERROR): // error
-        _eval_shmget_data.ret = -1;
-        errno = EINVAL;
-        break;
-    case(ACTION_LOG): // log
-        datalog("shmget,%x,%ld,%d", key, size, shmflg );
-    case(ACTION_SUCCESS): // success
-        _eval_shmget_data.ret = _eval_shmget_data.shmid;
-        break;
-    case(ACTION_BLOCK):
-        eval_error("shmget() called, aborting");
-        siglongjmp(_eval_env.jmp, EVAL_CATCH_BLOCKED );
-        break;
-    default:
-        _eval_shmget_data.shmid = shmget( key, size, shmflg );
-        _eval_shmget_data.ret = _eval_shmget_data.shmid;
+        val[n] += op;
     }
 
-    return _eval_shmget_data.ret;
+    for( int i = 0; i < s -> nsems; i++ ) s -> semval[i] = val[i];
+    s -> sempid = getpid();
+    return 0;
 }
 
 /**
- * @brief Global _eval_shmat_data variable for the shmat() function
+ * @brief Virtual shmget()
  * 
+ * Segment memory is a shared anonymous mapping, so it is shared with
+ * processes forked after the segment is created.
  */
-EVAL_VAR(shmat);
+int _eval_vipc_shmget( key_t key, size_t size, int shmflg ) {
+    int created;
+    int shmid = _eval_vipc_lookup( _EVAL_VIPC_SHM, key, shmflg, &created );
+    if ( shmid < 0 ) return -1;
+
+    _eval_vipc_obj_type *seg = _eval_vipc_get( _EVAL_VIPC_SHM, shmid );
+    if ( created ) {
+        long pagesize = sysconf( _SC_PAGESIZE );
+        size_t mapsize = ( size + pagesize - 1 ) / pagesize * pagesize;
+        void *addr = ( size > 0 ) ? mmap( NULL, mapsize, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_ANONYMOUS, -1, 0 ) : MAP_FAILED;
+        if ( addr == MAP_FAILED ) {
+            errno = ( size == 0 ) ? EINVAL : ENOMEM;
+            _eval_vipc_destroy( seg );
+            return -1;
+        }
+        seg -> addr = addr;
+        seg -> size = size;
+        seg -> mapsize = mapsize;
+        eval_checkrange_invalidate();
+    } else if ( size > seg -> size ) {
+        errno = EINVAL;
+        return -1;
+    }
+    return shmid;
+}
 
 /**
- * @brief Evaluate implementation calling of shmat function
- * Requires data in global _eval_shmat_data
- * 
- * Function `.action` options:
- * 
- * + `ACTION_ERROR`   - (error) Return `(void *) -1` (EINVAL)
- * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
- * + `ACTION_SUCCESS` - (success) Return the value set in `_eval_shmat_data.shmaddr`
- * + `ACTION_DEFAULT` - Capture parameters and call `shmat( shmid, shmaddr, shmflg )`
- * 
- * @param shmid     Shared memory ID
- * @param shmaddr   Choice for logical address
- * @param shmflg    Flags for address choice
- * @return          Logical address of shared memory region
+ * @brief Virtual shmat(). Every attachment of a segment returns the same
+ * (writable) address; the shmaddr and shmflg parameters are ignored.
  */
-void *_eval_shmat( int shmid, const void *shmaddr, int shmflg) {
-
-#ifdef _EVAL_DEBUG
-    printf( _EVAL_DEBUG_PREFIX "shmat( %d, %p, %d )\n", shmid, shmaddr, shmflg );
-#endif
-
-    _eval_shmat_data.status ++;
-    _eval_shmat_data.shmid = shmid;
-    _eval_shmat_data.shmflg = shmflg;
+void * _eval_vipc_shmat( int shmid, const void *shmaddr, int shmflg ) {
+    (void) shmaddr;
+    (void) shmflg;
+
+    _eval_vipc_obj_type *seg = _eval_vipc_get( _EVAL_VIPC_SHM, shmid );
+    if ( seg == NULL ) return (void *) -1;
+    if ( seg -> removed ) {
+        errno = EIDRM;
+        return (void *) -1;
+    }
+    seg -> nattch++;
+    _eval_capture_shm_track( seg -> addr, seg -> size );
+    return seg -> addr;
+}
 
-    switch( _eval_shmat_data.action ) {
-    case(ACTION_ERROR):
-        _eval_shmat_data.ret = (void *) -1;
-        errno=EINVAL;
-        break;
-    case(ACTION_LOG): // log
-        datalog("shmat,%d,%p,%d", shmid, shmaddr, shmflg );
-    case(ACTION_SUCCESS): // inject
-        _eval_shmat_data.ret = _eval_shmat_data.shmaddr;
-        break;
+/**
+ * @brief Finds the virtual segment attached at shmaddr
+ */
+static _eval_vipc_obj_type * _eval_vipc_shmfind( const void *shmaddr ) {
+    for( int i = 0; i < EVAL_VIPC_MAX; i++ ) {
+        _eval_vipc_obj_type *seg = &_eval_vipc.obj[ _EVAL_VIPC_SHM ][ i ];
+        if ( seg -> used && seg -> nattch > 0 && seg -> addr == shmaddr ) return seg;
+    }
+    return NULL;
+}
 
-    case(ACTION_BLOCK):
-        eval_error("shmat() called, aborting");
-        siglongjmp(_eval_env.jmp, EVAL_CATCH_BLOCKED );
-        break;
+/**
+ * @brief Virtual shmdt()
+ */
+int _eval_vipc_shmdt( const void *shmaddr ) {
+    _eval_vipc_obj_type *seg = _eval_vipc_shmfind( shmaddr );
+    if ( seg == NULL ) {
+        errno = EINVAL;
+        return -1;
+    }
+    // Snapshot the segment, as for real segments
+    _eval_capture_shmdt( shmaddr, _eval_shmdt_data.status, 0 );
+    if ( --seg -> nattch == 0 ) {
+        _eval_capture_shmdt( shmaddr, 0, 1 );
+        if ( seg -> removed ) _eval_vipc_destroy( seg );
+    }
+    return 0;
+}
 
+/**
+ * @brief Virtual shmctl(), supports IPC_STAT, IPC_SET and IPC_RMID
+ */
+int _eval_vipc_shmctl( int shmid, int cmd, struct shmid_ds *buf ) {
+    _eval_vipc_obj_type *seg = _eval_vipc_get( _EVAL_VIPC_SHM, shmid );
+    if ( seg == NULL ) return -1;
+
+    switch( cmd ) {
+    case( IPC_STAT ):
+        if ( buf == NULL ) { errno = EFAULT; return -1; }
+        memset( buf, 0, sizeof( struct shmid_ds ) );
+        buf -> shm_perm.uid = buf -> shm_perm.cuid = getuid();
+        buf -> shm_perm.gid = buf -> shm_perm.cgid = getgid();
+        buf -> shm_perm.mode = seg -> mode;
+        buf -> shm_segsz = seg -> size;
+        buf -> shm_nattch = seg -> nattch;
+        return 0;
+    case( IPC_SET ):
+        if ( buf == NULL ) { errno = EFAULT; return -1; }
+        seg -> mode = buf -> shm_perm.mode & 0777;
+        return 0;
+    case( IPC_RMID ):
+        seg -> removed = 1;
+        if ( seg -> nattch == 0 ) _eval_vipc_destroy( seg );
+        return 0;
     default:
-        _eval_shmat_data.ret = shmat( shmid, shmaddr, shmflg );
+        errno = EINVAL;
+        return -1;
     }
-
-    _eval_shmat_data.shmaddr = (void *) shmaddr;
-
-    return _eval_shmat_data.ret;
 }
 
 /**
- * @brief Global _eval_shmdt_data variable for the shmdt() function
+ * @brief Sets all System V IPC wrappers (msg*, sem*, shm*) to use the virtual
+ * IPC backend (ACTION_VIRTUAL)
  * 
  */
-EVAL_VAR(shmdt);
+void eval_ipc_virtual( void ) {
+    _eval_msgget_data.action = ACTION_VIRTUAL;
+    _eval_msgsnd_data.action = ACTION_VIRTUAL;
+    _eval_msgrcv_data.action = ACTION_VIRTUAL;
+    _eval_msgctl_data.action = ACTION_VIRTUAL;
+
+    _eval_semget_data.action = ACTION_VIRTUAL;
+    _eval_semctl_data.action = ACTION_VIRTUAL;
+    _eval_semop_data.action = ACTION_VIRTUAL;
+
+    _eval_shmget_data.action = ACTION_VIRTUAL;
+    _eval_shmat_data.action = ACTION_VIRTUAL;
+    _eval_shmdt_data.action = ACTION_VIRTUAL;
+    _eval_shmctl_data.action = ACTION_VIRTUAL;
+}
 
 /**
- * Evaluate implementation calling of shmdt function
- * Requires data in global _eval_shmdt_data
- * 
- * Function `.action` options:
- * 
- * + `ACTION_ERROR`   - (error) Return -1 (EINVAL)
- * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
- * + `ACTION_SUCCESS` - (success) Return 0
- * + `ACTION_DEFAULT` - Capture parameters and call `shmdt( shmaddr )`
+ * @brief Destroys all virtual IPC objects. This is called by eval_reset() and
+ * eval_reset_vars().
  * 
- * @param shmaddr   Logical address of shared memory region to detach
- * @return          success
  */
-int _eval_shmdt(const void *shmaddr) {
+void eval_ipc_release( void ) {
+    if ( ! _eval_vipc.active ) return;
 
-#ifdef _EVAL_DEBUG
-    printf( _EVAL_DEBUG_PREFIX "shmdt( %p )\n", shmaddr );
-#endif
+    for( int t = 0; t < _EVAL_VIPC_NTYPES; t++ )
+        for( int i = 0; i < EVAL_VIPC_MAX; i++ )
+            if ( _eval_vipc.obj[t][i].used ) _eval_vipc_destroy( &_eval_vipc.obj[t][i] );
 
-    _eval_shmdt_data.status ++;
-    _eval_shmdt_data.shmaddr = (void *) shmaddr;
-    
-    switch( _eval_shmdt_data.action ) {
+    _eval_vipc.active = 0;
+}
 
-    case( ACTION_ERROR ): // error
-        _eval_shmdt_data.ret = -1;
-        errno = EINVAL;
-        break;
+/**
+ * @brief Sets all _eval_*_data variables to 0
+ *
+ * This resets the status counter and sets the default action for all functions.
+ *
+ * It also sets the default timeout behavior.
+ * 
+ * Wrapper state is reset lazily, in O(1) time: each _eval_*_data variable is
+ * cleared the first time it is accessed after this call.
+ */
+void eval_reset_vars( void ) {
 
-    case( ACTION_LOG ): // log
-        datalog("shmdt,%p", shmaddr );
+    // To disable timeout by default compile with -DEVAL_TIMEOUT=0
+    _eval_env.timeout = EVAL_TIMEOUT;
+    _eval_env.wall_timeout = EVAL_WALL_TIMEOUT;
 
-    case( ACTION_SUCCESS ): // success
-        _eval_shmdt_data.ret = 0;
-        break;
+    // Memory mappings may have changed between tests
+    eval_checkrange_invalidate();
 
-    case(ACTION_BLOCK):
-        eval_error("shmdt() called, aborting");
-        siglongjmp(_eval_env.jmp, EVAL_CATCH_BLOCKED );
-        break;
+    // Captured payloads are released in bulk
+    eval_capture_release();
 
-    default:
-        _eval_shmdt_data.ret = shmdt( shmaddr );
-    }
+    // Virtual IPC objects are private to each test
+    eval_ipc_release();
 
-    return _eval_shmdt_data.ret;
+    // Virtual time restarts at 0 for each test
+    eval_vclock_reset();
+
+    // Virtual files are private to each test
+    eval_vfs_clear();
+
+    _eval_wrapper_reset( 0 );
 }
 
 /**
- * @brief Global _eval_shmctl_data variable for the shmctl() function
+ * @brief Sets default values for evaluation variables
+ * 
+ * This sets the default behavior for all eval.c functions.
  * 
+ * Specifically:
+ *  1 - Resets all _eval_*_data variables to 0, including the status and action fields
+ *  2 - Sets the timeout time to EVAL_TIMEOUT
+ *  3 - Sets the default action of each wrapper, as listed in EVAL_WRAPPERS:
+ *      - Block execution of pause(), execl(), wait() and waitpid()
+ *      - Prevent signals to self
  */
-EVAL_VAR(shmctl);
+void eval_reset( void ) {
+    eval_reset_vars();
+
+    // Except for the functions listed above the default behavior is to
+    // capture function parameters and then call function
+    _eval_wrapper_reset( 1 );
+}
+
+/******************************************************************************
+ * Resource usage
+ *****************************************************************************/
 
 /**
- * Evaluate implementation calling of shmctl function
- * Requires data in global _eval_shmctl_data
- * 
- * Function `.action` options:
- * 
- * + `ACTION_ERROR`   - (error) Return -1 (EINVAL)
- * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
- * + `ACTION_SUCCESS` - (success) Return 0
- * + `ACTION_DEFAULT` - Capture parameters and call `shmdt( shmaddr )`
+ * @brief Resource usage of the last EVAL_CATCH* macro
  * 
- * @param shmid     Shared memory ID
- * @param cmd       Command to perform
- * @param buf       struct shmid_ds for input / output of command
- * @return          success
  */
-int _eval_shmctl(int shmid, int cmd, struct shmid_ds *buf) {
-
-#ifdef _EVAL_DEBUG
-    printf( _EVAL_DEBUG_PREFIX "shmctl( %d, %d, %p )\n", shmid, cmd, (void *) buf );
-#endif
-
-    _eval_shmctl_data.status ++;
-    _eval_shmctl_data.shmid = shmid;
-    _eval_shmctl_data.cmd = cmd;
-    _eval_shmctl_data.buf = buf;
+eval_usage_t _eval_usage;
 
-    switch( _eval_shmctl_data.action ) {
-    case( ACTION_ERROR ):
-        _eval_shmctl_data.ret = -1;
-        errno = EINVAL;
-        break;
-    case( ACTION_LOG ): //log
-        datalog("shmctl,%d,%d,%p", shmid, cmd, buf );
-    case( ACTION_SUCCESS ): // success
-        _eval_shmctl_data.ret = 0;
-        break;
-    case( ACTION_BLOCK ):
-        eval_error("shmctl() called, aborting");
-        siglongjmp(_eval_env.jmp, EVAL_CATCH_BLOCKED );
-        break;
+/**
+ * @brief Resource usage accumulated over all EVAL_CATCH* macros since the
+ * last call to eval_usage_reset()
+ * 
+ */
+eval_usage_t _eval_usage_total;
 
-    default:
-    _eval_shmctl_data.ret = shmctl( shmid, cmd, buf );
-    }
+/**
+ * @brief Wrapped functions whose calls are counted in eval_usage_t.calls
+ * 
+ * Uses the .status call counter of the corresponding _eval_*_data variable
+ */
+static const int _eval_usage_funcs[] = {
+    EVAL_WRAPPER_SLEEP,
+    EVAL_WRAPPER_FORK,
+    EVAL_WRAPPER_WAIT,
+    EVAL_WRAPPER_WAITPID,
+    EVAL_WRAPPER_KILL,
+    EVAL_WRAPPER_RAISE,
+    EVAL_WRAPPER_SIGNAL,
+    EVAL_WRAPPER_SIGACTION,
+    EVAL_WRAPPER_PAUSE,
+    EVAL_WRAPPER_ALARM,
+    EVAL_WRAPPER_MSGGET,
+    EVAL_WRAPPER_MSGSND,
+    EVAL_WRAPPER_MSGRCV,
+    EVAL_WRAPPER_MSGCTL,
+    EVAL_WRAPPER_SEMGET,
+    EVAL_WRAPPER_SEMCTL,
+    EVAL_WRAPPER_SEMOP,
+    EVAL_WRAPPER_SHMGET,
+    EVAL_WRAPPER_SHMAT,
+    EVAL_WRAPPER_SHMDT,
+    EVAL_WRAPPER_SHMCTL,
+    EVAL_WRAPPER_MKFIFO,
+    EVAL_WRAPPER_ISFIFO,
+    EVAL_WRAPPER_REMOVE,
+    EVAL_WRAPPER_UNLINK,
+    EVAL_WRAPPER_ATOI,
+    EVAL_WRAPPER_FCLOSE,
+    EVAL_WRAPPER_FREAD,
+    EVAL_WRAPPER_FWRITE,
+    EVAL_WRAPPER_FSEEK,
+    EVAL_WRAPPER_EXECL,
+    EVAL_WRAPPER_FOPEN,
+    EVAL_WRAPPER_PTHREAD_CREATE,
+    EVAL_WRAPPER_PTHREAD_JOIN,
+    EVAL_WRAPPER_PTHREAD_MUTEX_LOCK,
+    EVAL_WRAPPER_PTHREAD_MUTEX_TRYLOCK,
+    EVAL_WRAPPER_PTHREAD_MUTEX_UNLOCK
+};
+
+_Static_assert( sizeof( _eval_usage_funcs ) / sizeof( _eval_usage_funcs[0] ) == EVAL_USAGE_NFUNCS,
+    "EVAL_USAGE_NFUNCS does not match the number of counted functions" );
 
-    return _eval_shmctl_data.ret;
+/**
+ * @brief Resource usage and call counters at the start of the current
+ * EVAL_CATCH* macro
+ * 
+ */
+static struct {
+    struct rusage ru;
+    int calls[ EVAL_USAGE_NFUNCS ];
+} _eval_usage_start_data;
+
+/**
+ * @brief Converts a struct timeval to seconds
+ */
+static double _eval_tv_sec( struct timeval tv ) {
+    return tv.tv_sec + 1.e-6 * tv.tv_usec;
 }
 
 /**
- * @brief Global _eval_mkfifo_data variable for the mkfifo() function
+ * @brief Returns the call counter of a wrapper
  * 
+ * Wrappers not accessed since the last reset are not reinitialized, their
+ * counter is 0.
+ * 
+ * @param id        Wrapper id
+ * @return int      Value of .status
  */
-EVAL_VAR(mkfifo);
+static int _eval_usage_count( int id ) {
+    if ( __atomic_load_n( &_eval_wrapper_gens[id], __ATOMIC_ACQUIRE ) != _eval_wrapper_gen ) return 0;
+    return ( (_eval_wrapper_head_type *) _eval_wrappers[id].data ) -> status;
+}
 
 /**
- * @brief Evaluate implementation calling of mkfifo function
- * Requires data in global _eval_mkfifo_data
- *
- * Function `.action` options:
+ * @brief Stores resource usage and call counters at the start of an
+ * EVAL_CATCH* macro
  * 
- * + `ACTION_ERROR`   - (error) Return -1 (EINVAL)
- * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
- * + `ACTION_SUCCESS` - (success) Return 0
- * + `ACTION_DEFAULT` - Capture parameters and call `mkfifo( path, mode )`
- *
- * @param path      Path to FIFO
- * @param mode      Creation mode
- * @return int      Success
+ * Called by _eval_arm_signals()
  */
-int _eval_mkfifo(const char *path, mode_t mode) {
-    
-    _eval_mkfifo_data.status ++;
-    _eval_mkfifo_data.mode = mode;
+void _eval_usage_start( void ) {
+    for( int i = 0; i < EVAL_USAGE_NFUNCS; i++ )
+        _eval_usage_start_data.calls[i] = _eval_usage_count( _eval_usage_funcs[i] );
 
-    int err = 0;
-    if ( eval_checkconstptr(path) ) {
-        eval_error("mkfifo(path,mode) invalid path");
-        _eval_mkfifo_data.path[0] = 0;
-        err++;
+    // Not sampled inside sessions, see eval_session_begin()
+    if ( ! _eval_env.session ) getrusage( RUSAGE_SELF, &_eval_usage_start_data.ru );
+}
+
+/**
+ * @brief Stores resource usage of the EVAL_CATCH* macro in _eval_usage, and
+ * adds it to _eval_usage_total
+ * 
+ * Called by _eval_disarm_signals(), after _eval_env.wall_time has been set
+ */
+void _eval_usage_stop( void ) {
+    struct rusage ru;
+    if ( _eval_env.session ) {
+        ru = _eval_usage_start_data.ru;
     } else {
-        strncpy( _eval_mkfifo_data.path, path, PATH_MAX );
+        getrusage( RUSAGE_SELF, &ru );
     }
 
-    switch( _eval_mkfifo_data.action ) {
-        case( ACTION_ERROR ):
-            _eval_mkfifo_data.ret = -1;
-            errno = EINVAL;
-            break;
-        case( ACTION_LOG ): //log
-            datalog("mkfifo,%s,%o", _eval_mkfifo_data.path, mode );
-        case( ACTION_SUCCESS ):
-            _eval_mkfifo_data.ret = 0;
-            break;
-        case(ACTION_BLOCK):
-            eval_error("mkfifo() called, aborting");
-            siglongjmp(_eval_env.jmp, EVAL_CATCH_BLOCKED );
-            break;
-        default:
-            if ( !err ) {
-                _eval_mkfifo_data.ret = mkfifo( path, mode );
-            } else {
-                _eval_mkfifo_data.ret = -1;
-                errno = EINVAL;
-            }
+    const struct rusage *r0 = &_eval_usage_start_data.ru;
+
+    _eval_usage.wall = _eval_env.wall_time;
+    _eval_usage.utime = _eval_tv_sec( ru.ru_utime ) - _eval_tv_sec( r0 -> ru_utime );
+    _eval_usage.stime = _eval_tv_sec( ru.ru_stime ) - _eval_tv_sec( r0 -> ru_stime );
+
+    _eval_usage.maxrss = ru.ru_maxrss - r0 -> ru_maxrss;
+#ifdef __APPLE__
+    // macOS reports ru_maxrss in bytes
+    _eval_usage.maxrss /= 1024;
+#endif
+
+    _eval_usage.minflt = ru.ru_minflt - r0 -> ru_minflt;
+    _eval_usage.majflt = ru.ru_majflt - r0 -> ru_majflt;
+    _eval_usage.nvcsw = ru.ru_nvcsw - r0 -> ru_nvcsw;
+    _eval_usage.nivcsw = ru.ru_nivcsw - r0 -> ru_nivcsw;
+
+    for( int i = 0; i < EVAL_USAGE_NFUNCS; i++ ) {
+        int start = _eval_usage_start_data.calls[i];
+        int end = _eval_usage_count( _eval_usage_funcs[i] );
+        // Counters may have been reset inside the macro
+        _eval_usage.calls[i] = ( end >= start ) ? end - start : end;
     }
-    return _eval_mkfifo_data.ret;
+
+    _eval_usage_total.wall += _eval_usage.wall;
+    _eval_usage_total.utime += _eval_usage.utime;
+    _eval_usage_total.stime += _eval_usage.stime;
+    if ( _eval_usage.maxrss > _eval_usage_total.maxrss ) 
+        _eval_usage_total.maxrss = _eval_usage.maxrss;
+    _eval_usage_total.minflt += _eval_usage.minflt;
+    _eval_usage_total.majflt += _eval_usage.majflt;
+    _eval_usage_total.nvcsw += _eval_usage.nvcsw;
+    _eval_usage_total.nivcsw += _eval_usage.nivcsw;
+    for( int i = 0; i < EVAL_USAGE_NFUNCS; i++ )
+        _eval_usage_total.calls[i] += _eval_usage.calls[i];
 }
 
 /**
- * @brief Global _eval_mkfifo_data variable for the S_ISFIFO() macro
+ * @brief Resets the accumulated resource usage (_eval_usage_total)
  * 
  */
-EVAL_VAR(isfifo);
+void eval_usage_reset( void ) {
+    memset( &_eval_usage_total, 0, sizeof( eval_usage_t ) );
+}
 
 /**
- * @brief Evaluate implementation calling of S_ISFIFO macro
- *
- * Requires data in global _eval_isfifo_data
- *
- * Function `.action` options:
+ * @brief Returns the number of times a wrapped function was called
  * 
- * + `ACTION_ERROR`   - (not a FIFO) Return 0
- * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
- * + `ACTION_SUCCESS` - (is a FIFO) Return 1
- * + `ACTION_DEFAULT` - Capture parameters and call `S_ISFIFO( mode )`
- *
- * @param mode  File mode from stat or fstat
- * @return      For action = 1 always returns true, for action = 0
- *              has the same behavior as the S_ISFIFO macro
+ * @param usage     Resource usage (e.g. &_eval_usage or &_eval_usage_total)
+ * @param name      Function name (e.g. "semop")
+ * @return int      Number of calls, -1 if function calls are not counted
  */
-int _eval_isfifo(mode_t mode) {
-    
-    _eval_isfifo_data.status ++;
-    _eval_isfifo_data.mode = mode;
+int eval_usage_calls( const eval_usage_t *usage, const char name[] ) {
+    for( int i = 0; i < EVAL_USAGE_NFUNCS; i++ ) {
+        if ( ! strcmp( eval_wrapper_name( _eval_usage_funcs[i] ), name ) ) return usage -> calls[i];
+    }
+    return -1;
+}
 
-    switch( _eval_isfifo_data.action ) {
-        case(ACTION_ERROR):
-            _eval_isfifo_data.ret = 0;
-            break;
-        case( ACTION_LOG ): //log
-            datalog("S_ISFIFO,%o", mode );
-        case(ACTION_SUCCESS):
-            _eval_isfifo_data.ret = 1;
-            break;
-        case(ACTION_BLOCK):
-            eval_error("S_ISFIFO() called, aborting");
-            siglongjmp(_eval_env.jmp, EVAL_CATCH_BLOCKED );
-            break;
-        default:
-            _eval_isfifo_data.ret = S_ISFIFO(mode);
+/**
+ * @brief Export accumulated resource usage
+ * 
+ * Prints the values in _eval_usage_total to screen, using the same format as
+ * question_export(). Only functions that were called are included.
+ * 
+ * @param msg   Message to print before / after the values
+ */
+void eval_usage_export( char msg[] ) {
+    const eval_usage_t *u = &_eval_usage_total;
+
+    printf("\n%s:usage\n", msg );
+    printf("wall:%.6f,utime:%.6f,stime:%.6f,maxrss:%ld,minflt:%ld,majflt:%ld,nvcsw:%ld,nivcsw:%ld",
+        u -> wall, u -> utime, u -> stime, u -> maxrss, 
+        u -> minflt, u -> majflt, u -> nvcsw, u -> nivcsw );
+    for( int i = 0; i < EVAL_USAGE_NFUNCS; i++ ) {
+        if ( u -> calls[i] > 0 ) printf(",%s:%d", eval_wrapper_name( _eval_usage_funcs[i] ), u -> calls[i] );
     }
-    return _eval_isfifo_data.ret;
+    printf("\n%s:end\n", msg );
 }
 
+/******************************************************************************
+ * Benchmarks
+ *****************************************************************************/
+
 /**
- * @brief Global _eval_remove_data variable for the remove() function
+ * @brief Results of the last EVAL_BENCH() macro
  * 
  */
-EVAL_VAR(remove);
+eval_bench_t _eval_bench = {
+    .warmup = EVAL_BENCH_WARMUP
+};
 
 /**
- * @brief Evaluate implementation calling of remove() function
- *
- * Requires data in global _eval_remove_data
- *
- * Function `.action` options:
+ * @brief Internal state of the EVAL_BENCH() macro
  * 
- * + `ACTION_ERROR`   - (error) Return -1 (EINVAL)
- * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
- *                      Note that the function call is logged as if the
- *                      corresponding `unlink()` function call was made.
- * + `ACTION_SUCCESS` - (success) Return 0
- * + `ACTION_DEFAULT` - Capture parameters and call `remove( path )`
- *
- * @param path      File name
- * @return int      0 on success, -1 on error
  */
-int _eval_remove(const char * path) {
-    _eval_remove_data.status ++;
+static struct {
+    double *samples;    // Measured times
+    int size;           // Size of samples buffer
+    int iter;           // Current iteration, including warmup
+    int total;          // Total number of iterations, including warmup
+    struct timespec t0; // Start of current iteration
+} _eval_bench_state;
 
-    int err = 0;
-    if ( eval_checkconstptr(path) ) {
-        eval_error("remove(path) invalid path");
-        _eval_remove_data.path[0] = 0;
-        err++;
-    } else {
-        strncpy( _eval_remove_data.path, path, PATH_MAX );
+/**
+ * @brief Prepares the EVAL_BENCH() macro
+ * 
+ * @param iterations    Number of measured iterations
+ */
+void _eval_bench_start( int iterations ) {
+    if ( iterations < 1 ) iterations = 1;
+    if ( _eval_bench.warmup < 0 ) _eval_bench.warmup = 0;
+
+    if ( _eval_bench_state.size < iterations ) {
+        double *samples = realloc( _eval_bench_state.samples, iterations * sizeof(double) );
+        if ( samples == NULL ) {
+            perror("_eval_bench_start: (*critical*) Unable to allocate samples buffer");
+            exit(1);
+        }
+        _eval_bench_state.samples = samples;
+        _eval_bench_state.size = iterations;
     }
 
-    _eval_remove_data.ret = 0;
+    _eval_bench.iterations = iterations;
+    _eval_bench.n = 0;
+    _eval_bench.noutliers = 0;
+    _eval_bench.min = _eval_bench.median = _eval_bench.p95 = _eval_bench.mean = 0;
 
-    switch( _eval_remove_data.action ) {
-    case(ACTION_ERROR): // error
-        _eval_remove_data.ret = -1;
-        errno = EINVAL;
-        break;
-    case( ACTION_LOG ): //log
-        // We use "unlink" deliberately
-        datalog("unlink,%s", _eval_remove_data.path );
-    case(ACTION_SUCCESS): // success
-        _eval_remove_data.ret = 0;
-        break;
-    case(ACTION_BLOCK):
-        eval_error("remove() called, aborting");
-        siglongjmp(_eval_env.jmp, EVAL_CATCH_BLOCKED );
-        break;
+    _eval_bench_state.iter = 0;
+    _eval_bench_state.total = _eval_bench.warmup + iterations;
+}
 
-    default:
-        if ( !err ) {
-            _eval_remove_data.ret = remove( path );
-        } else {
-            _eval_remove_data.ret = -1;
-            errno = EINVAL;
-        }
+/**
+ * @brief Records the time of the previous iteration and starts the next one
+ * 
+ * @return int  1 if another iteration should be run, 0 otherwise
+ */
+int _eval_bench_next( void ) {
+    struct timespec t1;
+    clock_gettime( CLOCK_MONOTONIC, &t1 );
+
+    if ( _eval_bench_state.iter > _eval_bench.warmup ) {
+        _eval_bench_state.samples[ _eval_bench.n++ ] = 
+            ( t1.tv_sec - _eval_bench_state.t0.tv_sec ) + 
+            1.e-9 * ( t1.tv_nsec - _eval_bench_state.t0.tv_nsec );
     }
-    return _eval_remove_data.ret;
+
+    if ( _eval_bench_state.iter >= _eval_bench_state.total ) return 0;
+    _eval_bench_state.iter++;
+
+    clock_gettime( CLOCK_MONOTONIC, &_eval_bench_state.t0 );
+    return 1;
 }
 
 /**
- * @brief Global _eval_unlink_data variable for the unlink() function
- * 
+ * @brief Comparison function for qsort()
  */
-EVAL_VAR(unlink);
+static int _eval_bench_cmp( const void *a, const void *b ) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return ( x > y ) - ( x < y );
+}
 
 /**
- * @brief Evaluate implementation calling of unlink() function
- *
- * Requires data in global _eval_unlink_data
- *
- *  Behavior:
- *    .action = 3 - Log call parameters and return 0 without calling unlink().
- *    .action = 2 - Return -1 without calling unlink()
- *    .action = 1 - Return 0 without calling unlink()
- *    default     - Call unlink()
- * 
- * @param path      File name
- * @return int      0 on success, -1 on error
+ * @brief Returns the p-th quantile (0 <= p <= 1) of a sorted array, using
+ * linear interpolation
  */
-int _eval_unlink(const char * path) {
-    _eval_unlink_data.status ++;
-    _eval_unlink_data.ret = 0;
+static double _eval_bench_quantile( const double *v, int n, double p ) {
+    double pos = p * ( n - 1 );
+    int i = floor( pos );
+    if ( i >= n - 1 ) return v[ n - 1 ];
+    return v[i] + ( pos - i ) * ( v[i+1] - v[i] );
+}
 
-    int err = 0;
-    if ( eval_checkconstptr(path) ) {
-        eval_error("unlink(path) invalid path");
-        _eval_unlink_data.path[0] = 0;
-        err++;
-    } else {
-        strncpy( _eval_unlink_data.path, path, PATH_MAX );
-    }
+/**
+ * @brief Computes the statistics of the EVAL_BENCH() macro
+ * 
+ * Samples outside [Q1 - 1.5 IQR, Q3 + 1.5 IQR] are considered outliers and
+ * rejected. Statistics are computed from any iterations completed, even if
+ * the code was interrupted (check _eval_env.stat).
+ */
+void _eval_bench_finish( void ) {
+    const int n = _eval_bench.n;
+    if ( n == 0 ) return;
+
+    double *v = _eval_bench_state.samples;
+    qsort( v, n, sizeof(double), _eval_bench_cmp );
+
+    // Outlier rejection
+    double q1 = _eval_bench_quantile( v, n, 0.25 );
+    double q3 = _eval_bench_quantile( v, n, 0.75 );
+    double lo = q1 - 1.5 * ( q3 - q1 );
+    double hi = q3 + 1.5 * ( q3 - q1 );
+
+    int first = 0, last = n;
+    while( first < last && v[first] < lo ) first++;
+    while( last > first && v[last-1] > hi ) last--;
+
+    const double *w = v + first;
+    const int m = last - first;
+
+    double sum = 0;
+    for( int i = 0; i < m; i++ ) sum += w[i];
+
+    _eval_bench.noutliers = n - m;
+    _eval_bench.min = w[0];
+    _eval_bench.median = _eval_bench_quantile( w, m, 0.5 );
+    _eval_bench.p95 = _eval_bench_quantile( w, m, 0.95 );
+    _eval_bench.mean = sum / m;
+}
 
-    switch( _eval_unlink_data.action ) {
-    case(ACTION_ERROR):
-        _eval_unlink_data.ret = -1;
-        errno = EINVAL;
-        break;
-    case(ACTION_LOG):
-        datalog("unlink,%s", _eval_unlink_data.path );
-    case(ACTION_SUCCESS):
-        _eval_unlink_data.ret = 0;
-        break;
-    case(ACTION_BLOCK):
-        eval_error("unlink() called, aborting");
-        siglongjmp(_eval_env.jmp, EVAL_CATCH_BLOCKED );
-        break;
+/**
+ * @brief Returns the speedup of a benchmark result relative to a reference,
+ * based on the median times
+ * 
+ * @param ref       Reference results (e.g. from a reference implementation)
+ * @param res       Results to evaluate
+ * @return double   Speedup (> 1 if res is faster than ref), 0 if not available
+ */
+double eval_bench_speedup( const eval_bench_t *ref, const eval_bench_t *res ) {
+    if ( ref -> n == 0 || res -> n == 0 || res -> median <= 0 ) return 0;
+    return ref -> median / res -> median;
+}
 
-    default:
-        if ( !err ) {
-            _eval_unlink_data.ret = unlink( path );
-        } else {
-            _eval_unlink_data.ret = -1;
-            errno = EINVAL;
-        }
-    }
-    return _eval_unlink_data.ret;
+/**
+ * @brief Prints benchmark results
+ * 
+ * @param res       Benchmark results
+ * @param msg       Message to print before the results
+ */
+void eval_bench_print( const eval_bench_t *res, const char msg[] ) {
+    eval_info( "%s: min %.3g s, median %.3g s, p95 %.3g s, mean %.3g s (%d/%d iterations, %d outliers)",
+        msg, res -> min, res -> median, res -> p95, res -> mean, 
+        res -> n, res -> iterations, res -> noutliers );
 }
 
+/******************************************************************************
+ * Parallel test runner
+ *****************************************************************************/
+
 /**
- * @brief Global _eval_atoi_data variable for the atoi() function
+ * @brief Global variable holding the registered test cases
  * 
  */
-EVAL_VAR(atoi);
+_eval_runner_type _eval_runner = {
+    .timeout = EVAL_RUNNER_TIMEOUT,
+    .current = -1
+};
 
 /**
- * @brief Evaluate implementation calling of atoi() function
- *
- * Requires data in global _eval_atoi_data
- *
- * The nptr pointer is checked before calling atoi(). On failure the value -1
- * is returned.
+ * @brief Registers a new test case for eval_run_parallel()
  * 
- * Function `.action` options:
+ * The test case function should set up and run its tests as usual, i.e.,
+ * calling eval_reset() and using the EVAL_CATCH* macros.
  * 
- * + `ACTION_ERROR`   - (error) Return INT32_MIN
- * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
- * + `ACTION_SUCCESS` - (success) Return previous `_eval_atoi_data.ret` value
- * + `ACTION_DEFAULT` - Capture parameters and call `atoi( nptr )`
+ * @param name      Test case name
+ * @param func      Test case function
+ * @return int      Test case index on success, -1 on error
+ */
+int eval_register_test( const char name[], eval_test_func_t func ) {
+
+    if ( func == NULL ) {
+        eval_error("(eval_register_test) Invalid test function for %s", name );
+        return -1;
+    }
+
+    if ( _eval_runner.ntests >= _eval_runner.size ) {
+        int size = ( _eval_runner.size > 0 ) ? 2 * _eval_runner.size : 16;
+        eval_test_t *tests = realloc( _eval_runner.tests, size * sizeof( eval_test_t ) );
+        if ( tests == NULL ) {
+            perror("eval_register_test: (*critical*) Unable to grow test list");
+            return -1;
+        }
+        _eval_runner.tests = tests;
+        _eval_runner.size = size;
+    }
+
+    eval_test_t *t = &_eval_runner.tests[ _eval_runner.ntests ];
+    memset( t, 0, sizeof( eval_test_t ) );
+    strncpy( t -> name, name, sizeof( t -> name ) - 1 );
+    t -> func = func;
+
+    return _eval_runner.ntests++;
+}
+
+/**
+ * @brief Removes all registered test cases
  * 
- * @param nptr      String to be converted to integer
- * @return int      Converted value
  */
-int _eval_atoi( const char *nptr ) {
-    _eval_atoi_data.status++;
+void eval_clear_tests( void ) {
+    free( _eval_runner.tests );
+    _eval_runner.tests = NULL;
+    _eval_runner.ntests = 0;
+    _eval_runner.size = 0;
+}
 
-    _eval_atoi_data.ret = -1;
+/**
+ * @brief Runs a single test case inside a worker process and stores results
+ *
+ * This function never returns.
+ * 
+ * @param idx       Test case index
+ * @param res       Result slot (in shared memory)
+ * @param outfd     Pipe used to send stdout to the parent process
+ */
+static void _eval_runner_worker( int idx, eval_test_t *res, int outfd ) {
 
-    int err = 0;
-    if ( ! eval_checkconstptr( nptr ) ) {
-        eval_error("atoi(nptr) called with invalid nptr");
-        _eval_atoi_data.nptr[0] = 0;
-        err++;
-    } else {
-        strncpy( _eval_atoi_data.nptr, nptr, 32 );
-        // atoi() is unsafe, we first check if the supplied string
-        // has a length of up to 32 characters
-        eval_error("atoi(nptr) called with invalid string");
-        err++;
+    if ( dup2( outfd, STDOUT_FILENO ) < 0 ) {
+        perror("_eval_runner_worker: Unable to redirect stdout");
+        _exit(1);
     }
+    close( outfd );
 
-    switch( _eval_atoi_data.action ) {
-    case( ACTION_ERROR ):
-        _eval_atoi_data.ret = INT32_MIN;
-        break;
-    case( ACTION_LOG ):
-        datalog("atoi,%s", _eval_atoi_data.nptr );
-    case( ACTION_SUCCESS ):
-        // Keep _eval_atoi_data.ret value
-        // _eval_atoi_data.ret;
-        break;
-    case(ACTION_BLOCK):
-        eval_error("atoi() called, aborting");
-        siglongjmp(_eval_env.jmp, EVAL_CATCH_BLOCKED );
-        break;
+    _eval_runner.current = idx;
+    _eval_runner.result = res;
 
-    default:
-        if ( ! err ) {
-            _eval_atoi_data.ret = atoi( nptr );
-        }  else {
-            _eval_atoi_data.ret = -1;
-        }
-    }
+    eval_reset_stats();
+    _eval_env.stat = 0;
+    _eval_env.signal = -1;
 
-    return _eval_atoi_data.ret;
+    res -> func();
+
+    fflush( stdout );
+
+    res -> stat = _eval_env.stat;
+    res -> signal = _eval_env.signal;
+    res -> exit_status = _eval_exit_data.status;
+    res -> stats = _eval_stats;
+    strncpy( res -> termination, eval_termination(), sizeof( res -> termination ) - 1 );
+    res -> completed = 1;
+
+    eval_report_flush();
+    _exit(0);
 }
 
 /**
- * @brief Global _eval_fclose_data variable for the fclose() function
+ * @brief Records a grade set inside a test case worker
  * 
+ * Called by question_setgrade() and eval_questions_setgrade(). Does nothing
+ * outside test case workers. Grades set again for the same key replace the
+ * previous value.
+ * 
+ * @param key       Question key
+ * @param grade     Grade
  */
-EVAL_VAR(fclose);
+void _eval_runner_grade( const char key[], float grade ) {
+    eval_test_t *res = _eval_runner.result;
+    if ( res == NULL ) return;
+
+    int n = ( res -> ngrades < EVAL_RUNNER_GRADES ) ? res -> ngrades : EVAL_RUNNER_GRADES;
+    for( int i = 0; i < n; i++ ) {
+        if ( ! strncmp( res -> grades[i].key, key, sizeof( res -> grades[i].key ) ) ) {
+            res -> grades[i].grade = grade;
+            return;
+        }
+    }
+
+    if ( res -> ngrades < EVAL_RUNNER_GRADES ) {
+        eval_grade_t *g = &res -> grades[ res -> ngrades ];
+        strncpy( g -> key, key, sizeof( g -> key ) - 1 );
+        g -> key[ sizeof( g -> key ) - 1 ] = 0;
+        g -> grade = grade;
+    }
+    res -> ngrades++;
+}
 
 /**
- * @brief Evaluate implementation calling of fclose() function
- *
- * Requires data in global _eval_fclose_data
- *
- * @param stream 
- * @return int      0 on success, < 0 on error
+ * @brief Applies the grades set by a test case to _eval_runner.questions
+ * 
+ * @param t         Test case results
  */
-int _eval_fclose( FILE* stream ) {
-    _eval_fclose_data.status++;
-    _eval_fclose_data.ret = -1;
-    _eval_fclose_data.stream = stream;
+static void _eval_runner_grades( const eval_test_t *t ) {
+    if ( _eval_runner.questions == NULL || t -> ngrades == 0 ) return;
 
-    switch( _eval_fclose_data.action ) {
+    int n = t -> ngrades;
+    if ( n > EVAL_RUNNER_GRADES ) {
+        eval_error("%s set %d grades, only the first %d were kept", t -> name, n, EVAL_RUNNER_GRADES );
+        n = EVAL_RUNNER_GRADES;
+    }
+    _eval_questions_update( _eval_runner.questions, t -> grades, n, 0 );
+}
 
-    case( ACTION_ERROR ): // error
-        _eval_fclose_data.ret = EOF;
-        errno = EINVAL;
-        break;
-    case(ACTION_LOG):
-        datalog("fclose,%p", stream );
-    case( ACTION_SUCCESS ): // success
-        _eval_fclose_data.ret = 0;
-        break;
-    case(ACTION_BLOCK):
-        eval_error("fclose() called, aborting");
-        siglongjmp(_eval_env.jmp, EVAL_CATCH_BLOCKED );
-        break;
+/**
+ * @brief Prints the output and results of a finished test case
+ * 
+ * @param t         Test case results
+ * @param out       Test case output
+ * @param len       Output size
+ * @param lost      Output bytes that were discarded
+ * @return int      1 if the test case failed, 0 otherwise
+ */
+static int _eval_runner_report( eval_test_t *t, const char *out, size_t len, size_t lost ) {
 
-    default:
-        _eval_fclose_data.ret = fclose(stream);
+    printf("\033[1;33m ⊢ \033[0m %s\n", t -> name );
+    if ( len > 0 ) {
+        fwrite( out, 1, len, stdout );
+        if ( out[ len - 1 ] != '\n' ) printf("\n");
+    }
+    if ( lost ) eval_error("%s output truncated, %zu byte(s) discarded (out of memory)", t -> name, lost );
+
+    int failed = 0;
+    if ( t -> timeout ) {
+        printf("\033[1;31m[✗]\033[0m %s worker killed after %g second(s)\n", t -> name, _eval_runner.timeout );
+        failed = 1;
+    } else if ( WIFSIGNALED( t -> wstatus ) ) {
+        printf("\033[1;31m[✗]\033[0m %s worker terminated by signal %d\n", t -> name, WTERMSIG( t -> wstatus ) );
+        failed = 1;
+    } else if ( ! t -> completed ) {
+        printf("\033[1;31m[✗]\033[0m %s worker terminated abnormally\n", t -> name );
+        failed = 1;
+    } else if ( t -> stats.error > 0 ) {
+        printf("\033[1;31m[✗]\033[0m %s completed with %d error(s), %s\n", t -> name, t -> stats.error, t -> termination );
+        failed = 1;
+    } else {
+        printf("\033[1;32m[✔]\033[0m %s completed with no errors, %s\n", t -> name, t -> termination );
     }
 
-    return _eval_fclose_data.ret;
+    t -> failed = failed;
+    return failed;
 }
 
 /**
- * @brief Global _eval_fread_data variable for the fread() function
+ * @brief Worker slot for eval_run_parallel()
  * 
  */
-EVAL_VAR(fread);
+typedef struct {
+    pid_t pid;
+    int idx;
+    int fd;
+    struct timespec start;
+    char *buffer;
+    size_t len;
+    size_t size;
+    size_t lost;        // Output discarded because the buffer could not grow
+} _eval_runner_slot_t;
 
 /**
- * @brief  Evaluate implementation calling of fread() function
- *
- * Requires data in global _eval_fread_data
+ * @brief Reads all output currently available from a worker
  * 
- * Function `.action` options:
+ * The pipe is always emptied, so the worker never blocks writing to it: if
+ * the output buffer cannot be grown the data is discarded and counted in
+ * slot -> lost. The pipe is closed on end of file or error.
  * 
- * + `ACTION_ERROR`   - (error) Return 0 (EINVAL)
- * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
- * + `ACTION_SUCCESS` - (success) Return `nmemb`
- * + `ACTION_DEFAULT` - Capture parameters and call `fread( ptr, size, nmemb, stream )`
+ * @param slot      Worker slot
+ */
+static void _eval_runner_drain( _eval_runner_slot_t *slot ) {
+    char discard[4096];
+
+    while ( slot -> fd >= 0 ) {
+        struct pollfd p = { .fd = slot -> fd, .events = POLLIN };
+        if ( poll( &p, 1, 0 ) <= 0 ) break;
+
+        if ( slot -> size - slot -> len < 4096 ) {
+            size_t size = ( slot -> size > 0 ) ? 2 * slot -> size : 16384;
+            char *buffer = realloc( slot -> buffer, size );
+            if ( buffer ) {
+                slot -> buffer = buffer;
+                slot -> size = size;
+            }
+        }
+
+        int keep = ( slot -> size - slot -> len >= 4096 );
+        ssize_t n = keep ? read( slot -> fd, slot -> buffer + slot -> len, slot -> size - slot -> len ) :
+                           read( slot -> fd, discard, sizeof( discard ) );
+        if ( n > 0 ) {
+            if ( keep ) slot -> len += n;
+            else slot -> lost += n;
+        } else if ( n == 0 || errno != EINTR ) {
+            close( slot -> fd );
+            slot -> fd = -1;
+        }
+    }
+}
+
+/**
+ * @brief Runs test cases using a pool of worker processes forked from the
+ * current process
  * 
- * @param ptr       Target memory location
- * @param size      Item size in bytes
- * @param nmemb     Number of items
- * @param stream    Stream to read data from
- * @return size_t   Number of items read
+ * @param njobs     Maximum number of simultaneous workers (1 .. ntests)
+ * @param results   Test cases / results (in shared memory)
+ * @param ntests    Number of test cases
+ * @return int      Number of test cases that failed, -1 on error
  */
-size_t _eval_fread(void *restrict ptr, size_t size, size_t nmemb,
-                    FILE *restrict stream) {
+static int _eval_runner_pool( int njobs, eval_test_t *results, int ntests ) {
 
-    _eval_fread_data.status++;
+    _eval_runner_slot_t *slots = calloc( njobs, sizeof( _eval_runner_slot_t ) );
+    struct pollfd *fds = calloc( njobs, sizeof( struct pollfd ) );
+    if ( slots == NULL || fds == NULL ) {
+        perror("eval_run_parallel: Unable to allocate worker slots" );
+        free( slots ); free( fds );
+        return -1;
+    }
+    for( int s = 0; s < njobs; s++ ) slots[s].pid = -1;
 
-    _eval_fread_data.ptr = ptr;
-    _eval_fread_data.size = size;
-    _eval_fread_data.nmemb = nmemb;
-    _eval_fread_data.stream = stream;
+    int next = 0, running = 0, failed = 0;
 
+    while( next < ntests || running > 0 ) {
 
-    // catch common errors
-    int err = 0;
-    if ( (void *) ptr == (void *) stream ) {
-        eval_error("fread(ptr,size,nmemb,stream) ptr must not have the same value as stream");
-        err++;
-    } else {
-        if ( eval_checkptr(ptr) ) {
-            eval_error("fread(ptr,size,nmemb,stream) invalid ptr (%p)", ptr);
-            err++;
+        // Start new workers on free slots
+        for( int s = 0; s < njobs && next < ntests; s++ ) {
+            if ( slots[s].pid >= 0 ) continue;
+
+            int pfd[2];
+            if ( pipe( pfd ) < 0 ) {
+                perror("eval_run_parallel: Unable to create pipe");
+                break;
+            }
+
+            // Avoid duplicating buffered output in the worker
+            fflush( stdout );
+            fflush( stderr );
+            eval_report_flush();
+
+            pid_t pid = fork();
+            if ( pid < 0 ) {
+                perror("eval_run_parallel: Unable to fork worker");
+                close( pfd[0] ); close( pfd[1] );
+                break;
+            }
+
+            if ( pid == 0 ) {
+                close( pfd[0] );
+                for( int k = 0; k < njobs; k++ )
+                    if ( slots[k].pid >= 0 ) close( slots[k].fd );
+                _eval_runner_worker( next, &results[next], pfd[1] );
+            }
+
+            close( pfd[1] );
+            slots[s].pid = pid;
+            slots[s].idx = next;
+            slots[s].fd = pfd[0];
+            slots[s].len = 0;
+            slots[s].lost = 0;
+            clock_gettime( CLOCK_MONOTONIC, &slots[s].start );
+            next++;
+            running++;
         }
 
-        if ( eval_checkptr(stream) ) {
-            eval_error("fread(ptr,size,nmemb,stream) invalid stream (%p)", stream);
-            err++;
+        if ( running == 0 ) {
+            // Unable to start any worker
+            failed = -1;
+            break;
         }
-    }
 
-    if ( size * nmemb <= 0  ) {
-        eval_error("fread(ptr,size,nmemb,stream) invalid size or nmemb");
-        err++;
-    }
+        // Wait for worker output / termination
+        int nfds = 0;
+        for( int s = 0; s < njobs; s++ ) {
+            if ( slots[s].pid >= 0 && slots[s].fd >= 0 ) {
+                fds[nfds].fd = slots[s].fd;
+                fds[nfds].events = POLLIN;
+                fds[nfds].revents = 0;
+                nfds++;
+            }
+        }
 
-    _eval_fread_data.ret = 0;
-        
-    switch( _eval_fread_data.action ) {
+        // Check for timeouts / reaped workers at least every 100 ms
+        if ( poll( fds, nfds, 100 ) < 0 && errno != EINTR ) {
+            perror("eval_run_parallel: poll() failed");
+        }
 
-    case( ACTION_ERROR ):
-        _eval_fread_data.ret = 0;
-        errno = EINVAL;
-        break;
-    case( ACTION_LOG ):
-        datalog("fread,%p,%ld,%ld,%p", ptr, size, nmemb, stream );
-    case( ACTION_SUCCESS ):
-        _eval_fread_data.ret = nmemb;
-        break;
+        for( int s = 0; s < njobs; s++ ) {
+            _eval_runner_slot_t *slot = &slots[s];
+            if ( slot -> pid < 0 ) continue;
+
+            // Drain worker output
+            _eval_runner_drain( slot );
+
+            eval_test_t *t = &results[ slot -> idx ];
+            int wstatus = 0;
+            pid_t w = waitpid( slot -> pid, &wstatus, WNOHANG );
+
+            if ( w == 0 ) {
+                if ( _eval_runner.timeout > 0 &&
+                     _eval_elapsed( CLOCK_MONOTONIC, &slot -> start ) > _eval_runner.timeout ) {
+                    kill( slot -> pid, SIGKILL );
+                    waitpid( slot -> pid, &wstatus, 0 );
+                    t -> timeout = 1;
+                } else {
+                    continue;
+                }
+            }
 
-    case(ACTION_BLOCK):
-        eval_error("fread() called, aborting");
-        siglongjmp(_eval_env.jmp, EVAL_CATCH_BLOCKED );
-        break;
+            // Worker finished, collect output written since the last drain
+            _eval_runner_drain( slot );
+            if ( slot -> fd >= 0 ) {
+                // Output pipe may still be held open by a child of the worker
+                close( slot -> fd );
+                slot -> fd = -1;
+            }
+            t -> wstatus = wstatus;
+            t -> wall_time = _eval_elapsed( CLOCK_MONOTONIC, &slot -> start );
 
-    default:
-        if ( ! err ) {
-            _eval_fread_data.ret = fread( ptr, size, nmemb, stream );
-        } else {
-            _eval_fread_data.ret = 0;
-            errno = EINVAL;
+            failed += _eval_runner_report( t, slot -> buffer, slot -> len, slot -> lost );
+            _eval_report_test( t );
+
+            slot -> pid = -1;
+            running--;
         }
     }
 
-    return _eval_fread_data.ret;
+    for( int s = 0; s < njobs; s++ ) free( slots[s].buffer );
+    free( slots );
+    free( fds );
 
+    return failed;
 }
 
 /**
- * @brief Global _eval_fwrite_data variable for the fwrite() function
+ * @brief Allocates shared memory for test case results
  * 
+ * @param njobs     Requested number of workers, updated to the number of
+ *                  workers used
+ * @return          Pointer to results or NULL on error
  */
-EVAL_VAR(fwrite);
+static eval_test_t * _eval_runner_open( int *njobs, const char *caller ) {
+
+    const int ntests = _eval_runner.ntests;
+
+    if ( *njobs <= 0 ) {
+        long ncpu = sysconf( _SC_NPROCESSORS_ONLN );
+        *njobs = ( ncpu > 0 ) ? ncpu : 1;
+    }
+    if ( *njobs > ntests ) *njobs = ntests;
+
+    // Test results are written by the workers directly to shared memory
+    size_t bytes = ntests * sizeof( eval_test_t );
+    eval_test_t *results = mmap( NULL, bytes, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_ANONYMOUS, -1, 0 );
+    if ( results == MAP_FAILED ) {
+        fprintf( stderr, "%s: ", caller );
+        perror("Unable to allocate shared memory for results");
+        return NULL;
+    }
+    // Clear results from previous runs
+    for( int i = 0; i < ntests; i++ ) {
+        memset( &results[i], 0, sizeof( eval_test_t ) );
+        memcpy( results[i].name, _eval_runner.tests[i].name, sizeof( results[i].name ) );
+        results[i].func = _eval_runner.tests[i].func;
+    }
+
+    return results;
+}
 
 /**
- * @brief  Evaluate implementation calling of fwrite() function
- *
- * Requires data in global _eval_fwrite_data
- * 
- * Function `.action` options:
- * 
- * + `ACTION_ERROR`   - (error) Return 0 (EINVAL)
- * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
- * + `ACTION_SUCCESS` - (success) Return `nmemb`
- * + `ACTION_DEFAULT` - Capture parameters and call `fwrite( ptr, size, nmemb, stream )`
+ * @brief Copies test case results back to _eval_runner.tests[], adds the
+ * per test case _eval_stats to the _eval_stats of the calling process,
+ * applies the grades set by the test cases to _eval_runner.questions and
+ * frees the shared memory
  * 
- * @param ptr       Source memory location
- * @param size      Item size in bytes
- * @param nmemb     Number of items
- * @param stream    Stream to write data to
- * @return size_t   Number of items written
+ * @param results   Test case results (in shared memory)
+ * @return int      Number of test cases that failed
  */
-size_t _eval_fwrite(const void *ptr, size_t size, size_t nmemb,
-                     FILE *stream) {
+static int _eval_runner_close( eval_test_t *results ) {
+
+    const int ntests = _eval_runner.ntests;
+    size_t bytes = ntests * sizeof( eval_test_t );
+
+    int failed = 0;
+    for( int i = 0; i < ntests; i++ ) {
+        failed += results[i].failed;
+        _eval_stats.error += results[i].stats.error;
+        _eval_stats.info += results[i].stats.info;
+        _eval_stats.success += results[i].stats.success;
+        _eval_runner_grades( &results[i] );
+    }
 
-    _eval_fwrite_data.status++;
-    _eval_fwrite_data.ptr = (void *) ptr;
-    _eval_fwrite_data.size = size;
-    _eval_fwrite_data.nmemb = nmemb;
-    _eval_fwrite_data.stream = stream;
+    memcpy( _eval_runner.tests, results, bytes );
+    munmap( results, bytes );
 
+    printf("\nTotal number of test cases: %d, %d failed\n\n", ntests, failed );
 
-    // catch common errors
-    int err = 0;
-    if ( (void *) ptr == (void *) stream ) {
-        eval_error("fwrite(ptr,size,nmemb,stream) ptr must not have the same value as stream");
-        err++;
-    } else {
-        if ( eval_checkptr(_eval_fwrite_data.ptr) ) {
-            eval_error("fwrite(ptr,size,nmemb,stream) invalid ptr (%p)", ptr);
-            err++;
-        }
+    return failed;
+}
 
-        if ( eval_checkptr(stream) ) {
-            eval_error("fwrite(ptr,size,nmemb,stream) invalid stream (%p)", stream);
-            err++;
-        }
-    }
+/**
+ * @brief Runs all registered test cases using a pool of worker processes
+ *
+ * Each test case runs in a separate (forked) worker process, so crashes,
+ * hangs or globals modified by one test case do not affect the others. At
+ * most njobs workers run simultaneously and a new test case is started as
+ * soon as a worker finishes.
+ *
+ * The stdout output of each test case is collected and printed, together
+ * with the test case results, once the test case finishes. The results
+ * (_eval_env.stat, eval_termination() and _eval_stats) are stored in
+ * _eval_runner.tests[], and the per test case _eval_stats are added to the
+ * _eval_stats of the calling process.
+ * 
+ * @param njobs     Maximum number of simultaneous workers. If <= 0, use the
+ *                  number of online processors
+ * @return int      Number of test cases that failed, -1 on error
+ */
+int eval_run_parallel( int njobs ) {
 
-    if ( size * nmemb <= 0  ) {
-        eval_error("fwrite(ptr,size,nmemb,stream) invalid size or nmemb");
-        err++;
-    }
+    if ( _eval_runner.ntests == 0 ) return 0;
 
-    _eval_fwrite_data.ret = 0;
-        
-    switch( _eval_fwrite_data.action ) {
+    eval_test_t *results = _eval_runner_open( &njobs, "eval_run_parallel" );
+    if ( results == NULL ) return -1;
 
-    case( ACTION_ERROR ):
-        _eval_fwrite_data.ret = 0;
-        errno = EINVAL;
-        break;
-    case( ACTION_LOG ):
-        datalog("fwrite,%p,%ld,%ld,%p", ptr, size, nmemb, stream );
-    case( ACTION_SUCCESS ):
-        _eval_fwrite_data.ret = nmemb;
-        break;
+    int ret = _eval_runner_pool( njobs, results, _eval_runner.ntests );
+    int failed = _eval_runner_close( results );
+
+    return ( ret < 0 ) ? -1 : failed;
+}
+
+/**
+ * @brief Runs all registered test cases from a pre-initialized process image
+ *
+ * A template process is forked from the calling process and runs the setup
+ * function once (e.g. creating fixture files, lock files, or initializing
+ * data structures). Each test case is then run in a worker forked from the
+ * template, so every test case starts from the same (copy-on-write) state,
+ * including the globals and statics of the code being tested, without
+ * repeating the setup. The calling process is not affected by the setup.
+ *
+ * Test case output and results are handled as in eval_run_parallel().
+ * 
+ * @param setup     Setup function, returns 0 on success. May be NULL.
+ * @param njobs     Maximum number of simultaneous workers. If <= 0, use the
+ *                  number of online processors
+ * @return int      Number of test cases that failed, -1 on error
+ */
+int eval_run_forkserver( eval_setup_func_t setup, int njobs ) {
+
+    if ( _eval_runner.ntests == 0 ) return 0;
+
+    eval_test_t *results = _eval_runner_open( &njobs, "eval_run_forkserver" );
+    if ( results == NULL ) return -1;
 
-    case(ACTION_BLOCK):
-        eval_error("fwrite() called, aborting");
-        siglongjmp(_eval_env.jmp, EVAL_CATCH_BLOCKED );
-        break;
+    fflush( stdout );
+    fflush( stderr );
+    eval_report_flush();
 
-    default:
-        if ( ! err ) {
-            _eval_fwrite_data.ret = fwrite( ptr, size, nmemb, stream );
+    pid_t pid = fork();
+    if ( pid < 0 ) {
+        perror("eval_run_forkserver: Unable to fork template process");
+        munmap( results, _eval_runner.ntests * sizeof( eval_test_t ) );
+        return -1;
+    }
+
+    if ( pid == 0 ) {
+        // Template process
+        if ( setup ) {
+            eval_reset_stats();
+            int ret = setup();
+            fflush( stdout );
+            if ( ret || _eval_stats.error > 0 ) {
+                printf("\033[1;31m[✗]\033[0m fork server setup failed\n");
+                fflush( stdout );
+                eval_report_flush();
+                _exit( 2 );
+            }
+        }
+
+        int ret = _eval_runner_pool( njobs, results, _eval_runner.ntests );
+        fflush( stdout );
+        eval_report_flush();
+        _exit( ( ret < 0 ) ? 1 : 0 );
+    }
+
+    int wstatus = 0;
+    while( waitpid( pid, &wstatus, 0 ) < 0 ) {
+        if ( errno != EINTR ) {
+            perror("eval_run_forkserver: waitpid() failed");
+            break;
+        }
+    }
+
+    int ok = WIFEXITED( wstatus ) && WEXITSTATUS( wstatus ) == 0;
+    if ( ! ok ) {
+        if ( WIFSIGNALED( wstatus ) ) {
+            eval_error("Fork server terminated by signal %d", WTERMSIG( wstatus ) );
+        } else if ( WIFEXITED( wstatus ) && WEXITSTATUS( wstatus ) == 2 ) {
+            eval_error("Fork server setup failed, no test cases were run");
         } else {
-            _eval_fwrite_data.ret = 0;
-            errno = EINVAL;
+            eval_error("Fork server terminated abnormally");
         }
     }
 
-    return _eval_fwrite_data.ret;
+    int failed = _eval_runner_close( results );
+    return ( ok ) ? failed : -1;
 }
 
+/******************************************************************************
+ * Batch submission driver
+ *****************************************************************************/
+
 /**
- * @brief Global _eval_fseek_data variable for the fseek() function
+ * @brief Global variable holding the submission being tested by eval_batch_run()
  * 
  */
-EVAL_VAR(fseek);
+_eval_batch_type _eval_batch = {
+    .current = -1
+};
 
 /**
- * @brief Evaluate implementation calling of fseek() function
- *
- * Requires data in global _eval_fseek_data
- * 
- * Function `.action` options:
+ * @brief Binds symbols from a loaded submission
  * 
- * + `ACTION_ERROR`   - (error) Return -1 (EINVAL)
- * + `ACTION_LOG`     - (log) Log function call and proceed with `ACTION_SUCCESS`.
- * + `ACTION_SUCCESS` - (success) Return 0
- * + `ACTION_DEFAULT` - Capture parameters and call `fseek( stream, offset, whence )`
+ * Sets the variable pointed to by the .addr field of each entry to the
+ * address of the corresponding symbol. Variables for symbols that are not
+ * found are set to NULL.
  * 
- * @param stream 
- * @param offset 
- * @param whence 
- * @return int 
+ * @param handle    Handle returned by dlopen()
+ * @param binds     Symbols to bind, terminated by an entry with .name = NULL
+ *                  (EVAL_BIND_END)
+ * @return int      Number of required symbols not found, -1 on error
  */
-int _eval_fseek(FILE *stream, long offset, int whence) {
+int eval_bind( void *handle, eval_bind_t binds[] ) {
+    if ( handle == NULL || binds == NULL ) {
+        eval_error("(eval_bind) Invalid parameters");
+        return -1;
+    }
 
-    _eval_fseek_data.status++;
-    _eval_fseek_data.stream = stream;
-    _eval_fseek_data.offset = offset;
-    _eval_fseek_data.whence = whence;
+    int missing = 0;
+    for( int i = 0; binds[i].name; i++ ) {
+        dlerror();
+        void *addr = dlsym( handle, binds[i].name );
+        if ( dlerror() != NULL ) addr = NULL;
 
-    // catch common errors
-    int err = 0;
-    if ( eval_checkptr( stream ) ) {
-        eval_error("fseek(stream, offset, whence) invalid stream");
-        err ++;
+        if ( binds[i].addr ) *binds[i].addr = addr;
+        if ( addr == NULL && ! binds[i].optional ) {
+            eval_error("Symbol %s not found", binds[i].name );
+            missing++;
+        }
     }
+    return missing;
+}
 
-    switch( whence ) {
-    case(SEEK_SET):
-    case(SEEK_CUR):
-    case(SEEK_END):
-        break;
-    default: 
-        eval_error("fseek(stream, offset, whence) invalid value for whence");
-        err ++;
+/**
+ * @brief Clears the variables set by eval_bind()
+ * 
+ * Calling a function through a cleared variable raises SIGSEGV (caught by the
+ * EVAL_CATCH* macros) instead of running code from an unloaded submission.
+ * 
+ * @param binds     Symbols to unbind, terminated by an entry with .name = NULL
+ */
+void eval_unbind( eval_bind_t binds[] ) {
+    if ( binds == NULL ) return;
+    for( int i = 0; binds[i].name; i++ ) {
+        if ( binds[i].addr ) *binds[i].addr = NULL;
     }
+}
 
-    _eval_fseek_data.ret = -1;
-    switch( _eval_fseek_data.action ) {
+/**
+ * @brief Runs the registered test cases on a batch of submissions
+ * 
+ * Each submission is a shared object built from the student code (including
+ * eval.h), e.g. `gcc -shared -fPIC -include eval.h student.c -o student.so`.
+ * Submissions are loaded in turn with dlopen(), the symbols under test are
+ * bound with eval_bind(), the wrappers are reset with eval_reset() and all
+ * registered test cases are run with eval_run_parallel(), so every test case
+ * runs in a worker forked from the process with the submission freshly
+ * loaded. The submission is then unloaded.
+ * 
+ * The harness must be linked with -rdynamic, so the wrappers used by the
+ * submissions resolve to the eval core of the harness.
+ * 
+ * @param paths     Paths of the submissions (shared objects)
+ * @param n         Number of submissions
+ * @param binds     Symbols to bind, terminated by an entry with .name = NULL
+ * @param njobs     Maximum number of simultaneous workers. If <= 0, use the
+ *                  number of online processors
+ * @param results   Submission results, may be NULL
+ * @return int      Number of submissions that failed to load, or with failed
+ *                  test cases, -1 on error
+ */
+int eval_batch_run( const char *paths[], int n, eval_bind_t binds[], int njobs,
+    eval_submission_t results[] ) {
 
-    case( ACTION_ERROR ): // error
-        _eval_fseek_data.ret = -1;
-        errno = EINVAL;
-        break;
-    case( ACTION_LOG ):
-        datalog("fseek,%p,%ld,%p", stream, offset, whence );
-    case( ACTION_SUCCESS ): // success
-        _eval_fseek_data.ret = 0;
-        break;
+    if ( paths == NULL || binds == NULL || n < 0 ) {
+        eval_error("(eval_batch_run) Invalid parameters");
+        return -1;
+    }
 
-    case(ACTION_BLOCK):
-        eval_error("fseek() called, aborting");
-        siglongjmp(_eval_env.jmp, EVAL_CATCH_BLOCKED );
-        break;
+    int failed = 0;
+    for( int i = 0; i < n; i++ ) {
+        eval_submission_t sub;
+        memset( &sub, 0, sizeof( sub ) );
+        strncpy( sub.path, paths[i], sizeof( sub.path ) - 1 );
 
-    default:
-        if ( !err ) {
-            _eval_fseek_data.ret = fseek( stream, offset, whence );
+        printf("\n\033[1;33m ⊢ \033[0m Submission %s\n", paths[i] );
+        eval_stats_t stats = _eval_stats;
+
+        void *handle = dlopen( paths[i], RTLD_NOW | RTLD_LOCAL );
+        if ( handle == NULL ) {
+            eval_error("Unable to load %s: %s", paths[i], dlerror() );
         } else {
-            _eval_fseek_data.ret = -1;
-            errno = EINVAL;
+            sub.missing = eval_bind( handle, binds );
+            if ( sub.missing == 0 ) {
+                sub.loaded = 1;
+                _eval_batch.current = i;
+                _eval_batch.path = paths[i];
+                _eval_batch.handle = handle;
+
+                eval_reset();
+                int ret = eval_run_parallel( njobs );
+                sub.ntests = _eval_runner.ntests;
+                sub.failed = ( ret < 0 ) ? sub.ntests : ret;
+
+                _eval_batch.current = -1;
+                _eval_batch.path = NULL;
+                _eval_batch.handle = NULL;
+            }
+            eval_unbind( binds );
+            dlclose( handle );
+        }
+
+        sub.stats.error = _eval_stats.error - stats.error;
+        sub.stats.info = _eval_stats.info - stats.info;
+        sub.stats.success = _eval_stats.success - stats.success;
+
+        if ( ! sub.loaded || sub.failed > 0 ) {
+            printf("\033[1;31m[✗]\033[0m %s: ", paths[i] );
+            if ( ! sub.loaded ) printf("not tested\n");
+            else printf("%d of %d test case(s) failed\n", sub.failed, sub.ntests );
+            failed++;
+        } else {
+            printf("\033[1;32m[✔]\033[0m %s: %d test case(s) passed\n", paths[i], sub.ntests );
         }
+
+        _eval_report_submission( &sub );
+        if ( results ) results[i] = sub;
     }
-    return _eval_fseek_data.ret;
+
+    return failed;
 }
 
+/******************************************************************************
+ * Property-based testing
+ *****************************************************************************/
+
 /**
- * @brief Global _eval_execl_data variable for the execl() function
+ * @brief Global variable holding the settings and results of eval_prop_check()
  * 
  */
-EVAL_VAR(execl);
+_eval_prop_type _eval_prop = {
+    .seed = 0,
+    .maxsize = EVAL_PROP_MAXSIZE,
+    .maxshrink = EVAL_PROP_SHRINK
+};
 
 /**
- * @brief Evaluate implementation calling of execl() function
- *
- * Requires data in global _eval_execl_data
- *
- * The default settings implemented by the eval_reset() function will prevent
- * the execl() function from being called, instead issuing an error and
- * terminating the code.
- *
- * The function can be made to call `execl()` by setting `.action = 0` but
- * unless the call fails this will replace the current process with a new one.
- * Unless a new process was forked before this happens, this will of course
- * stop the execution of the current process.
+ * @brief splitmix64 mixing function
  * 
- * @param path      Path to the binary being called
- * @param ...       Additional parameter to the binary being calledf
- * @return int      -1 on error. The function does not return on success.
+ * @param x         Value to mix
+ * @return uint64_t Mixed value
  */
-int _eval_execl(const char *path, ... ) {
+static uint64_t _eval_prop_mix( uint64_t x ) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = ( x ^ ( x >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+    x = ( x ^ ( x >> 27 ) ) * 0x94D049BB133111EBULL;
+    return x ^ ( x >> 31 );
+}
 
-    _eval_execl_data.status ++;
+/**
+ * @brief Returns a pseudo-random number from the property test generator
+ * 
+ * The sequence is fully determined by the seed of the test case being
+ * generated, so generators must use only this function (or
+ * eval_prop_range()) as a source of randomness.
+ * 
+ * @return uint64_t     Pseudo-random number
+ */
+uint64_t eval_prop_rand( void ) {
+    _eval_prop.rng += 0x9E3779B97F4A7C15ULL;
+    return _eval_prop_mix( _eval_prop.rng );
+}
 
-    int err = 0;
-    if ( eval_checkconstptr( path ) ) {
-        eval_error("execl(path, ...) invalid path");
-        _eval_execl_data.path[0] = 0;
-        err++ ;
-    } else {
-        strncpy( _eval_execl_data.path, path, PATH_MAX );
+/**
+ * @brief Returns a pseudo-random number in the range [lo, hi]
+ * 
+ * @param lo        Lower limit
+ * @param hi        Upper limit
+ * @return long     Pseudo-random number
+ */
+long eval_prop_range( long lo, long hi ) {
+    if ( hi < lo ) {
+        long tmp = lo; lo = hi; hi = tmp;
     }
+    uint64_t span = (uint64_t) hi - (uint64_t) lo + 1;
+    uint64_t r = eval_prop_rand();
+    if ( span ) r %= span;
+    return (long) ( (uint64_t) lo + r );
+}
 
-    switch( _eval_execl_data.action ) {
+/**
+ * @brief Appends data to the stdin of a test case
+ * 
+ * The data is kept '\0' terminated.
+ * 
+ * @param c         Test case
+ * @param data      Data to append, NULL to only reserve len bytes (left
+ *                  uninitialized)
+ * @param len       Data size
+ * @return int      0 on success, -1 on error
+ */
+int eval_prop_write( eval_prop_case_t *c, const void *data, size_t len ) {
+    if ( c -> inlen + len + 1 > c -> insize ) {
+        size_t size = ( c -> insize ) ? c -> insize : 256;
+        while( size < c -> inlen + len + 1 ) size *= 2;
+        char *in = realloc( c -> in, size );
+        if ( in == NULL ) {
+            eval_error("(eval_prop_write) Unable to allocate memory");
+            return -1;
+        }
+        c -> in = in;
+        c -> insize = size;
+    }
+    if ( len && data ) memcpy( c -> in + c -> inlen, data, len );
+    c -> inlen += len;
+    c -> in[ c -> inlen ] = 0;
+    return 0;
+}
 
-    
-    case( ACTION_LOG ):
-        datalog("execl,%s", _eval_execl_data.path );
-    case(ACTION_ERROR):
-        _eval_execl_data.ret = -1;
-        break;
+/**
+ * @brief Appends formatted text to the stdin of a test case
+ * 
+ * @param c         Test case
+ * @param format    printf() style format
+ * @param ...       Format arguments
+ * @return int      Number of characters written, -1 on error
+ */
+int eval_prop_printf( eval_prop_case_t *c, const char *restrict format, ... ) {
+    char buffer[256];
+    va_list args;
 
-    case(ACTION_BLOCK):
-        eval_error("execl() called, aborting");
-        _eval_execl_data.ret = -1;
-        siglongjmp(_eval_env.jmp, EVAL_CATCH_BLOCKED );
-        break;
+    va_start( args, format );
+    int n = vsnprintf( buffer, sizeof( buffer ), format, args );
+    va_end( args );
+    if ( n < 0 ) return -1;
 
-    default:
-        if ( ! err ) {
-            va_list args;
-            va_start( args, path );
-            _eval_execl_data.ret = execv( path, (char **)args );
-            va_end( args );
-        } else {
-            _eval_execl_data.ret = -1;
-        }
+    if ( (size_t) n < sizeof( buffer ) ) {
+        if ( eval_prop_write( c, buffer, n ) ) return -1;
+    } else {
+        // Reserve space and format in place
+        if ( eval_prop_write( c, NULL, n ) ) return -1;
+        va_start( args, format );
+        vsnprintf( c -> in + c -> inlen - n, n + 1, format, args );
+        va_end( args );
     }
-    return _eval_execl_data.ret;
+    return n;
 }
 
 /**
- * @brief Sets all _eval_*_data variables to 0
- *
- * This resets the status counter and sets the default action for all functions.
- *
- * It also sets the default timeout behavior.
+ * @brief Releases the memory used by a test case
  * 
+ * @param c         Test case
  */
-void eval_reset_vars( void ) {
+static void _eval_prop_free( eval_prop_case_t *c ) {
+    free( c -> in );
+    memset( c, 0, sizeof( *c ) );
+}
 
-    // To disable timeout by default compile with -DEVAL_TIMEOUT=0
-    _eval_env.timeout = EVAL_TIMEOUT;
+/**
+ * @brief Copies a test case
+ * 
+ * @param dst       Destination, with memory previously used released
+ * @param src       Source
+ * @return int      0 on success, -1 on error
+ */
+static int _eval_prop_copy( eval_prop_case_t *dst, const eval_prop_case_t *src ) {
+    _eval_prop_free( dst );
+    memcpy( dst -> arg, src -> arg, sizeof( dst -> arg ) );
+    dst -> narg = src -> narg;
+    if ( src -> in ) return eval_prop_write( dst, src -> in, src -> inlen );
+    return 0;
+}
+
+typedef struct {
+    eval_prop_gen_t gen;
+    eval_prop_run_t run;
+    eval_prop_oracle_t oracle;
+    int budget;             // Test runs left for shrinking
+} _eval_prop_ctx_t;
+
+/**
+ * @brief Generates a test case
+ * 
+ * @param ctx       Property test context
+ * @param c         (out) Test case, with memory previously used released
+ * @param seed      Test case seed
+ * @param size      Size parameter
+ */
+static void _eval_prop_gen( _eval_prop_ctx_t *ctx, eval_prop_case_t *c, uint64_t seed, int size ) {
+    _eval_prop_free( c );
+    _eval_prop.rng = seed;
+    ctx -> gen( c, size );
+    if ( c -> narg > EVAL_PROP_NARGS ) c -> narg = EVAL_PROP_NARGS;
+    if ( c -> narg < 0 ) c -> narg = 0;
+}
+
+/**
+ * @brief Runs a test case inside EVAL_CATCH_MEMIO() and checks the property
+ * 
+ * Without an oracle, the property holds if the code terminates normally.
+ * 
+ * @param ctx       Property test context
+ * @param c         Test case
+ * @return int      1 if the property holds, 0 otherwise
+ */
+static int _eval_prop_holds( _eval_prop_ctx_t *ctx, const eval_prop_case_t *c ) {
+    // Always redirect stdin, so that code reading it does not block
+    EVAL_CATCH_MEMIO( ctx -> run( c ), ( c -> in ) ? c -> in : "", c -> inlen );
+    if ( ctx -> oracle ) return ctx -> oracle( c ) != 0;
+    return _eval_env.stat == 0;
+}
 
-    RESET_VAR(exit);
-    RESET_VAR(abort);
+/**
+ * @brief Checks if a candidate test case still fails, while shrinking
+ * 
+ * If so, the candidate replaces the minimal failing test case.
+ * 
+ * @param ctx       Property test context
+ * @param cand      Candidate test case
+ * @return int      1 if the candidate was accepted, 0 otherwise
+ */
+static int _eval_prop_try( _eval_prop_ctx_t *ctx, eval_prop_case_t *cand ) {
+    if ( ctx -> budget <= 0 ) return 0;
+    ctx -> budget--;
+    if ( _eval_prop_holds( ctx, cand ) ) return 0;
+
+    // Swap buffers, the old minimal case is reused for the next candidate
+    eval_prop_case_t tmp = _eval_prop.min;
+    _eval_prop.min = *cand;
+    *cand = tmp;
+    strncpy( _eval_prop.termination, eval_termination(), sizeof( _eval_prop.termination ) - 1 );
+    _eval_prop.nshrink++;
+    return 1;
+}
 
-    RESET_VAR(sleep);
+/**
+ * @brief Tries to remove the [pos, pos+len[ range from the minimal case stdin
+ * 
+ * @param ctx       Property test context
+ * @param cand      Buffer for candidate test case
+ * @param pos       Start of range
+ * @param len       Range size
+ * @return int      1 if the range was removed, 0 otherwise
+ */
+static int _eval_prop_try_cut( _eval_prop_ctx_t *ctx, eval_prop_case_t *cand, size_t pos, size_t len ) {
+    const eval_prop_case_t *min = &_eval_prop.min;
 
-    RESET_VAR(fork);
-    RESET_VAR(wait);
-    RESET_VAR(waitpid);
+    _eval_prop_free( cand );
+    memcpy( cand -> arg, min -> arg, sizeof( cand -> arg ) );
+    cand -> narg = min -> narg;
+    if ( eval_prop_write( cand, min -> in, pos ) ||
+         eval_prop_write( cand, min -> in + pos + len, min -> inlen - pos - len ) ) return 0;
 
-    RESET_VAR(kill);
-    RESET_VAR(raise);
-    RESET_VAR(signal);
-    RESET_VAR(sigaction);
-    RESET_VAR(pause);
-    RESET_VAR(alarm);
+    return _eval_prop_try( ctx, cand );
+}
 
-    RESET_VAR(msgget);
-    RESET_VAR(msgsnd);
-    RESET_VAR(msgrcv);
-    RESET_VAR(msgctl);
+/**
+ * @brief Shrinks the minimal failing test case
+ * 
+ * Tries, in order, regenerating the test case with smaller sizes, removing
+ * lines and then byte ranges from stdin and moving arguments towards 0,
+ * keeping each change for which the property still fails. Stops when no
+ * change succeeds or the shrinking budget is exhausted.
+ * 
+ * @param ctx       Property test context
+ */
+static void _eval_prop_shrink( _eval_prop_ctx_t *ctx ) {
+    eval_prop_case_t cand;
+    memset( &cand, 0, sizeof( cand ) );
+
+    // Smaller sizes using the same seed
+    for( int size = 0; size < _eval_prop.size && ctx -> budget > 0; size++ ) {
+        _eval_prop_gen( ctx, &cand, _eval_prop.case_seed, size );
+        if ( _eval_prop_try( ctx, &cand ) ) {
+            _eval_prop.size = size;
+            break;
+        }
+    }
 
-    RESET_VAR(semget);
-    RESET_VAR(semctl);
-    RESET_VAR(semop);
+    int progress = 1;
+    while( progress && ctx -> budget > 0 ) {
+        progress = 0;
 
-    RESET_VAR(shmget);
-    RESET_VAR(shmat);
-    RESET_VAR(shmdt);
-    RESET_VAR(shmctl);
+        // Remove whole lines
+        for( size_t pos = 0; _eval_prop.min.in && pos < _eval_prop.min.inlen && ctx -> budget > 0; ) {
+            const char *nl = memchr( _eval_prop.min.in + pos, '\n', _eval_prop.min.inlen - pos );
+            size_t len = nl ? (size_t) ( nl - ( _eval_prop.min.in + pos ) ) + 1 : _eval_prop.min.inlen - pos;
+            if ( _eval_prop_try_cut( ctx, &cand, pos, len ) ) progress = 1;
+            else pos += len;
+        }
 
-    RESET_VAR(mkfifo);
-    RESET_VAR(isfifo);
+        // Remove byte ranges of decreasing size
+        for( size_t len = _eval_prop.min.inlen / 2; len > 0 && ctx -> budget > 0; len /= 2 ) {
+            for( size_t pos = 0; pos + len <= _eval_prop.min.inlen && ctx -> budget > 0; ) {
+                if ( _eval_prop_try_cut( ctx, &cand, pos, len ) ) progress = 1;
+                else pos += len;
+            }
+        }
 
-    RESET_VAR(remove);
-    RESET_VAR(unlink);
+        // Move arguments towards 0
+        for( int k = 0; k < _eval_prop.min.narg && ctx -> budget > 0; k++ ) {
+            long a = _eval_prop.min.arg[k];
+            if ( a == 0 ) continue;
+
+            // Try 0, then halve the distance to the current value
+            for( long d = a; d != 0 && ctx -> budget > 0; d /= 2 ) {
+                if ( _eval_prop_copy( &cand, &_eval_prop.min ) ) break;
+                cand.arg[k] = a - d;
+                if ( _eval_prop_try( ctx, &cand ) ) {
+                    progress = 1;
+                    break;
+                }
+            }
+        }
+    }
 
-    RESET_VAR(atoi);
-    RESET_VAR(fclose);
-    RESET_VAR(execl);
-    RESET_VAR(fread);
-    RESET_VAR(fwrite);
-    RESET_VAR(fseek);
+    _eval_prop_free( &cand );
 }
 
 /**
- * @brief Sets default values for evaluation variables
+ * @brief Prints out a test case
  * 
- * This sets the default behavior for all eval.c functions.
+ * stdin data is shown escaped, and truncated to 256 characters
  * 
- * Specifically:
- *  1 - Resets all _eval_*_data variables to 0, including the status and action fields
- *  2 - Sets the timeout time to EVAL_TIMEOUT
- *  3 - Block execution of pause(), execl(), wait() and waitpid()
- *  4 - Prevent signals to self
+ * @param c         Test case
  */
-void eval_reset( void ) {
-    // Reset all values
-    // Except for the exit() function the default behavior is to
-    // capture function parameters and then call function
-    eval_reset_vars();
+static void _eval_prop_print( const eval_prop_case_t *c ) {
+    if ( c -> narg > 0 ) {
+        printf("         args  :");
+        for( int k = 0; k < c -> narg; k++ ) printf(" %ld", c -> arg[k] );
+        printf("\n");
+    }
+    if ( c -> in ) {
+        printf("         stdin : \"");
+        size_t n = ( c -> inlen > 256 ) ? 256 : c -> inlen;
+        for( size_t i = 0; i < n; i++ ) {
+            unsigned char ch = c -> in[i];
+            switch( ch ) {
+            case( '\n' ): printf("\\n"); break;
+            case( '\t' ): printf("\\t"); break;
+            case( '\\' ): printf("\\\\"); break;
+            case( '"' ):  printf("\\\""); break;
+            default:
+                if ( ch < 32 || ch > 126 ) printf("\\x%02x", ch );
+                else putchar( ch );
+            }
+        }
+        printf("\"%s (%zu bytes)\n", ( c -> inlen > n ) ? "..." : "", c -> inlen );
+    }
+}
+
+/**
+ * @brief Checks a property on generated test cases
+ * 
+ * For each test case the generator fills in the stdin data and arguments
+ * of a new test case (using eval_prop_rand(), eval_prop_range(),
+ * eval_prop_write() and eval_prop_printf()), with a size parameter growing
+ * up to _eval_prop.maxsize. The code under test is then run inside an
+ * EVAL_CATCH_MEMIO() block and the oracle checks the results (_eval_env,
+ * _eval_memio, etc.). When a test case fails it is shrunk to a minimal
+ * failing test case (_eval_prop.min), which is reported along with the seed
+ * needed to reproduce the run (set _eval_prop.seed to replay it).
+ * 
+ * @param name      Property name, used in messages
+ * @param gen       Test case generator
+ * @param run       Code under test
+ * @param oracle    Returns non-zero if the property holds for the test case
+ *                  just run. If NULL, the property holds if the code
+ *                  terminates normally
+ * @param ncases    Number of test cases to generate
+ * @return int      0 if the property held for all test cases, 1 if a failing
+ *                  test case was found, -1 on error
+ */
+int eval_prop_check( const char name[], eval_prop_gen_t gen, eval_prop_run_t run,
+    eval_prop_oracle_t oracle, int ncases ) {
 
-    // Abort test whenever pause() or execl() are called
-    _eval_pause_data.action = ACTION_BLOCK; 
-    _eval_execl_data.action = ACTION_BLOCK; 
+    if ( gen == NULL || run == NULL || ncases < 1 ) {
+        eval_error("(eval_prop_check) Invalid parameters");
+        return -1;
+    }
+
+    uint64_t seed = _eval_prop.seed;
+    if ( seed == 0 ) {
+        struct timespec t;
+        clock_gettime( CLOCK_REALTIME, &t );
+        seed = _eval_prop_mix( ( (uint64_t) t.tv_sec * 1000000000ULL + t.tv_nsec ) ^ ( (uint64_t) getpid() << 32 ) );
+    }
+
+    _eval_prop_free( &_eval_prop.min );
+    _eval_prop.run_seed = seed;
+    _eval_prop.n = 0;
+    _eval_prop.failed = 0;
+    _eval_prop.case_seed = 0;
+    _eval_prop.size = 0;
+    _eval_prop.nshrink = 0;
+    _eval_prop.termination[0] = 0;
+
+    _eval_prop_ctx_t ctx = {
+        .gen = gen,
+        .run = run,
+        .oracle = oracle,
+        .budget = _eval_prop.maxshrink
+    };
+
+    int maxsize = ( _eval_prop.maxsize > 0 ) ? _eval_prop.maxsize : EVAL_PROP_MAXSIZE;
+
+    eval_prop_case_t c;
+    memset( &c, 0, sizeof( c ) );
+
+    for( int i = 0; i < ncases; i++ ) {
+        uint64_t case_seed = _eval_prop_mix( seed + (uint64_t) i );
+        int size = (int) ( (long) maxsize * i / ( ( ncases > 1 ) ? ncases - 1 : 1 ) );
+
+        _eval_prop_gen( &ctx, &c, case_seed, size );
+        _eval_prop.n++;
+        if ( ! _eval_prop_holds( &ctx, &c ) ) {
+            _eval_prop.failed = 1;
+            _eval_prop.case_seed = case_seed;
+            _eval_prop.size = size;
+            _eval_prop.min = c;
+            memset( &c, 0, sizeof( c ) );
+            strncpy( _eval_prop.termination, eval_termination(), sizeof( _eval_prop.termination ) - 1 );
+            break;
+        }
+    }
+    _eval_prop_free( &c );
+
+    if ( ! _eval_prop.failed ) {
+        eval_success("Property %s held for %d test case(s) (seed 0x%016" PRIx64 ")",
+            name, _eval_prop.n, seed );
+        return 0;
+    }
 
-    // Abort test whenever wait() or waitpid() are called
-    _eval_wait_data.action = ACTION_BLOCK; 
-    _eval_waitpid_data.action = ACTION_BLOCK; 
+    _eval_prop_shrink( &ctx );
 
-    // Prevent signals to self
-    _eval_raise_data.action = ACTION_BLOCK;
-    _eval_kill_data.action = ACTION_PROTECT;
+    eval_error("Property %s failed on test case %d (seed 0x%016" PRIx64 ")",
+        name, _eval_prop.n, seed );
+    printf("         case seed 0x%016" PRIx64 ", size %d, %d shrinking step(s)\n",
+        _eval_prop.case_seed, _eval_prop.size, _eval_prop.nshrink );
+    _eval_prop_print( &_eval_prop.min );
+    printf("         result: %s\n", _eval_prop.termination );
 
+    return 1;
 }
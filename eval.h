@@ -12,16 +12,51 @@
 #ifndef __EVAL_H__
 #define __EVAL_H__
 
-// Default timeout for student code
+// Default timeout for student code (CPU time)
 #ifndef EVAL_TIMEOUT
 #define EVAL_TIMEOUT 1.0
 #endif
 
+// Default wall clock timeout for student code, 0 to disable
+#ifndef EVAL_WALL_TIMEOUT
+#define EVAL_WALL_TIMEOUT 0
+#endif
+
+// Size of the alternate signal stack used for catching stack overflows
+#ifndef EVAL_ALTSTACK_SIZE
+#define EVAL_ALTSTACK_SIZE 65536
+#endif
+
+// Wrapper specialization levels, see EVAL_WRAP_DEFAULT
+#define EVAL_WRAP_PASSTHROUGH 0
+#define EVAL_WRAP_COUNT 1
+#define EVAL_WRAP_FULL 2
+
+// Default wrapper specialization level. Individual wrappers can be set with
+// -DEVAL_WRAP_<function>=<level>, e.g. -DEVAL_WRAP_fread=EVAL_WRAP_COUNT
+#ifndef EVAL_WRAP_DEFAULT
+#define EVAL_WRAP_DEFAULT EVAL_WRAP_FULL
+#endif
+
 // Enable printing additional messages
 //#define _EVAL_DEBUG 1
 
 #define _EVAL_DEBUG_PREFIX "\033[33m  ⇢ \033[0m"
 
+// Thread-local storage, using the GNU extension before C11
+#if defined( __STDC_VERSION__ ) && __STDC_VERSION__ >= 201112L
+#define _EVAL_THREAD_LOCAL _Thread_local
+#else
+#define _EVAL_THREAD_LOCAL __thread
+#endif
+
+// Functions that never return, using the GNU attribute before C11
+#if defined( __STDC_VERSION__ ) && __STDC_VERSION__ >= 201112L
+#define _EVAL_NORETURN _Noreturn
+#else
+#define _EVAL_NORETURN __attribute__(( noreturn ))
+#endif
+
 #include <unistd.h>
 #include <stdio.h>
 #include <sys/types.h>
@@ -34,10 +69,13 @@
 
 #include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/wait.h>
+#include <time.h>
 
 #include <string.h>
 #include <stdlib.h>
 #include <signal.h>
+#include <pthread.h>
 
 #include <setjmp.h>
 
@@ -49,9 +87,27 @@
 #include <sys/syslimits.h>
 #endif
 
+// Initial number of lines in log buffers
 #define LOGSIZE 128
+
+// Maximum size of a single log line
 #define LOGLINE 256
 
+// Maximum size of log buffers (bytes)
+#ifndef EVAL_LOG_MAXSIZE
+#define EVAL_LOG_MAXSIZE ( 16 * 1024 * 1024 )
+#endif
+
+// Number of hash buckets in the log line prefix index
+#ifndef EVAL_LOG_BUCKETS
+#define EVAL_LOG_BUCKETS 256
+#endif
+
+// Maximum number of captures in a log pattern
+#ifndef EVAL_LOGPAT_MAXCAP
+#define EVAL_LOGPAT_MAXCAP 8
+#endif
+
 typedef struct {
     char key[16];
     char text[128];
@@ -66,10 +122,113 @@ int question_setgrade( question_t questions[], char key[], float grade );
 int question_list( question_t questions[], char* msg );
 void question_export( question_t questions[], char msg[] );
 
+/**
+ * @brief Question in a question registry (eval_questions_t)
+ * 
+ * Keys are hierarchical: "3.2.a" is a sub-item of "3.2", which is a
+ * sub-item of "3"
+ */
+typedef struct {
+    char key[16];
+    char text[128];
+    float grade;
+    float weight;       // Weight of the question in the score of its parent / total
+    float score;        // Grade, or weighted mean of the sub-item scores, see eval_questions_total()
+    int parent;         // Index of the parent question, -1 if none
+} eval_question_t;
+
+/**
+ * @brief Question registry, with a hash index on the question key
+ * 
+ */
+typedef struct {
+    eval_question_t *list;  // Questions, in registration order
+    int n;                  // Number of questions
+    int size;               // Size of .list
+    int *index;             // Open addressing hash index of .list, -1 for empty slots
+    int nslots;             // Size of .index (power of 2)
+} eval_questions_t;
+
+/**
+ * @brief Grade update, see eval_questions_update()
+ * 
+ */
+typedef struct {
+    char key[16];
+    float grade;
+} eval_grade_t;
+
+int eval_questions_init( eval_questions_t *table, const question_t questions[] );
+void eval_questions_free( eval_questions_t *table );
+int eval_questions_add( eval_questions_t *table, const char key[], const char text[], float weight );
+int eval_questions_find( const eval_questions_t *table, const char key[] );
+const char *eval_questions_text( const eval_questions_t *table, const char key[] );
+int eval_questions_setgrade( eval_questions_t *table, const char key[], float grade );
+int eval_questions_update( eval_questions_t *table, const eval_grade_t grades[], int n );
+double eval_questions_total( eval_questions_t *table, double *max );
+int eval_questions_list( eval_questions_t *table, char *msg );
+void eval_questions_export( eval_questions_t *table, char msg[] );
+
+/**
+ * @brief Question result stored in the shared result table
+ * 
+ */
+typedef struct {
+    char key[16];
+    float grade;
+    int set;            // Number of times the grade was set
+    int test;           // Runner test case that set the grade (-1 if outside the runner)
+    int stat;           // _eval_env.stat of the last EVAL_CATCH* when the grade was set
+    double cpu_time;    // CPU time of the last EVAL_CATCH* (s)
+    double wall_time;   // Wall clock time of the last EVAL_CATCH* (s)
+    pid_t pid;          // Process that set the grade
+    pid_t owner;        // Process writing the entry, 0 if none
+    unsigned seq;       // Write sequence number, odd while a write is in progress
+} eval_result_t;
+
+int eval_results_open( question_t questions[] );
+int eval_results_setgrade( char key[], float grade );
+int eval_results_get( char key[], eval_result_t *result );
+int eval_results_collect( question_t questions[] );
+void eval_results_export( char msg[] );
+void eval_results_close( void );
+
+// Number of wrapped functions whose calls are counted in eval_usage_t
+#define EVAL_USAGE_NFUNCS 37
+
+typedef struct {
+    double wall;        // Wall clock time (s)
+    double utime;       // User CPU time (s)
+    double stime;       // System CPU time (s)
+    long maxrss;        // Increase in maximum resident set size (kB)
+    long minflt;        // Minor page faults
+    long majflt;        // Major page faults
+    long nvcsw;         // Voluntary context switches
+    long nivcsw;        // Involuntary context switches
+    int calls[ EVAL_USAGE_NFUNCS ];  // Wrapped function calls
+} eval_usage_t;
+
+extern eval_usage_t _eval_usage;
+extern eval_usage_t _eval_usage_total;
+
+void _eval_usage_start( void );
+void _eval_usage_stop( void );
+void eval_usage_reset( void );
+int eval_usage_calls( const eval_usage_t *, const char [] );
+void eval_usage_export( char [] );
+
 typedef struct {
-    char buffer[LOGSIZE][LOGLINE];
-    int start;
-    int end;
+    char *buffer;       // Line data, stored contiguously
+    size_t size;        // Size of buffer (bytes)
+    size_t *offsets;    // Position of each line in buffer, starting at line .first
+    int nlines;         // Size of offsets
+
+    int first;          // Index of first line in offsets
+    int start;          // Index of head line
+    int end;            // Index after last line
+
+    struct _eval_log_index *index;  // Line prefix index, allocated on first query
+    int indexed;        // Index after last line added to the index
 } log_t;
 
 extern log_t _success_log;
@@ -77,16 +236,73 @@ extern log_t _error_log;
 extern log_t _data_log;
 
 void initlog( log_t * );
+void freelog( log_t * );
 char *newline( log_t * );
+const char* logline( log_t*, int );
 void printlog( log_t * );
 int rmheadmsg( log_t*, const char [] );
 int findinlog( log_t*, const char *restrict, ... );
 
 const char* loghead( log_t* );
 
+typedef struct {
+    char pattern[LOGLINE];  // Glob pattern ('*' and '?' wildcards, '[...]' sets)
+    char key[LOGLINE];      // Literal text at the start of matching lines
+    int haskey;             // .key includes the complete line prefix (index key)
+    int ncap;               // Number of captures ('*' wildcards)
+} eval_logpat_t;
+
+typedef struct {
+    int line;                               // Index of the matching line
+    int ncap;                               // Number of captures
+    const char *cap[ EVAL_LOGPAT_MAXCAP ];  // Captured text ('\0' terminated)
+    char buffer[ LOGLINE + EVAL_LOGPAT_MAXCAP ];
+} eval_logmatch_t;
+
+int eval_logpat( eval_logpat_t*, const char *restrict, ... );
+int eval_logpat_match( const eval_logpat_t*, const char [], eval_logmatch_t* );
+int eval_log_find( log_t*, const eval_logpat_t*, int, eval_logmatch_t* );
+int eval_log_count( log_t*, const eval_logpat_t* );
+int eval_log_unordered( log_t*, const eval_logpat_t [], int, int [] );
+int eval_log_sequence( log_t*, const eval_logpat_t [], int, int [] );
+int eval_check_log_unordered( log_t*, const eval_logpat_t [], int );
+int eval_check_log_sequence( log_t*, const eval_logpat_t [], int );
+
 int create_lockfile( char * );
 int remove_lockfile( char * );
 
+// Default tolerance for numeric output comparisons
+#ifndef EVAL_CMP_TOLERANCE
+#define EVAL_CMP_TOLERANCE 1e-6
+#endif
+
+// Default maximum number of differences reported by output comparisons
+#ifndef EVAL_CMP_MAXDIFFS
+#define EVAL_CMP_MAXDIFFS 10
+#endif
+
+enum EVAL_CMP_MODES {
+    EVAL_CMP_EXACT = 0,
+    EVAL_CMP_TRAILING_WS,
+    EVAL_CMP_NUMERIC,
+    EVAL_CMP_UNORDERED
+};
+
+typedef struct {
+    double tolerance;   // Tolerance for EVAL_CMP_NUMERIC comparisons
+    int maxdiffs;       // Maximum number of differences to report
+
+    int ndiffs;         // Number of differences found in last comparison
+    int line;           // Line of the first difference
+    int col;            // Column of the first difference
+} _eval_cmp_type;
+
+extern _eval_cmp_type _eval_cmp;
+
+int eval_compare_mem( const char*, size_t, const char*, size_t, int );
+int eval_compare_file( const char*, const char*, int );
+int eval_compare_stdout( const char*, int );
+
 
 typedef struct {
     int error;
@@ -99,11 +315,43 @@ extern eval_stats_t _eval_stats;
 void eval_reset_stats( void );
 
 
+// Size of scratch buffer for eval_error() / eval_info() / eval_success() messages
+#ifndef EVAL_MSG_SIZE
+#define EVAL_MSG_SIZE 1024
+#endif
+
+// Size of stdout buffer used when stdout is not a terminal
+#ifndef EVAL_MSG_SINK
+#define EVAL_MSG_SINK ( 64 * 1024 )
+#endif
+
 int eval_error(const char *restrict, ...);
 int eval_info(const char *restrict, ...);
 int eval_success(const char *restrict, ...);
 int eval_complete( char[] );
 
+// Size of the buffer used for structured report records
+#ifndef EVAL_REPORT_BUFSIZE
+#define EVAL_REPORT_BUFSIZE ( 64 * 1024 )
+#endif
+
+enum EVAL_REPORT_FORMATS {
+    EVAL_REPORT_NONE = 0,
+    EVAL_REPORT_JSONL,
+    EVAL_REPORT_JUNIT
+};
+
+int eval_report_open( const char spec[] );
+void eval_report_close( void );
+void eval_report_flush( void );
+void eval_report_case( const char name[] );
+
+void _eval_report_message( const char type[], const char *msg, size_t len );
+void _eval_report_catch( void );
+void _eval_report_grade( const char key[], float grade );
+void _eval_report_section( const char name[] );
+int _eval_report_fd( void );
+
 int datalog(const char *restrict , ...);
 int successlog(const char *restrict , ...);
 int errorlog(const char *restrict , ...);
@@ -115,7 +363,7 @@ int eval_check_errorlog( const char *restrict , ...);
 void eval_clear_logs( void );
 void eval_close_logs( char msg[] );
 
-#define EVAL_VAR( name ) _eval_##name##_type _eval_##name##_data 
+#define EVAL_VAR( name ) _eval_##name##_type _eval_##name##_store
 
 #define RESET_VAR( name ) memset(&(_eval_##name##_data), 0, sizeof(_eval_##name##_type))
 
@@ -136,12 +384,26 @@ typedef struct {
     int signal;
     int stat;
 
-    struct sigaction sigactions[5];
-    float timeout;
+    struct sigaction sigactions[6];
+    float timeout;          // CPU time limit (s), <= 0 to disable
+    float wall_timeout;     // Wall clock time limit (s), <= 0 to disable
+    int deadline;           // Deadline that expired (EVAL_DEADLINE_*), 0 if none
+
+    double cpu_time;        // CPU time used by last EVAL_CATCH (s)
+    double wall_time;       // Wall clock time used by last EVAL_CATCH (s)
+    struct timespec cpu_start;
+    struct timespec wall_start;
 
     int filemon;
+    int seccomp;            // Enforce blocked wrappers with a seccomp filter (Linux x86_64, runner workers only)
+    int session;            // Signal handlers are armed once, see eval_session_begin()
 } _eval_env_type;
 
+enum EVAL_DEADLINES {
+    EVAL_DEADLINE_CPU = 1,
+    EVAL_DEADLINE_WALL
+};
+
 extern _eval_env_type _eval_env;
 
 const char * eval_termination( void );
@@ -151,11 +413,139 @@ void _eval_sighandler( int sig, siginfo_t *info, void *ucontext);
 void _eval_arm_signals( void );
 void _eval_disarm_signals( void );
 
+// Inside a session, number of file descriptors from the first free one
+// probed at the end of every EVAL_CATCH* block
+#ifndef EVAL_SESSION_FDPROBE
+#define EVAL_SESSION_FDPROBE 16
+#endif
+
+// Inside a session, the open file descriptors are fully scanned every
+// EVAL_SESSION_FDSCAN blocks
+#ifndef EVAL_SESSION_FDSCAN
+#define EVAL_SESSION_FDSCAN 64
+#endif
+
+int eval_session_begin( void );
+void eval_session_end( void );
+
+int _eval_session_expired( int id );
+void _eval_session_uncaught( int sig, siginfo_t *info );
+
+_EVAL_NORETURN void _eval_longjmp( int code );
+
+
+#define EVAL_CHECK_READ     1
+#define EVAL_CHECK_WRITE    2
+
+int eval_checkrange( const void* ptr, size_t len, int mode );
+
+void eval_checkrange_invalidate( void );
 
 int eval_checkptr( void* ptr );
 
 int eval_checkconstptr( const void* ptr );
 
+/******************************************************************************
+ * Call trace
+ *****************************************************************************/
+
+// Default number of events in the call trace ring buffer
+#ifndef EVAL_TRACE_SIZE
+#define EVAL_TRACE_SIZE 4096
+#endif
+
+// Maximum number of arguments stored for each call
+#define EVAL_TRACE_NARGS 5
+
+// Maximum size of string arguments stored for each call (truncated)
+#define EVAL_TRACE_STRLEN 32
+
+enum EVAL_TRACE_FUNCS {
+    EVAL_TRACE_EXIT = 0,
+    EVAL_TRACE_ABORT,
+    EVAL_TRACE_SLEEP,
+    EVAL_TRACE_FORK,
+    EVAL_TRACE_WAIT,
+    EVAL_TRACE_WAITPID,
+    EVAL_TRACE_KILL,
+    EVAL_TRACE_RAISE,
+    EVAL_TRACE_SIGNAL,
+    EVAL_TRACE_SIGACTION,
+    EVAL_TRACE_PAUSE,
+    EVAL_TRACE_ALARM,
+    EVAL_TRACE_MSGGET,
+    EVAL_TRACE_MSGSND,
+    EVAL_TRACE_MSGRCV,
+    EVAL_TRACE_MSGCTL,
+    EVAL_TRACE_SEMGET,
+    EVAL_TRACE_SEMCTL,
+    EVAL_TRACE_SEMOP,
+    EVAL_TRACE_SHMGET,
+    EVAL_TRACE_SHMAT,
+    EVAL_TRACE_SHMDT,
+    EVAL_TRACE_SHMCTL,
+    EVAL_TRACE_MKFIFO,
+    EVAL_TRACE_ISFIFO,
+    EVAL_TRACE_REMOVE,
+    EVAL_TRACE_UNLINK,
+    EVAL_TRACE_ATOI,
+    EVAL_TRACE_FCLOSE,
+    EVAL_TRACE_FREAD,
+    EVAL_TRACE_FWRITE,
+    EVAL_TRACE_FSEEK,
+    EVAL_TRACE_EXECL,
+    EVAL_TRACE_MALLOC,
+    EVAL_TRACE_CALLOC,
+    EVAL_TRACE_REALLOC,
+    EVAL_TRACE_FREE,
+    EVAL_TRACE_FOPEN,
+    EVAL_TRACE_PTHREAD_CREATE,
+    EVAL_TRACE_PTHREAD_JOIN,
+    EVAL_TRACE_PTHREAD_MUTEX_LOCK,
+    EVAL_TRACE_PTHREAD_MUTEX_TRYLOCK,
+    EVAL_TRACE_PTHREAD_MUTEX_UNLOCK,
+    EVAL_TRACE_NFUNCS
+};
+
+typedef struct {
+    int func;           // Function id (EVAL_TRACE_*)
+    int err;            // errno on return, -1 if the function did not return
+    intptr_t ret;       // Return value
+    intptr_t args[ EVAL_TRACE_NARGS ];      // Function arguments
+    double t;           // Time of call since trace was enabled (s)
+    char str[ EVAL_TRACE_STRLEN ];          // String argument (e.g. path)
+} eval_trace_event_t;
+
+typedef struct {
+    int enabled;        // Record calls to wrapped functions
+    int capacity;       // Size of ring buffer (events)
+    long total;         // Number of events recorded (including overwritten events)
+    long pending;       // Event waiting for return value, -1 if none
+    int saved_errno;    // errno value before the pending call
+    struct timespec t0; // Time when trace was enabled
+    eval_trace_event_t *events;
+} _eval_trace_type;
+
+extern _eval_trace_type _eval_trace;
+
+void _eval_trace_call( int, const intptr_t [] );
+void _eval_trace_str( const char * );
+void _eval_trace_ret( intptr_t );
+
+int eval_trace_enable( int );
+void eval_trace_disable( void );
+void eval_trace_clear( void );
+
+const char * eval_trace_name( int );
+int eval_trace_size( void );
+const eval_trace_event_t * eval_trace_get( int );
+int eval_trace_count( int );
+const eval_trace_event_t * eval_trace_nth( int, int );
+int eval_trace_find( int, int, int, intptr_t );
+int eval_trace_format( const eval_trace_event_t *, char [], size_t );
+int eval_trace_match( int, const char *restrict, ... );
+void eval_trace_print( void );
+
 
 typedef struct {
     // int stdin;
@@ -174,6 +564,26 @@ void _eval_close_filemon( void );
 #define FILE_STDOUT "eval.stdout"
 #define FILE_DEVNULL "/dev/null"
 
+typedef struct {
+    int active;         // Use memory buffers for the next I/O redirection
+
+    const char *in;     // stdin data
+    size_t inlen;       // stdin data size
+
+    char *out;          // Captured stdout data ('\0' terminated)
+    size_t outlen;      // Captured stdout data size
+    size_t outsize;     // Size of the .out buffer
+
+    int infd;           // stdin memory file descriptor
+    int outfd;          // stdout memory file descriptor
+    FILE *intmp;        // stdin temporary file (fallback)
+    FILE *outtmp;       // stdout temporary file (fallback)
+} _eval_memio_t;
+
+extern _eval_memio_t _eval_memio;
+
+void _eval_memio_arm( const char* , size_t );
+
 enum EVAL_CATCH_CODES {
     EVAL_CATCH_EXIT = 1,
     EVAL_CATCH_ABORT,
@@ -192,7 +602,8 @@ enum ACTION_CODES {
     ACTION_WARN,
     ACTION_CREATE,
     ACTION_RETRY,
-    ACTION_INJECT
+    ACTION_INJECT,
+    ACTION_VIRTUAL
 };
 
 #ifdef _EVAL_DEBUG
@@ -210,7 +621,7 @@ enum ACTION_CODES {
     _eval_arm_signals(); \
     printf("\033[1;33m ⊢ \033[0m %s running...\n", #_code ); \
     _eval_env.catch = 1; \
-    _eval_env.stat = sigsetjmp( _eval_env.jmp, 1 ); \
+    _eval_env.stat = sigsetjmp( _eval_env.jmp, ! _eval_env.session ); \
     if ( !_eval_env.stat ) { \
         {_code;} \
         printf("\033[1;33m ⊣ \033[0m %s completed normally.\n", #_code); \
@@ -226,7 +637,9 @@ enum ACTION_CODES {
             printf("\033[1;33m ⊣ \033[0m %s terminated by calling blocked function\n", #_code ); \
             break; \
         case(EVAL_CATCH_SIGNAL): \
-            if ( _eval_env.signal == SIGPROF ) { \
+            if ( _eval_env.deadline == EVAL_DEADLINE_WALL ) { \
+                printf("\033[1;33m ⊣ \033[0m %s wall clock timeout after %g second(s)\n", #_code, _eval_env.wall_timeout);\
+            } else if ( _eval_env.deadline ) { \
                 printf("\033[1;33m ⊣ \033[0m %s timeout after %g second(s)\n", #_code, _eval_env.timeout);\
             } else { \
                 printf("\033[1;33m ⊣ \033[0m %s terminated by signal %d\n", #_code, _eval_env.signal);\
@@ -256,7 +669,7 @@ enum ACTION_CODES {
     printf("\033[1;33m ⊢ \033[0m %s running...\n", #_code ); \
     _eval_io_redirect( _stdin, _stdout ); \
     _eval_env.catch = 1; \
-    _eval_env.stat = sigsetjmp( _eval_env.jmp, 1 ); \
+    _eval_env.stat = sigsetjmp( _eval_env.jmp, ! _eval_env.session ); \
     if ( !_eval_env.stat ) { \
         {_code;} \
         _eval_io_restore();\
@@ -274,7 +687,9 @@ enum ACTION_CODES {
             printf("\033[1;33m ⊣ \033[0m %s terminated by calling blocked function\n", #_code ); \
             break; \
         case(EVAL_CATCH_SIGNAL): \
-            if ( _eval_env.signal == SIGPROF ) { \
+            if ( _eval_env.deadline == EVAL_DEADLINE_WALL ) { \
+                printf("\033[1;33m ⊣ \033[0m %s wall clock timeout after %g second(s)\n", #_code, _eval_env.wall_timeout);\
+            } else if ( _eval_env.deadline ) { \
                 printf("\033[1;33m ⊣ \033[0m %s timeout after %g second(s)\n", #_code, _eval_env.timeout);\
             } else { \
                 printf("\033[1;33m ⊣ \033[0m %s terminated by signal %d\n", #_code, _eval_env.signal);\
@@ -306,7 +721,7 @@ enum ACTION_CODES {
     _eval_init_filemon(); \
     _eval_arm_signals(); \
     _eval_env.catch = 1; \
-    _eval_env.stat = sigsetjmp( _eval_env.jmp, 1 ); \
+    _eval_env.stat = sigsetjmp( _eval_env.jmp, ! _eval_env.session ); \
     if ( !_eval_env.stat ) { \
         {_code;} \
     } else { \
@@ -338,7 +753,7 @@ enum ACTION_CODES {
     _eval_arm_signals(); \
     _eval_io_redirect( _stdin, _stdout ); \
     _eval_env.catch = 1; \
-    _eval_env.stat = sigsetjmp( _eval_env.jmp, 1 ); \
+    _eval_env.stat = sigsetjmp( _eval_env.jmp, ! _eval_env.session ); \
     if ( !_eval_env.stat ) { \
         {_code;} \
         _eval_io_restore();\
@@ -362,6 +777,213 @@ enum ACTION_CODES {
 
 #endif
 
+/**
+ * @brief Works like EVAL_CATCH_IO(), but stdin is read from the _in memory
+ * buffer (_inlen bytes) and stdout is captured into memory. After the macro
+ * completes the captured output is available at _eval_memio.out, with
+ * _eval_memio.outlen bytes. If _in is NULL no stdin redirection takes place.
+ * 
+ */
+#define EVAL_CATCH_MEMIO( _code, _in, _inlen ) { \
+    _eval_memio_arm( _in, _inlen ); \
+    EVAL_CATCH_IO( _code, NULL, NULL ); \
+}
+
+// Default number of warmup iterations for EVAL_BENCH()
+#ifndef EVAL_BENCH_WARMUP
+#define EVAL_BENCH_WARMUP 3
+#endif
+
+typedef struct {
+    int warmup;         // Number of warmup iterations (not measured)
+
+    int iterations;     // Number of measured iterations requested
+    int n;              // Number of measured iterations completed
+    int noutliers;      // Number of samples rejected as outliers
+
+    double min;         // Minimum time (s)
+    double median;      // Median time (s)
+    double p95;         // 95th percentile time (s)
+    double mean;        // Mean time (s), excluding outliers
+} eval_bench_t;
+
+extern eval_bench_t _eval_bench;
+
+void _eval_bench_start( int );
+int _eval_bench_next( void );
+void _eval_bench_finish( void );
+
+double eval_bench_speedup( const eval_bench_t*, const eval_bench_t* );
+void eval_bench_print( const eval_bench_t*, const char [] );
+
+/**
+ * @brief Runs _code _iter times (after _eval_bench.warmup iterations) inside
+ * a single EVAL_CATCH() block, timing each iteration. Results are stored in
+ * _eval_bench.
+ * 
+ */
+#define EVAL_BENCH( _code, _iter ) { \
+    _eval_bench_start( _iter ); \
+    EVAL_CATCH( while( _eval_bench_next() ) { _code; } ); \
+    _eval_bench_finish(); \
+}
+
+/******************************************************************************
+ * Parallel test runner
+ *****************************************************************************/
+
+// Default wall clock limit for each test case worker (seconds)
+#ifndef EVAL_RUNNER_TIMEOUT
+#define EVAL_RUNNER_TIMEOUT 60.0
+#endif
+
+// Maximum number of grades forwarded from each test case worker
+#ifndef EVAL_RUNNER_GRADES
+#define EVAL_RUNNER_GRADES 64
+#endif
+
+typedef void (*eval_test_func_t)( void );
+typedef int (*eval_setup_func_t)( void );
+
+typedef struct {
+    char name[64];
+    eval_test_func_t func;
+
+    // Test case results, set by eval_run_parallel()
+    int stat;               // _eval_env.stat at the end of the test case
+    int signal;             // _eval_env.signal at the end of the test case
+    int exit_status;        // _eval_exit_data.status at the end of the test case
+    eval_stats_t stats;     // _eval_stats for the test case
+    char termination[128];  // eval_termination() at the end of the test case
+    double wall_time;       // Worker wall clock time (s)
+    eval_grade_t grades[ EVAL_RUNNER_GRADES ];  // Grades set by the test case
+    int ngrades;            // Number of grades set (may exceed EVAL_RUNNER_GRADES)
+
+    int wstatus;            // Worker process termination status (see waitpid())
+    int timeout;            // Worker was killed for exceeding the runner timeout
+    int completed;          // Worker reported back its results
+    int failed;             // Test case failed (errors or abnormal worker termination)
+} eval_test_t;
+
+typedef struct {
+    int ntests;
+    int size;
+    eval_test_t *tests;
+
+    float timeout;          // Wall clock limit per test case, <= 0 to disable
+    int current;            // Index of the test case running in this worker (-1 in parent)
+    eval_test_t *result;    // Result slot of this worker (NULL in parent)
+    eval_questions_t *questions;    // Receives the grades set by the test cases, NULL for none
+} _eval_runner_type;
+
+extern _eval_runner_type _eval_runner;
+
+int eval_register_test( const char name[], eval_test_func_t func );
+void eval_clear_tests( void );
+int eval_run_parallel( int njobs );
+int eval_run_forkserver( eval_setup_func_t setup, int njobs );
+
+void _eval_report_test( const eval_test_t * );
+void _eval_runner_grade( const char key[], float grade );
+
+#define EVAL_TEST( func ) eval_register_test( #func, func )
+
+/******************************************************************************
+ * Batch submission driver
+ *****************************************************************************/
+
+typedef struct {
+    const char *name;       // Symbol name in the submission
+    void **addr;            // Variable receiving the symbol address
+    int optional;           // A missing symbol is not an error
+} eval_bind_t;
+
+#define EVAL_BIND( name, ptr ) { #name, (void **) &(ptr), 0 }
+#define EVAL_BIND_OPTIONAL( name, ptr ) { #name, (void **) &(ptr), 1 }
+#define EVAL_BIND_END { NULL, NULL, 0 }
+
+typedef struct {
+    char path[ PATH_MAX ];
+    int loaded;             // Submission was loaded and all required symbols were bound
+    int missing;            // Required symbols not found
+    int ntests;             // Test cases run
+    int failed;             // Test cases that failed
+    eval_stats_t stats;     // _eval_stats for the submission
+} eval_submission_t;
+
+typedef struct {
+    int current;            // Index of the submission being tested (-1 if none)
+    const char *path;       // Path of the submission being tested (NULL if none)
+    void *handle;           // dlopen() handle of the submission being tested
+} _eval_batch_type;
+
+extern _eval_batch_type _eval_batch;
+
+int eval_bind( void *handle, eval_bind_t binds[] );
+void eval_unbind( eval_bind_t binds[] );
+int eval_batch_run( const char *paths[], int n, eval_bind_t binds[], int njobs,
+    eval_submission_t results[] );
+
+void _eval_report_submission( const eval_submission_t * );
+
+/******************************************************************************
+ * Property-based testing
+ *****************************************************************************/
+
+// Maximum number of integer arguments in a generated test case
+#ifndef EVAL_PROP_NARGS
+#define EVAL_PROP_NARGS 8
+#endif
+
+// Default maximum size parameter passed to the generator
+#ifndef EVAL_PROP_MAXSIZE
+#define EVAL_PROP_MAXSIZE 100
+#endif
+
+// Default maximum number of test runs used to shrink a failing case
+#ifndef EVAL_PROP_SHRINK
+#define EVAL_PROP_SHRINK 1000
+#endif
+
+typedef struct {
+    char *in;                       // stdin data (NULL for empty stdin)
+    size_t inlen;                   // stdin data size
+    size_t insize;                  // Size of the .in buffer
+    long arg[ EVAL_PROP_NARGS ];    // Integer arguments
+    int narg;                       // Number of arguments in use
+} eval_prop_case_t;
+
+typedef void (*eval_prop_gen_t)( eval_prop_case_t *c, int size );
+typedef void (*eval_prop_run_t)( const eval_prop_case_t *c );
+typedef int (*eval_prop_oracle_t)( const eval_prop_case_t *c );
+
+typedef struct {
+    uint64_t seed;          // Seed for the run, 0 picks one from the clock
+    int maxsize;            // Maximum size parameter passed to the generator
+    int maxshrink;          // Maximum number of test runs used for shrinking
+
+    // Results, set by eval_prop_check()
+    uint64_t run_seed;      // Seed used for the run
+    int n;                  // Test cases run (excluding shrinking)
+    int failed;             // A failing test case was found
+    uint64_t case_seed;     // Seed that generates the failing test case
+    int size;               // Size parameter of the failing test case
+    int nshrink;            // Shrinking steps that kept the test case failing
+    eval_prop_case_t min;   // Minimal failing test case
+    char termination[128];  // eval_termination() for the minimal failing test case
+
+    uint64_t rng;           // Generator state
+} _eval_prop_type;
+
+extern _eval_prop_type _eval_prop;
+
+uint64_t eval_prop_rand( void );
+long eval_prop_range( long lo, long hi );
+int eval_prop_write( eval_prop_case_t *c, const void *data, size_t len );
+int eval_prop_printf( eval_prop_case_t *c, const char *restrict format, ... );
+int eval_prop_check( const char name[], eval_prop_gen_t gen, eval_prop_run_t run,
+    eval_prop_oracle_t oracle, int ncases );
+
 /******************************************************************************
  * exit
  *****************************************************************************/
@@ -370,7 +992,7 @@ typedef struct {
     int status; // Actual exit status, not number of times called
 } _eval_exit_type;
 
-extern _eval_exit_type _eval_exit_data;
+#define _eval_exit_data (*_eval_exit_touch())
 
 void _eval_exit(int);
 
@@ -390,7 +1012,7 @@ typedef struct {
     int status;
 } _eval_abort_type;
 
-extern _eval_abort_type _eval_abort_data;
+#define _eval_abort_data (*_eval_abort_touch())
 
 void _eval_abort(void);
 
@@ -407,11 +1029,17 @@ typedef struct {
     unsigned int seconds;
 } _eval_sleep_type;
 
-extern _eval_sleep_type _eval_sleep_data;
+#define _eval_sleep_data (*_eval_sleep_touch())
 
 unsigned int _eval_sleep(unsigned int seconds);
 
+#ifndef EVAL_WRAP_sleep
+#define EVAL_WRAP_sleep EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_sleep == EVAL_WRAP_FULL
 #define sleep( seconds ) _eval_sleep( seconds )
+#endif
 
 /******************************************************************************
  * fork
@@ -422,11 +1050,53 @@ typedef struct {
     pid_t ret;
 } _eval_fork_type;
 
-extern _eval_fork_type _eval_fork_data;
+#define _eval_fork_data (*_eval_fork_touch())
 
 pid_t _eval_fork(void);
 
+#ifndef EVAL_WRAP_fork
+#define EVAL_WRAP_fork EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_fork == EVAL_WRAP_FULL
 #define fork() _eval_fork()
+#endif
+
+/******************************************************************************
+ * Child process supervision
+ *****************************************************************************/
+
+// Maximum number of child processes tracked in each EVAL_CATCH* block
+#ifndef EVAL_CHILDREN_MAX
+#define EVAL_CHILDREN_MAX 64
+#endif
+
+// Exit status of supervised children terminated by calling a blocked function
+#define EVAL_CHILD_BLOCKED 255
+
+typedef struct {
+    pid_t pid;
+    int status;         // Termination status (as returned by wait()), valid if .reaped is set
+    int reaped;         // Child terminated and was reaped
+    int killed;         // Child was still running at the end of the EVAL_CATCH* block
+    double runtime;     // Wall clock time from fork() until the child was reaped (s)
+    struct timespec start;
+} eval_child_t;
+
+typedef struct {
+    int child;          // Set in supervised child processes
+    int forking;        // Set while the fork() wrapper calls fork()
+    int n;              // Children forked in the last EVAL_CATCH* block
+    int killed;         // Children killed at the end of the last EVAL_CATCH* block
+    eval_child_t list[ EVAL_CHILDREN_MAX ];
+} _eval_children_type;
+
+extern _eval_children_type _eval_children;
+
+void _eval_child_forked( pid_t pid );
+void _eval_children_stop( void );
+const eval_child_t *eval_child( pid_t pid );
+void eval_children_print( void );
 
 /******************************************************************************
  * wait
@@ -439,11 +1109,17 @@ typedef struct {
     int *stat_loc;
 } _eval_wait_type;
 
-extern _eval_wait_type _eval_wait_data;
+#define _eval_wait_data (*_eval_wait_touch())
 
 pid_t _eval_wait(int *stat_loc);
 
+#ifndef EVAL_WRAP_wait
+#define EVAL_WRAP_wait EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_wait == EVAL_WRAP_FULL
 #define wait( stat_loc ) _eval_wait( stat_loc )
+#endif
 
 /******************************************************************************
  * waitpid
@@ -458,11 +1134,17 @@ typedef struct {
     int options;
 } _eval_waitpid_type;
 
-extern _eval_waitpid_type _eval_waitpid_data;
+#define _eval_waitpid_data (*_eval_waitpid_touch())
 
 pid_t _eval_waitpid(pid_t pid, int *stat_loc, int options);
 
+#ifndef EVAL_WRAP_waitpid
+#define EVAL_WRAP_waitpid EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_waitpid == EVAL_WRAP_FULL
 #define waitpid( pid, stat_loc, options ) _eval_waitpid( pid, stat_loc, options )
+#endif
 
 /******************************************************************************
  * kill
@@ -476,11 +1158,18 @@ typedef struct {
     int sig;
 } _eval_kill_type;
 
-extern _eval_kill_type _eval_kill_data;
+#define _eval_kill_data (*_eval_kill_touch())
 
 int _eval_kill(pid_t pid, int sig);
+int _eval_kill_refused( pid_t pid );
 
+#ifndef EVAL_WRAP_kill
+#define EVAL_WRAP_kill EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_kill == EVAL_WRAP_FULL
 #define kill( pid, sig ) _eval_kill( pid, sig )
+#endif
 
 /******************************************************************************
  * raise
@@ -493,11 +1182,17 @@ typedef struct {
     int sig;
 } _eval_raise_type;
 
-extern _eval_raise_type _eval_raise_data;
+#define _eval_raise_data (*_eval_raise_touch())
 
 int _eval_raise(int sig);
 
+#ifndef EVAL_WRAP_raise
+#define EVAL_WRAP_raise EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_raise == EVAL_WRAP_FULL
 #define raise( sig ) _eval_raise( sig )
+#endif
 
 /******************************************************************************
  * signal
@@ -513,11 +1208,17 @@ typedef struct {
     sighandler_t handler;
 } _eval_signal_type;
 
-extern _eval_signal_type _eval_signal_data;
+#define _eval_signal_data (*_eval_signal_touch())
 
 sighandler_t _eval_signal(int signum, sighandler_t handler);
 
+#ifndef EVAL_WRAP_signal
+#define EVAL_WRAP_signal EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_signal == EVAL_WRAP_FULL
 #define signal( signum, handler ) _eval_signal( signum, handler )
+#endif
 
 /******************************************************************************
  * sigaction
@@ -532,11 +1233,17 @@ typedef struct {
     struct sigaction *oldact;
 } _eval_sigaction_type;
 
-extern _eval_sigaction_type _eval_sigaction_data;
+#define _eval_sigaction_data (*_eval_sigaction_touch())
 
 int _eval_sigaction(int signum, const struct sigaction *act, struct sigaction *oldact);
 
+#ifndef EVAL_WRAP_sigaction
+#define EVAL_WRAP_sigaction EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_sigaction == EVAL_WRAP_FULL
 #define sigaction( signum, act, oldact ) _eval_sigaction( signum, act, oldact )
+#endif
 
 /******************************************************************************
  * pause
@@ -547,11 +1254,17 @@ typedef struct {
     int ret;
 } _eval_pause_type;
 
-extern _eval_pause_type _eval_pause_data;
+#define _eval_pause_data (*_eval_pause_touch())
 
 int _eval_pause(void);
 
+#ifndef EVAL_WRAP_pause
+#define EVAL_WRAP_pause EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_pause == EVAL_WRAP_FULL
 #define pause( ) _eval_pause( )
+#endif
 
 /******************************************************************************
  * msgget
@@ -566,11 +1279,17 @@ typedef struct {
     key_t key;
     int msgflg;
 } _eval_msgget_type;
-extern _eval_msgget_type _eval_msgget_data;
+#define _eval_msgget_data (*_eval_msgget_touch())
 
 int _eval_msgget(key_t key, int msgflg);
 
+#ifndef EVAL_WRAP_msgget
+#define EVAL_WRAP_msgget EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_msgget == EVAL_WRAP_FULL
 #define msgget(key, msgflg) _eval_msgget(key, msgflg)
+#endif
 
 /******************************************************************************
  * msgsnd
@@ -587,11 +1306,17 @@ typedef struct {
     int msgflg;
 } _eval_msgsnd_type;
 
-extern _eval_msgsnd_type _eval_msgsnd_data;
+#define _eval_msgsnd_data (*_eval_msgsnd_touch())
 
 int _eval_msgsnd(int msqid, const void *msgp, size_t msgsz, int msgflg);
 
+#ifndef EVAL_WRAP_msgsnd
+#define EVAL_WRAP_msgsnd EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_msgsnd == EVAL_WRAP_FULL
 #define msgsnd( msqid, msgp, msgsz, msgflg) _eval_msgsnd( msqid, msgp, msgsz, msgflg)
+#endif
 
 /******************************************************************************
  * msgrcv
@@ -611,11 +1336,17 @@ typedef struct {
     int _errno;
 } _eval_msgrcv_type;
 
-extern _eval_msgrcv_type _eval_msgrcv_data;
+#define _eval_msgrcv_data (*_eval_msgrcv_touch())
 
 ssize_t _eval_msgrcv(int msqid, void *msgp, size_t msgsz, long msgtyp, int msgflg);
 
+#ifndef EVAL_WRAP_msgrcv
+#define EVAL_WRAP_msgrcv EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_msgrcv == EVAL_WRAP_FULL
 #define msgrcv( msqid, msgp, msgsz, msgtyp ,msgflg) _eval_msgrcv( msqid, msgp, msgsz, msgtyp, msgflg)
+#endif
 
 /******************************************************************************
  * msgctl
@@ -630,11 +1361,17 @@ typedef struct {
     struct msqid_ds *buf;
 } _eval_msgctl_type;
 
-extern _eval_msgctl_type _eval_msgctl_data;
+#define _eval_msgctl_data (*_eval_msgctl_touch())
 
 int _eval_msgctl(int msqid, int cmd, struct msqid_ds *buf);
 
+#ifndef EVAL_WRAP_msgctl
+#define EVAL_WRAP_msgctl EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_msgctl == EVAL_WRAP_FULL
 #define msgctl(msqid, cmd, buf) _eval_msgctl(msqid, cmd, buf)
+#endif
 
 /******************************************************************************
  * semget
@@ -651,11 +1388,17 @@ typedef struct {
     int semflg;
 } _eval_semget_type;
 
-extern _eval_semget_type _eval_semget_data;
+#define _eval_semget_data (*_eval_semget_touch())
 
 int _eval_semget(key_t key, int nsems, int semflg);
 
+#ifndef EVAL_WRAP_semget
+#define EVAL_WRAP_semget EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_semget == EVAL_WRAP_FULL
 #define semget( key, nsems, semflg) _eval_semget( key, nsems, semflg )
+#endif
 
 /******************************************************************************
  * semctl
@@ -682,11 +1425,17 @@ typedef struct {
     union semun arg;
 } _eval_semctl_type;
 
-extern _eval_semctl_type _eval_semctl_data;
+#define _eval_semctl_data (*_eval_semctl_touch())
 
 int _eval_semctl(int semid, int semnum, int cmd, ... );
 
+#ifndef EVAL_WRAP_semctl
+#define EVAL_WRAP_semctl EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_semctl == EVAL_WRAP_FULL
 #define semctl( semid, ... ) _eval_semctl( semid, __VA_ARGS__ )
+#endif
 
 /******************************************************************************
  * semop
@@ -700,11 +1449,17 @@ typedef struct {
     size_t nsops;
 } _eval_semop_type;
 
-extern _eval_semop_type _eval_semop_data;
+#define _eval_semop_data (*_eval_semop_touch())
 
 int _eval_semop(int semid, struct sembuf *sops, size_t nsops);
 
+#ifndef EVAL_WRAP_semop
+#define EVAL_WRAP_semop EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_semop == EVAL_WRAP_FULL
 #define semop( semid, sops, nsops ) _eval_semop( semid, sops, nsops )
+#endif
 
 /******************************************************************************
  * shmget
@@ -721,11 +1476,17 @@ typedef struct {
     int shmid;
 } _eval_shmget_type;
 
-extern _eval_shmget_type _eval_shmget_data;
+#define _eval_shmget_data (*_eval_shmget_touch())
 
 int _eval_shmget(key_t key, size_t size, int shmflg);
 
+#ifndef EVAL_WRAP_shmget
+#define EVAL_WRAP_shmget EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_shmget == EVAL_WRAP_FULL
 #define shmget( key, size, shmflg) _eval_shmget( key, size, shmflg )
+#endif
 
 /******************************************************************************
  * shmat
@@ -740,11 +1501,17 @@ typedef struct {
     int shmflg;
 } _eval_shmat_type;
 
-extern _eval_shmat_type _eval_shmat_data;
+#define _eval_shmat_data (*_eval_shmat_touch())
 
 void *_eval_shmat( int shmid, const void *shmaddr, int shmflg);
 
+#ifndef EVAL_WRAP_shmat
+#define EVAL_WRAP_shmat EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_shmat == EVAL_WRAP_FULL
 #define shmat( shmid, shmaddr, shmflg ) _eval_shmat( shmid, shmaddr, shmflg )
+#endif
 
 /******************************************************************************
  * shmdt
@@ -756,11 +1523,17 @@ typedef struct {
     void *shmaddr;
 } _eval_shmdt_type;
 
-extern _eval_shmdt_type _eval_shmdt_data;
+#define _eval_shmdt_data (*_eval_shmdt_touch())
 
 int _eval_shmdt(const void *shmaddr);
 
+#ifndef EVAL_WRAP_shmdt
+#define EVAL_WRAP_shmdt EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_shmdt == EVAL_WRAP_FULL
 #define shmdt(shmaddr) _eval_shmdt(shmaddr)
+#endif
 
 /******************************************************************************
  * shmctl
@@ -774,11 +1547,17 @@ typedef struct {
     struct shmid_ds *buf;
 } _eval_shmctl_type;
 
-extern _eval_shmctl_type _eval_shmctl_data;
+#define _eval_shmctl_data (*_eval_shmctl_touch())
 
 int _eval_shmctl(int shmid, int cmd, struct shmid_ds *buf);
 
+#ifndef EVAL_WRAP_shmctl
+#define EVAL_WRAP_shmctl EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_shmctl == EVAL_WRAP_FULL
 #define shmctl( shmid, cmd, buf ) _eval_shmctl( shmid, cmd, buf )
+#endif
 
 
 /******************************************************************************
@@ -792,11 +1571,17 @@ typedef struct {
     int ret;
 } _eval_mkfifo_type;
 
-extern _eval_mkfifo_type _eval_mkfifo_data;
+#define _eval_mkfifo_data (*_eval_mkfifo_touch())
 
 int _eval_mkfifo(const char *path, mode_t mode);
 
+#ifndef EVAL_WRAP_mkfifo
+#define EVAL_WRAP_mkfifo EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_mkfifo == EVAL_WRAP_FULL
 #define mkfifo( path, mode ) _eval_mkfifo( path, mode )
+#endif
 
 /******************************************************************************
  * S_ISFIFO
@@ -808,7 +1593,7 @@ typedef struct {
     int ret;
 } _eval_isfifo_type;
 
-extern _eval_isfifo_type _eval_isfifo_data;
+#define _eval_isfifo_data (*_eval_isfifo_touch())
 
 int _eval_isfifo(mode_t mode);
 
@@ -825,15 +1610,43 @@ typedef struct {
     unsigned int ret;
 } _eval_alarm_type;
 
-extern _eval_alarm_type _eval_alarm_data;
+#define _eval_alarm_data (*_eval_alarm_touch())
 
 unsigned int _eval_alarm( unsigned int seconds );
 
-#define alarm( seconds ) _eval_alarm( seconds )
+#ifndef EVAL_WRAP_alarm
+#define EVAL_WRAP_alarm EVAL_WRAP_DEFAULT
+#endif
 
+#if EVAL_WRAP_alarm == EVAL_WRAP_FULL
+#define alarm( seconds ) _eval_alarm( seconds )
+#endif
 
 /******************************************************************************
- * remove
+ * Virtual clock
+ *****************************************************************************/
+
+/**
+ * @brief Virtual clock used by the sleep(), alarm() and pause() wrappers when
+ * set to ACTION_VIRTUAL
+ * 
+ */
+typedef struct {
+    double now;         // Current virtual time (s)
+    double alarm;       // Virtual time of the pending SIGALRM, < 0 if none
+    int alarms;         // Number of SIGALRM signals delivered
+} eval_vclock_t;
+
+extern eval_vclock_t _eval_vclock;
+
+void eval_vclock_enable( void );
+double eval_vclock( void );
+void eval_vclock_advance( double seconds );
+void eval_vclock_reset( void );
+
+
+/******************************************************************************
+ * remove
  *****************************************************************************/
 typedef struct {
     int action;
@@ -842,11 +1655,17 @@ typedef struct {
     int ret;
 } _eval_remove_type;
 
-extern _eval_remove_type _eval_remove_data;
+#define _eval_remove_data (*_eval_remove_touch())
 
 int _eval_remove(const char * path);
 
+#ifndef EVAL_WRAP_remove
+#define EVAL_WRAP_remove EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_remove == EVAL_WRAP_FULL
 #define remove( path ) _eval_remove( path )
+#endif
 
 /******************************************************************************
  * unlink
@@ -858,11 +1677,17 @@ typedef struct {
     int ret;
 } _eval_unlink_type;
 
-extern _eval_unlink_type _eval_unlink_data;
+#define _eval_unlink_data (*_eval_unlink_touch())
 
 int _eval_unlink(const char * path);
 
+#ifndef EVAL_WRAP_unlink
+#define EVAL_WRAP_unlink EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_unlink == EVAL_WRAP_FULL
 #define unlink( path ) _eval_unlink( path )
+#endif
 
 /******************************************************************************
  * atoi
@@ -874,11 +1699,40 @@ typedef struct {
     int ret;
 } _eval_atoi_type;
 
-extern _eval_atoi_type _eval_atoi_data;
+#define _eval_atoi_data (*_eval_atoi_touch())
 
 int _eval_atoi(const char *nptr);
 
+#ifndef EVAL_WRAP_atoi
+#define EVAL_WRAP_atoi EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_atoi == EVAL_WRAP_FULL
 #define atoi( nptr ) _eval_atoi( nptr )
+#endif
+
+/******************************************************************************
+ * fopen
+ *****************************************************************************/
+typedef struct {
+    int action;
+    int status;
+    char path[ PATH_MAX ];
+    char mode[ 8 ];
+    FILE *ret;
+} _eval_fopen_type;
+
+#define _eval_fopen_data (*_eval_fopen_touch())
+
+FILE *_eval_fopen( const char *restrict path, const char *restrict mode );
+
+#ifndef EVAL_WRAP_fopen
+#define EVAL_WRAP_fopen EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_fopen == EVAL_WRAP_FULL
+#define fopen( path, mode ) _eval_fopen( path, mode )
+#endif
 
 /******************************************************************************
  * fclose
@@ -890,11 +1744,17 @@ typedef struct {
     int ret;
 } _eval_fclose_type;
 
-extern _eval_fclose_type _eval_fclose_data;
+#define _eval_fclose_data (*_eval_fclose_touch())
 
 int _eval_fclose(FILE* stream);
 
+#ifndef EVAL_WRAP_fclose
+#define EVAL_WRAP_fclose EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_fclose == EVAL_WRAP_FULL
 #define fclose( stream ) _eval_fclose( stream )
+#endif
 
 /******************************************************************************
  * execl
@@ -906,13 +1766,19 @@ typedef struct {
     int ret;
 } _eval_execl_type;
 
-extern _eval_execl_type _eval_execl_data;
+#define _eval_execl_data (*_eval_execl_touch())
 
 // The declaration must be different from execl() so that we can then call
 // execv() instead. See the implementation for details.
 int _eval_execl(const char *path, ... );
 
+#ifndef EVAL_WRAP_execl
+#define EVAL_WRAP_execl EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_execl == EVAL_WRAP_FULL
 #define execl( path, arg0, ... ) _eval_execl( path, arg0, __VA_ARGS__ )
+#endif
 
 /******************************************************************************
  * fread
@@ -927,12 +1793,18 @@ typedef struct {
     int ret;
 } _eval_fread_type;
 
-extern _eval_fread_type _eval_fread_data;
+#define _eval_fread_data (*_eval_fread_touch())
 
 size_t _eval_fread(void *restrict ptr, size_t size, size_t nmemb,
                     FILE *restrict stream);
 
+#ifndef EVAL_WRAP_fread
+#define EVAL_WRAP_fread EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_fread == EVAL_WRAP_FULL
 #define fread( ptr, size, nmemb, stream ) _eval_fread( ptr, size, nmemb, stream )
+#endif
 
 
 /******************************************************************************
@@ -949,12 +1821,18 @@ typedef struct {
     int ret;
 } _eval_fwrite_type;
 
-extern _eval_fwrite_type _eval_fwrite_data;
+#define _eval_fwrite_data (*_eval_fwrite_touch())
 
 size_t _eval_fwrite(const void *ptr, size_t size, size_t nmemb,
                      FILE *stream);
 
+#ifndef EVAL_WRAP_fwrite
+#define EVAL_WRAP_fwrite EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_fwrite == EVAL_WRAP_FULL
 #define fwrite( ptr, size, nmemb, stream ) _eval_fwrite( ptr, size, nmemb, stream )
+#endif
 
 /******************************************************************************
  * fseek
@@ -969,11 +1847,820 @@ typedef struct {
     int ret;
 } _eval_fseek_type;
 
-extern _eval_fseek_type _eval_fseek_data;
+#define _eval_fseek_data (*_eval_fseek_touch())
 
 int _eval_fseek(FILE *stream, long offset, int whence);
 
+#ifndef EVAL_WRAP_fseek
+#define EVAL_WRAP_fseek EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_fseek == EVAL_WRAP_FULL
 #define fseek( stream, offset, whence ) _eval_fseek( stream, offset, whence )
+#endif
+
+/******************************************************************************
+ * Virtual filesystem
+ *****************************************************************************/
+
+int eval_vfs_put( const char *path, const void *data, size_t size );
+const void * eval_vfs_get( const char *path, size_t *size );
+int eval_vfs_exists( const char *path );
+int eval_vfs_remove( const char *path );
+void eval_vfs_clear( void );
+void eval_vfs_enable( void );
+
+int _eval_vfs_mkfifo( const char *path, mode_t mode );
+int _eval_vfs_unlink( const char *path );
+FILE * _eval_vfs_fopen( const char *path, const char *mode, int create );
+
+/******************************************************************************
+ * Virtual System V IPC
+ *****************************************************************************/
+
+#ifndef EVAL_VIPC_MAX
+/**
+ * @brief Maximum number of virtual IPC objects of each type (queues,
+ * semaphore arrays, shared memory segments)
+ * 
+ */
+#define EVAL_VIPC_MAX 64
+#endif
+
+#ifndef EVAL_VIPC_MSGMAX
+/**
+ * @brief Maximum size of a virtual message (bytes)
+ * 
+ */
+#define EVAL_VIPC_MSGMAX 8192
+#endif
+
+#ifndef EVAL_VIPC_MSGMNB
+/**
+ * @brief Default maximum size of a virtual message queue (bytes)
+ * 
+ */
+#define EVAL_VIPC_MSGMNB 16384
+#endif
+
+/**
+ * @brief Maximum value of a virtual semaphore
+ * 
+ */
+#define EVAL_VIPC_SEMVMX 32767
+
+/**
+ * @brief Maximum number of operations in a single virtual semop() call
+ * 
+ */
+#define EVAL_VIPC_SEMOPM 500
+
+int _eval_vipc_msgget( key_t key, int msgflg );
+int _eval_vipc_msgsnd( int msqid, const void *msgp, size_t msgsz, int msgflg );
+ssize_t _eval_vipc_msgrcv( int msqid, void *msgp, size_t msgsz, long msgtyp, int msgflg );
+int _eval_vipc_msgctl( int msqid, int cmd, struct msqid_ds *buf );
+int _eval_vipc_semget( key_t key, int nsems, int semflg );
+int _eval_vipc_semctl( int semid, int semnum, int cmd, union semun arg );
+int _eval_vipc_semop( int semid, struct sembuf *sops, size_t nsops );
+int _eval_vipc_shmget( key_t key, size_t size, int shmflg );
+void * _eval_vipc_shmat( int shmid, const void *shmaddr, int shmflg );
+int _eval_vipc_shmdt( const void *shmaddr );
+int _eval_vipc_shmctl( int shmid, int cmd, struct shmid_ds *buf );
+
+void eval_ipc_virtual( void );
+void eval_ipc_release( void );
+
+/******************************************************************************
+ * malloc / calloc / realloc / free
+ *****************************************************************************/
+
+#ifndef EVAL_LEAK_CHECK
+/**
+ * @brief Report memory leaks at the end of every EVAL_CATCH* macro. May be
+ * disabled (0) when the code being tested legitimately returns allocated
+ * memory.
+ * 
+ */
+#define EVAL_LEAK_CHECK 1
+#endif
+
+#ifndef EVAL_HEAP_QUARANTINE
+/**
+ * @brief Number of freed blocks kept allocated, so that their addresses are
+ * not reused and freeing them again is detected as a double free
+ * 
+ */
+#define EVAL_HEAP_QUARANTINE 256
+#endif
+
+#ifndef EVAL_HEAP_QUARANTINE_BYTES
+/**
+ * @brief Maximum size of the blocks in quarantine (bytes)
+ * 
+ */
+#define EVAL_HEAP_QUARANTINE_BYTES ( 16 * 1024 * 1024 )
+#endif
+
+/**
+ * @brief Heap usage of the code being tested
+ * 
+ * All values except .live / .nlive refer to the last EVAL_CATCH* macro
+ */
+typedef struct {
+    int allocs;         // Number of allocations (malloc / calloc / realloc)
+    int frees;          // Number of blocks freed
+    size_t bytes;       // Total bytes allocated
+    size_t peak;        // Peak live heap (bytes)
+    int nleaks;         // Blocks allocated and not freed
+    size_t leaked;      // Bytes allocated and not freed
+    int double_frees;   // Attempts to free a block already freed
+
+    int nlive;          // Live blocks (tracked)
+    size_t live;        // Live heap (bytes, tracked)
+
+    int leakcheck;      // Report leaks at the end of EVAL_CATCH* macros
+} eval_heap_t;
+
+extern eval_heap_t _eval_heap;
+
+void _eval_heap_start( void );
+void _eval_heap_stop( void );
+void eval_heap_print( void );
+
+typedef struct {
+    int action;
+    int status;
+    void *ret;
+
+    size_t size;
+} _eval_malloc_type;
+
+#define _eval_malloc_data (*_eval_malloc_touch())
+
+void *_eval_malloc( size_t size );
+
+#ifndef EVAL_WRAP_malloc
+#define EVAL_WRAP_malloc EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_malloc == EVAL_WRAP_FULL
+#define malloc( size ) _eval_malloc( size )
+#endif
+
+typedef struct {
+    int action;
+    int status;
+    void *ret;
+
+    size_t nmemb;
+    size_t size;
+} _eval_calloc_type;
+
+#define _eval_calloc_data (*_eval_calloc_touch())
+
+void *_eval_calloc( size_t nmemb, size_t size );
+
+#ifndef EVAL_WRAP_calloc
+#define EVAL_WRAP_calloc EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_calloc == EVAL_WRAP_FULL
+#define calloc( nmemb, size ) _eval_calloc( nmemb, size )
+#endif
+
+typedef struct {
+    int action;
+    int status;
+    void *ret;
+
+    void *ptr;
+    size_t size;
+} _eval_realloc_type;
+
+#define _eval_realloc_data (*_eval_realloc_touch())
+
+void *_eval_realloc( void *ptr, size_t size );
+
+#ifndef EVAL_WRAP_realloc
+#define EVAL_WRAP_realloc EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_realloc == EVAL_WRAP_FULL
+#define realloc( ptr, size ) _eval_realloc( ptr, size )
+#endif
+
+typedef struct {
+    int action;
+    int status;
+
+    void *ptr;
+} _eval_free_type;
+
+#define _eval_free_data (*_eval_free_touch())
+
+void _eval_free( void *ptr );
+
+#ifndef EVAL_WRAP_free
+#define EVAL_WRAP_free EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_free == EVAL_WRAP_FULL
+#define free( ptr ) _eval_free( ptr )
+#endif
+
+/******************************************************************************
+ * Threads
+ *****************************************************************************/
+
+// Maximum number of threads tracked simultaneously
+#ifndef EVAL_THREADS_MAX
+#define EVAL_THREADS_MAX 64
+#endif
+
+// Time allowed for tracked threads to finish at the end of a block, and to
+// terminate when cancelled (s)
+#ifndef EVAL_THREADS_GRACE
+#define EVAL_THREADS_GRACE 0.5
+#endif
+
+enum EVAL_THREAD_STATES {
+    EVAL_THREAD_FREE = 0,
+    EVAL_THREAD_RUNNING,
+    EVAL_THREAD_DONE
+};
+
+typedef struct {
+    pthread_t thread;
+    void *(*start)( void * );
+    void *arg;
+    void *ret;
+
+    sigjmp_buf jmp;     // Catch point of the thread, see _eval_longjmp()
+    int state;          // EVAL_THREAD_*
+    int cancel;         // Cancellation requested
+    int detached;       // Created in the detached state
+    int stat;           // EVAL_CATCH_* code that terminated the thread, 0 if none
+    void *altstack;     // Alternate signal stack of the thread, NULL if none
+} _eval_thread_type;
+
+typedef struct {
+    pthread_t catch;    // Thread running the EVAL_CATCH* code
+    int live;           // Tracked threads not yet joined
+    int created;        // Threads created in the last EVAL_CATCH* block
+    int cancelled;      // Threads cancelled at the end of the last EVAL_CATCH* block
+    int stuck;          // Threads that could not be cancelled
+    int fault;          // EVAL_CATCH_* code raised by a thread, 0 if none
+    int pending;        // Fault not yet delivered to the catch thread
+    int closing;        // Set while tracked threads are being cancelled
+    int heap_lock;      // Serializes heap tracking while threads are live
+
+    int sigprof;        // SIGPROF handler installed for fault delivery
+    struct sigaction sigaction;
+
+    _eval_thread_type list[ EVAL_THREADS_MAX ];
+} _eval_threads_type;
+
+extern _eval_threads_type _eval_threads;
+extern _EVAL_THREAD_LOCAL _eval_thread_type *_eval_thread_self;
+
+void _eval_threads_stop( void );
+void eval_threads_print( void );
+
+/******************************************************************************
+ * pthread_create
+ *****************************************************************************/
+typedef struct {
+    int action;
+    int status;
+    int ret;
+} _eval_pthread_create_type;
+
+#define _eval_pthread_create_data (*_eval_pthread_create_touch())
+
+int _eval_pthread_create( pthread_t *restrict thread, const pthread_attr_t *restrict attr,
+    void *(*start)( void * ), void *restrict arg );
+
+#ifndef EVAL_WRAP_pthread_create
+#define EVAL_WRAP_pthread_create EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_pthread_create == EVAL_WRAP_FULL
+#define pthread_create( thread, attr, start, arg ) _eval_pthread_create( thread, attr, start, arg )
+#endif
+
+/******************************************************************************
+ * pthread_join
+ *****************************************************************************/
+typedef struct {
+    int action;
+    int status;
+    int ret;
+
+    int faulted;        // Joined threads that were terminated by a fault
+} _eval_pthread_join_type;
+
+#define _eval_pthread_join_data (*_eval_pthread_join_touch())
+
+int _eval_pthread_join( pthread_t thread, void **retval );
+
+#ifndef EVAL_WRAP_pthread_join
+#define EVAL_WRAP_pthread_join EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_pthread_join == EVAL_WRAP_FULL
+#define pthread_join( thread, retval ) _eval_pthread_join( thread, retval )
+#endif
+
+/******************************************************************************
+ * pthread_mutex_lock
+ *****************************************************************************/
+typedef struct {
+    int action;
+    int status;
+    int ret;
+
+    int contended;      // Calls that found the mutex locked by another thread
+} _eval_pthread_mutex_lock_type;
+
+#define _eval_pthread_mutex_lock_data (*_eval_pthread_mutex_lock_touch())
+
+int _eval_pthread_mutex_lock( pthread_mutex_t *mutex );
+
+#ifndef EVAL_WRAP_pthread_mutex_lock
+#define EVAL_WRAP_pthread_mutex_lock EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_pthread_mutex_lock == EVAL_WRAP_FULL
+#define pthread_mutex_lock( mutex ) _eval_pthread_mutex_lock( mutex )
+#endif
+
+/******************************************************************************
+ * pthread_mutex_trylock
+ *****************************************************************************/
+typedef struct {
+    int action;
+    int status;
+    int ret;
+
+    int busy;           // Calls that returned EBUSY
+} _eval_pthread_mutex_trylock_type;
+
+#define _eval_pthread_mutex_trylock_data (*_eval_pthread_mutex_trylock_touch())
+
+int _eval_pthread_mutex_trylock( pthread_mutex_t *mutex );
+
+#ifndef EVAL_WRAP_pthread_mutex_trylock
+#define EVAL_WRAP_pthread_mutex_trylock EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_pthread_mutex_trylock == EVAL_WRAP_FULL
+#define pthread_mutex_trylock( mutex ) _eval_pthread_mutex_trylock( mutex )
+#endif
+
+/******************************************************************************
+ * pthread_mutex_unlock
+ *****************************************************************************/
+typedef struct {
+    int action;
+    int status;
+    int ret;
+} _eval_pthread_mutex_unlock_type;
+
+#define _eval_pthread_mutex_unlock_data (*_eval_pthread_mutex_unlock_touch())
+
+int _eval_pthread_mutex_unlock( pthread_mutex_t *mutex );
+
+#ifndef EVAL_WRAP_pthread_mutex_unlock
+#define EVAL_WRAP_pthread_mutex_unlock EVAL_WRAP_DEFAULT
+#endif
+
+#if EVAL_WRAP_pthread_mutex_unlock == EVAL_WRAP_FULL
+#define pthread_mutex_unlock( mutex ) _eval_pthread_mutex_unlock( mutex )
+#endif
+
+/******************************************************************************
+ * Wrapper registry
+ *****************************************************************************/
+
+/**
+ * @brief List of all wrapped functions: X( name, ID, default action )
+ * 
+ * The default action is the one set by eval_reset(). eval_reset_vars() sets
+ * the action of all functions to ACTION_DEFAULT.
+ */
+#define EVAL_WRAPPERS( X ) \
+    X( exit,      EXIT,      ACTION_DEFAULT ) \
+    X( abort,     ABORT,     ACTION_DEFAULT ) \
+    X( sleep,     SLEEP,     ACTION_DEFAULT ) \
+    X( fork,      FORK,      ACTION_DEFAULT ) \
+    X( wait,      WAIT,      ACTION_BLOCK   ) \
+    X( waitpid,   WAITPID,   ACTION_BLOCK   ) \
+    X( kill,      KILL,      ACTION_PROTECT ) \
+    X( raise,     RAISE,     ACTION_BLOCK   ) \
+    X( signal,    SIGNAL,    ACTION_DEFAULT ) \
+    X( sigaction, SIGACTION, ACTION_DEFAULT ) \
+    X( pause,     PAUSE,     ACTION_BLOCK   ) \
+    X( alarm,     ALARM,     ACTION_DEFAULT ) \
+    X( msgget,    MSGGET,    ACTION_DEFAULT ) \
+    X( msgsnd,    MSGSND,    ACTION_DEFAULT ) \
+    X( msgrcv,    MSGRCV,    ACTION_DEFAULT ) \
+    X( msgctl,    MSGCTL,    ACTION_DEFAULT ) \
+    X( semget,    SEMGET,    ACTION_DEFAULT ) \
+    X( semctl,    SEMCTL,    ACTION_DEFAULT ) \
+    X( semop,     SEMOP,     ACTION_DEFAULT ) \
+    X( shmget,    SHMGET,    ACTION_DEFAULT ) \
+    X( shmat,     SHMAT,     ACTION_DEFAULT ) \
+    X( shmdt,     SHMDT,     ACTION_DEFAULT ) \
+    X( shmctl,    SHMCTL,    ACTION_DEFAULT ) \
+    X( mkfifo,    MKFIFO,    ACTION_DEFAULT ) \
+    X( isfifo,    ISFIFO,    ACTION_DEFAULT ) \
+    X( remove,    REMOVE,    ACTION_DEFAULT ) \
+    X( unlink,    UNLINK,    ACTION_DEFAULT ) \
+    X( atoi,      ATOI,      ACTION_DEFAULT ) \
+    X( fclose,    FCLOSE,    ACTION_DEFAULT ) \
+    X( fread,     FREAD,     ACTION_DEFAULT ) \
+    X( fwrite,    FWRITE,    ACTION_DEFAULT ) \
+    X( fseek,     FSEEK,     ACTION_DEFAULT ) \
+    X( execl,     EXECL,     ACTION_BLOCK   ) \
+    X( malloc,    MALLOC,    ACTION_DEFAULT ) \
+    X( calloc,    CALLOC,    ACTION_DEFAULT ) \
+    X( realloc,   REALLOC,   ACTION_DEFAULT ) \
+    X( free,      FREE,      ACTION_DEFAULT ) \
+    X( fopen,     FOPEN,     ACTION_DEFAULT ) \
+    X( pthread_create,        PTHREAD_CREATE,        ACTION_DEFAULT ) \
+    X( pthread_join,          PTHREAD_JOIN,          ACTION_DEFAULT ) \
+    X( pthread_mutex_lock,    PTHREAD_MUTEX_LOCK,    ACTION_DEFAULT ) \
+    X( pthread_mutex_trylock, PTHREAD_MUTEX_TRYLOCK, ACTION_DEFAULT ) \
+    X( pthread_mutex_unlock,  PTHREAD_MUTEX_UNLOCK,  ACTION_DEFAULT )
+
+#define _EVAL_WRAPPER_ID( name, ID, action ) EVAL_WRAPPER_##ID,
+
+enum EVAL_WRAPPER_FUNCS {
+    EVAL_WRAPPERS( _EVAL_WRAPPER_ID )
+    EVAL_WRAPPER_NFUNCS
+};
+
+/**
+ * @brief Fields common to all _eval_*_data variables
+ * 
+ */
+typedef struct {
+    int action;
+    int status;
+} _eval_wrapper_head_type;
+
+/**
+ * @brief Wrapper state generations
+ * 
+ * Resetting the wrappers only increments _eval_wrapper_gen; the state of each
+ * wrapper is reinitialized the first time it is accessed after a reset.
+ */
+extern unsigned int _eval_wrapper_gen;
+extern unsigned int _eval_wrapper_gens[ EVAL_WRAPPER_NFUNCS ];
+
+void _eval_wrapper_init( int id );
+
+#define _EVAL_WRAPPER_ACCESSOR( name, ID, action ) \
+extern _eval_##name##_type _eval_##name##_store; \
+static inline _eval_##name##_type * _eval_##name##_touch( void ) { \
+    if ( __atomic_load_n( &_eval_wrapper_gens[ EVAL_WRAPPER_##ID ], __ATOMIC_ACQUIRE ) != _eval_wrapper_gen ) \
+        _eval_wrapper_init( EVAL_WRAPPER_##ID ); \
+    return &_eval_##name##_store; \
+}
+
+EVAL_WRAPPERS( _EVAL_WRAPPER_ACCESSOR )
+
+int eval_wrapper_find( const char *name );
+const char * eval_wrapper_name( int id );
+void * eval_wrapper_data( int id );
+int eval_wrapper_set_action( const char *name, int action );
+int eval_wrapper_get_action( const char *name );
+int eval_wrapper_status( const char *name );
+void eval_wrapper_print( void );
+
+/******************************************************************************
+ * Wrapper specialization
+ *****************************************************************************/
+
+#ifndef EVAL_NOWRAP
+
+/**
+ * @brief Generates a static inline wrapper that only counts calls (in the
+ * .status field of the wrapper variable) before calling the base function
+ */
+#define _EVAL_WRAP_COUNTED( name, type, params, args ) \
+static inline type _eval_##name##_counted params { \
+    _eval_##name##_touch() -> status++; \
+    return name args; \
+}
+
+#if EVAL_WRAP_sleep == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( sleep, unsigned int, ( unsigned int seconds ), ( seconds ) )
+#define sleep( seconds ) _eval_sleep_counted( seconds )
+#endif
+
+#if EVAL_WRAP_fork == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( fork, pid_t, ( void ), () )
+#define fork() _eval_fork_counted()
+#endif
+
+#if EVAL_WRAP_wait == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( wait, pid_t, ( int *stat_loc ), ( stat_loc ) )
+#define wait( stat_loc ) _eval_wait_counted( stat_loc )
+#endif
+
+#if EVAL_WRAP_waitpid == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( waitpid, pid_t, ( pid_t pid, int *stat_loc, int options ), ( pid, stat_loc, options ) )
+#define waitpid( pid, stat_loc, options ) _eval_waitpid_counted( pid, stat_loc, options )
+#endif
+
+#if EVAL_WRAP_kill == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( kill, int, ( pid_t pid, int sig ), ( pid, sig ) )
+#define kill( pid, sig ) _eval_kill_counted( pid, sig )
+#endif
+
+#if EVAL_WRAP_raise == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( raise, int, ( int sig ), ( sig ) )
+#define raise( sig ) _eval_raise_counted( sig )
+#endif
+
+#if EVAL_WRAP_signal == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( signal, sighandler_t, ( int signum, sighandler_t handler ), ( signum, handler ) )
+#define signal( signum, handler ) _eval_signal_counted( signum, handler )
+#endif
+
+#if EVAL_WRAP_sigaction == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( sigaction, int, ( int signum, const struct sigaction *act, struct sigaction *oldact ), ( signum, act, oldact ) )
+#define sigaction( signum, act, oldact ) _eval_sigaction_counted( signum, act, oldact )
+#endif
+
+#if EVAL_WRAP_pause == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( pause, int, ( void ), () )
+#define pause() _eval_pause_counted()
+#endif
+
+#if EVAL_WRAP_alarm == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( alarm, unsigned int, ( unsigned int seconds ), ( seconds ) )
+#define alarm( seconds ) _eval_alarm_counted( seconds )
+#endif
+
+#if EVAL_WRAP_msgget == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( msgget, int, ( key_t key, int msgflg ), ( key, msgflg ) )
+#define msgget( key, msgflg ) _eval_msgget_counted( key, msgflg )
+#endif
+
+#if EVAL_WRAP_msgsnd == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( msgsnd, int, ( int msqid, const void *msgp, size_t msgsz, int msgflg ), ( msqid, msgp, msgsz, msgflg ) )
+#define msgsnd( msqid, msgp, msgsz, msgflg ) _eval_msgsnd_counted( msqid, msgp, msgsz, msgflg )
+#endif
+
+#if EVAL_WRAP_msgrcv == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( msgrcv, ssize_t, ( int msqid, void *msgp, size_t msgsz, long msgtyp, int msgflg ), ( msqid, msgp, msgsz, msgtyp, msgflg ) )
+#define msgrcv( msqid, msgp, msgsz, msgtyp, msgflg ) _eval_msgrcv_counted( msqid, msgp, msgsz, msgtyp, msgflg )
+#endif
+
+#if EVAL_WRAP_msgctl == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( msgctl, int, ( int msqid, int cmd, struct msqid_ds *buf ), ( msqid, cmd, buf ) )
+#define msgctl( msqid, cmd, buf ) _eval_msgctl_counted( msqid, cmd, buf )
+#endif
+
+#if EVAL_WRAP_semget == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( semget, int, ( key_t key, int nsems, int semflg ), ( key, nsems, semflg ) )
+#define semget( key, nsems, semflg ) _eval_semget_counted( key, nsems, semflg )
+#endif
+
+#if EVAL_WRAP_semctl == EVAL_WRAP_COUNT
+#define semctl( semid, ... ) ( _eval_semctl_touch() -> status++, semctl( semid, __VA_ARGS__ ) )
+#endif
+
+#if EVAL_WRAP_semop == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( semop, int, ( int semid, struct sembuf *sops, size_t nsops ), ( semid, sops, nsops ) )
+#define semop( semid, sops, nsops ) _eval_semop_counted( semid, sops, nsops )
+#endif
+
+#if EVAL_WRAP_shmget == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( shmget, int, ( key_t key, size_t size, int shmflg ), ( key, size, shmflg ) )
+#define shmget( key, size, shmflg ) _eval_shmget_counted( key, size, shmflg )
+#endif
+
+#if EVAL_WRAP_shmat == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( shmat, void *, ( int shmid, const void *shmaddr, int shmflg ), ( shmid, shmaddr, shmflg ) )
+#define shmat( shmid, shmaddr, shmflg ) _eval_shmat_counted( shmid, shmaddr, shmflg )
+#endif
+
+#if EVAL_WRAP_shmdt == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( shmdt, int, ( const void *shmaddr ), ( shmaddr ) )
+#define shmdt( shmaddr ) _eval_shmdt_counted( shmaddr )
+#endif
+
+#if EVAL_WRAP_shmctl == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( shmctl, int, ( int shmid, int cmd, struct shmid_ds *buf ), ( shmid, cmd, buf ) )
+#define shmctl( shmid, cmd, buf ) _eval_shmctl_counted( shmid, cmd, buf )
+#endif
+
+#if EVAL_WRAP_mkfifo == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( mkfifo, int, ( const char *path, mode_t mode ), ( path, mode ) )
+#define mkfifo( path, mode ) _eval_mkfifo_counted( path, mode )
+#endif
+
+#if EVAL_WRAP_remove == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( remove, int, ( const char *path ), ( path ) )
+#define remove( path ) _eval_remove_counted( path )
+#endif
+
+#if EVAL_WRAP_unlink == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( unlink, int, ( const char *path ), ( path ) )
+#define unlink( path ) _eval_unlink_counted( path )
+#endif
+
+#if EVAL_WRAP_atoi == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( atoi, int, ( const char *nptr ), ( nptr ) )
+#define atoi( nptr ) _eval_atoi_counted( nptr )
+#endif
+
+#if EVAL_WRAP_fopen == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( fopen, FILE *, ( const char *restrict path, const char *restrict mode ), ( path, mode ) )
+#define fopen( path, mode ) _eval_fopen_counted( path, mode )
+#endif
+
+#if EVAL_WRAP_fclose == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( fclose, int, ( FILE *stream ), ( stream ) )
+#define fclose( stream ) _eval_fclose_counted( stream )
+#endif
+
+#if EVAL_WRAP_pthread_create == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( pthread_create, int, ( pthread_t *restrict thread, const pthread_attr_t *restrict attr,
+    void *(*start)( void * ), void *restrict arg ), ( thread, attr, start, arg ) )
+#define pthread_create( thread, attr, start, arg ) _eval_pthread_create_counted( thread, attr, start, arg )
+#endif
+
+#if EVAL_WRAP_pthread_join == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( pthread_join, int, ( pthread_t thread, void **retval ), ( thread, retval ) )
+#define pthread_join( thread, retval ) _eval_pthread_join_counted( thread, retval )
+#endif
+
+#if EVAL_WRAP_pthread_mutex_lock == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( pthread_mutex_lock, int, ( pthread_mutex_t *mutex ), ( mutex ) )
+#define pthread_mutex_lock( mutex ) _eval_pthread_mutex_lock_counted( mutex )
+#endif
+
+#if EVAL_WRAP_pthread_mutex_trylock == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( pthread_mutex_trylock, int, ( pthread_mutex_t *mutex ), ( mutex ) )
+#define pthread_mutex_trylock( mutex ) _eval_pthread_mutex_trylock_counted( mutex )
+#endif
+
+#if EVAL_WRAP_pthread_mutex_unlock == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( pthread_mutex_unlock, int, ( pthread_mutex_t *mutex ), ( mutex ) )
+#define pthread_mutex_unlock( mutex ) _eval_pthread_mutex_unlock_counted( mutex )
+#endif
+
+#if EVAL_WRAP_execl == EVAL_WRAP_COUNT
+#define execl( path, arg0, ... ) ( _eval_execl_touch() -> status++, execl( path, arg0, __VA_ARGS__ ) )
+#endif
+
+#if EVAL_WRAP_fread == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( fread, size_t, ( void *restrict ptr, size_t size, size_t nmemb, FILE *restrict stream ), ( ptr, size, nmemb, stream ) )
+#define fread( ptr, size, nmemb, stream ) _eval_fread_counted( ptr, size, nmemb, stream )
+#endif
+
+#if EVAL_WRAP_fwrite == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( fwrite, size_t, ( const void *ptr, size_t size, size_t nmemb, FILE *stream ), ( ptr, size, nmemb, stream ) )
+#define fwrite( ptr, size, nmemb, stream ) _eval_fwrite_counted( ptr, size, nmemb, stream )
+#endif
+
+#if EVAL_WRAP_fseek == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( fseek, int, ( FILE *stream, long offset, int whence ), ( stream, offset, whence ) )
+#define fseek( stream, offset, whence ) _eval_fseek_counted( stream, offset, whence )
+#endif
+
+#if EVAL_WRAP_malloc == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( malloc, void *, ( size_t size ), ( size ) )
+#define malloc( size ) _eval_malloc_counted( size )
+#endif
+
+#if EVAL_WRAP_calloc == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( calloc, void *, ( size_t nmemb, size_t size ), ( nmemb, size ) )
+#define calloc( nmemb, size ) _eval_calloc_counted( nmemb, size )
+#endif
+
+#if EVAL_WRAP_realloc == EVAL_WRAP_COUNT
+_EVAL_WRAP_COUNTED( realloc, void *, ( void *ptr, size_t size ), ( ptr, size ) )
+#define realloc( ptr, size ) _eval_realloc_counted( ptr, size )
+#endif
+
+#if EVAL_WRAP_free == EVAL_WRAP_COUNT
+static inline void _eval_free_counted( void *ptr ) {
+    _eval_free_touch() -> status++;
+    free( ptr );
+}
+#define free( ptr ) _eval_free_counted( ptr )
+#endif
+
+#endif // EVAL_NOWRAP
+
+/******************************************************************************
+ * Wrapper scripts
+ *****************************************************************************/
+
+#ifndef EVAL_SCRIPT_SIZE
+/**
+ * @brief Maximum number of steps in a wrapper script
+ * 
+ */
+#define EVAL_SCRIPT_SIZE 64
+#endif
+
+/**
+ * @brief A single step of a wrapper script, consumed by one (or .repeat)
+ * call(s) to the wrapped function
+ * 
+ */
+typedef struct {
+    int action;             // .action value used for the call
+    int setret;             // If set, the call returns .ret
+    intptr_t ret;           // Return value (if .setret is set)
+    int err;                // If not 0, errno is set to this value on return
+    const void *payload;    // Payload for ACTION_INJECT (msgsnd(), msgrcv()), may be NULL
+    size_t size;            // Payload size (msgsz)
+    int repeat;             // Number of calls using this step (values <= 1 mean a single call)
+} eval_step_t;
+
+/**
+ * @brief Behavior when all the steps of a script have been consumed
+ * 
+ */
+enum EVAL_SCRIPT_MODES {
+    EVAL_SCRIPT_FALLBACK = 0,   // Restore the .action value from before the script started
+    EVAL_SCRIPT_LAST,           // Keep repeating the last step
+    EVAL_SCRIPT_CYCLE           // Restart from the first step
+};
+
+typedef struct {
+    unsigned int gen;       // Wrapper generation the script belongs to
+    int mode;               // EVAL_SCRIPT_MODES
+    int nsteps;             // Number of steps
+    int pos;                // Current step
+    int count;              // Number of calls consumed by current step
+    int started;            // Script has started, .fallback is valid
+    int fallback;           // .action value from before the script started
+    eval_step_t steps[ EVAL_SCRIPT_SIZE ];
+} _eval_script_type;
+
+const eval_step_t * _eval_script_begin( int id );
+intptr_t _eval_script_end( const eval_step_t *step, intptr_t ret );
+
+int eval_script_push( int id, eval_step_t step );
+int eval_script_action( int id, int action, int repeat );
+int eval_script_return( int id, intptr_t ret, int err );
+int eval_script_mode( int id, int mode );
+void eval_script_clear( int id );
+int eval_script_remaining( int id );
+
+/******************************************************************************
+ * Capture store
+ *****************************************************************************/
+
+#ifndef EVAL_CAPTURE_CHUNK
+/**
+ * @brief Size of capture arena chunks (bytes)
+ * 
+ */
+#define EVAL_CAPTURE_CHUNK 65536
+#endif
+
+#ifndef EVAL_CAPTURE_SHMS
+/**
+ * @brief Maximum number of shared memory attachments tracked for shmdt()
+ * snapshots
+ * 
+ */
+#define EVAL_CAPTURE_SHMS 64
+#endif
+
+/**
+ * @brief Payload captured by a wrapped function
+ * 
+ * The data is stored in the capture arena and remains valid until the next
+ * eval_reset() / eval_reset_vars() / eval_capture_release() call.
+ */
+typedef struct {
+    int call;           // Call number (.status value of the wrapper)
+    long seq;           // Global capture sequence number
+    const void *data;   // Captured data
+    size_t size;        // Size of captured data (bytes)
+} eval_capture_t;
+
+void * _eval_capture_alloc( size_t size );
+void * _eval_capture_add( int id, int call, const void *data, size_t size );
+void _eval_capture_shmat( const void *shmaddr, int shmid );
+void _eval_capture_shm_track( const void *shmaddr, size_t size );
+void _eval_capture_shmdt( const void *shmaddr, int call, int detached );
+
+int eval_capture_count( int id );
+const eval_capture_t * eval_capture_get( int id, int n );
+const eval_capture_t * eval_capture_call( int id, int call );
+size_t eval_capture_bytes( void );
+void eval_capture_release( void );
 
 /******************************************************************************
  * Undefine wrapper macros
@@ -995,6 +2682,8 @@ int _eval_fseek(FILE *stream, long offset, int whence);
 #undef kill
 #undef raise
 #undef fork
+#undef wait
+#undef waitpid
 #undef signal
 #undef sigaction
 #undef pause
@@ -1025,12 +2714,23 @@ int _eval_fseek(FILE *stream, long offset, int whence);
 #undef unlink
 
 #undef atoi
+#undef fopen
+#undef pthread_create
+#undef pthread_join
+#undef pthread_mutex_lock
+#undef pthread_mutex_trylock
+#undef pthread_mutex_unlock
 #undef fclose
 #undef execl
 #undef fread
 #undef fwrite
 #undef fseek
 
+#undef malloc
+#undef calloc
+#undef realloc
+#undef free
+
 #endif
 
 #endif